@@ -329,6 +329,17 @@ bool SX1272IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh
     return status;
 }
 
+void SX1272StartCarrierSense( RadioModems_t modem, uint32_t freq )
+{
+    SX1272SetModem( modem );
+
+    SX1272SetChannel( freq );
+
+    // The receiver only runs for the RSSI, its interrupts are ignored
+    SX1272.Settings.State = RF_IDLE;
+    SX1272SetOpMode( RF_OPMODE_RECEIVER );
+}
+
 uint32_t SX1272Random( void )
 {
     uint8_t i;
@@ -662,49 +673,40 @@ uint32_t SX1272GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
     {
     case MODEM_FSK:
         {
-            airTime = (uint32_t) round( ( 8 * ( SX1272.Settings.Fsk.PreambleLen +
-                                     ( ( SX1272Read( REG_SYNCCONFIG ) & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1 ) +
-                                     ( ( SX1272.Settings.Fsk.FixLen == 0x01 ) ? 0.0 : 1.0 ) +
-                                     ( ( ( SX1272Read( REG_PACKETCONFIG1 ) & ~RF_PACKETCONFIG1_ADDRSFILTERING_MASK ) != 0x00 ) ? 1.0 : 0 ) +
-                                     pktLen +
-                                     ( ( SX1272.Settings.Fsk.CrcOn == 0x01 ) ? 2.0 : 0 ) ) /
-                                     SX1272.Settings.Fsk.Datarate ) * 1000 );
+            // Packet length in bits, the time on air is rounded to the nearest ms
+            uint32_t nBits = 8 * ( SX1272.Settings.Fsk.PreambleLen +
+                                 ( ( SX1272Read( REG_SYNCCONFIG ) & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1 ) +
+                                 ( ( SX1272.Settings.Fsk.FixLen == 0x01 ) ? 0 : 1 ) +
+                                 ( ( ( SX1272Read( REG_PACKETCONFIG1 ) & ~RF_PACKETCONFIG1_ADDRSFILTERING_MASK ) != 0x00 ) ? 1 : 0 ) +
+                                 pktLen +
+                                 ( ( SX1272.Settings.Fsk.CrcOn == 0x01 ) ? 2 : 0 ) );
+
+            airTime = ( 2000 * nBits + SX1272.Settings.Fsk.Datarate ) / ( 2 * SX1272.Settings.Fsk.Datarate );
         }
         break;
     case MODEM_LORA:
         {
-            double bw = 0.0;
-            switch( SX1272.Settings.LoRa.Bandwidth )
+            // REMARK: When using LoRa modem only bandwidths 125, 250 and 500 kHz are supported
+            // Quarter of the symbol time in us, 2^SF / BW being exact for these
+            // bandwidths [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+            uint32_t tQuarterSymbol = ( ( uint32_t )1 << ( SX1272.Settings.LoRa.Datarate + 3 - SX1272.Settings.LoRa.Bandwidth ) ) / 4;
+            // Symbol length of payload
+            int32_t nBits = 8 * pktLen - 4 * SX1272.Settings.LoRa.Datarate +
+                            28 + 16 * SX1272.Settings.LoRa.CrcOn -
+                            ( SX1272.Settings.LoRa.FixLen ? 20 : 0 );
+            int32_t nBitsPerSymbol = 4 * ( SX1272.Settings.LoRa.Datarate -
+                                     ( ( SX1272.Settings.LoRa.LowDatarateOptimize > 0 ) ? 2 : 0 ) );
+            uint32_t nPayload = 8;
+
+            if( nBits > 0 )
             {
-            case 0: // 125 kHz
-                bw = 125000;
-                break;
-            case 1: // 250 kHz
-                bw = 250000;
-                break;
-            case 2: // 500 kHz
-                bw = 500000;
-                break;
+                nPayload += ( ( nBits + nBitsPerSymbol - 1 ) / nBitsPerSymbol ) *
+                            ( SX1272.Settings.LoRa.Coderate + 4 );
             }
-
-            // Symbol rate : time for one symbol (secs)
-            double rs = bw / ( 1 << SX1272.Settings.LoRa.Datarate );
-            double ts = 1 / rs;
-            // time of preamble
-            double tPreamble = ( SX1272.Settings.LoRa.PreambleLen + 4.25 ) * ts;
-            // Symbol length of payload and time
-            double tmp = ceil( ( 8 * pktLen - 4 * SX1272.Settings.LoRa.Datarate +
-                                 28 + 16 * SX1272.Settings.LoRa.CrcOn -
-                                 ( SX1272.Settings.LoRa.FixLen ? 20 : 0 ) ) /
-                                 ( double )( 4 * ( SX1272.Settings.LoRa.Datarate -
-                                 ( ( SX1272.Settings.LoRa.LowDatarateOptimize > 0 ) ? 2 : 0 ) ) ) ) *
-                                 ( SX1272.Settings.LoRa.Coderate + 4 );
-            double nPayload = 8 + ( ( tmp > 0 ) ? tmp : 0 );
-            double tPayload = nPayload * ts;
-            // Time on air
-            double tOnAir = tPreamble + tPayload;
-            // return ms secs
-            airTime = (uint32_t) floor( tOnAir * 1000 + 0.999 );
+            // Time on air in us, the preamble lasting PreambleLen + 4.25 symbols
+            airTime = ( 4 * SX1272.Settings.LoRa.PreambleLen + 17 + 4 * nPayload ) * tQuarterSymbol;
+            // return ms secs, rounded up
+            airTime = ( airTime + 999 ) / 1000;
         }
         break;
     }
@@ -304,6 +304,15 @@ void SX1272SetChannel( uint32_t freq );
  */
 bool SX1272IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
 
+/*!
+ * \brief Sets the radio in reception on the channel without reception
+ *        interrupts, SX1272ReadRssi then measures it
+ *
+ * \param [IN] modem      Radio modem to be used [0: FSK, 1: LoRa]
+ * \param [IN] freq       Channel RF frequency
+ */
+void SX1272StartCarrierSense( RadioModems_t modem, uint32_t freq );
+
 /*!
  * \brief Generates a 32 bits random value based on the RSSI readings
  *
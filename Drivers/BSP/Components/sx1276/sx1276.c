@@ -54,6 +54,8 @@ Maintainer: Miguel Luis, Gregory Cristian and Wael Guibene
 #include "sx1276.h"
 #include "timeServer.h"
 #include "delay.h"
+#include "energy.h"
+#include "trace.h"
 
 /*
  * Local types definition
@@ -78,6 +80,17 @@ typedef struct
     uint8_t  RegValue;
 }FskBandwidth_t;
 
+/*!
+ * LoRa register settings depending only on the bandwidth and the spreading
+ * factor
+ */
+typedef struct
+{
+    uint8_t LowDatarateOptimize;
+    uint8_t DetectOptimize;
+    uint8_t DetectionThreshold;
+}LoRaProfile_t;
+
 
 /*
  * Private functions prototypes
@@ -124,6 +137,83 @@ void SX1276ReadFifo( uint8_t *buffer, uint8_t size );
  */
 void SX1276SetOpMode( uint8_t opMode );
 
+/*!
+ * \brief Reads the radio register at the specified address from the shadow
+ *        copy, falling back to the radio when it is not known yet
+ *
+ * \remark Only to be used for register bits the MCU alone changes. Status,
+ *         IRQ and RSSI registers must be read with SX1276Read
+ *
+ * \param [IN]: addr Register address
+ * \retval data Register value
+ */
+static uint8_t SX1276ReadCached( uint8_t addr );
+
+/*!
+ * \brief Gets the index of a register in the shadow copy
+ *
+ * \param [IN]: addr Register address
+ * \retval index Shadow index [REG_SHADOW_SIZE: register page unknown]
+ */
+static uint16_t SX1276ShadowIndex( uint8_t addr );
+
+/*!
+ * \brief Writes multiple radio registers starting at address, unless the
+ *        shadow copy shows they already hold the given values
+ *
+ * \param [IN] addr   First Radio register address
+ * \param [IN] buffer Buffer containing the new register's values
+ * \param [IN] size   Number of registers to be written
+ */
+static void SX1276WriteBufferChanged( uint8_t addr, uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Writes the radio register at the specified address, unless the
+ *        shadow copy shows it already holds the given value
+ *
+ * \param [IN]: addr Register address
+ * \param [IN]: data New register value
+ */
+static void SX1276WriteChanged( uint8_t addr, uint8_t data );
+
+/*!
+ * \brief Updates the shadow copy of the radio registers
+ *
+ * \param [IN] addr   First Radio register address
+ * \param [IN] buffer Buffer containing the register's values
+ * \param [IN] size   Number of registers
+ */
+static void SX1276ShadowUpdate( uint8_t addr, uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Forgets the shadow copy after a failed SPI transfer, the radio
+ *        registers may or may not hold the bytes sent
+ *
+ * \param [IN] addr   First Radio register address
+ * \param [IN] size   Number of registers
+ */
+static void SX1276ShadowInvalidate( uint8_t addr, uint8_t size );
+
+/*!
+ * \brief Shifts the LSB of the LoRa wideband RSSI into the entropy pool
+ *
+ * \remark The radio must be receiving in LoRa mode, the register only
+ *         follows the noise while the receiver runs
+ */
+static void SX1276EntropyHarvest( void );
+
+/*!
+ * \brief Samples the wideband RSSI ENTROPY_RX_SAMPLES times, one sample
+ *        every ENTROPY_SAMPLE_PERIOD on EntropyTimer, while the radio
+ *        receives in LoRa mode
+ */
+static void SX1276EntropyStart( void );
+
+/*!
+ * \brief Takes the next sample of SX1276EntropyStart
+ */
+static void SX1276OnEntropyTimerEvent( void );
+
 /*
  * SX1276 DIO IRQ callback functions prototype
  */
@@ -180,6 +270,27 @@ const RadioRegisters_t RadioRegsInit[] = RADIO_INIT_REGISTERS_VALUE;
 #define RSSI_OFFSET_LF                              -164
 #define RSSI_OFFSET_HF                              -157
 
+/*!
+ * Wideband RSSI samples taken in each LoRa reception window, two windows
+ * fill the 32 bits the next random value takes
+ */
+#define ENTROPY_RX_SAMPLES                          16
+
+/*!
+ * Time between two wideband RSSI samples [ms]. The datasheet gives no
+ * update rate for RegRssiWideband, reads a few SPI transfers apart may
+ * return the same measurement. The reference driver samples it 1 ms apart.
+ */
+#define ENTROPY_SAMPLE_PERIOD                       1
+
+/*!
+ * Register addresses shared by the LoRa and FSK pages and size of the
+ * register shadow copy holding both pages
+ */
+#define REG_SHADOW_PAGE_START                       0x0D
+#define REG_SHADOW_PAGE_END                         0x3F
+#define REG_SHADOW_SIZE                             ( 0x80 + REG_SHADOW_PAGE_END - REG_SHADOW_PAGE_START + 1 )
+
 /*!
  * Precomputed FSK bandwidth registers values
  */
@@ -209,6 +320,20 @@ const FskBandwidth_t FskBandwidths[] =
     { 300000, 0x00 }, // Invalid Bandwidth
 };
 
+/*!
+ * LoRa register settings, precomputed per bandwidth [125, 250, 500 kHz] and
+ * spreading factor [SF6 to SF12]
+ */
+#define LORA_PROFILE_SF6                            { 0x00, RFLR_DETECTIONOPTIMIZE_SF6, RFLR_DETECTIONTHRESH_SF6 }
+#define LORA_PROFILE( ldro )                        { ldro, RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12, RFLR_DETECTIONTHRESH_SF7_TO_SF12 }
+
+const LoRaProfile_t LoRaProfiles[3][7] =
+{
+    { LORA_PROFILE_SF6, LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 1 ), LORA_PROFILE( 1 ) },
+    { LORA_PROFILE_SF6, LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 1 ) },
+    { LORA_PROFILE_SF6, LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ), LORA_PROFILE( 0 ) },
+};
+
 /*
  * Private global variables
  */
@@ -225,6 +350,42 @@ static uint8_t RxTxBuffer[RX_BUFFER_SIZE];
 
 static LoRaBoardCallback_t *LoRaBoardCallbacks;
 
+/*!
+ * Shadow copy of the radio registers. The LoRa page is stored after the
+ * common registers
+ */
+static uint8_t RegShadow[REG_SHADOW_SIZE];
+
+/*!
+ * Bit field of the valid shadow registers
+ */
+static uint8_t RegShadowValid[( REG_SHADOW_SIZE + 7 ) / 8];
+
+/*!
+ * Number of SPI transactions issued to the radio
+ */
+static uint32_t SpiTransactions = 0;
+
+/*!
+ * Raw wideband RSSI bits gathered while the radio was receiving
+ */
+static uint32_t EntropyPool = 0;
+
+/*!
+ * Number of fresh bits in EntropyPool
+ */
+static uint8_t EntropyBits = 0;
+
+/*!
+ * Samples left to take in the current reception window
+ */
+static uint8_t EntropySamples = 0;
+
+/*!
+ * Last random value returned, chained into the next one
+ */
+static uint32_t EntropyState = 0;
+
 /*
  * Public global variables
  */
@@ -248,6 +409,11 @@ TimerEvent_t TxTimeoutTimer;
 TimerEvent_t RxTimeoutTimer;
 TimerEvent_t RxTimeoutSyncWord;
 
+/*!
+ * Wideband RSSI sampling timer
+ */
+static TimerEvent_t EntropyTimer;
+
 /*
  * Radio driver functions implementation
  */
@@ -266,6 +432,7 @@ uint32_t SX1276Init( RadioEvents_t *events )
     TimerInit( &TxTimeoutTimer, SX1276OnTimeoutIrq );
     TimerInit( &RxTimeoutTimer, SX1276OnTimeoutIrq );
     TimerInit( &RxTimeoutSyncWord, SX1276OnTimeoutIrq );
+    TimerInit( &EntropyTimer, SX1276OnEntropyTimerEvent );
 
     LoRaBoardCallbacks->SX1276BoardSetXO( SET );
 
@@ -298,14 +465,17 @@ RadioState_t SX1276GetStatus( void )
 void SX1276SetChannel( uint32_t freq )
 {
     uint32_t channel;
+    uint8_t frf[3];
 
     SX1276.Settings.Channel = freq;
 
     SX_FREQ_TO_CHANNEL( channel, freq );
 
-    SX1276Write( REG_FRFMSB, ( uint8_t )( ( channel >> 16 ) & 0xFF ) );
-    SX1276Write( REG_FRFMID, ( uint8_t )( ( channel >> 8 ) & 0xFF ) );
-    SX1276Write( REG_FRFLSB, ( uint8_t )( channel & 0xFF ) );
+    // REG_FRFMSB, REG_FRFMID and REG_FRFLSB in a single burst
+    frf[0] = ( uint8_t )( ( channel >> 16 ) & 0xFF );
+    frf[1] = ( uint8_t )( ( channel >> 8 ) & 0xFF );
+    frf[2] = ( uint8_t )( channel & 0xFF );
+    SX1276WriteBuffer( REG_FRFMSB, frf, 3 );
 }
 
 bool SX1276IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime )
@@ -313,6 +483,7 @@ bool SX1276IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh
     bool status = true;
     int16_t rssi = 0;
     uint32_t carrierSenseTime = 0;
+    uint32_t sampleTime = 0;
 
     SX1276SetModem( modem );
 
@@ -320,13 +491,20 @@ bool SX1276IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh
 
     SX1276SetOpMode( RF_OPMODE_RECEIVER );
 
-    DelayMs( 1 );
+    TimerDelayMs( 1 );
 
     carrierSenseTime = TimerGetCurrentTime( );
+    sampleTime = carrierSenseTime - ENTROPY_SAMPLE_PERIOD;
 
     // Perform carrier sense for maxCarrierSenseTime
     while( TimerGetElapsedTime( carrierSenseTime ) < maxCarrierSenseTime )
     {
+        if( ( modem == MODEM_LORA ) && ( TimerGetElapsedTime( sampleTime ) >= ENTROPY_SAMPLE_PERIOD ) )
+        {
+            SX1276EntropyHarvest( );
+            sampleTime = TimerGetCurrentTime( );
+        }
+
         rssi = SX1276ReadRssi( modem );
 
         if( rssi > rssiThresh )
@@ -339,42 +517,119 @@ bool SX1276IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh
     return status;
 }
 
-uint32_t SX1276Random( void )
+void SX1276StartCarrierSense( RadioModems_t modem, uint32_t freq )
 {
-    uint8_t i;
-    uint32_t rnd = 0;
+    SX1276SetModem( modem );
 
-    /*
-     * Radio setup for random number generation
-     */
-    // Set LoRa modem ON
-    SX1276SetModem( MODEM_LORA );
+    SX1276SetChannel( freq );
 
-    // Disable LoRa modem interrupts
-    SX1276Write( REG_LR_IRQFLAGSMASK, RFLR_IRQFLAGS_RXTIMEOUT |
-                  RFLR_IRQFLAGS_RXDONE |
-                  RFLR_IRQFLAGS_PAYLOADCRCERROR |
-                  RFLR_IRQFLAGS_VALIDHEADER |
-                  RFLR_IRQFLAGS_TXDONE |
-                  RFLR_IRQFLAGS_CADDONE |
-                  RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL |
-                  RFLR_IRQFLAGS_CADDETECTED );
-
-    // Set radio in continuous reception
+    // The receiver only runs for the RSSI, its interrupts are ignored
+    SX1276.Settings.State = RF_IDLE;
     SX1276SetOpMode( RF_OPMODE_RECEIVER );
 
-    for( i = 0; i < 32; i++ )
+    SX1276EntropyStart( );
+}
+
+uint32_t SX1276Random( void )
+{
+    uint32_t rnd = 0;
+
+    if( EntropyBits < 32 )
     {
-        DelayMs( 1 );
-        // Unfiltered RSSI value reading. Only takes the LSB value
-        rnd |= ( ( uint32_t )SX1276Read( REG_LR_RSSIWIDEBAND ) & 0x01 ) << i;
+        /*
+         * Radio setup for random number generation
+         */
+        // Set LoRa modem ON
+        SX1276SetModem( MODEM_LORA );
+
+        // Disable LoRa modem interrupts
+        SX1276Write( REG_LR_IRQFLAGSMASK, RFLR_IRQFLAGS_RXTIMEOUT |
+                      RFLR_IRQFLAGS_RXDONE |
+                      RFLR_IRQFLAGS_PAYLOADCRCERROR |
+                      RFLR_IRQFLAGS_VALIDHEADER |
+                      RFLR_IRQFLAGS_TXDONE |
+                      RFLR_IRQFLAGS_CADDONE |
+                      RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL |
+                      RFLR_IRQFLAGS_CADDETECTED );
+
+        // Set radio in continuous reception
+        SX1276SetOpMode( RF_OPMODE_RECEIVER );
+
+        // Only sample the bits the pool is missing
+        while( EntropyBits < 32 )
+        {
+            TimerDelayMs( ENTROPY_SAMPLE_PERIOD );
+            SX1276EntropyHarvest( );
+        }
+
+        SX1276SetSleep( );
     }
 
-    SX1276SetSleep( );
+    BACKUP_PRIMASK();
+    DISABLE_IRQ( );
+    rnd = EntropyPool;
+    EntropyBits = 0;
+    RESTORE_PRIMASK( );
+
+    // Whiten the raw RSSI bits with a 32 bits mixer, chained so that
+    // consecutive values differ even if the samples are biased
+    rnd ^= EntropyState;
+    rnd ^= rnd >> 16;
+    rnd *= 0x85EBCA6B;
+    rnd ^= rnd >> 13;
+    rnd *= 0xC2B2AE35;
+    rnd ^= rnd >> 16;
+    EntropyState = rnd;
 
     return rnd;
 }
 
+static void SX1276EntropyHarvest( void )
+{
+    // Unfiltered RSSI value reading. Only takes the LSB value
+    uint32_t bit = ( uint32_t )SX1276Read( REG_LR_RSSIWIDEBAND ) & 0x01;
+
+    BACKUP_PRIMASK();
+    DISABLE_IRQ( );
+    EntropyPool = ( EntropyPool << 1 ) | bit;
+    if( EntropyBits < 32 )
+    {
+        EntropyBits++;
+    }
+    RESTORE_PRIMASK( );
+}
+
+static void SX1276EntropyStart( void )
+{
+    EntropySamples = ENTROPY_RX_SAMPLES;
+    TimerSetValue( &EntropyTimer, ENTROPY_SAMPLE_PERIOD );
+    TimerStart( &EntropyTimer );
+}
+
+static void SX1276OnEntropyTimerEvent( void )
+{
+    uint8_t opMode;
+
+    if( SX1276.Settings.Modem != MODEM_LORA )
+    {
+        return;
+    }
+    // A single reception falls back to standby on its own at RxDone or
+    // RxTimeout, the register no longer follows the noise then
+    opMode = SX1276Read( REG_OPMODE ) & ~RFLR_OPMODE_MASK;
+    if( ( opMode != RFLR_OPMODE_RECEIVER ) && ( opMode != RFLR_OPMODE_RECEIVER_SINGLE ) )
+    {
+        return;
+    }
+
+    SX1276EntropyHarvest( );
+    EntropySamples--;
+    if( EntropySamples > 0 )
+    {
+        TimerStart( &EntropyTimer );
+    }
+}
+
 /*!
  * Performs the Rx chain calibration for LF and HF bands
  * \remark Must be called just after the reset so all registers are at their
@@ -447,6 +702,9 @@ void SX1276SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
                          bool crcOn, bool freqHopOn, uint8_t hopPeriod,
                          bool iqInverted, bool rxContinuous )
 {
+    uint8_t modemConfig[5];
+    const LoRaProfile_t *profile;
+
     SX1276SetModem( modem );
 
     switch( modem )
@@ -484,12 +742,12 @@ void SX1276SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
             }
 
             SX1276Write( REG_PACKETCONFIG1,
-                         ( SX1276Read( REG_PACKETCONFIG1 ) &
+                         ( SX1276ReadCached( REG_PACKETCONFIG1 ) &
                            RF_PACKETCONFIG1_CRC_MASK &
                            RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
                            ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
                            ( crcOn << 4 ) );
-            SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+            SX1276Write( REG_PACKETCONFIG2, ( SX1276ReadCached( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
         }
         break;
     case MODEM_LORA:
@@ -521,41 +779,31 @@ void SX1276SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
                 datarate = 6;
             }
 
-            if( ( ( bandwidth == 7 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
-                ( ( bandwidth == 8 ) && ( datarate == 12 ) ) )
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x01;
-            }
-            else
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x00;
-            }
-
-            SX1276Write( REG_LR_MODEMCONFIG1,
-                         ( SX1276Read( REG_LR_MODEMCONFIG1 ) &
-                           RFLR_MODEMCONFIG1_BW_MASK &
-                           RFLR_MODEMCONFIG1_CODINGRATE_MASK &
-                           RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
-                           ( bandwidth << 4 ) | ( coderate << 1 ) |
-                           fixLen );
-
-            SX1276Write( REG_LR_MODEMCONFIG2,
-                         ( SX1276Read( REG_LR_MODEMCONFIG2 ) &
-                           RFLR_MODEMCONFIG2_SF_MASK &
-                           RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK &
-                           RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) |
-                           ( datarate << 4 ) | ( crcOn << 2 ) |
-                           ( ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) );
-
-            SX1276Write( REG_LR_MODEMCONFIG3,
-                         ( SX1276Read( REG_LR_MODEMCONFIG3 ) &
-                           RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
-                           ( SX1276.Settings.LoRa.LowDatarateOptimize << 3 ) );
-
-            SX1276Write( REG_LR_SYMBTIMEOUTLSB, ( uint8_t )( symbTimeout & 0xFF ) );
-
-            SX1276Write( REG_LR_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ) );
-            SX1276Write( REG_LR_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ) );
+            profile = &LoRaProfiles[bandwidth - 7][datarate - 6];
+            SX1276.Settings.LoRa.LowDatarateOptimize = profile->LowDatarateOptimize;
+
+            SX1276WriteChanged( REG_LR_MODEMCONFIG3,
+                                ( SX1276ReadCached( REG_LR_MODEMCONFIG3 ) &
+                                  RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
+                                  ( SX1276.Settings.LoRa.LowDatarateOptimize << 3 ) );
+
+            // REG_LR_MODEMCONFIG1 up to REG_LR_PREAMBLELSB in a single burst
+            modemConfig[0] = ( SX1276ReadCached( REG_LR_MODEMCONFIG1 ) &
+                               RFLR_MODEMCONFIG1_BW_MASK &
+                               RFLR_MODEMCONFIG1_CODINGRATE_MASK &
+                               RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
+                               ( bandwidth << 4 ) | ( coderate << 1 ) |
+                               fixLen;
+            modemConfig[1] = ( SX1276ReadCached( REG_LR_MODEMCONFIG2 ) &
+                               RFLR_MODEMCONFIG2_SF_MASK &
+                               RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK &
+                               RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) |
+                               ( datarate << 4 ) | ( crcOn << 2 ) |
+                               ( ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK );
+            modemConfig[2] = ( uint8_t )( symbTimeout & 0xFF );
+            modemConfig[3] = ( uint8_t )( ( preambleLen >> 8 ) & 0xFF );
+            modemConfig[4] = ( uint8_t )( preambleLen & 0xFF );
+            SX1276WriteBufferChanged( REG_LR_MODEMCONFIG1, modemConfig, 5 );
 
             if( fixLen == 1 )
             {
@@ -564,46 +812,33 @@ void SX1276SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
 
             if( SX1276.Settings.LoRa.FreqHopOn == true )
             {
-                SX1276Write( REG_LR_PLLHOP, ( SX1276Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
+                SX1276Write( REG_LR_PLLHOP, ( SX1276ReadCached( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
                 SX1276Write( REG_LR_HOPPERIOD, SX1276.Settings.LoRa.HopPeriod );
             }
 
             if( ( bandwidth == 9 ) && ( SX1276.Settings.Channel > RF_MID_BAND_THRESH ) )
             {
                 // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
-                SX1276Write( REG_LR_TEST36, 0x02 );
-                SX1276Write( REG_LR_TEST3A, 0x64 );
+                SX1276WriteChanged( REG_LR_TEST36, 0x02 );
+                SX1276WriteChanged( REG_LR_TEST3A, 0x64 );
             }
             else if( bandwidth == 9 )
             {
                 // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
-                SX1276Write( REG_LR_TEST36, 0x02 );
-                SX1276Write( REG_LR_TEST3A, 0x7F );
+                SX1276WriteChanged( REG_LR_TEST36, 0x02 );
+                SX1276WriteChanged( REG_LR_TEST3A, 0x7F );
             }
             else
             {
                 // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
-                SX1276Write( REG_LR_TEST36, 0x03 );
+                SX1276WriteChanged( REG_LR_TEST36, 0x03 );
             }
 
-            if( datarate == 6 )
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                               RFLR_DETECTIONOPTIMIZE_MASK ) |
-                               RFLR_DETECTIONOPTIMIZE_SF6 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF6 );
-            }
-            else
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                             RFLR_DETECTIONOPTIMIZE_MASK ) |
-                             RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF7_TO_SF12 );
-            }
+            SX1276WriteChanged( REG_LR_DETECTOPTIMIZE,
+                                ( SX1276ReadCached( REG_LR_DETECTOPTIMIZE ) &
+                                  RFLR_DETECTIONOPTIMIZE_MASK ) |
+                                  profile->DetectOptimize );
+            SX1276WriteChanged( REG_LR_DETECTIONTHRESHOLD, profile->DetectionThreshold );
         }
         break;
     }
@@ -615,6 +850,9 @@ void SX1276SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
                         bool fixLen, bool crcOn, bool freqHopOn,
                         uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
 {
+    uint8_t modemConfig[5];
+    const LoRaProfile_t *profile;
+
     SX1276SetModem( modem );
 
     LoRaBoardCallbacks->SX1276BoardSetRfTxPower( power );
@@ -645,12 +883,12 @@ void SX1276SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
             SX1276Write( REG_PREAMBLELSB, preambleLen & 0xFF );
 
             SX1276Write( REG_PACKETCONFIG1,
-                         ( SX1276Read( REG_PACKETCONFIG1 ) &
+                         ( SX1276ReadCached( REG_PACKETCONFIG1 ) &
                            RF_PACKETCONFIG1_CRC_MASK &
                            RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
                            ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
                            ( crcOn << 4 ) );
-            SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+            SX1276Write( REG_PACKETCONFIG2, ( SX1276ReadCached( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
         }
         break;
     case MODEM_LORA:
@@ -681,62 +919,42 @@ void SX1276SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
             {
                 datarate = 6;
             }
-            if( ( ( bandwidth == 7 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
-                ( ( bandwidth == 8 ) && ( datarate == 12 ) ) )
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x01;
-            }
-            else
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x00;
-            }
+            profile = &LoRaProfiles[bandwidth - 7][datarate - 6];
+            SX1276.Settings.LoRa.LowDatarateOptimize = profile->LowDatarateOptimize;
 
             if( SX1276.Settings.LoRa.FreqHopOn == true )
             {
-                SX1276Write( REG_LR_PLLHOP, ( SX1276Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
+                SX1276Write( REG_LR_PLLHOP, ( SX1276ReadCached( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
                 SX1276Write( REG_LR_HOPPERIOD, SX1276.Settings.LoRa.HopPeriod );
             }
 
-            SX1276Write( REG_LR_MODEMCONFIG1,
-                         ( SX1276Read( REG_LR_MODEMCONFIG1 ) &
-                           RFLR_MODEMCONFIG1_BW_MASK &
-                           RFLR_MODEMCONFIG1_CODINGRATE_MASK &
-                           RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
-                           ( bandwidth << 4 ) | ( coderate << 1 ) |
-                           fixLen );
-
-            SX1276Write( REG_LR_MODEMCONFIG2,
-                         ( SX1276Read( REG_LR_MODEMCONFIG2 ) &
-                           RFLR_MODEMCONFIG2_SF_MASK &
-                           RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK ) |
-                           ( datarate << 4 ) | ( crcOn << 2 ) );
-
-            SX1276Write( REG_LR_MODEMCONFIG3,
-                         ( SX1276Read( REG_LR_MODEMCONFIG3 ) &
-                           RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
-                           ( SX1276.Settings.LoRa.LowDatarateOptimize << 3 ) );
-
-            SX1276Write( REG_LR_PREAMBLEMSB, ( preambleLen >> 8 ) & 0x00FF );
-            SX1276Write( REG_LR_PREAMBLELSB, preambleLen & 0xFF );
-
-            if( datarate == 6 )
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                               RFLR_DETECTIONOPTIMIZE_MASK ) |
-                               RFLR_DETECTIONOPTIMIZE_SF6 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF6 );
-            }
-            else
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                             RFLR_DETECTIONOPTIMIZE_MASK ) |
-                             RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF7_TO_SF12 );
-            }
+            SX1276WriteChanged( REG_LR_MODEMCONFIG3,
+                                ( SX1276ReadCached( REG_LR_MODEMCONFIG3 ) &
+                                  RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
+                                  ( SX1276.Settings.LoRa.LowDatarateOptimize << 3 ) );
+
+            // REG_LR_MODEMCONFIG1 up to REG_LR_PREAMBLELSB in a single burst,
+            // the symbol timeout being kept as is from the shadow copy
+            modemConfig[0] = ( SX1276ReadCached( REG_LR_MODEMCONFIG1 ) &
+                               RFLR_MODEMCONFIG1_BW_MASK &
+                               RFLR_MODEMCONFIG1_CODINGRATE_MASK &
+                               RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
+                               ( bandwidth << 4 ) | ( coderate << 1 ) |
+                               fixLen;
+            modemConfig[1] = ( SX1276ReadCached( REG_LR_MODEMCONFIG2 ) &
+                               RFLR_MODEMCONFIG2_SF_MASK &
+                               RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK ) |
+                               ( datarate << 4 ) | ( crcOn << 2 );
+            modemConfig[2] = SX1276ReadCached( REG_LR_SYMBTIMEOUTLSB );
+            modemConfig[3] = ( preambleLen >> 8 ) & 0x00FF;
+            modemConfig[4] = preambleLen & 0xFF;
+            SX1276WriteBufferChanged( REG_LR_MODEMCONFIG1, modemConfig, 5 );
+
+            SX1276WriteChanged( REG_LR_DETECTOPTIMIZE,
+                                ( SX1276ReadCached( REG_LR_DETECTOPTIMIZE ) &
+                                  RFLR_DETECTIONOPTIMIZE_MASK ) |
+                                  profile->DetectOptimize );
+            SX1276WriteChanged( REG_LR_DETECTIONTHRESHOLD, profile->DetectionThreshold );
         }
         break;
     }
@@ -750,71 +968,40 @@ uint32_t SX1276GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
     {
     case MODEM_FSK:
         {
-            airTime = (uint32_t) round( ( 8 * ( SX1276.Settings.Fsk.PreambleLen +
-                                     ( ( SX1276Read( REG_SYNCCONFIG ) & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1 ) +
-                                     ( ( SX1276.Settings.Fsk.FixLen == 0x01 ) ? 0.0 : 1.0 ) +
-                                     ( ( ( SX1276Read( REG_PACKETCONFIG1 ) & ~RF_PACKETCONFIG1_ADDRSFILTERING_MASK ) != 0x00 ) ? 1.0 : 0 ) +
-                                     pktLen +
-                                     ( ( SX1276.Settings.Fsk.CrcOn == 0x01 ) ? 2.0 : 0 ) ) /
-                                     SX1276.Settings.Fsk.Datarate ) * 1000 );
+            // Packet length in bits, the time on air is rounded to the nearest ms
+            uint32_t nBits = 8 * ( SX1276.Settings.Fsk.PreambleLen +
+                                 ( ( SX1276ReadCached( REG_SYNCCONFIG ) & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1 ) +
+                                 ( ( SX1276.Settings.Fsk.FixLen == 0x01 ) ? 0 : 1 ) +
+                                 ( ( ( SX1276ReadCached( REG_PACKETCONFIG1 ) & ~RF_PACKETCONFIG1_ADDRSFILTERING_MASK ) != 0x00 ) ? 1 : 0 ) +
+                                 pktLen +
+                                 ( ( SX1276.Settings.Fsk.CrcOn == 0x01 ) ? 2 : 0 ) );
+
+            airTime = ( 2000 * nBits + SX1276.Settings.Fsk.Datarate ) / ( 2 * SX1276.Settings.Fsk.Datarate );
         }
         break;
     case MODEM_LORA:
         {
-            double bw = 0.0;
             // REMARK: When using LoRa modem only bandwidths 125, 250 and 500 kHz are supported
-            switch( SX1276.Settings.LoRa.Bandwidth )
+            // Quarter of the symbol time in us, 2^SF / BW being exact for these
+            // bandwidths [7: 125 kHz, 8: 250 kHz, 9: 500 kHz]
+            uint32_t tQuarterSymbol = ( ( uint32_t )1 << ( SX1276.Settings.LoRa.Datarate + 10 - SX1276.Settings.LoRa.Bandwidth ) ) / 4;
+            // Symbol length of payload
+            int32_t nBits = 8 * pktLen - 4 * SX1276.Settings.LoRa.Datarate +
+                            28 + 16 * SX1276.Settings.LoRa.CrcOn -
+                            ( SX1276.Settings.LoRa.FixLen ? 20 : 0 );
+            int32_t nBitsPerSymbol = 4 * ( SX1276.Settings.LoRa.Datarate -
+                                     ( ( SX1276.Settings.LoRa.LowDatarateOptimize > 0 ) ? 2 : 0 ) );
+            uint32_t nPayload = 8;
+
+            if( nBits > 0 )
             {
-            //case 0: // 7.8 kHz
-            //    bw = 7800;
-            //    break;
-            //case 1: // 10.4 kHz
-            //    bw = 10400;
-            //    break;
-            //case 2: // 15.6 kHz
-            //    bw = 15600;
-            //    break;
-            //case 3: // 20.8 kHz
-            //    bw = 20800;
-            //    break;
-            //case 4: // 31.2 kHz
-            //    bw = 31200;
-            //    break;
-            //case 5: // 41.4 kHz
-            //    bw = 41400;
-            //    break;
-            //case 6: // 62.5 kHz
-            //    bw = 62500;
-            //    break;
-            case 7: // 125 kHz
-                bw = 125000;
-                break;
-            case 8: // 250 kHz
-                bw = 250000;
-                break;
-            case 9: // 500 kHz
-                bw = 500000;
-                break;
+                nPayload += ( ( nBits + nBitsPerSymbol - 1 ) / nBitsPerSymbol ) *
+                            ( SX1276.Settings.LoRa.Coderate + 4 );
             }
-
-            // Symbol rate : time for one symbol (secs)
-            double rs = bw / ( 1 << SX1276.Settings.LoRa.Datarate );
-            double ts = 1 / rs;
-            // time of preamble
-            double tPreamble = ( SX1276.Settings.LoRa.PreambleLen + 4.25 ) * ts;
-            // Symbol length of payload and time
-            double tmp = ceil( ( 8 * pktLen - 4 * SX1276.Settings.LoRa.Datarate +
-                                 28 + 16 * SX1276.Settings.LoRa.CrcOn -
-                                 ( SX1276.Settings.LoRa.FixLen ? 20 : 0 ) ) /
-                                 ( double )( 4 * ( SX1276.Settings.LoRa.Datarate -
-                                 ( ( SX1276.Settings.LoRa.LowDatarateOptimize > 0 ) ? 2 : 0 ) ) ) ) *
-                                 ( SX1276.Settings.LoRa.Coderate + 4 );
-            double nPayload = 8 + ( ( tmp > 0 ) ? tmp : 0 );
-            double tPayload = nPayload * ts;
-            // Time on air
-            double tOnAir = tPreamble + tPayload;
-            // return ms secs
-            airTime = (uint32_t) floor( tOnAir * 1000 + 0.999 );
+            // Time on air in us, the preamble lasting PreambleLen + 4.25 symbols
+            airTime = ( 4 * SX1276.Settings.LoRa.PreambleLen + 17 + 4 * nPayload ) * tQuarterSymbol;
+            // return ms secs, rounded up
+            airTime = ( airTime + 999 ) / 1000;
         }
         break;
     }
@@ -861,12 +1048,12 @@ void SX1276Send( uint8_t *buffer, uint8_t size )
         {
             if( SX1276.Settings.LoRa.IqInverted == true )
             {
-                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276Read( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_OFF | RFLR_INVERTIQ_TX_ON ) );
+                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276ReadCached( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_OFF | RFLR_INVERTIQ_TX_ON ) );
                 SX1276Write( REG_LR_INVERTIQ2, RFLR_INVERTIQ2_ON );
             }
             else
             {
-                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276Read( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_OFF | RFLR_INVERTIQ_TX_OFF ) );
+                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276ReadCached( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_OFF | RFLR_INVERTIQ_TX_OFF ) );
                 SX1276Write( REG_LR_INVERTIQ2, RFLR_INVERTIQ2_OFF );
             }
 
@@ -883,7 +1070,7 @@ void SX1276Send( uint8_t *buffer, uint8_t size )
             if( ( SX1276Read( REG_OPMODE ) & ~RF_OPMODE_MASK ) == RF_OPMODE_SLEEP )
             {
                 SX1276SetStby( );
-                DelayMs( 1 );
+                TimerDelayMs( 1 );
             }
             // Write payload buffer
             SX1276WriteFifo( buffer, size );
@@ -899,6 +1086,7 @@ void SX1276SetSleep( void )
 {
     TimerStop( &RxTimeoutTimer );
     TimerStop( &TxTimeoutTimer );
+    TimerStop( &EntropyTimer );
 
     SX1276SetOpMode( RF_OPMODE_SLEEP );
     SX1276.Settings.State = RF_IDLE;
@@ -908,6 +1096,7 @@ void SX1276SetStby( void )
 {
     TimerStop( &RxTimeoutTimer );
     TimerStop( &TxTimeoutTimer );
+    TimerStop( &EntropyTimer );
 
     SX1276SetOpMode( RF_OPMODE_STANDBY );
     SX1276.Settings.State = RF_IDLE;
@@ -929,19 +1118,19 @@ void SX1276SetRx( uint32_t timeout )
             // DIO3=FifoEmpty
             // DIO4=Preamble
             // DIO5=ModeReady
-            SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK &
+            SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK &
                                                                             RF_DIOMAPPING1_DIO1_MASK &
                                                                             RF_DIOMAPPING1_DIO2_MASK ) |
                                                                             RF_DIOMAPPING1_DIO0_00 |
                                                                             RF_DIOMAPPING1_DIO1_00 |
                                                                             RF_DIOMAPPING1_DIO2_11 );
 
-            SX1276Write( REG_DIOMAPPING2, ( SX1276Read( REG_DIOMAPPING2 ) & RF_DIOMAPPING2_DIO4_MASK &
+            SX1276Write( REG_DIOMAPPING2, ( SX1276ReadCached( REG_DIOMAPPING2 ) & RF_DIOMAPPING2_DIO4_MASK &
                                                                             RF_DIOMAPPING2_MAP_MASK ) |
                                                                             RF_DIOMAPPING2_DIO4_11 |
                                                                             RF_DIOMAPPING2_MAP_PREAMBLEDETECT );
 
-            SX1276.Settings.FskPacketHandler.FifoThresh = SX1276Read( REG_FIFOTHRESH ) & 0x3F;
+            SX1276.Settings.FskPacketHandler.FifoThresh = SX1276ReadCached( REG_FIFOTHRESH ) & 0x3F;
 
             SX1276Write( REG_RXCONFIG, RF_RXCONFIG_AFCAUTO_ON | RF_RXCONFIG_AGCAUTO_ON | RF_RXCONFIG_RXTRIGER_PREAMBLEDETECT );
 
@@ -955,19 +1144,19 @@ void SX1276SetRx( uint32_t timeout )
         {
             if( SX1276.Settings.LoRa.IqInverted == true )
             {
-                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276Read( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_ON | RFLR_INVERTIQ_TX_OFF ) );
+                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276ReadCached( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_ON | RFLR_INVERTIQ_TX_OFF ) );
                 SX1276Write( REG_LR_INVERTIQ2, RFLR_INVERTIQ2_ON );
             }
             else
             {
-                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276Read( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_OFF | RFLR_INVERTIQ_TX_OFF ) );
+                SX1276Write( REG_LR_INVERTIQ, ( ( SX1276ReadCached( REG_LR_INVERTIQ ) & RFLR_INVERTIQ_TX_MASK & RFLR_INVERTIQ_RX_MASK ) | RFLR_INVERTIQ_RX_OFF | RFLR_INVERTIQ_TX_OFF ) );
                 SX1276Write( REG_LR_INVERTIQ2, RFLR_INVERTIQ2_OFF );
             }
 
             // ERRATA 2.3 - Receiver Spurious Reception of a LoRa Signal
             if( SX1276.Settings.LoRa.Bandwidth < 9 )
             {
-                SX1276Write( REG_LR_DETECTOPTIMIZE, SX1276Read( REG_LR_DETECTOPTIMIZE ) & 0x7F );
+                SX1276Write( REG_LR_DETECTOPTIMIZE, SX1276ReadCached( REG_LR_DETECTOPTIMIZE ) & 0x7F );
                 SX1276Write( REG_LR_TEST30, 0x00 );
                 switch( SX1276.Settings.LoRa.Bandwidth )
                 {
@@ -1008,7 +1197,7 @@ void SX1276SetRx( uint32_t timeout )
             }
             else
             {
-                SX1276Write( REG_LR_DETECTOPTIMIZE, SX1276Read( REG_LR_DETECTOPTIMIZE ) | 0x80 );
+                SX1276Write( REG_LR_DETECTOPTIMIZE, SX1276ReadCached( REG_LR_DETECTOPTIMIZE ) | 0x80 );
             }
 
             rxContinuous = SX1276.Settings.LoRa.RxContinuous;
@@ -1025,7 +1214,7 @@ void SX1276SetRx( uint32_t timeout )
                                                   RFLR_IRQFLAGS_CADDETECTED );
 
                 // DIO0=RxDone, DIO2=FhssChangeChannel
-                SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK  ) | RFLR_DIOMAPPING1_DIO0_00 | RFLR_DIOMAPPING1_DIO2_00 );
+                SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK  ) | RFLR_DIOMAPPING1_DIO0_00 | RFLR_DIOMAPPING1_DIO2_00 );
             }
             else
             {
@@ -1039,7 +1228,7 @@ void SX1276SetRx( uint32_t timeout )
                                                   RFLR_IRQFLAGS_CADDETECTED );
 
                 // DIO0=RxDone
-                SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_00 );
+                SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_00 );
             }
             SX1276Write( REG_LR_FIFORXBASEADDR, 0 );
             SX1276Write( REG_LR_FIFOADDRPTR, 0 );
@@ -1049,8 +1238,12 @@ void SX1276SetRx( uint32_t timeout )
 
     memset( RxTxBuffer, 0, ( size_t )RX_BUFFER_SIZE );
 
+    Trace_Record( TRACE_RADIO_SET_RX, rxContinuous, ( timeout > 0xFFFF ) ? 0xFFFF : timeout );
+
     SX1276.Settings.State = RF_RX_RUNNING;
-    if( timeout != 0 )
+    // A LoRa single reception ends on the radio symbol timeout (DIO1) or on
+    // RxDone, it needs no MCU timer. The caller keeps a watchdog for a lost DIO.
+    if( ( timeout != 0 ) && ( ( SX1276.Settings.Modem == MODEM_FSK ) || ( rxContinuous == true ) ) )
     {
         TimerSetValue( &RxTimeoutTimer, timeout );
         TimerStart( &RxTimeoutTimer );
@@ -1076,11 +1269,16 @@ void SX1276SetRx( uint32_t timeout )
         {
             SX1276SetOpMode( RFLR_OPMODE_RECEIVER_SINGLE );
         }
+        // The window is open, sample the noise while the radio looks for a
+        // preamble
+        SX1276EntropyStart( );
     }
 }
 
 void SX1276SetTx( uint32_t timeout )
 {
+    Trace_Record( TRACE_RADIO_SET_TX, 0, ( timeout > 0xFFFF ) ? 0xFFFF : timeout );
+
     TimerSetValue( &TxTimeoutTimer, timeout );
 
     switch( SX1276.Settings.Modem )
@@ -1093,14 +1291,14 @@ void SX1276SetTx( uint32_t timeout )
             // DIO3=FifoEmpty
             // DIO4=LowBat
             // DIO5=ModeReady
-            SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK &
+            SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK &
                                                                             RF_DIOMAPPING1_DIO1_MASK &
                                                                             RF_DIOMAPPING1_DIO2_MASK ) |
                                                                             RF_DIOMAPPING1_DIO1_01 );
 
-            SX1276Write( REG_DIOMAPPING2, ( SX1276Read( REG_DIOMAPPING2 ) & RF_DIOMAPPING2_DIO4_MASK &
+            SX1276Write( REG_DIOMAPPING2, ( SX1276ReadCached( REG_DIOMAPPING2 ) & RF_DIOMAPPING2_DIO4_MASK &
                                                                             RF_DIOMAPPING2_MAP_MASK ) );
-            SX1276.Settings.FskPacketHandler.FifoThresh = SX1276Read( REG_FIFOTHRESH ) & 0x3F;
+            SX1276.Settings.FskPacketHandler.FifoThresh = SX1276ReadCached( REG_FIFOTHRESH ) & 0x3F;
         }
         break;
     case MODEM_LORA:
@@ -1117,7 +1315,7 @@ void SX1276SetTx( uint32_t timeout )
                                                   RFLR_IRQFLAGS_CADDETECTED );
 
                 // DIO0=TxDone, DIO2=FhssChangeChannel
-                SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK ) | RFLR_DIOMAPPING1_DIO0_01 | RFLR_DIOMAPPING1_DIO2_00 );
+                SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK ) | RFLR_DIOMAPPING1_DIO0_01 | RFLR_DIOMAPPING1_DIO2_00 );
             }
             else
             {
@@ -1131,7 +1329,7 @@ void SX1276SetTx( uint32_t timeout )
                                                   RFLR_IRQFLAGS_CADDETECTED );
 
                 // DIO0=TxDone
-                SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_01 );
+                SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_01 );
             }
         }
         break;
@@ -1164,7 +1362,7 @@ void SX1276StartCad( void )
                                         );
 
             // DIO3=CADDone
-            SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO3_MASK ) | RFLR_DIOMAPPING1_DIO3_00 );
+            SX1276Write( REG_DIOMAPPING1, ( SX1276ReadCached( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO3_MASK ) | RFLR_DIOMAPPING1_DIO3_00 );
 
             SX1276.Settings.State = RF_CAD;
             SX1276SetOpMode( RFLR_OPMODE_CAD );
@@ -1183,7 +1381,7 @@ void SX1276SetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
 
     SX1276SetTxConfig( MODEM_FSK, power, 0, 0, 4800, 0, 5, false, false, 0, 0, 0, timeout );
 
-    SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) & RF_PACKETCONFIG2_DATAMODE_MASK ) );
+    SX1276Write( REG_PACKETCONFIG2, ( SX1276ReadCached( REG_PACKETCONFIG2 ) & RF_PACKETCONFIG2_DATAMODE_MASK ) );
     // Disable radio interrupts
     SX1276Write( REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_11 | RF_DIOMAPPING1_DIO1_11 );
     SX1276Write( REG_DIOMAPPING2, RF_DIOMAPPING2_DIO4_10 | RF_DIOMAPPING2_DIO5_10 );
@@ -1242,17 +1440,24 @@ void SX1276Reset( void )
 
     // Wait 6 ms
     DelayMs( 6 );
+
+    // All registers are back to their default values
+    memset1( RegShadowValid, 0, sizeof( RegShadowValid ) );
 }
 
 void SX1276SetOpMode( uint8_t opMode )
 {
+    Trace_Record( TRACE_RADIO_OPMODE, opMode, SX1276.Settings.Modem );
+
     if( opMode == RF_OPMODE_SLEEP )
     {
-      SX1276Write( REG_OPMODE, ( SX1276Read( REG_OPMODE ) & RF_OPMODE_MASK ) | opMode );
+      SX1276Write( REG_OPMODE, ( SX1276ReadCached( REG_OPMODE ) & RF_OPMODE_MASK ) | opMode );
       
       LoRaBoardCallbacks->SX1276BoardSetAntSwLowPower( true );
       
       LoRaBoardCallbacks->SX1276BoardSetXO( RESET ); 
+
+      Energy_SetRadioState( ENERGY_RADIO_SLEEP );
     }
     else
     {
@@ -1262,13 +1467,28 @@ void SX1276SetOpMode( uint8_t opMode )
       
       LoRaBoardCallbacks->SX1276BoardSetAntSw( opMode );
       
-      SX1276Write( REG_OPMODE, ( SX1276Read( REG_OPMODE ) & RF_OPMODE_MASK ) | opMode );
+      SX1276Write( REG_OPMODE, ( SX1276ReadCached( REG_OPMODE ) & RF_OPMODE_MASK ) | opMode );
+
+      switch( opMode )
+      {
+      case RF_OPMODE_TRANSMITTER:
+          Energy_SetRadioTx( ( SX1276.Settings.Modem == MODEM_LORA ) ? SX1276.Settings.LoRa.Power : SX1276.Settings.Fsk.Power );
+          break;
+      case RF_OPMODE_RECEIVER:
+      case RFLR_OPMODE_RECEIVER_SINGLE:
+      case RFLR_OPMODE_CAD:
+          Energy_SetRadioState( ENERGY_RADIO_RX );
+          break;
+      default:
+          Energy_SetRadioState( ENERGY_RADIO_STANDBY );
+          break;
+      }
     }
 }
 
 void SX1276SetModem( RadioModems_t modem )
 {
-    if( ( SX1276Read( REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_ON ) != 0 )
+    if( ( SX1276ReadCached( REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_ON ) != 0 )
     {
         SX1276.Settings.Modem = MODEM_LORA;
     }
@@ -1288,14 +1508,14 @@ void SX1276SetModem( RadioModems_t modem )
     default:
     case MODEM_FSK:
         SX1276SetSleep( );
-        SX1276Write( REG_OPMODE, ( SX1276Read( REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_MASK ) | RFLR_OPMODE_LONGRANGEMODE_OFF );
+        SX1276Write( REG_OPMODE, ( SX1276ReadCached( REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_MASK ) | RFLR_OPMODE_LONGRANGEMODE_OFF );
 
         SX1276Write( REG_DIOMAPPING1, 0x00 );
         SX1276Write( REG_DIOMAPPING2, 0x30 ); // DIO5=ModeReady
         break;
     case MODEM_LORA:
         SX1276SetSleep( );
-        SX1276Write( REG_OPMODE, ( SX1276Read( REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_MASK ) | RFLR_OPMODE_LONGRANGEMODE_ON );
+        SX1276Write( REG_OPMODE, ( SX1276ReadCached( REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_MASK ) | RFLR_OPMODE_LONGRANGEMODE_ON );
 
         SX1276Write( REG_DIOMAPPING1, 0x00 );
         SX1276Write( REG_DIOMAPPING2, 0x00 );
@@ -1315,39 +1535,157 @@ uint8_t SX1276Read( uint8_t addr )
     return data;
 }
 
-void SX1276WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
+static uint16_t SX1276ShadowIndex( uint8_t addr )
+{
+    if( ( addr < REG_SHADOW_PAGE_START ) || ( addr > REG_SHADOW_PAGE_END ) )
+    {
+        return addr;
+    }
+    if( ( RegShadowValid[REG_OPMODE / 8] & ( 1 << ( REG_OPMODE % 8 ) ) ) == 0 )
+    {
+        // Register page unknown
+        return REG_SHADOW_SIZE;
+    }
+    if( ( RegShadow[REG_OPMODE] & RFLR_OPMODE_LONGRANGEMODE_ON ) != 0 )
+    {
+        return 0x80 + addr - REG_SHADOW_PAGE_START;
+    }
+    return addr;
+}
+
+static void SX1276ShadowUpdate( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
     uint8_t i;
+    uint16_t index;
 
-    //NSS = 0;
-    HW_GPIO_Write( RADIO_NSS_PORT, RADIO_NSS_PIN, 0 );
+    // The FIFO is not a register
+    if( addr == REG_FIFO )
+    {
+        return;
+    }
+
+    for( i = 0; ( i < size ) && ( ( addr + i ) < 0x80 ); i++ )
+    {
+        index = SX1276ShadowIndex( addr + i );
+        if( index < REG_SHADOW_SIZE )
+        {
+            RegShadow[index] = buffer[i];
+            RegShadowValid[index / 8] |= 1 << ( index % 8 );
+        }
+    }
+}
+
+static void SX1276ShadowInvalidate( uint8_t addr, uint8_t size )
+{
+    Trace_Record( TRACE_RADIO_SPI_ERROR, addr, size );
+    // The page of the registers is not known if RegOpMode was in the burst,
+    // a failure is rare enough to start over
+    memset1( RegShadowValid, 0, sizeof( RegShadowValid ) );
+}
+
+static uint8_t SX1276ReadCached( uint8_t addr )
+{
+    uint16_t index = SX1276ShadowIndex( addr );
+
+    if( ( index >= REG_SHADOW_SIZE ) ||
+        ( ( RegShadowValid[index / 8] & ( 1 << ( index % 8 ) ) ) == 0 ) )
+    {
+        return SX1276Read( addr );
+    }
+    return RegShadow[index];
+}
+
+static void SX1276WriteBufferChanged( uint8_t addr, uint8_t *buffer, uint8_t size )
+{
+    uint8_t i;
+    uint16_t index;
 
-    HW_SPI_InOut( addr | 0x80 );
     for( i = 0; i < size; i++ )
     {
-        HW_SPI_InOut( buffer[i] );
+        index = SX1276ShadowIndex( addr + i );
+        if( ( index >= REG_SHADOW_SIZE ) ||
+            ( ( RegShadowValid[index / 8] & ( 1 << ( index % 8 ) ) ) == 0 ) ||
+            ( RegShadow[index] != buffer[i] ) )
+        {
+            SX1276WriteBuffer( addr, buffer, size );
+            return;
+        }
     }
+}
+
+static void SX1276WriteChanged( uint8_t addr, uint8_t data )
+{
+    SX1276WriteBufferChanged( addr, &data, 1 );
+}
+
+uint32_t SX1276GetSpiTransactions( void )
+{
+    return SpiTransactions;
+}
+
+bool SX1276GetShadowRegister( RadioModems_t modem, uint8_t addr, uint8_t *data )
+{
+    uint16_t index = addr & 0x7F;
+
+    if( ( modem == MODEM_LORA ) && ( index >= REG_SHADOW_PAGE_START ) && ( index <= REG_SHADOW_PAGE_END ) )
+    {
+        index = 0x80 + index - REG_SHADOW_PAGE_START;
+    }
+    if( ( RegShadowValid[index / 8] & ( 1 << ( index % 8 ) ) ) == 0 )
+    {
+        return false;
+    }
+    *data = RegShadow[index];
+    return true;
+}
+
+void SX1276WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
+{
+    bool done;
+
+    //NSS = 0;
+    HW_GPIO_Write( RADIO_NSS_PORT, RADIO_NSS_PIN, 0 );
+
+    HW_SPI_InOut( addr | 0x80 );
+    done = HW_SPI_Transfer( buffer, NULL, size );
 
     //NSS = 1;
     HW_GPIO_Write( RADIO_NSS_PORT, RADIO_NSS_PIN, 1 );
+
+    SpiTransactions++;
+    if( done == true )
+    {
+        SX1276ShadowUpdate( addr, buffer, size );
+    }
+    else
+    {
+        SX1276ShadowInvalidate( addr, size );
+    }
 }
 
 void SX1276ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
+    bool done;
 
     //NSS = 0;
     HW_GPIO_Write( RADIO_NSS_PORT, RADIO_NSS_PIN, 0 );
 
     HW_SPI_InOut( addr & 0x7F );
-
-    for( i = 0; i < size; i++ )
-    {
-        buffer[i] = HW_SPI_InOut( 0 );
-    }
+    done = HW_SPI_Transfer( NULL, buffer, size );
 
     //NSS = 1;
     HW_GPIO_Write( RADIO_NSS_PORT, RADIO_NSS_PIN, 1 );
+
+    SpiTransactions++;
+    if( done == true )
+    {
+        SX1276ShadowUpdate( addr & 0x7F, buffer, size );
+    }
+    else
+    {
+        // The bytes not received read as 0, they must not be cached
+        SX1276ShadowInvalidate( addr & 0x7F, size );
+    }
 }
 
 void SX1276WriteFifo( uint8_t *buffer, uint8_t size )
@@ -1401,6 +1739,8 @@ uint32_t SX1276GetRadioWakeUpTime( void )
 
 void SX1276OnTimeoutIrq( void )
 {
+    Trace_Record( TRACE_RADIO_TIMEOUT, SX1276.Settings.State, 0 );
+
     switch( SX1276.Settings.State )
     {
     case RF_RX_RUNNING:
@@ -1425,6 +1765,8 @@ void SX1276OnTimeoutIrq( void )
             }
             else
             {
+                // The FSK receiver runs until it is told to stop
+                SX1276SetOpMode( RF_OPMODE_STANDBY );
                 SX1276.Settings.State = RF_IDLE;
                 TimerStop( &RxTimeoutSyncWord );
             }
@@ -1478,6 +1820,8 @@ void SX1276OnDio0Irq( void )
 {
     volatile uint8_t irqFlags = 0;
 
+    Trace_Record( TRACE_RADIO_DIO, 0, SX1276.Settings.State );
+
     switch( SX1276.Settings.State )
     {
         case RF_RX_RUNNING:
@@ -1502,6 +1846,8 @@ void SX1276OnDio0Irq( void )
                         if( SX1276.Settings.Fsk.RxContinuous == false )
                         {
                             TimerStop( &RxTimeoutSyncWord );
+                            // The FSK receiver runs until it is told to stop
+                            SX1276SetOpMode( RF_OPMODE_STANDBY );
                             SX1276.Settings.State = RF_IDLE;
                         }
                         else
@@ -1547,6 +1893,8 @@ void SX1276OnDio0Irq( void )
 
                 if( SX1276.Settings.Fsk.RxContinuous == false )
                 {
+                    // The FSK receiver runs until it is told to stop
+                    SX1276SetOpMode( RF_OPMODE_STANDBY );
                     SX1276.Settings.State = RF_IDLE;
                     TimerStop( &RxTimeoutSyncWord );
                 }
@@ -1581,6 +1929,7 @@ void SX1276OnDio0Irq( void )
 
                         if( SX1276.Settings.LoRa.RxContinuous == false )
                         {
+                            Energy_SetRadioState( ENERGY_RADIO_STANDBY );
                             SX1276.Settings.State = RF_IDLE;
                         }
                         TimerStop( &RxTimeoutTimer );
@@ -1637,6 +1986,8 @@ void SX1276OnDio0Irq( void )
 
                     if( SX1276.Settings.LoRa.RxContinuous == false )
                     {
+                        // The radio falls back to standby at the end of a single reception
+                        Energy_SetRadioState( ENERGY_RADIO_STANDBY );
                         SX1276.Settings.State = RF_IDLE;
                     }
                     TimerStop( &RxTimeoutTimer );
@@ -1661,9 +2012,19 @@ void SX1276OnDio0Irq( void )
             case MODEM_LORA:
                 // Clear Irq
                 SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_TXDONE );
-                // Intentional fall through
+                // The radio falls back to standby at the end of the transmission
+                Energy_SetRadioState( ENERGY_RADIO_STANDBY );
+                SX1276.Settings.State = RF_IDLE;
+                if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+                {
+                    RadioEvents->TxDone( );
+                    //PRINTF( "txDone\n\r" );
+                }
+                break;
             case MODEM_FSK:
             default:
+                // The FSK transmitter keeps sending until it is told to stop
+                SX1276SetOpMode( RF_OPMODE_STANDBY );
                 SX1276.Settings.State = RF_IDLE;
                 if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
                 {
@@ -1680,6 +2041,8 @@ void SX1276OnDio0Irq( void )
 
 void SX1276OnDio1Irq( void )
 {
+    Trace_Record( TRACE_RADIO_DIO, 1, SX1276.Settings.State );
+
     switch( SX1276.Settings.State )
     {
         case RF_RX_RUNNING:
@@ -1717,6 +2080,7 @@ void SX1276OnDio1Irq( void )
                 // Clear Irq
                 SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_RXTIMEOUT );
 
+                Energy_SetRadioState( ENERGY_RADIO_STANDBY );
                 SX1276.Settings.State = RF_IDLE;
                 if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
                 {
@@ -1760,6 +2124,8 @@ void SX1276OnDio2Irq( void )
 {
     uint32_t afcChannel = 0;
 
+    Trace_Record( TRACE_RADIO_DIO, 2, SX1276.Settings.State );
+
     switch( SX1276.Settings.State )
     {
         case RF_RX_RUNNING:
@@ -1831,6 +2197,8 @@ void SX1276OnDio2Irq( void )
 
 void SX1276OnDio3Irq( void )
 {
+    Trace_Record( TRACE_RADIO_DIO, 3, SX1276.Settings.State );
+
     switch( SX1276.Settings.Modem )
     {
     case MODEM_FSK:
@@ -1840,6 +2208,8 @@ void SX1276OnDio3Irq( void )
         {
             // Clear Irq
             SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_CADDETECTED | RFLR_IRQFLAGS_CADDONE );
+            // The radio falls back to standby at the end of the CAD
+            Energy_SetRadioState( ENERGY_RADIO_STANDBY );
             if( ( RadioEvents != NULL ) && ( RadioEvents->CadDone != NULL ) )
             {
                 RadioEvents->CadDone( true );
@@ -1849,6 +2219,7 @@ void SX1276OnDio3Irq( void )
         {
             // Clear Irq
             SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_CADDONE );
+            Energy_SetRadioState( ENERGY_RADIO_STANDBY );
             if( ( RadioEvents != NULL ) && ( RadioEvents->CadDone != NULL ) )
             {
                 RadioEvents->CadDone( false );
@@ -1862,6 +2233,8 @@ void SX1276OnDio3Irq( void )
 
 void SX1276OnDio4Irq( void )
 {
+    Trace_Record( TRACE_RADIO_DIO, 4, SX1276.Settings.State );
+
     switch( SX1276.Settings.Modem )
     {
     case MODEM_FSK:
@@ -1881,6 +2254,8 @@ void SX1276OnDio4Irq( void )
 
 void SX1276OnDio5Irq( void )
 {
+    Trace_Record( TRACE_RADIO_DIO, 5, SX1276.Settings.State );
+
     switch( SX1276.Settings.Modem )
     {
     case MODEM_FSK:
@@ -70,6 +70,7 @@ Maintainer: Miguel Luis and Gregory Cristian
  */
 #define LORA_MAC_PUBLIC_SYNCWORD                    0x34
 
+
 /*!
  * Radio FSK modem parameters
  */
@@ -311,11 +312,23 @@ void SX1276SetChannel( uint32_t freq );
  */
 bool SX1276IsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
 
+/*!
+ * \brief Sets the radio in reception on the channel without reception
+ *        interrupts, SX1276ReadRssi then measures it
+ *
+ * \param [IN] modem      Radio modem to be used [0: FSK, 1: LoRa]
+ * \param [IN] freq       Channel RF frequency
+ */
+void SX1276StartCarrierSense( RadioModems_t modem, uint32_t freq );
+
 /*!
  * \brief Generates a 32 bits random value based on the RSSI readings
  *
- * \remark This function sets the radio in LoRa modem mode and disables
- *         all interrupts.
+ * \remark The wideband RSSI is sampled 16 times, 1 ms apart, in every LoRa
+ *         reception window and carrier sense, while the radio receives.
+ *         When fewer than 32 bits were gathered this way, this function
+ *         sets the radio in LoRa modem mode, disables all interrupts and
+ *         samples the missing bits.
  *         After calling this function either SX1276SetRxConfig or
  *         SX1276SetTxConfig functions must be called.
  *
@@ -504,6 +517,9 @@ void SX1276WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size );
  * \param [IN] addr First Radio register address
  * \param [OUT] buffer Buffer where to copy the registers data
  * \param [IN] size Number of registers to be read
+ *
+ * \remark When the SPI stops responding the bytes not received read as 0
+ *         and the shadow copy of the registers is dropped
  */
 void SX1276ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size );
 
@@ -531,4 +547,23 @@ void SX1276SetPublicNetwork( bool enable );
  */
 uint32_t SX1276GetRadioWakeUpTime( void );
 
+/*!
+ * \brief   Gets the number of SPI transactions issued to the radio
+ *
+ * \remark  Register reads served from the driver shadow copy are not counted
+ *
+ * \retval  Number of SPI transactions since power up
+ */
+uint32_t SX1276GetSpiTransactions( void );
+
+/*!
+ * \brief   Gets a register from the driver shadow copy
+ *
+ * \param [IN]  modem Register page of the addresses 0x0D to 0x3F
+ * \param [IN]  addr  Register address
+ * \param [OUT] data  Register value
+ * \retval  Returns false when the shadow copy does not hold the register
+ */
+bool SX1276GetShadowRegister( RadioModems_t modem, uint8_t addr, uint8_t *data );
+
 #endif /* __SX1276_H__ */
@@ -109,6 +109,7 @@ const struct Radio_s Radio =
     SX1276SetModem,
     SX1276SetChannel,
     SX1276IsChannelFree,
+    SX1276StartCarrierSense,
     SX1276Random,
     SX1276SetRxConfig,
     SX1276SetTxConfig,
@@ -140,9 +141,13 @@ void SX1276SetXO( uint8_t state )
 
   if (state == SET )
   {
-    TCXO_ON(); 
+    /* Only pay the TCXO start up time when it was actually off */
+    if ( HW_GPIO_Read( RADIO_TCXO_VCC_PORT, RADIO_TCXO_VCC_PIN ) == 0 )
+    {
+      TCXO_ON(); 
     
-    DelayMs( BOARD_WAKEUP_TIME ); //start up time of TCXO
+      TimerDelayMs( BOARD_WAKEUP_TIME ); //start up time of TCXO
+    }
   }
   else
   {
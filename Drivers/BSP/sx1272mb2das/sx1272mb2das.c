@@ -101,6 +101,7 @@ const struct Radio_s Radio =
     SX1272SetModem,
     SX1272SetChannel,
     SX1272IsChannelFree,
+    SX1272StartCarrierSense,
     SX1272Random,
     SX1272SetRxConfig,
     SX1272SetTxConfig,
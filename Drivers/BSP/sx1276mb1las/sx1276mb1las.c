@@ -107,6 +107,7 @@ const struct Radio_s Radio =
     SX1276SetModem,
     SX1276SetChannel,
     SX1276IsChannelFree,
+    SX1276StartCarrierSense,
     SX1276Random,
     SX1276SetRxConfig,
     SX1276SetTxConfig,
@@ -24,8 +24,10 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #include <stdint.h>
 #include "radio.h"
 #include "timeServer.h"
+#include "trace.h"
 #include "LoRaMac.h"
 #include "region/Region.h"
+#include "region/RegionCommon.h"
 #include "LoRaMacCrypto.h"
 
 #include "debug.h"
@@ -48,11 +50,137 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
  */
 #define LORA_MAC_COMMAND_MAX_FOPTS_LENGTH           15
 
+/*!
+ * Time after the end of the last reception window at which the reception
+ * watchdog gives up on a radio which did not report it, in ms. Also used as
+ * the slack of the watchdog timer.
+ */
+#define LORAMAC_RX_WATCHDOG_MARGIN                  1000
+
+/*!
+ * Margin over the radio wake-up time above which a measured reception window
+ * wake-up latency is discarded, in ms
+ */
+#define LORAMAC_RX_WAKEUP_LATENCY_MARGIN            10
+
+/*!
+ * Number of sessions of the regions left kept by LoRaMacSwitchRegion, the
+ * oldest is dropped first
+ */
+#ifndef LORAMAC_REGION_CONTEXTS
+#define LORAMAC_REGION_CONTEXTS                     3
+#endif
+
+/*!
+ * Number of channels probed by channel activity detection before an uplink
+ * is delayed. 0 sends without sensing the channel.
+ */
+#ifndef LORAMAC_CAD_ATTEMPTS
+#define LORAMAC_CAD_ATTEMPTS                        0
+#endif
+
+/*!
+ * Time after which a channel activity detection which did not complete counts
+ * as a busy channel, in ms
+ */
+#define LORAMAC_CAD_TIMEOUT                         100
+
+/*!
+ * The FSK datarates have no CAD, their channel is free when its RSSI stays
+ * under LORAMAC_FSK_RSSI_FREE_TH dBm for LORAMAC_FSK_CARRIER_SENSE_TIME ms
+ */
+#define LORAMAC_FSK_CARRIER_SENSE_TIME              5
+#define LORAMAC_FSK_RSSI_FREE_TH                    -85
+
+/*!
+ * Number of channels probed by the carrier sense of the listen before talk
+ * regions before an uplink is delayed
+ */
+#define LORAMAC_LBT_ATTEMPTS                        16
+
+/*!
+ * Period of the RSSI readings of a carrier sense, in ms. The first one is
+ * taken a period after the receiver started.
+ */
+#define LORAMAC_CARRIER_SENSE_PERIOD                1
+
+/*!
+ * Range of the random delay, in ms, before retrying once all the probed
+ * channels were busy
+ */
+#define LORAMAC_CAD_BACKOFF_MIN                     100
+#define LORAMAC_CAD_BACKOFF_MAX                     1000
+
+/*!
+ * Number of delays after which an uplink still finding the channels busy is
+ * given up, confirmed with LORAMAC_EVENT_INFO_STATUS_CHANNEL_BUSY
+ */
+#ifndef LORAMAC_CAD_BACKOFFS
+#define LORAMAC_CAD_BACKOFFS                        8
+#endif
+
 /*!
  * LoRaMac region.
  */
 static LoRaMacRegion_t LoRaMacRegion;
 
+/*!
+ * Operations of LoRaMacRegion, looked up at initialization and on region
+ * switch
+ */
+static const RegionOps_t* LoRaMacRegionOps;
+
+/*!
+ * Region PHY parameters read on every frame, indexed by datarate where
+ * applicable. Refreshed by RegionPhyCacheUpdate when the region, the dwell
+ * times or the repeater support change
+ */
+static PhyCache_t RegionPhyCache;
+
+/*!
+ * MAC session of a region left by LoRaMacSwitchRegion. The channels, masks
+ * and bands are kept by the region implementation itself
+ */
+typedef struct sLoRaMacRegionContext
+{
+    /*!
+     * Set to true when the context holds a session
+     */
+    bool Valid;
+    /*!
+     * Region of the session
+     */
+    LoRaMacRegion_t Region;
+    /*!
+     * Order of the save, the oldest session is dropped first
+     */
+    uint32_t Saved;
+    bool IsNetworkJoined;
+    uint32_t NetID;
+    uint32_t DevAddr;
+    uint8_t NwkSKey[16];
+    uint8_t AppSKey[16];
+    uint32_t UpLinkCounter;
+    uint32_t DownLinkCounter;
+    uint32_t AdrAckCounter;
+    bool DutyCycleOn;
+    TimerTime_t AggregatedLastTxDoneTime;
+    TimerTime_t AggregatedTimeOff;
+    uint8_t Channel;
+    LoRaMacParams_t Params;
+    LoRaMacParams_t ParamsDefaults;
+}LoRaMacRegionContext_t;
+
+/*!
+ * Sessions of the regions left by LoRaMacSwitchRegion
+ */
+static LoRaMacRegionContext_t RegionContexts[LORAMAC_REGION_CONTEXTS];
+
+/*!
+ * Sessions saved so far, orders the contexts
+ */
+static uint32_t RegionContextSaves = 0;
+
 /*!
  * LoRaMac duty cycle for the back-off procedure during the first hour.
  */
@@ -300,6 +428,7 @@ enum eLoRaMacState
     LORAMAC_TX_DELAYED    = 0x00000010,
     LORAMAC_TX_CONFIG     = 0x00000020,
     LORAMAC_RX_ABORT      = 0x00000040,
+    LORAMAC_TX_CAD        = 0x00000080,
 };
 
 /*!
@@ -308,7 +437,8 @@ enum eLoRaMacState
 uint32_t LoRaMacState = LORAMAC_IDLE;
 
 /*!
- * LoRaMac timer used to check the LoRaMacState (runs every second)
+ * LoRaMac timer used to check the LoRaMacState. It is triggered by the events
+ * completing an operation and otherwise runs as a watchdog
  */
 static TimerEvent_t MacStateCheckTimer;
 
@@ -332,6 +462,47 @@ static RadioEvents_t RadioEvents;
  */
 static TimerEvent_t TxDelayedTimer;
 
+/*!
+ * LoRaMac channel activity detection timeout timer
+ */
+static TimerEvent_t CadTimeoutTimer;
+
+/*!
+ * LoRaMac carrier sense timer, reads the RSSI of the sensed channel
+ */
+static TimerEvent_t CarrierSenseTimer;
+
+/*!
+ * Start time, modem, length in ms and free RSSI threshold of the running
+ * carrier sense
+ */
+static TimerTime_t CarrierSenseStart = 0;
+static RadioModems_t CarrierSenseModem = MODEM_LORA;
+static uint32_t CarrierSenseTime = 0;
+static int16_t CarrierSenseRssiTh = 0;
+
+/*!
+ * Number of busy channels found for the pending uplink
+ */
+static uint8_t CadAttempts = 0;
+
+/*!
+ * Number of times the pending uplink was delayed after finding all the
+ * probed channels busy
+ */
+static uint8_t CadBackOffs = 0;
+
+/*!
+ * Set while TxDelayedTimer runs for such a delay, the frame already prepared
+ * is sent as it is
+ */
+static bool CadBackOffRunning = false;
+
+/*!
+ * Channels found busy for the pending uplink, left out of the next selection
+ */
+static uint16_t CadBusyChannels[REGION_COMMON_BUSY_MASK_SIZE];
+
 /*!
  * LoRaMac reception windows timers
  */
@@ -346,6 +517,28 @@ static TimerEvent_t RxWindowTimer2;
 static uint32_t RxWindow1Delay;
 static uint32_t RxWindow2Delay;
 
+/*!
+ * Time at which the reception window timers have been started
+ */
+static TimerTime_t RxWindowTimersStart;
+
+/*!
+ * Measured latency between the expected and the actual expiry of a reception
+ * window timer, covering the RTC alarm interrupt and the stop mode exit [ms]
+ */
+static uint32_t RxWakeUpAlarmLatency;
+
+/*!
+ * Measured latency between a reception window timer expiry and the radio
+ * being in RX, covering the TCXO start up and the SPI configuration [ms]
+ */
+static uint32_t RxWakeUpSetupLatency;
+
+/*!
+ * Set to true once the reception window wake-up latencies have been measured
+ */
+static bool RxWakeUpCalibrated = false;
+
 /*!
  * LoRaMac Rx windows configuration
  */
@@ -357,6 +550,12 @@ static RxConfigParams_t RxWindow2Config;
  */
 static TimerEvent_t AckTimeoutTimer;
 
+/*!
+ * Reception watchdog timer. The radio ends LoRa single reception windows on
+ * its symbol timeout without an MCU timer, this timer covers a lost DIO.
+ */
+static TimerEvent_t RxWatchdogTimer;
+
 /*!
  * Number of trials to get a frame acknowledged
  */
@@ -443,11 +642,85 @@ static void OnRadioRxError( void );
  */
 static void OnRadioRxTimeout( void );
 
+/*!
+ * \brief Records the outcome of a receive window in the statistics of the
+ *        channel of the last uplink. The continuous reception of class C is
+ *        not tied to an uplink and is left out.
+ *
+ * \param [IN] received Set to true if a valid downlink was received
+ * \param [IN] rssi RSSI of the downlink
+ * \param [IN] snr SNR of the downlink
+ */
+static void RecordRxWindowStats( bool received, int16_t rssi, int8_t snr );
+
+/*!
+ * \brief Function executed on Radio CAD Done event
+ *
+ * \param [IN] channelActivityDetected Set to true if the channel is busy
+ */
+static void OnRadioCadDone( bool channelActivityDetected );
+
+/*!
+ * \brief Function executed when the channel activity detection does not complete
+ */
+static void OnCadTimeoutTimerEvent( void );
+
+/*!
+ * \brief Senses the selected channel before sending the prepared frame on it
+ *
+ * \retval Status of the operation
+ */
+static LoRaMacStatus_t StartChannelActivityDetection( void );
+
+/*!
+ * \brief Measures the RSSI of the selected channel before sending the
+ *        prepared frame on it, without blocking
+ *
+ * \param [IN] senseTime Time the RSSI must stay under the threshold [ms]
+ * \param [IN] rssiThresh RSSI threshold [dBm]
+ *
+ * \retval Status of the operation
+ */
+static LoRaMacStatus_t StartCarrierSense( uint32_t senseTime, int16_t rssiThresh );
+
+/*!
+ * \brief Function executed on the carrier sense timer event, reads the RSSI
+ */
+static void OnCarrierSenseTimerEvent( void );
+
+/*!
+ * \brief Continues the uplink after the selected channel was found busy, or
+ *        its channel activity detection did not complete
+ */
+static void OnChannelNotFree( void );
+
+/*!
+ * \brief Forgets the busy channels of the uplink
+ */
+static void CadReset( void );
+
+/*!
+ * \brief Gives the pending uplink up and confirms it
+ *
+ * \param [IN] status Status of the confirm
+ */
+static void AbortUplink( LoRaMacEventInfoStatus_t status );
+
 /*!
  * \brief Function executed on Resend Frame timer event.
  */
 static void OnMacStateCheckTimerEvent( void );
 
+/*!
+ * \brief Trigs the Mac layer state check as soon as possible
+ */
+static void MacStateCheckTrigger( void );
+
+/*!
+ * \brief Starts the Mac layer state check watchdog
+ */
+static void MacStateCheckWatchdogStart( void );
+
 /*!
  * \brief Function executed on duty cycle delayed Tx  timer event
  */
@@ -468,6 +741,11 @@ static void OnRxWindow2TimerEvent( void );
  */
 static void OnAckTimeoutTimerEvent( void );
 
+/*!
+ * \brief Function executed on the reception watchdog timer event
+ */
+static void OnRxWatchdogTimerEvent( void );
+
 /*!
  * \brief Initializes and opens the reception window
  *
@@ -476,6 +754,35 @@ static void OnAckTimeoutTimerEvent( void );
  */
 static void RxWindowSetup( bool rxContinuous, uint32_t maxRxWindow );
 
+/*!
+ * \brief Updates the wake-up latency estimates after a reception window
+ *        has been opened
+ *
+ * \param [IN] windowDelay Delay the reception window timer was started with
+ * \param [IN] timerTime Time at which the reception window timer expired
+ */
+static void RxWakeUpLatencyUpdate( uint32_t windowDelay, TimerTime_t timerTime );
+
+/*!
+ * \brief Filters a wake-up latency estimate with a new measurement
+ *
+ * \param [IN] estimate Current latency estimate
+ * \param [IN] sample New latency measurement
+ *
+ * \retval Updated latency estimate
+ */
+static uint32_t RxWakeUpLatencyFilter( uint32_t estimate, uint32_t sample );
+
+/*!
+ * \brief Compensates a reception window delay computed with the nominal radio
+ *        wake-up time by the measured wake-up latency
+ *
+ * \param [IN] delay Reception window delay computed by the region
+ *
+ * \retval Compensated reception window delay
+ */
+static uint32_t RxWakeUpCompensate( uint32_t delay );
+
 /*!
  * \brief Adds a new MAC command to be sent.
  *
@@ -570,6 +877,16 @@ static LoRaMacStatus_t ScheduleTx( void );
  */
 static void CalculateBackOff( uint8_t channel );
 
+/*
+ * \brief Computes the time ScheduleTx would wait before sending an uplink,
+ *        without changing the MAC state.
+ *
+ * \param [OUT] delay      Time to wait in ms
+ *
+ * \retval Status of the operation
+ */
+static LoRaMacStatus_t ComputeNextTxDelay( TimerTime_t* delay );
+
 /*!
  * \brief LoRaMAC layer prepared frame buffer transmission with channel specification
  *
@@ -608,6 +925,38 @@ LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequency, uint
  */
 static void ResetMacParameters( void );
 
+/*!
+ * \brief Reads the region PHY parameters cached in RegionPhyCache
+ */
+static void RegionPhyCacheUpdate( void );
+
+/*!
+ * \brief Loads the default MAC parameters of the region and initializes it
+ */
+static void RegionDefaultsInit( void );
+
+/*!
+ * \brief Moves the session saved for a region out of RegionContexts, freeing
+ *        its context
+ *
+ * \param [IN] region Region of the session
+ * \param [OUT] session Session saved
+ *
+ * \retval Returns true if a session was saved, false if none was
+ */
+static bool RegionContextTake( LoRaMacRegion_t region, LoRaMacRegionContext_t* session );
+
+/*!
+ * \brief Saves the MAC session of the current region into RegionContexts,
+ *        dropping the oldest session when all of them are taken
+ */
+static void RegionContextSave( void );
+
+/*!
+ * \brief Restores a MAC session taken from RegionContexts
+ */
+static void RegionContextRestore( const LoRaMacRegionContext_t* session );
+
 static void OnRadioTxDone( void )
 {
     GetPhyParams_t getPhy;
@@ -627,6 +976,7 @@ static void OnRadioTxDone( void )
     // Setup timers
     if( IsRxWindowsEnabled == true )
     {
+        RxWindowTimersStart = TimerGetCurrentTime( );
         TimerSetValue( &RxWindowTimer1, RxWindow1Delay );
         TimerStart( &RxWindowTimer1 );
         if( LoRaMacDeviceClass != CLASS_C )
@@ -637,10 +987,16 @@ static void OnRadioTxDone( void )
         if( ( LoRaMacDeviceClass == CLASS_C ) || ( NodeAckRequested == true ) )
         {
             getPhy.Attribute = PHY_ACK_TIMEOUT;
-            phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
+            phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
             TimerSetValue( &AckTimeoutTimer, RxWindow2Delay + phyParam.Value );
             TimerStart( &AckTimeoutTimer );
         }
+        // One coarse watchdog for the single reception windows of the uplink,
+        // RX1 in class C, RX2 otherwise
+        TimerSetValue( &RxWatchdogTimer, ( ( LoRaMacDeviceClass == CLASS_C ) ? RxWindow1Delay : RxWindow2Delay ) +
+                                         LoRaMacParams.MaxRxWindow + LORAMAC_RX_WATCHDOG_MARGIN );
+        TimerSetSlack( &RxWatchdogTimer, LORAMAC_RX_WATCHDOG_MARGIN );
+        TimerStart( &RxWatchdogTimer );
     }
     else
     {
@@ -652,6 +1008,7 @@ static void OnRadioTxDone( void )
             LoRaMacFlags.Bits.McpsReq = 1;
         }
         LoRaMacFlags.Bits.MacDone = 1;
+        MacStateCheckTrigger( );
     }
 
     // Verify if the last uplink was a join request
@@ -666,11 +1023,15 @@ static void OnRadioTxDone( void )
 
     // Store last Tx channel
     LastTxChannel = Channel;
+    if( NodeAckRequested == true )
+    {
+        RegionCommonChannelStatsTx( Channel );
+    }
     // Update last tx done time for the current channel
     txDone.Channel = Channel;
     txDone.Joined = IsLoRaMacNetworkJoined;
     txDone.LastTxDoneTime = curTime;
-    RegionSetBandTxDone( LoRaMacRegion, &txDone );
+    LoRaMacRegionOps->SetBandTxDone( &txDone );
     // Update Aggregated last tx done time
     AggregatedLastTxDoneTime = curTime;
 
@@ -694,8 +1055,7 @@ static void PrepareRxDoneAbort( void )
     LoRaMacFlags.Bits.MacDone = 1;
 
     // Trig OnMacCheckTimerEvent call as soon as possible
-    TimerSetValue( &MacStateCheckTimer, 1 );
-    TimerStart( &MacStateCheckTimer );
+    MacStateCheckTrigger( );
 }
 
 static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
@@ -703,8 +1063,6 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
     LoRaMacHeader_t macHdr;
     LoRaMacFrameCtrl_t fCtrl;
     ApplyCFListParams_t applyCFList;
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     bool skipIndication = false;
 
     uint8_t pktHeaderLen = 0;
@@ -798,9 +1156,10 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
                 // Size of the regular payload is 12. Plus 1 byte MHDR and 4 bytes MIC
                 applyCFList.Size = size - 17;
 
-                RegionApplyCFList( LoRaMacRegion, &applyCFList );
+                LoRaMacRegionOps->ApplyCFList( &applyCFList );
 
                 MlmeConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+                RecordRxWindowStats( true, rssi, snr );
                 IsLoRaMacNetworkJoined = true;
                 LoRaMacParams.ChannelsDatarate = LoRaMacParamsDefaults.ChannelsDatarate;
             }
@@ -813,17 +1172,7 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
         case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
             {
                 // Check if the received payload size is valid
-                getPhy.UplinkDwellTime = LoRaMacParams.DownlinkDwellTime;
-                getPhy.Datarate = McpsIndication.RxDatarate;
-                getPhy.Attribute = PHY_MAX_PAYLOAD;
-
-                // Get the maximum payload length
-                if( RepeaterSupport == true )
-                {
-                    getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
-                }
-                phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-                if( MAX( 0, ( int16_t )( ( int16_t )size - ( int16_t )LORA_MAC_FRMPAYLOAD_OVERHEAD ) ) > phyParam.Value )
+                if( MAX( 0, ( int16_t )( ( int16_t )size - ( int16_t )LORA_MAC_FRMPAYLOAD_OVERHEAD ) ) > RegionPhyCache.MaxRxPayload[McpsIndication.RxDatarate & 0x0F] )
                 {
                     McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
                     PrepareRxDoneAbort( );
@@ -903,9 +1252,7 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
                 }
 
                 // Check for a the maximum allowed counter difference
-                getPhy.Attribute = PHY_MAX_FCNT_GAP;
-                phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-                if( sequenceCounterDiff >= phyParam.Value )
+                if( sequenceCounterDiff >= RegionPhyCache.MaxFCntGap )
                 {
                     McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_TOO_MANY_FRAMES_LOSS;
                     McpsIndication.DownLinkCounter = downLinkCounter;
@@ -923,6 +1270,7 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
                     McpsIndication.DownLinkCounter = downLinkCounter;
 
                     McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+                    RecordRxWindowStats( true, rssi, snr );
 
                     AdrAckCounter = 0;
                     MacCommandsBufferToRepeatIndex = 0;
@@ -1062,6 +1410,7 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
                         {
                             McpsConfirm.AckReceived = true;
                             McpsIndication.AckReceived = true;
+                            RegionCommonChannelStatsAck( LastTxChannel );
 
                             // Stop the AckTimeout timer as no more retransmissions
                             // are needed.
@@ -1113,12 +1462,13 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
     LoRaMacFlags.Bits.MacDone = 1;
 
     // Trig OnMacCheckTimerEvent call as soon as possible
-    TimerSetValue( &MacStateCheckTimer, 1 );
-    TimerStart( &MacStateCheckTimer );
+    MacStateCheckTrigger( );
 }
 
 static void OnRadioTxTimeout( void )
 {
+    Trace_Record( TRACE_MAC_TX_TIMEOUT, 0, 0 );
+
     if( LoRaMacDeviceClass != CLASS_C )
     {
         Radio.Sleep( );
@@ -1131,10 +1481,30 @@ static void OnRadioTxTimeout( void )
     McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT;
     MlmeConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT;
     LoRaMacFlags.Bits.MacDone = 1;
+    MacStateCheckTrigger( );
+}
+
+static void RecordRxWindowStats( bool received, int16_t rssi, int8_t snr )
+{
+    if( ( LoRaMacDeviceClass == CLASS_C ) && ( RxSlot != 0 ) )
+    {
+        return;
+    }
+    if( received == true )
+    {
+        RegionCommonChannelStatsRx( LastTxChannel, rssi, snr );
+    }
+    else
+    {
+        RegionCommonChannelStatsRxTimeout( LastTxChannel );
+    }
 }
 
 static void OnRadioRxError( void )
 {
+    Trace_Record( TRACE_MAC_RX_ERROR, RxSlot, 0 );
+    RecordRxWindowStats( false, 0, 0 );
+
     if( LoRaMacDeviceClass != CLASS_C )
     {
         Radio.Sleep( );
@@ -1155,6 +1525,7 @@ static void OnRadioRxError( void )
         if( TimerGetElapsedTime( AggregatedLastTxDoneTime ) >= RxWindow2Delay )
         {
             LoRaMacFlags.Bits.MacDone = 1;
+            MacStateCheckTrigger( );
         }
     }
     else
@@ -1165,11 +1536,15 @@ static void OnRadioRxError( void )
         }
         MlmeConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX2_ERROR;
         LoRaMacFlags.Bits.MacDone = 1;
+        MacStateCheckTrigger( );
     }
 }
 
 static void OnRadioRxTimeout( void )
 {
+    Trace_Record( TRACE_MAC_RX_TIMEOUT, RxSlot, 0 );
+    RecordRxWindowStats( false, 0, 0 );
+
     if( LoRaMacDeviceClass != CLASS_C )
     {
         Radio.Sleep( );
@@ -1190,6 +1565,7 @@ static void OnRadioRxTimeout( void )
         if( TimerGetElapsedTime( AggregatedLastTxDoneTime ) >= RxWindow2Delay )
         {
             LoRaMacFlags.Bits.MacDone = 1;
+            MacStateCheckTrigger( );
         }
     }
     else
@@ -1203,14 +1579,210 @@ static void OnRadioRxTimeout( void )
         if( LoRaMacDeviceClass != CLASS_C )
         {
             LoRaMacFlags.Bits.MacDone = 1;
+            MacStateCheckTrigger( );
         }
     }
 }
 
-static void OnMacStateCheckTimerEvent( void )
+static LoRaMacStatus_t StartChannelActivityDetection( void )
+{
+    TxConfigParams_t txConfig;
+    int8_t txPower = 0;
+    TimerTime_t txTimeOnAir = 0;
+
+    // Tune the radio to the channel and datarate of the frame
+    txConfig.Channel = Channel;
+    txConfig.Datarate = LoRaMacParams.ChannelsDatarate;
+    txConfig.TxPower = LoRaMacParams.ChannelsTxPower;
+    txConfig.MaxEirp = LoRaMacParams.MaxEirp;
+    txConfig.AntennaGain = LoRaMacParams.AntennaGain;
+    txConfig.PktLen = LoRaMacBufferPktLen;
+    LoRaMacRegionOps->TxConfig( &txConfig, &txPower, &txTimeOnAir );
+
+    // Hold new requests until the frame is sent or delayed
+    LoRaMacState |= LORAMAC_TX_DELAYED | LORAMAC_TX_CAD;
+    TimerStart( &CadTimeoutTimer );
+    Radio.StartCad( );
+
+    return LORAMAC_STATUS_OK;
+}
+
+static void OnRadioCadDone( bool channelActivityDetected )
+{
+    TimerStop( &CadTimeoutTimer );
+
+    if( ( LoRaMacState & LORAMAC_TX_CAD ) == 0 )
+    {
+        return;
+    }
+    LoRaMacState &= ~( LORAMAC_TX_DELAYED | LORAMAC_TX_CAD );
+
+    if( channelActivityDetected == false )
+    {
+        CadReset( );
+        CadBackOffs = 0;
+        SendFrameOnChannel( Channel );
+        return;
+    }
+
+    RegionCommonChannelStatsBusy( Channel );
+    OnChannelNotFree( );
+}
+
+static void OnCadTimeoutTimerEvent( void )
+{
+    TimerStop( &CadTimeoutTimer );
+
+    if( ( LoRaMacState & LORAMAC_TX_CAD ) == 0 )
+    {
+        return;
+    }
+    LoRaMacState &= ~( LORAMAC_TX_DELAYED | LORAMAC_TX_CAD );
+
+    // No CAD result, the channel is not known to be free
+    Radio.Standby( );
+    OnChannelNotFree( );
+}
+
+static LoRaMacStatus_t StartCarrierSense( uint32_t senseTime, int16_t rssiThresh )
 {
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_CHANNELS;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+
+    CarrierSenseModem = MODEM_FSK;
+    if( RegionPhyCache.Bandwidth[LoRaMacParams.ChannelsDatarate & 0x0F] != 0 )
+    {
+        CarrierSenseModem = MODEM_LORA;
+    }
+    CarrierSenseTime = senseTime;
+    CarrierSenseRssiTh = rssiThresh;
+
+    // Hold new requests until the frame is sent or delayed. The RSSI is read
+    // on a timer, the MCU sleeps in between
+    LoRaMacState |= LORAMAC_TX_DELAYED | LORAMAC_TX_CAD;
+    Radio.StartCarrierSense( CarrierSenseModem, phyParam.Channels[Channel].Frequency );
+    CarrierSenseStart = TimerGetCurrentTime( );
+    TimerStart( &CarrierSenseTimer );
+
+    return LORAMAC_STATUS_OK;
+}
+
+static void OnCarrierSenseTimerEvent( void )
+{
+    TimerStop( &CarrierSenseTimer );
+
+    if( ( LoRaMacState & LORAMAC_TX_CAD ) == 0 )
+    {
+        return;
+    }
+
+    if( Radio.Rssi( CarrierSenseModem ) > CarrierSenseRssiTh )
+    {
+        LoRaMacState &= ~( LORAMAC_TX_DELAYED | LORAMAC_TX_CAD );
+        Radio.Standby( );
+        RegionCommonChannelStatsBusy( Channel );
+        OnChannelNotFree( );
+        return;
+    }
+
+    if( TimerGetElapsedTime( CarrierSenseStart ) < ( CarrierSenseTime + LORAMAC_CARRIER_SENSE_PERIOD ) )
+    {
+        TimerStart( &CarrierSenseTimer );
+        return;
+    }
+
+    // The channel stayed free for the whole sense time
+    LoRaMacState &= ~( LORAMAC_TX_DELAYED | LORAMAC_TX_CAD );
+    Radio.Standby( );
+    CadReset( );
+    CadBackOffs = 0;
+    SendFrameOnChannel( Channel );
+}
+
+static void OnChannelNotFree( void )
+{
+    LoRaMacStatus_t status;
+    uint8_t attempts = LORAMAC_CAD_ATTEMPTS;
+
+    if( RegionPhyCache.CarrierSenseTime != 0 )
+    {
+        attempts = LORAMAC_LBT_ATTEMPTS;
+    }
+
+    CadBusyChannels[Channel / 16] |= 1 << ( Channel % 16 );
+    CadAttempts++;
+    if( CadAttempts < attempts )
+    {
+        // Let the region select another channel than the busy ones
+        status = ScheduleTx( );
+        if( status != LORAMAC_STATUS_OK )
+        {
+            // The frame cannot be scheduled any more, give the uplink up
+            AbortUplink( ( status == LORAMAC_STATUS_LENGTH_ERROR ) ? LORAMAC_EVENT_INFO_STATUS_TX_DR_PAYLOAD_SIZE_ERROR :
+                                                                    LORAMAC_EVENT_INFO_STATUS_ERROR );
+        }
+        return;
+    }
+
+    // All the probed channels were busy
+    CadReset( );
+    CadBackOffs++;
+    if( CadBackOffs > LORAMAC_CAD_BACKOFFS )
+    {
+        // The channels stay busy, give the uplink up rather than holding the
+        // MAC
+        AbortUplink( LORAMAC_EVENT_INFO_STATUS_CHANNEL_BUSY );
+        return;
+    }
+
+    // Retry later
+    if( LoRaMacDeviceClass != CLASS_C )
+    {
+        Radio.Sleep( );
+    }
+    else
+    {
+        OnRxWindow2TimerEvent( );
+    }
+    LoRaMacState |= LORAMAC_TX_DELAYED;
+    CadBackOffRunning = true;
+    TimerSetValue( &TxDelayedTimer, randr( LORAMAC_CAD_BACKOFF_MIN, LORAMAC_CAD_BACKOFF_MAX ) );
+    TimerStart( &TxDelayedTimer );
+}
+
+static void CadReset( void )
+{
+    CadAttempts = 0;
+    memset1( ( uint8_t* )CadBusyChannels, 0, sizeof( CadBusyChannels ) );
+}
+
+static void AbortUplink( LoRaMacEventInfoStatus_t status )
+{
+    CadReset( );
+    CadBackOffs = 0;
+    if( LoRaMacDeviceClass != CLASS_C )
+    {
+        Radio.Sleep( );
+    }
+    else
+    {
+        OnRxWindow2TimerEvent( );
+    }
+    MlmeConfirm.Status = status;
+    McpsConfirm.Status = status;
+    MacCommandsBufferIndex = 0;
+    NodeAckRequested = false;
+    McpsConfirm.AckReceived = false;
+    McpsConfirm.NbRetries = AckTimeoutRetriesCounter;
+    LoRaMacState &= ~LORAMAC_TX_RUNNING;
+    MacStateCheckTrigger( );
+}
+
+static void OnMacStateCheckTimerEvent( void )
+{
     bool txTimeout = false;
 
     TimerStop( &MacStateCheckTimer );
@@ -1321,11 +1893,7 @@ static void OnMacStateCheckTimerEvent( void )
 
                 if( ( AckTimeoutRetriesCounter % 2 ) == 1 )
                 {
-                    getPhy.Attribute = PHY_NEXT_LOWER_TX_DR;
-                    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
-                    getPhy.Datarate = LoRaMacParams.ChannelsDatarate;
-                    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-                    LoRaMacParams.ChannelsDatarate = phyParam.Value;
+                    LoRaMacParams.ChannelsDatarate = RegionPhyCache.NextLowerTxDr[LoRaMacParams.ChannelsDatarate & 0x0F];
                 }
                 // Try to send the frame again
                 if( ScheduleTx( ) == LORAMAC_STATUS_OK )
@@ -1351,7 +1919,7 @@ static void OnMacStateCheckTimerEvent( void )
             }
             else
             {
-                RegionInitDefaults( LoRaMacRegion, INIT_TYPE_RESTORE );
+                LoRaMacRegionOps->InitDefaults( INIT_TYPE_RESTORE );
 
                 LoRaMacState &= ~LORAMAC_TX_RUNNING;
 
@@ -1390,9 +1958,8 @@ static void OnMacStateCheckTimerEvent( void )
     }
     else
     {
-        // Operation not finished restart timer
-        TimerSetValue( &MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT );
-        TimerStart( &MacStateCheckTimer );
+        // Operation not finished restart the watchdog
+        MacStateCheckWatchdogStart( );
     }
 
     if( LoRaMacFlags.Bits.McpsInd == 1 )
@@ -1410,21 +1977,40 @@ static void OnMacStateCheckTimerEvent( void )
     }
 }
 
+static void MacStateCheckTrigger( void )
+{
+    TimerSetValue( &MacStateCheckTimer, 1 );
+    TimerSetSlack( &MacStateCheckTimer, 0 );
+    TimerStart( &MacStateCheckTimer );
+}
+
+static void MacStateCheckWatchdogStart( void )
+{
+    TimerSetValue( &MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT );
+    TimerSetSlack( &MacStateCheckTimer, MAC_STATE_CHECK_SLACK );
+    TimerStart( &MacStateCheckTimer );
+}
+
 static void OnTxDelayedTimerEvent( void )
 {
     LoRaMacHeader_t macHdr;
     LoRaMacFrameCtrl_t fCtrl;
     AlternateDrParams_t altDr;
+    LoRaMacStatus_t status;
+    bool backOff = CadBackOffRunning;
 
     TimerStop( &TxDelayedTimer );
     LoRaMacState &= ~LORAMAC_TX_DELAYED;
+    CadBackOffRunning = false;
 
-    if( ( LoRaMacFlags.Bits.MlmeReq == 1 ) && ( MlmeConfirm.MlmeRequest == MLME_JOIN ) )
+    // A join request delayed because the channels were busy was not sent, it
+    // keeps its DevNonce
+    if( ( LoRaMacFlags.Bits.MlmeReq == 1 ) && ( MlmeConfirm.MlmeRequest == MLME_JOIN ) && ( backOff == false ) )
     {
         ResetMacParameters( );
 
         altDr.NbTrials = JoinRequestTrials + 1;
-        LoRaMacParams.ChannelsDatarate = RegionAlternateDr( LoRaMacRegion, &altDr );
+        LoRaMacParams.ChannelsDatarate = LoRaMacRegionOps->AlternateDr( &altDr );
 
         macHdr.Value = 0;
         macHdr.Bits.MType = FRAME_TYPE_JOIN_REQ;
@@ -1438,14 +2024,24 @@ static void OnTxDelayedTimerEvent( void )
         PrepareFrame( &macHdr, &fCtrl, 0, NULL, 0 );
     }
 
-    ScheduleTx( );
+    status = ScheduleTx( );
+    if( status != LORAMAC_STATUS_OK )
+    {
+        // Nobody waits for a return value here, confirm the failure
+        AbortUplink( ( status == LORAMAC_STATUS_LENGTH_ERROR ) ? LORAMAC_EVENT_INFO_STATUS_TX_DR_PAYLOAD_SIZE_ERROR :
+                                                                LORAMAC_EVENT_INFO_STATUS_ERROR );
+    }
 }
 
 static void OnRxWindow1TimerEvent( void )
 {
+    TimerTime_t timerTime = TimerGetCurrentTime( );
+
     TimerStop( &RxWindowTimer1 );
     RxSlot = 0;
 
+    Trace_Record( TRACE_MAC_RX_WINDOW, 0, RxWindow1Delay );
+
     RxWindow1Config.Channel = Channel;
     RxWindow1Config.DrOffset = LoRaMacParams.Rx1DrOffset;
     RxWindow1Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
@@ -1458,14 +2054,20 @@ static void OnRxWindow1TimerEvent( void )
         Radio.Standby( );
     }
 
-    RegionRxConfig( LoRaMacRegion, &RxWindow1Config, ( int8_t* )&McpsIndication.RxDatarate );
+    LoRaMacRegionOps->RxConfig( &RxWindow1Config, ( int8_t* )&McpsIndication.RxDatarate );
     RxWindowSetup( RxWindow1Config.RxContinuous, LoRaMacParams.MaxRxWindow );
+
+    RxWakeUpLatencyUpdate( RxWindow1Delay, timerTime );
 }
 
 static void OnRxWindow2TimerEvent( void )
 {
+    TimerTime_t timerTime = TimerGetCurrentTime( );
+
     TimerStop( &RxWindowTimer2 );
 
+    Trace_Record( TRACE_MAC_RX_WINDOW, 1, RxWindow2Delay );
+
     RxWindow2Config.Channel = Channel;
     RxWindow2Config.Frequency = LoRaMacParams.Rx2Channel.Frequency;
     RxWindow2Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
@@ -1481,10 +2083,16 @@ static void OnRxWindow2TimerEvent( void )
         RxWindow2Config.RxContinuous = true;
     }
 
-    if( RegionRxConfig( LoRaMacRegion, &RxWindow2Config, ( int8_t* )&McpsIndication.RxDatarate ) == true )
+    if( LoRaMacRegionOps->RxConfig( &RxWindow2Config, ( int8_t* )&McpsIndication.RxDatarate ) == true )
     {
         RxWindowSetup( RxWindow2Config.RxContinuous, LoRaMacParams.MaxRxWindow );
         RxSlot = RxWindow2Config.Window;
+
+        if( LoRaMacDeviceClass != CLASS_C )
+        {
+            // Class C opens the RX2 window directly, not from its timer
+            RxWakeUpLatencyUpdate( RxWindow2Delay, timerTime );
+        }
     }
 }
 
@@ -1501,6 +2109,27 @@ static void OnAckTimeoutTimerEvent( void )
     {
         LoRaMacFlags.Bits.MacDone = 1;
     }
+    if( ( AckTimeoutRetry == true ) || ( LoRaMacFlags.Bits.MacDone == 1 ) )
+    {
+        // Retry or complete the transmission without waiting for the watchdog
+        MacStateCheckTrigger( );
+    }
+}
+
+static void OnRxWatchdogTimerEvent( void )
+{
+    TimerStop( &RxWatchdogTimer );
+
+    if( ( LoRaMacDeviceClass == CLASS_C ) && ( RxSlot != 0 ) )
+    {
+        // The class C RX2 window is continuous
+        return;
+    }
+    if( Radio.GetStatus( ) == RF_RX_RUNNING )
+    {
+        // The radio did not report the end of the last single reception window
+        OnRadioRxTimeout( );
+    }
 }
 
 static void RxWindowSetup( bool rxContinuous, uint32_t maxRxWindow )
@@ -1515,25 +2144,76 @@ static void RxWindowSetup( bool rxContinuous, uint32_t maxRxWindow )
     }
 }
 
-static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
+static uint32_t RxWakeUpLatencyFilter( uint32_t estimate, uint32_t sample )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-    uint16_t maxN = 0;
-    uint16_t payloadSize = 0;
+    // Follow an increase at once, decrease slowly to keep a safe guard time
+    if( sample >= estimate )
+    {
+        return sample;
+    }
+    return estimate - ( ( estimate - sample + 7 ) >> 3 );
+}
 
-    // Setup PHY request
-    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
-    getPhy.Datarate = datarate;
-    getPhy.Attribute = PHY_MAX_PAYLOAD;
+static void RxWakeUpLatencyUpdate( uint32_t windowDelay, TimerTime_t timerTime )
+{
+    // The elapsed times are computed on the RTC ticks, which keeps them right
+    // across the wrap around of the RTC counter
+    uint32_t setup = TimerGetElapsedTime( timerTime );
+    uint32_t elapsed = TimerGetElapsedTime( RxWindowTimersStart );
+    uint32_t limit = Radio.GetRadioWakeUpTime( ) + LORAMAC_RX_WAKEUP_LATENCY_MARGIN;
+    uint32_t alarm = 0;
+
+    if( elapsed > ( windowDelay + setup ) )
+    {
+        alarm = elapsed - windowDelay - setup;
+    }
 
-    // Get the maximum payload length
-    if( RepeaterSupport == true )
+    // A window opened far too late, e.g. behind a long critical section,
+    // does not measure the wake-up path
+    if( ( alarm > limit ) || ( setup > limit ) )
     {
-        getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
+        return;
     }
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    maxN = phyParam.Value;
+
+    if( RxWakeUpCalibrated == false )
+    {
+        RxWakeUpAlarmLatency = alarm;
+        RxWakeUpSetupLatency = setup;
+        RxWakeUpCalibrated = true;
+    }
+    else
+    {
+        RxWakeUpAlarmLatency = RxWakeUpLatencyFilter( RxWakeUpAlarmLatency, alarm );
+        RxWakeUpSetupLatency = RxWakeUpLatencyFilter( RxWakeUpSetupLatency, setup );
+    }
+}
+
+static uint32_t RxWakeUpCompensate( uint32_t delay )
+{
+    int32_t compensated;
+
+    if( RxWakeUpCalibrated == false )
+    {
+        return delay;
+    }
+
+    // The region offset already accounts for the nominal radio wake-up time
+    compensated = ( int32_t )delay + ( int32_t )Radio.GetRadioWakeUpTime( ) -
+                  ( int32_t )( RxWakeUpAlarmLatency + RxWakeUpSetupLatency );
+    if( compensated < 0 )
+    {
+        compensated = 0;
+    }
+    return ( uint32_t )compensated;
+}
+
+static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
+{
+    uint16_t maxN = 0;
+    uint16_t payloadSize = 0;
+
+    // Get the maximum payload length
+    maxN = RegionPhyCache.MaxTxPayload[datarate & 0x0F];
 
     // Calculate the resulting payload size
     payloadSize = ( lenN + fOptsLen );
@@ -1728,8 +2408,8 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
                     linkAdrReq.CurrentNbRep = LoRaMacParams.ChannelsNbRep;
 
                     // Process the ADR requests
-                    status = RegionLinkAdrReq( LoRaMacRegion, &linkAdrReq, &linkAdrDatarate,
-                                               &linkAdrTxPower, &linkAdrNbRep, &linkAdrNbBytesParsed );
+                    status = LoRaMacRegionOps->LinkAdrReq( &linkAdrReq, &linkAdrDatarate,
+                                                           &linkAdrTxPower, &linkAdrNbRep, &linkAdrNbBytesParsed );
 
                     if( ( status & 0x07 ) == 0x07 )
                     {
@@ -1767,7 +2447,7 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
                     rxParamSetupReq.Frequency *= 100;
 
                     // Perform request on region
-                    status = RegionRxParamSetupReq( LoRaMacRegion, &rxParamSetupReq );
+                    status = LoRaMacRegionOps->RxParamSetupReq( &rxParamSetupReq );
 
                     if( ( status & 0x07 ) == 0x07 )
                     {
@@ -1804,7 +2484,7 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
                     chParam.Rx1Frequency = 0;
                     chParam.DrRange.Value = payload[macIndex++];
 
-                    status = RegionNewChannelReq( LoRaMacRegion, &newChannelReq );
+                    status = LoRaMacRegionOps->NewChannelReq( &newChannelReq );
 
                     AddMacCommand( MOTE_MAC_NEW_CHANNEL_ANS, status, 0 );
                 }
@@ -1841,12 +2521,13 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
                     txParamSetupReq.MaxEirp = eirpDwellTime & 0x0F;
 
                     // Check the status for correctness
-                    if( RegionTxParamSetupReq( LoRaMacRegion, &txParamSetupReq ) != -1 )
+                    if( LoRaMacRegionOps->TxParamSetupReq( &txParamSetupReq ) != -1 )
                     {
                         // Accept command
                         LoRaMacParams.UplinkDwellTime = txParamSetupReq.UplinkDwellTime;
                         LoRaMacParams.DownlinkDwellTime = txParamSetupReq.DownlinkDwellTime;
-                        LoRaMacParams.MaxEirp = LoRaMacMaxEirpTable[txParamSetupReq.MaxEirp];
+                        LoRaMacParams.MaxEirp = 2 * LoRaMacMaxEirpTable[txParamSetupReq.MaxEirp];
+                        RegionPhyCacheUpdate( );
                         // Add command response
                         AddMacCommand( MOTE_MAC_TX_PARAM_SETUP_ANS, 0, 0 );
                     }
@@ -1863,7 +2544,7 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
                     dlChannelReq.Rx1Frequency |= ( uint32_t )payload[macIndex++] << 16;
                     dlChannelReq.Rx1Frequency *= 100;
 
-                    status = RegionDlChannelReq( LoRaMacRegion, &dlChannelReq );
+                    status = LoRaMacRegionOps->DlChannelReq( &dlChannelReq );
 
                     AddMacCommand( MOTE_MAC_DL_CHANNEL_ANS, status, 0 );
                 }
@@ -1929,9 +2610,15 @@ static LoRaMacStatus_t ScheduleTx( void )
     nextChan.DutyCycleEnabled = DutyCycleOn;
     nextChan.Joined = IsLoRaMacNetworkJoined;
     nextChan.LastAggrTx = AggregatedLastTxDoneTime;
+    nextChan.Query = false;
+    nextChan.BusyChannelsMask = NULL;
+    if( CadAttempts > 0 )
+    {
+        nextChan.BusyChannelsMask = CadBusyChannels;
+    }
 
     // Select channel
-    while( RegionNextChannel( LoRaMacRegion, &nextChan, &Channel, &dutyCycleTimeOff, &AggregatedTimeOff ) == false )
+    while( LoRaMacRegionOps->NextChannel( &nextChan, &Channel, &dutyCycleTimeOff, &AggregatedTimeOff ) == false )
     {
         // Set the default datarate
         LoRaMacParams.ChannelsDatarate = LoRaMacParamsDefaults.ChannelsDatarate;
@@ -1940,22 +2627,20 @@ static LoRaMacStatus_t ScheduleTx( void )
     }
 
     // Compute Rx1 windows parameters
-    RegionComputeRxWindowParameters( LoRaMacRegion,
-                                     RegionApplyDrOffset( LoRaMacRegion, LoRaMacParams.DownlinkDwellTime, LoRaMacParams.ChannelsDatarate, LoRaMacParams.Rx1DrOffset ),
-                                     LoRaMacParams.MinRxSymbols,
-                                     LoRaMacParams.SystemMaxRxError,
-                                     &RxWindow1Config );
+    LoRaMacRegionOps->ComputeRxWindowParameters( LoRaMacRegionOps->ApplyDrOffset( LoRaMacParams.DownlinkDwellTime, LoRaMacParams.ChannelsDatarate, LoRaMacParams.Rx1DrOffset ),
+                                                 LoRaMacParams.MinRxSymbols,
+                                                 LoRaMacParams.SystemMaxRxError,
+                                                 &RxWindow1Config );
     // Compute Rx2 windows parameters
-    RegionComputeRxWindowParameters( LoRaMacRegion,
-                                     LoRaMacParams.Rx2Channel.Datarate,
-                                     LoRaMacParams.MinRxSymbols,
-                                     LoRaMacParams.SystemMaxRxError,
-                                     &RxWindow2Config );
+    LoRaMacRegionOps->ComputeRxWindowParameters( LoRaMacParams.Rx2Channel.Datarate,
+                                                 LoRaMacParams.MinRxSymbols,
+                                                 LoRaMacParams.SystemMaxRxError,
+                                                 &RxWindow2Config );
 
     if( IsLoRaMacNetworkJoined == false )
     {
-        RxWindow1Delay = LoRaMacParams.JoinAcceptDelay1 + RxWindow1Config.WindowOffset;
-        RxWindow2Delay = LoRaMacParams.JoinAcceptDelay2 + RxWindow2Config.WindowOffset;
+        RxWindow1Delay = RxWakeUpCompensate( LoRaMacParams.JoinAcceptDelay1 + RxWindow1Config.WindowOffset );
+        RxWindow2Delay = RxWakeUpCompensate( LoRaMacParams.JoinAcceptDelay2 + RxWindow2Config.WindowOffset );
     }
     else
     {
@@ -1963,13 +2648,29 @@ static LoRaMacStatus_t ScheduleTx( void )
         {
             return LORAMAC_STATUS_LENGTH_ERROR;
         }
-        RxWindow1Delay = LoRaMacParams.ReceiveDelay1 + RxWindow1Config.WindowOffset;
-        RxWindow2Delay = LoRaMacParams.ReceiveDelay2 + RxWindow2Config.WindowOffset;
+        RxWindow1Delay = RxWakeUpCompensate( LoRaMacParams.ReceiveDelay1 + RxWindow1Config.WindowOffset );
+        RxWindow2Delay = RxWakeUpCompensate( LoRaMacParams.ReceiveDelay2 + RxWindow2Config.WindowOffset );
     }
 
     // Schedule transmission of frame
     if( dutyCycleTimeOff == 0 )
     {
+        if( RegionPhyCache.CarrierSenseTime != 0 )
+        {
+            // Listen before talk of the region, OnCarrierSenseTimerEvent
+            // sends the frame
+            return StartCarrierSense( RegionPhyCache.CarrierSenseTime, RegionPhyCache.RssiFreeTh );
+        }
+        if( LORAMAC_CAD_ATTEMPTS > 0 )
+        {
+            // Sense the channel first, OnRadioCadDone sends the frame. The
+            // FSK datarates have no CAD, their RSSI is measured instead
+            if( RegionPhyCache.Bandwidth[LoRaMacParams.ChannelsDatarate & 0x0F] != 0 )
+            {
+                return StartChannelActivityDetection( );
+            }
+            return StartCarrierSense( LORAMAC_FSK_CARRIER_SENSE_TIME, LORAMAC_FSK_RSSI_FREE_TH );
+        }
         // Try to send now
         return SendFrameOnChannel( Channel );
     }
@@ -1996,12 +2697,61 @@ static void CalculateBackOff( uint8_t channel )
     calcBackOff.LastTxIsJoinRequest = LastTxIsJoinRequest;
 
     // Update regional back-off
-    RegionCalcBackOff( LoRaMacRegion, &calcBackOff );
+    LoRaMacRegionOps->CalcBackOff( &calcBackOff );
 
     // Update aggregated time-off
     AggregatedTimeOff = AggregatedTimeOff + ( TxTimeOnAir * AggregatedDCycle - TxTimeOnAir );
 }
 
+static LoRaMacStatus_t ComputeNextTxDelay( TimerTime_t* delay )
+{
+    CalcBackOffParams_t calcBackOff;
+    NextChanParams_t nextChan;
+    TimerTime_t aggregatedTimeOff = AggregatedTimeOff;
+    uint8_t channel = Channel;
+
+    if( LoRaMacState != LORAMAC_IDLE )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+    if( MaxDCycle == 255 )
+    {
+        return LORAMAC_STATUS_DEVICE_OFF;
+    }
+
+    // Same back-off as ScheduleTx, the band time-off of the last channel
+    // only gets updated when the next frame is scheduled
+    calcBackOff.Joined = IsLoRaMacNetworkJoined;
+    calcBackOff.DutyCycleEnabled = DutyCycleOn;
+    calcBackOff.Channel = LastTxChannel;
+    calcBackOff.ElapsedTime = TimerGetElapsedTime( LoRaMacInitializationTime );
+    calcBackOff.TxTimeOnAir = TxTimeOnAir;
+    calcBackOff.LastTxIsJoinRequest = LastTxIsJoinRequest;
+    LoRaMacRegionOps->CalcBackOff( &calcBackOff );
+
+    if( MaxDCycle == 0 )
+    {
+        aggregatedTimeOff = 0;
+    }
+    aggregatedTimeOff = aggregatedTimeOff + ( TxTimeOnAir * AggregatedDCycle - TxTimeOnAir );
+
+    nextChan.AggrTimeOff = aggregatedTimeOff;
+    nextChan.Datarate = LoRaMacParams.ChannelsDatarate;
+    nextChan.DutyCycleEnabled = DutyCycleOn;
+    nextChan.Joined = IsLoRaMacNetworkJoined;
+    nextChan.LastAggrTx = AggregatedLastTxDoneTime;
+    // No carrier sense and no channels mask update
+    nextChan.Query = true;
+    nextChan.BusyChannelsMask = NULL;
+
+    while( LoRaMacRegionOps->NextChannel( &nextChan, &channel, delay, &aggregatedTimeOff ) == false )
+    {
+        // ScheduleTx falls back to the default datarate
+        nextChan.Datarate = LoRaMacParamsDefaults.ChannelsDatarate;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
 static void ResetMacParameters( void )
 {
     IsLoRaMacNetworkJoined = false;
@@ -2049,6 +2799,171 @@ static void ResetMacParameters( void )
     // Initialize channel index.
     Channel = 0;
     LastTxChannel = Channel;
+
+    RegionPhyCacheUpdate( );
+}
+
+static void RegionPhyCacheUpdate( void )
+{
+    GetPhyCacheParams_t getPhyCache;
+
+    getPhyCache.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
+    getPhyCache.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
+    getPhyCache.RepeaterSupport = RepeaterSupport;
+    RegionGetPhyCache( LoRaMacRegion, &getPhyCache, &RegionPhyCache );
+}
+
+static void RegionDefaultsInit( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    // Reset to defaults
+    getPhy.Attribute = PHY_DUTY_CYCLE;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    DutyCycleOn = ( bool ) phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_TX_POWER;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.ChannelsTxPower = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_TX_DR;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.ChannelsDatarate = phyParam.Value;
+
+    getPhy.Attribute = PHY_MAX_RX_WINDOW;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.MaxRxWindow = phyParam.Value;
+
+    getPhy.Attribute = PHY_RECEIVE_DELAY1;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.ReceiveDelay1 = phyParam.Value;
+
+    getPhy.Attribute = PHY_RECEIVE_DELAY2;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.ReceiveDelay2 = phyParam.Value;
+
+    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY1;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.JoinAcceptDelay1 = phyParam.Value;
+
+    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY2;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.JoinAcceptDelay2 = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_DR1_OFFSET;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.Rx1DrOffset = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_RX2_FREQUENCY;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.Rx2Channel.Frequency = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_RX2_DR;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.Rx2Channel.Datarate = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_UPLINK_DWELL_TIME;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.UplinkDwellTime = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_DOWNLINK_DWELL_TIME;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.DownlinkDwellTime = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_MAX_EIRP;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.MaxEirp = ( int8_t )phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_ANTENNA_GAIN;
+    phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
+    LoRaMacParamsDefaults.AntennaGain = ( int8_t )phyParam.Value;
+
+    LoRaMacRegionOps->InitDefaults( INIT_TYPE_INIT );
+
+    // Init parameters which are not set in function ResetMacParameters
+    LoRaMacParamsDefaults.ChannelsNbRep = 1;
+    LoRaMacParamsDefaults.SystemMaxRxError = 10;
+    LoRaMacParamsDefaults.MinRxSymbols = 6;
+
+    LoRaMacParams.SystemMaxRxError = LoRaMacParamsDefaults.SystemMaxRxError;
+    LoRaMacParams.MinRxSymbols = LoRaMacParamsDefaults.MinRxSymbols;
+    LoRaMacParams.MaxRxWindow = LoRaMacParamsDefaults.MaxRxWindow;
+    LoRaMacParams.ReceiveDelay1 = LoRaMacParamsDefaults.ReceiveDelay1;
+    LoRaMacParams.ReceiveDelay2 = LoRaMacParamsDefaults.ReceiveDelay2;
+    LoRaMacParams.JoinAcceptDelay1 = LoRaMacParamsDefaults.JoinAcceptDelay1;
+    LoRaMacParams.JoinAcceptDelay2 = LoRaMacParamsDefaults.JoinAcceptDelay2;
+    LoRaMacParams.ChannelsNbRep = LoRaMacParamsDefaults.ChannelsNbRep;
+}
+
+static bool RegionContextTake( LoRaMacRegion_t region, LoRaMacRegionContext_t* session )
+{
+    for( uint8_t i = 0; i < LORAMAC_REGION_CONTEXTS; i++ )
+    {
+        if( ( RegionContexts[i].Valid == true ) && ( RegionContexts[i].Region == region ) )
+        {
+            *session = RegionContexts[i];
+            RegionContexts[i].Valid = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void RegionContextSave( void )
+{
+    LoRaMacRegionContext_t* context = &RegionContexts[0];
+
+    // The current region has no context, its session was taken on restore
+    for( uint8_t i = 0; i < LORAMAC_REGION_CONTEXTS; i++ )
+    {
+        if( RegionContexts[i].Valid == false )
+        {
+            context = &RegionContexts[i];
+            break;
+        }
+        if( ( int32_t )( RegionContexts[i].Saved - context->Saved ) < 0 )
+        { // Oldest session so far, dropped when no context is free
+            context = &RegionContexts[i];
+        }
+    }
+
+    context->Valid = true;
+    context->Region = LoRaMacRegion;
+    context->Saved = RegionContextSaves++;
+    context->IsNetworkJoined = IsLoRaMacNetworkJoined;
+    context->NetID = LoRaMacNetID;
+    context->DevAddr = LoRaMacDevAddr;
+    memcpy1( context->NwkSKey, LoRaMacNwkSKey, sizeof( context->NwkSKey ) );
+    memcpy1( context->AppSKey, LoRaMacAppSKey, sizeof( context->AppSKey ) );
+    context->UpLinkCounter = UpLinkCounter;
+    context->DownLinkCounter = DownLinkCounter;
+    context->AdrAckCounter = AdrAckCounter;
+    context->DutyCycleOn = DutyCycleOn;
+    context->AggregatedLastTxDoneTime = AggregatedLastTxDoneTime;
+    context->AggregatedTimeOff = AggregatedTimeOff;
+    context->Channel = Channel;
+    context->Params = LoRaMacParams;
+    context->ParamsDefaults = LoRaMacParamsDefaults;
+}
+
+static void RegionContextRestore( const LoRaMacRegionContext_t* session )
+{
+    IsLoRaMacNetworkJoined = session->IsNetworkJoined;
+    LoRaMacNetID = session->NetID;
+    LoRaMacDevAddr = session->DevAddr;
+    memcpy1( LoRaMacNwkSKey, session->NwkSKey, sizeof( session->NwkSKey ) );
+    memcpy1( LoRaMacAppSKey, session->AppSKey, sizeof( session->AppSKey ) );
+    UpLinkCounter = session->UpLinkCounter;
+    DownLinkCounter = session->DownLinkCounter;
+    AdrAckCounter = session->AdrAckCounter;
+    DutyCycleOn = session->DutyCycleOn;
+    AggregatedLastTxDoneTime = session->AggregatedLastTxDoneTime;
+    AggregatedTimeOff = session->AggregatedTimeOff;
+    Channel = session->Channel;
+    LastTxChannel = Channel;
+    LoRaMacParams = session->Params;
+    LoRaMacParamsDefaults = session->ParamsDefaults;
 }
 
 LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl, uint8_t fPort, void *fBuffer, uint16_t fBufferSize )
@@ -2113,8 +3028,8 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl
             adrNext.TxPower = LoRaMacParams.ChannelsTxPower;
             adrNext.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
 
-            fCtrl->Bits.AdrAckReq = RegionAdrNext( LoRaMacRegion, &adrNext,
-                                                   &LoRaMacParams.ChannelsDatarate, &LoRaMacParams.ChannelsTxPower, &AdrAckCounter );
+            fCtrl->Bits.AdrAckReq = LoRaMacRegionOps->AdrNext( &adrNext,
+                                                               &LoRaMacParams.ChannelsDatarate, &LoRaMacParams.ChannelsTxPower, &AdrAckCounter );
 
             if( SrvAckRequested == true )
             {
@@ -2231,7 +3146,7 @@ LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
 
     DBG_PRINTF( "\n\r*** seqTx= %d *****\n\r", UpLinkCounter );
 
-    RegionTxConfig( LoRaMacRegion, &txConfig, &txPower, &TxTimeOnAir );
+    LoRaMacRegionOps->TxConfig( &txConfig, &txPower, &TxTimeOnAir );
 
     MlmeConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
     McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
@@ -2242,9 +3157,8 @@ LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     McpsConfirm.TxTimeOnAir = TxTimeOnAir;
     MlmeConfirm.TxTimeOnAir = TxTimeOnAir;
 
-    // Starts the MAC layer status check timer
-    TimerSetValue( &MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT );
-    TimerStart( &MacStateCheckTimer );
+    // Starts the MAC layer status check watchdog
+    MacStateCheckWatchdogStart( );
 
     if( IsLoRaMacNetworkJoined == false )
     {
@@ -2270,11 +3184,10 @@ LoRaMacStatus_t SetTxContinuousWave( uint16_t timeout )
     continuousWave.AntennaGain = LoRaMacParams.AntennaGain;
     continuousWave.Timeout = timeout;
 
-    RegionSetContinuousWave( LoRaMacRegion, &continuousWave );
+    LoRaMacRegionOps->SetContinuousWave( &continuousWave );
 
-    // Starts the MAC layer status check timer
-    TimerSetValue( &MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT );
-    TimerStart( &MacStateCheckTimer );
+    // Starts the MAC layer status check watchdog
+    MacStateCheckWatchdogStart( );
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
 
@@ -2285,9 +3198,8 @@ LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequency, uint
 {
     Radio.SetTxContinuousWave( frequency, power, timeout );
 
-    // Starts the MAC layer status check timer
-    TimerSetValue( &MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT );
-    TimerStart( &MacStateCheckTimer );
+    // Starts the MAC layer status check watchdog
+    MacStateCheckWatchdogStart( );
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
 
@@ -2296,9 +3208,6 @@ LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequency, uint
 
 LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks, LoRaMacRegion_t region )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-
     if( primitives == NULL )
     {
         return LORAMAC_STATUS_PARAMETER_INVALID;
@@ -2319,6 +3228,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
     LoRaMacPrimitives = primitives;
     LoRaMacCallbacks = callbacks;
     LoRaMacRegion = region;
+    LoRaMacRegionOps = RegionGetOps( region );
     McpsIndication.Region = region;
 
     LoRaMacFlags.Value = 0;
@@ -2334,82 +3244,12 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
     AggregatedLastTxDoneTime = 0;
     AggregatedTimeOff = 0;
 
-    // Reset to defaults
-    getPhy.Attribute = PHY_DUTY_CYCLE;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    DutyCycleOn = ( bool ) phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_TX_POWER;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.ChannelsTxPower = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_TX_DR;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.ChannelsDatarate = phyParam.Value;
-
-    getPhy.Attribute = PHY_MAX_RX_WINDOW;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.MaxRxWindow = phyParam.Value;
-
-    getPhy.Attribute = PHY_RECEIVE_DELAY1;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.ReceiveDelay1 = phyParam.Value;
-
-    getPhy.Attribute = PHY_RECEIVE_DELAY2;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.ReceiveDelay2 = phyParam.Value;
-
-    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY1;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.JoinAcceptDelay1 = phyParam.Value;
-
-    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY2;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.JoinAcceptDelay2 = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_DR1_OFFSET;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.Rx1DrOffset = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_RX2_FREQUENCY;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.Rx2Channel.Frequency = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_RX2_DR;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.Rx2Channel.Datarate = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_UPLINK_DWELL_TIME;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.UplinkDwellTime = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_DOWNLINK_DWELL_TIME;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.DownlinkDwellTime = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_MAX_EIRP;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.MaxEirp = phyParam.fValue;
-
-    getPhy.Attribute = PHY_DEF_ANTENNA_GAIN;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    LoRaMacParamsDefaults.AntennaGain = phyParam.fValue;
-
-    RegionInitDefaults( LoRaMacRegion, INIT_TYPE_INIT );
-
-    // Init parameters which are not set in function ResetMacParameters
-    LoRaMacParamsDefaults.ChannelsNbRep = 1;
-    LoRaMacParamsDefaults.SystemMaxRxError = 10;
-    LoRaMacParamsDefaults.MinRxSymbols = 6;
+    RegionDefaultsInit( );
 
-    LoRaMacParams.SystemMaxRxError = LoRaMacParamsDefaults.SystemMaxRxError;
-    LoRaMacParams.MinRxSymbols = LoRaMacParamsDefaults.MinRxSymbols;
-    LoRaMacParams.MaxRxWindow = LoRaMacParamsDefaults.MaxRxWindow;
-    LoRaMacParams.ReceiveDelay1 = LoRaMacParamsDefaults.ReceiveDelay1;
-    LoRaMacParams.ReceiveDelay2 = LoRaMacParamsDefaults.ReceiveDelay2;
-    LoRaMacParams.JoinAcceptDelay1 = LoRaMacParamsDefaults.JoinAcceptDelay1;
-    LoRaMacParams.JoinAcceptDelay2 = LoRaMacParamsDefaults.JoinAcceptDelay2;
-    LoRaMacParams.ChannelsNbRep = LoRaMacParamsDefaults.ChannelsNbRep;
+    // Forget the sessions of the previously used regions
+    memset1( ( uint8_t* )RegionContexts, 0, sizeof( RegionContexts ) );
+    RegionContextSaves = 0;
+    RegionCommonChannelStatsReset( );
 
     ResetMacParameters( );
 
@@ -2418,9 +3258,17 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
     TimerSetValue( &MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT );
 
     TimerInit( &TxDelayedTimer, OnTxDelayedTimerEvent );
+    TimerInit( &CadTimeoutTimer, OnCadTimeoutTimerEvent );
+    TimerSetValue( &CadTimeoutTimer, LORAMAC_CAD_TIMEOUT );
+    TimerInit( &CarrierSenseTimer, OnCarrierSenseTimerEvent );
+    TimerSetValue( &CarrierSenseTimer, LORAMAC_CARRIER_SENSE_PERIOD );
+    CadReset( );
+    CadBackOffs = 0;
+    CadBackOffRunning = false;
     TimerInit( &RxWindowTimer1, OnRxWindow1TimerEvent );
     TimerInit( &RxWindowTimer2, OnRxWindow2TimerEvent );
     TimerInit( &AckTimeoutTimer, OnAckTimeoutTimerEvent );
+    TimerInit( &RxWatchdogTimer, OnRxWatchdogTimerEvent );
 
     // Store the current initialization time
     LoRaMacInitializationTime = TimerGetCurrentTime( );
@@ -2431,6 +3279,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
     RadioEvents.RxError = OnRadioRxError;
     RadioEvents.TxTimeout = OnRadioTxTimeout;
     RadioEvents.RxTimeout = OnRadioRxTimeout;
+    RadioEvents.CadDone = OnRadioCadDone;
     Radio.Init( &RadioEvents );
 
     // Random seed initialization
@@ -2443,11 +3292,70 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
     return LORAMAC_STATUS_OK;
 }
 
+LoRaMacStatus_t LoRaMacSwitchRegion( LoRaMacRegion_t region )
+{
+    LoRaMacRegionContext_t session;
+    bool restore;
+
+    // Verify if the region is supported
+    if( RegionIsActive( region ) == false )
+    {
+        return LORAMAC_STATUS_REGION_NOT_SUPPORTED;
+    }
+    if( LoRaMacState != LORAMAC_IDLE )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+    if( region == LoRaMacRegion )
+    {
+        return LORAMAC_STATUS_OK;
+    }
+
+    // Stop the class C reception of the region we leave
+    TimerStop( &RxWindowTimer2 );
+    TimerStop( &RxWatchdogTimer );
+    Radio.Sleep( );
+
+    // Take the session of the region switched to first, its context is free
+    // for the session left
+    restore = RegionContextTake( region, &session );
+    RegionContextSave( );
+
+    LoRaMacRegion = region;
+    LoRaMacRegionOps = RegionGetOps( region );
+    McpsIndication.Region = region;
+    // The channel statistics are indexed by the channel ids of the region
+    RegionCommonChannelStatsReset( );
+
+    // Pending MAC command answers and acknowledgements belong to the session we leave
+    MacCommandsBufferIndex = 0;
+    MacCommandsBufferToRepeatIndex = 0;
+    MacCommandsInNextTx = false;
+    NodeAckRequested = false;
+    SrvAckRequested = false;
+    ChannelsNbRepCounter = 0;
+
+    if( restore == true )
+    {
+        RegionContextRestore( &session );
+        RegionPhyCacheUpdate( );
+    }
+    else
+    { // First use of the region, or its session has been dropped
+        RegionDefaultsInit( );
+        ResetMacParameters( );
+    }
+
+    if( LoRaMacDeviceClass == CLASS_C )
+    {
+        OnRxWindow2TimerEvent( );
+    }
+    return LORAMAC_STATUS_OK;
+}
+
 LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
 {
     AdrNextParams_t adrNext;
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     int8_t datarate = LoRaMacParamsDefaults.ChannelsDatarate;
     int8_t txPower = LoRaMacParamsDefaults.ChannelsTxPower;
     uint8_t fOptLen = MacCommandsBufferIndex + MacCommandsBufferToRepeatIndex;
@@ -2467,20 +3375,10 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
 
     // We call the function for information purposes only. We don't want to
     // apply the datarate, the tx power and the ADR ack counter.
-    RegionAdrNext( LoRaMacRegion, &adrNext, &datarate, &txPower, &AdrAckCounter );
+    LoRaMacRegionOps->AdrNext( &adrNext, &datarate, &txPower, &AdrAckCounter );
 
-    // Setup PHY request
-    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
-    getPhy.Datarate = datarate;
-    getPhy.Attribute = PHY_MAX_PAYLOAD;
-
-    // Change request in case repeater is supported
-    if( RepeaterSupport == true )
-    {
-        getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
-    }
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    txInfo->CurrentPayloadSize = phyParam.Value;
+    // Get the maximum payload length
+    txInfo->CurrentPayloadSize = RegionPhyCache.MaxTxPayload[datarate & 0x0F];
 
     // Verify if the fOpts fit into the maximum payload
     if( txInfo->CurrentPayloadSize >= fOptLen )
@@ -2566,7 +3464,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
         case MIB_CHANNELS:
         {
             getPhy.Attribute = PHY_CHANNELS;
-            phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
+            phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
 
             mibGet->Param.ChannelList = phyParam.Channels;
             break;
@@ -2584,7 +3482,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
         case MIB_CHANNELS_DEFAULT_MASK:
         {
             getPhy.Attribute = PHY_CHANNELS_DEFAULT_MASK;
-            phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
+            phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
 
             mibGet->Param.ChannelsDefaultMask = phyParam.ChannelsMask;
             break;
@@ -2592,7 +3490,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
         case MIB_CHANNELS_MASK:
         {
             getPhy.Attribute = PHY_CHANNELS_MASK;
-            phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
+            phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
 
             mibGet->Param.ChannelsMask = phyParam.ChannelsMask;
             break;
@@ -2674,7 +3572,12 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
         }
         case MIB_ANTENNA_GAIN:
         {
-            mibGet->Param.AntennaGain = LoRaMacParams.AntennaGain;
+            mibGet->Param.AntennaGain = LoRaMacParams.AntennaGain / 2.0f;
+            break;
+        }
+        case MIB_NEXT_TX_DELAY:
+        {
+            status = ComputeNextTxDelay( &mibGet->Param.NextTxDelay );
             break;
         }
         default:
@@ -2782,6 +3685,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
         case MIB_REPEATER_SUPPORT:
         {
              RepeaterSupport = mibSet->Param.EnableRepeaterSupport;
+             RegionPhyCacheUpdate( );
             break;
         }
         case MIB_RX2_CHANNEL:
@@ -2789,18 +3693,17 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
             verify.DatarateParams.Datarate = mibSet->Param.Rx2Channel.Datarate;
             verify.DatarateParams.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_RX_DR ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_RX_DR ) == true )
             {
                 LoRaMacParams.Rx2Channel = mibSet->Param.Rx2Channel;
 
                 if( ( LoRaMacDeviceClass == CLASS_C ) && ( IsLoRaMacNetworkJoined == true ) )
                 {
                     // Compute Rx2 windows parameters
-                    RegionComputeRxWindowParameters( LoRaMacRegion,
-                                                     LoRaMacParams.Rx2Channel.Datarate,
-                                                     LoRaMacParams.MinRxSymbols,
-                                                     LoRaMacParams.SystemMaxRxError,
-                                                     &RxWindow2Config );
+                    LoRaMacRegionOps->ComputeRxWindowParameters( LoRaMacParams.Rx2Channel.Datarate,
+                                                                 LoRaMacParams.MinRxSymbols,
+                                                                 LoRaMacParams.SystemMaxRxError,
+                                                                 &RxWindow2Config );
 
                     RxWindow2Config.Channel = Channel;
                     RxWindow2Config.Frequency = LoRaMacParams.Rx2Channel.Frequency;
@@ -2809,7 +3712,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
                     RxWindow2Config.Window = 1;
                     RxWindow2Config.RxContinuous = true;
 
-                    if( RegionRxConfig( LoRaMacRegion, &RxWindow2Config, ( int8_t* )&McpsIndication.RxDatarate ) == true )
+                    if( LoRaMacRegionOps->RxConfig( &RxWindow2Config, ( int8_t* )&McpsIndication.RxDatarate ) == true )
                     {
                         RxWindowSetup( RxWindow2Config.RxContinuous, LoRaMacParams.MaxRxWindow );
                         RxSlot = RxWindow2Config.Window;
@@ -2831,7 +3734,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
             verify.DatarateParams.Datarate = mibSet->Param.Rx2Channel.Datarate;
             verify.DatarateParams.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_RX_DR ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_RX_DR ) == true )
             {
                 LoRaMacParamsDefaults.Rx2Channel = mibSet->Param.Rx2DefaultChannel;
             }
@@ -2846,7 +3749,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
             chanMaskSet.ChannelsMaskIn = mibSet->Param.ChannelsMask;
             chanMaskSet.ChannelsMaskType = CHANNELS_DEFAULT_MASK;
 
-            if( RegionChanMaskSet( LoRaMacRegion, &chanMaskSet ) == false )
+            if( LoRaMacRegionOps->ChanMaskSet( &chanMaskSet ) == false )
             {
                 status = LORAMAC_STATUS_PARAMETER_INVALID;
             }
@@ -2857,7 +3760,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
             chanMaskSet.ChannelsMaskIn = mibSet->Param.ChannelsMask;
             chanMaskSet.ChannelsMaskType = CHANNELS_MASK;
 
-            if( RegionChanMaskSet( LoRaMacRegion, &chanMaskSet ) == false )
+            if( LoRaMacRegionOps->ChanMaskSet( &chanMaskSet ) == false )
             {
                 status = LORAMAC_STATUS_PARAMETER_INVALID;
             }
@@ -2905,7 +3808,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
         {
             verify.DatarateParams.Datarate = mibSet->Param.ChannelsDefaultDatarate;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_DEF_TX_DR ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_DEF_TX_DR ) == true )
             {
                 LoRaMacParamsDefaults.ChannelsDatarate = verify.DatarateParams.Datarate;
             }
@@ -2919,7 +3822,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
         {
             verify.DatarateParams.Datarate = mibSet->Param.ChannelsDatarate;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_TX_DR ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_TX_DR ) == true )
             {
                 LoRaMacParams.ChannelsDatarate = verify.DatarateParams.Datarate;
             }
@@ -2933,7 +3836,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
         {
             verify.TxPower = mibSet->Param.ChannelsDefaultTxPower;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_DEF_TX_POWER ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_DEF_TX_POWER ) == true )
             {
                 LoRaMacParamsDefaults.ChannelsTxPower = verify.TxPower;
             }
@@ -2947,7 +3850,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
         {
             verify.TxPower = mibSet->Param.ChannelsTxPower;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_TX_POWER ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_TX_POWER ) == true )
             {
                 LoRaMacParams.ChannelsTxPower = verify.TxPower;
             }
@@ -2979,7 +3882,12 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
         }
         case MIB_ANTENNA_GAIN:
         {
-            LoRaMacParams.AntennaGain = mibSet->Param.AntennaGain;
+            // In half dB, rounded up
+            LoRaMacParams.AntennaGain = ( int8_t )( mibSet->Param.AntennaGain * 2 );
+            if( LoRaMacParams.AntennaGain < mibSet->Param.AntennaGain * 2 )
+            {
+                LoRaMacParams.AntennaGain++;
+            }
             break;
         }
         default:
@@ -3006,7 +3914,7 @@ LoRaMacStatus_t LoRaMacChannelAdd( uint8_t id, ChannelParams_t params )
     channelAdd.NewChannel = &params;
     channelAdd.ChannelId = id;
 
-    return RegionChannelAdd( LoRaMacRegion, &channelAdd );
+    return LoRaMacRegionOps->ChannelAdd( &channelAdd );
 }
 
 LoRaMacStatus_t LoRaMacChannelRemove( uint8_t id )
@@ -3023,7 +3931,7 @@ LoRaMacStatus_t LoRaMacChannelRemove( uint8_t id )
 
     channelRemove.ChannelId = id;
 
-    if( RegionChannelsRemove( LoRaMacRegion, &channelRemove ) == false )
+    if( LoRaMacRegionOps->ChannelsRemove( &channelRemove ) == false )
     {
         return LORAMAC_STATUS_PARAMETER_INVALID;
     }
@@ -3146,11 +4054,11 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t *mlmeRequest )
             // Verify the parameter NbTrials for the join procedure
             verify.NbJoinTrials = mlmeRequest->Req.Join.NbTrials;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_NB_JOIN_TRIALS ) == false )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_NB_JOIN_TRIALS ) == false )
             {
                 // Value not supported, get default
                 getPhy.Attribute = PHY_DEF_NB_JOIN_TRIALS;
-                phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
+                phyParam = LoRaMacRegionOps->GetPhyParam( &getPhy );
                 mlmeRequest->Req.Join.NbTrials = ( uint8_t ) phyParam.Value;
             }
 
@@ -3173,7 +4081,7 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t *mlmeRequest )
 
             altDr.NbTrials = JoinRequestTrials + 1;
 
-            LoRaMacParams.ChannelsDatarate = RegionAlternateDr( LoRaMacRegion, &altDr );
+            LoRaMacParams.ChannelsDatarate = LoRaMacRegionOps->AlternateDr( &altDr );
 
             status = Send( &macHdr, 0, NULL, 0 );
             break;
@@ -3216,8 +4124,6 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t *mlmeRequest )
 
 LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     LoRaMacStatus_t status = LORAMAC_STATUS_SERVICE_UNKNOWN;
     LoRaMacHeader_t macHdr;
     VerifyParams_t verify;
@@ -3285,13 +4191,9 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
             break;
     }
 
-    // Get the minimum possible datarate
-    getPhy.Attribute = PHY_MIN_TX_DR;
-    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
     // Apply the minimum possible datarate.
     // Some regions have limitations for the minimum datarate.
-    datarate = MAX( datarate, phyParam.Value );
+    datarate = MAX( datarate, RegionPhyCache.MinTxDr );
 
     if( readyToSend == true )
     {
@@ -3300,7 +4202,7 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
             verify.DatarateParams.Datarate = datarate;
             verify.DatarateParams.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
 
-            if( RegionVerify( LoRaMacRegion, &verify, PHY_TX_DR ) == true )
+            if( LoRaMacRegionOps->Verify( &verify, PHY_TX_DR ) == true )
             {
                 LoRaMacParams.ChannelsDatarate = verify.DatarateParams.Datarate;
             }
@@ -3342,7 +4244,7 @@ void LoRaMacTestSetDutyCycleOn( bool enable )
 
     verify.DutyCycle = enable;
 
-    if( RegionVerify( LoRaMacRegion, &verify, PHY_DUTY_CYCLE ) == true )
+    if( LoRaMacRegionOps->Verify( &verify, PHY_DUTY_CYCLE ) == true )
     {
         DutyCycleOn = enable;
     }
@@ -3352,3 +4254,8 @@ void LoRaMacTestSetChannel( uint8_t channel )
 {
     Channel = channel;
 }
+
+uint16_t LoRaMacTestGetRegionContextSize( void )
+{
+    return sizeof( LoRaMacRegionContext_t );
+}
@@ -83,9 +83,17 @@
 #define __LORAMAC_H__
 
 /*!
- * Check the Mac layer state every MAC_STATE_CHECK_TIMEOUT in ms
+ * Watchdog period of the Mac layer state check in ms. The check is run as
+ * soon as an event completes the current operation, the watchdog only
+ * recovers from a missing event
  */
-#define MAC_STATE_CHECK_TIMEOUT                     1000
+#define MAC_STATE_CHECK_TIMEOUT                     5000
+
+/*!
+ * Delay in ms the Mac layer state check watchdog tolerates, letting it share
+ * the wake-up of a timer expiring shortly after
+ */
+#define MAC_STATE_CHECK_SLACK                       50
 
 /*!
  * Maximum number of times the MAC layer tries to get an acknowledge.
@@ -222,6 +230,16 @@ typedef union uDrRange
     }Fields;
 }DrRange_t;
 
+/*!
+ * Number of frames a band keeps to spend its duty cycle over a sliding one
+ * hour window once the node is joined, see RegionCommonCalcBackOff. The
+ * oldest ones are merged when more frames go out within the hour.
+ * 0 applies the time-off after every frame.
+ */
+#ifndef REGION_COMMON_DC_WINDOW_FRAMES
+#define REGION_COMMON_DC_WINDOW_FRAMES              0
+#endif
+
 /*!
  * LoRaMAC band parameters definition
  */
@@ -247,6 +265,17 @@ typedef struct sBand
      * Holds the time where the device is off
      */
     TimerTime_t TimeOff;
+#if ( REGION_COMMON_DC_WINDOW_FRAMES > 0 )
+    /*!
+     * End time and airtime of the frames of the last hour, oldest first
+     */
+    TimerTime_t WindowEnd[REGION_COMMON_DC_WINDOW_FRAMES];
+    TimerTime_t WindowAirtime[REGION_COMMON_DC_WINDOW_FRAMES];
+    /*!
+     * Number of frames in the window
+     */
+    uint8_t WindowFrames;
+#endif
 }Band_t;
 
 /*!
@@ -356,13 +385,13 @@ typedef struct sLoRaMacParams
      */
     uint8_t DownlinkDwellTime;
     /*!
-     * Maximum possible EIRP
+     * Maximum possible EIRP [half dB]
      */
-    float MaxEirp;
+    int8_t MaxEirp;
     /*!
-     * Antenna gain of the node
+     * Antenna gain of the node [half dB]
      */
-    float AntennaGain;
+    int8_t AntennaGain;
 }LoRaMacParams_t;
 
 /*!
@@ -676,6 +705,10 @@ typedef enum eLoRaMacEventInfoStatus
      * message integrity check failure
      */
     LORAMAC_EVENT_INFO_STATUS_MIC_FAIL,
+    /*!
+     * The channels sensed before the uplink stayed busy, it was not sent
+     */
+    LORAMAC_EVENT_INFO_STATUS_CHANNEL_BUSY,
 }LoRaMacEventInfoStatus_t;
 
 /*!
@@ -1182,6 +1215,7 @@ typedef struct sMlmeConfirm
  * \ref MIB_SYSTEM_MAX_RX_ERROR      | YES | YES
  * \ref MIB_MIN_RX_SYMBOLS           | YES | YES
  * \ref MIB_ANTENNA_GAIN             | YES | YES
+ * \ref MIB_NEXT_TX_DELAY            | YES | NO
  *
  * The following table provides links to the function implementations of the
  * related MIB primitives:
@@ -1388,7 +1422,13 @@ typedef enum eMib
      * The formula is:
      * radioTxPower = ( int8_t )floor( maxEirp - antennaGain )
      */
-    MIB_ANTENNA_GAIN
+    MIB_ANTENNA_GAIN,
+    /*!
+     * Time in ms until the next uplink can go out, according to the band
+     * time-offs and the aggregated time-off. A get request returns
+     * \ref LORAMAC_STATUS_BUSY while a transmission is in progress.
+     */
+    MIB_NEXT_TX_DELAY
 }Mib_t;
 
 /*!
@@ -1571,11 +1611,17 @@ typedef union uMibParam
      */
     uint8_t MinRxSymbols;
     /*!
-     * Antenna gain
+     * Antenna gain [dB], held by the MAC in half dB rounded up
      *
      * Related MIB type: \ref MIB_ANTENNA_GAIN
      */
     float AntennaGain;
+    /*!
+     * Time until the next uplink can go out
+     *
+     * Related MIB type: \ref MIB_NEXT_TX_DELAY
+     */
+    TimerTime_t NextTxDelay;
 }MibParam_t;
 
 /*!
@@ -1734,6 +1780,25 @@ static const uint8_t LoRaMacMaxEirpTable[] = { 8, 10, 12, 13, 14, 16, 18, 20, 21
  */
 LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks, LoRaMacRegion_t region );
 
+/*!
+ * \brief   Switches the LoRaMAC layer to another region
+ *
+ * \details The session of the current region ( join state, keys, counters and
+ *          MAC parameters ) is kept and restored when switching back to it.
+ *          A region used for the first time starts from its defaults, as
+ *          does a region whose session was dropped: the MAC keeps the
+ *          sessions of LORAMAC_REGION_CONTEXTS regions left and drops the
+ *          oldest one.
+ *
+ * \param   [IN] region - The region to switch to.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_REGION_NOT_SUPPORTED.
+ */
+LoRaMacStatus_t LoRaMacSwitchRegion( LoRaMacRegion_t region );
+
 /*!
  * \brief   Queries the LoRaMAC if it is possible to send the next frame with
  *          a given payload size. The LoRaMAC takes scheduled MAC commands into
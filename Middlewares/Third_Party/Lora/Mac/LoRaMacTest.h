@@ -76,6 +76,15 @@ void LoRaMacTestSetDutyCycleOn( bool enable );
  */
 void LoRaMacTestSetChannel( uint8_t channel );
 
+/*!
+ * \brief   Returns the RAM taken by a region context
+ *
+ * \details This is a test function. It shall be used for testing purposes only.
+ *
+ * \retval  Size of the session of a region left by LoRaMacSwitchRegion [bytes]
+ */
+uint16_t LoRaMacTestGetRegionContextSize( void );
+
 /*! \} defgroup LORAMACTEST */
 
 #endif // __LORAMACTEST_H__
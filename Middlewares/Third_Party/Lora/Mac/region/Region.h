@@ -657,7 +657,24 @@ typedef enum ePhyAttribute
     /*!
      * Next lower datarate.
      */
-    PHY_NEXT_LOWER_TX_DR
+    PHY_NEXT_LOWER_TX_DR,
+    /*!
+     * Bandwidth of a datarate in Hz, 0 for the FSK datarate.
+     */
+    PHY_BANDWIDTH,
+    /*!
+     * Symbol time of a datarate in us.
+     */
+    PHY_SYMBOL_TIME,
+    /*!
+     * Time the channel is sensed before each uplink in ms, 0 when the region
+     * has no listen before talk.
+     */
+    PHY_CARRIER_SENSE_TIME,
+    /*!
+     * RSSI under which the sensed channel is free, in dBm.
+     */
+    PHY_RSSI_FREE_TH
 }PhyAttribute_t;
 
 /*!
@@ -722,7 +739,8 @@ typedef struct sGetPhyParams
     /*!
      * Datarate.
      * The parameter is needed for the following queries:
-     * PHY_MAX_PAYLOAD, PHY_MAX_PAYLOAD_REPEATER, PHY_NEXT_LOWER_TX_DR.
+     * PHY_MAX_PAYLOAD, PHY_MAX_PAYLOAD_REPEATER, PHY_NEXT_LOWER_TX_DR,
+     * PHY_BANDWIDTH, PHY_SYMBOL_TIME.
      */
     int8_t Datarate;
     /*!
@@ -739,6 +757,69 @@ typedef struct sGetPhyParams
     uint8_t DownlinkDwellTime;
 }GetPhyParams_t;
 
+/*!
+ * Region PHY parameters the MAC reads on every frame, indexed by datarate
+ * where applicable. Filled by RegionGetPhyCache.
+ */
+typedef struct sPhyCache
+{
+    /*!
+     * Maximum uplink payload, 0 for the datarates not allowed for tx.
+     */
+    uint8_t MaxTxPayload[16];
+    /*!
+     * Maximum downlink payload, 0 for the datarates not allowed for rx.
+     */
+    uint8_t MaxRxPayload[16];
+    /*!
+     * Next lower datarate used by the confirmed uplink retransmissions.
+     */
+    int8_t NextLowerTxDr[16];
+    /*!
+     * Bandwidth in Hz, 0 for the FSK and the RFU datarates.
+     */
+    uint32_t Bandwidth[16];
+    /*!
+     * Symbol time in us, 0 for the RFU datarates.
+     */
+    uint32_t SymbolTime[16];
+    /*!
+     * Minimum uplink datarate.
+     */
+    int8_t MinTxDr;
+    /*!
+     * Maximum gap of the downlink frame counter.
+     */
+    uint32_t MaxFCntGap;
+    /*!
+     * Listen before talk sense time in ms, 0 without listen before talk.
+     */
+    uint32_t CarrierSenseTime;
+    /*!
+     * Listen before talk RSSI threshold in dBm.
+     */
+    int16_t RssiFreeTh;
+}PhyCache_t;
+
+/*!
+ * Parameter structure for the function RegionGetPhyCache.
+ */
+typedef struct sGetPhyCacheParams
+{
+    /*!
+     * Uplink dwell time.
+     */
+    uint8_t UplinkDwellTime;
+    /*!
+     * Downlink dwell time.
+     */
+    uint8_t DownlinkDwellTime;
+    /*!
+     * Set to true if the repeater payload limits apply.
+     */
+    bool RepeaterSupport;
+}GetPhyCacheParams_t;
+
 /*!
  * Parameter structure for the function RegionSetBandTxDone.
  */
@@ -925,13 +1006,13 @@ typedef struct sTxConfigParams
      */
     int8_t TxPower;
     /*!
-     * The Max EIRP, if applicable.
+     * The Max EIRP in half dB, if applicable.
      */
-    float MaxEirp;
+    int8_t MaxEirp;
     /*!
-     * The antenna gain, if applicable.
+     * The antenna gain in half dB, if applicable.
      */
-    float AntennaGain;
+    int8_t AntennaGain;
     /*!
      * Frame length to setup.
      */
@@ -1108,6 +1189,16 @@ typedef struct sNextChanParams
      * Set to true, if the duty cycle is enabled, otherwise false.
      */
     bool DutyCycleEnabled;
+    /*!
+     * Set to true to only compute the delay to the next uplink: no carrier
+     * sense is performed and the channels masks are left untouched.
+     */
+    bool Query;
+    /*!
+     * Channels found busy for the pending uplink, one bit per channel, or
+     * NULL. They are only selected when all the other channels are busy too.
+     */
+    uint16_t* BusyChannelsMask;
 }NextChanParams_t;
 
 /*!
@@ -1154,13 +1245,13 @@ typedef struct sContinuousWaveParams
      */
     int8_t TxPower;
     /*!
-     * Max EIRP, if applicable.
+     * Max EIRP in half dB, if applicable.
      */
-    float MaxEirp;
+    int8_t MaxEirp;
     /*!
-     * The antenna gain, if applicable.
+     * The antenna gain in half dB, if applicable.
      */
-    float AntennaGain;
+    int8_t AntennaGain;
     /*!
      * Specifies the time the radio will stay in CW mode.
      */
@@ -1169,6 +1260,104 @@ typedef struct sContinuousWaveParams
 
 
 
+/*!
+ * Operations of a region. Each region exports a constant instance, see
+ * the Region<Name>Ops declarations of the region headers.
+ */
+typedef struct sRegionOps
+{
+    /*!
+     * Gets a PHY parameter, see RegionGetPhyParam.
+     */
+    PhyParam_t ( *GetPhyParam )( GetPhyParams_t* getPhy );
+    /*!
+     * Updates the last TX done parameters of the current channel, see RegionSetBandTxDone.
+     */
+    void ( *SetBandTxDone )( SetBandTxDoneParams_t* txDone );
+    /*!
+     * Initializes the channels masks and the channels, see RegionInitDefaults.
+     */
+    void ( *InitDefaults )( InitType_t type );
+    /*!
+     * Verifies a parameter, see RegionVerify.
+     */
+    bool ( *Verify )( VerifyParams_t* verify, PhyAttribute_t phyAttribute );
+    /*!
+     * Applies the CF list, see RegionApplyCFList.
+     */
+    void ( *ApplyCFList )( ApplyCFListParams_t* applyCFList );
+    /*!
+     * Sets a channels mask, see RegionChanMaskSet.
+     */
+    bool ( *ChanMaskSet )( ChanMaskSetParams_t* chanMaskSet );
+    /*!
+     * Calculates the next datarate to set, when ADR is on or off, see RegionAdrNext.
+     */
+    bool ( *AdrNext )( AdrNextParams_t* adrNext, int8_t* drOut, int8_t* txPowOut, uint32_t* adrAckCounter );
+    /*!
+     * Computes the RX window timeout and offset, see RegionComputeRxWindowParameters.
+     */
+    void ( *ComputeRxWindowParameters )( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams );
+    /*!
+     * Configuration of the RX windows, see RegionRxConfig.
+     */
+    bool ( *RxConfig )( RxConfigParams_t* rxConfig, int8_t* datarate );
+    /*!
+     * TX configuration, see RegionTxConfig.
+     */
+    bool ( *TxConfig )( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir );
+    /*!
+     * Processes a LinkAdrReq, see RegionLinkAdrReq.
+     */
+    uint8_t ( *LinkAdrReq )( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, int8_t* txPowOut, uint8_t* nbRepOut, uint8_t* nbBytesParsed );
+    /*!
+     * Processes a RxParamSetupReq, see RegionRxParamSetupReq.
+     */
+    uint8_t ( *RxParamSetupReq )( RxParamSetupReqParams_t* rxParamSetupReq );
+    /*!
+     * Processes a NewChannelReq, see RegionNewChannelReq.
+     */
+    uint8_t ( *NewChannelReq )( NewChannelReqParams_t* newChannelReq );
+    /*!
+     * Processes a TxParamSetupReq, see RegionTxParamSetupReq.
+     */
+    int8_t ( *TxParamSetupReq )( TxParamSetupReqParams_t* txParamSetupReq );
+    /*!
+     * Processes a DlChannelReq, see RegionDlChannelReq.
+     */
+    uint8_t ( *DlChannelReq )( DlChannelReqParams_t* dlChannelReq );
+    /*!
+     * Alternates the datarate of the channel for the join request, see RegionAlternateDr.
+     */
+    int8_t ( *AlternateDr )( AlternateDrParams_t* alternateDr );
+    /*!
+     * Calculates the back-off time, see RegionCalcBackOff.
+     */
+    void ( *CalcBackOff )( CalcBackOffParams_t* calcBackOff );
+    /*!
+     * Searches and sets the next random available channel, see RegionNextChannel.
+     */
+    bool ( *NextChannel )( NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
+    /*!
+     * Adds a channel, see RegionChannelAdd.
+     */
+    LoRaMacStatus_t ( *ChannelAdd )( ChannelAddParams_t* channelAdd );
+    /*!
+     * Removes a channel, see RegionChannelsRemove.
+     */
+    bool ( *ChannelsRemove )( ChannelRemoveParams_t* channelRemove );
+    /*!
+     * Sets the radio into continuous wave mode, see RegionSetContinuousWave.
+     */
+    void ( *SetContinuousWave )( ContinuousWaveParams_t* continuousWave );
+    /*!
+     * Computes new datarate according to the given offset, see RegionApplyDrOffset.
+     */
+    uint8_t ( *ApplyDrOffset )( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
+}RegionOps_t;
+
+
+
 /*!
  * \brief The function verifies if a region is active or not. If a region
  *        is not active, it cannot be used.
@@ -1179,6 +1368,16 @@ typedef struct sContinuousWaveParams
  */
 bool RegionIsActive( LoRaMacRegion_t region );
 
+/*!
+ * \brief Gets the operations of a region, for the callers which keep them
+ *        instead of passing the region on every call.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \retval Returns the region operations, NULL if the region is not active.
+ */
+const RegionOps_t* RegionGetOps( LoRaMacRegion_t region );
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -1190,6 +1389,17 @@ bool RegionIsActive( LoRaMacRegion_t region );
  */
 PhyParam_t RegionGetPhyParam( LoRaMacRegion_t region, GetPhyParams_t* getPhy );
 
+/*!
+ * \brief Reads the PHY parameters the MAC needs on every frame at once.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [IN] getPhyCache Pointer to the function parameters.
+ *
+ * \param [OUT] phyCache Parameters of the region.
+ */
+void RegionGetPhyCache( LoRaMacRegion_t region, GetPhyCacheParams_t* getPhyCache, PhyCache_t* phyCache );
+
 /*!
  * \brief Updates the last TX done parameters of the current channel.
  *
@@ -122,14 +122,14 @@
 #define AS923_DEFAULT_DOWNLINK_DWELL_TIME           1
 
 /*!
- * Default Max EIRP
+ * Default Max EIRP in half dB, 16 dBm
  */
-#define AS923_DEFAULT_MAX_EIRP                      16.0f
+#define AS923_DEFAULT_MAX_EIRP                      32
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define AS923_DEFAULT_ANTENNA_GAIN                  2.15f
+#define AS923_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -498,6 +498,11 @@ void RegionAS923SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionAS923ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionAS923Ops;
+
 /*! \} defgroup REGIONAS923 */
 
 #endif // __REGION_AS923_H__
@@ -65,6 +65,11 @@ static uint16_t ChannelsMaskRemaining[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Enabled channels supporting each tx datarate
+ */
+static uint16_t ChannelsDrMask[AU915_TX_MAX_DATARATE + 1][CHANNELS_MASK_SIZE];
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -105,35 +110,29 @@ static int8_t LimitTxPower( int8_t txPower, int8_t maxBandTxPower, int8_t datara
     return txPowerResult;
 }
 
-static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
+static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, Band_t* bands, uint16_t* enabledMask, uint8_t* delayTx )
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTransmission = 0;
 
-    for( uint8_t i = 0, k = 0; i < AU915_MAX_NB_CHANNELS; i += 16, k++ )
+    for( uint8_t k = 0; k < CHANNELS_MASK_SIZE; k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        if( datarate <= AU915_TX_MAX_DATARATE )
+        { // Keep the enabled channels supporting the given datarate
+            enabledMask[k] = channelsMask[k] & ChannelsDrMask[datarate][k];
+        }
+        else
         {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
+            enabledMask[k] = 0;
         }
     }
+    nbEnabledChannels = RegionCommonCountChannels( enabledMask, 0, CHANNELS_MASK_SIZE );
+
+    if( bands[0].TimeOff > 0 )
+    { // Check if the band is available for transmission, all the channels are in band 0
+        delayTransmission = nbEnabledChannels;
+        nbEnabledChannels = 0;
+    }
 
     *delayTx = delayTransmission;
     return nbEnabledChannels;
@@ -165,6 +164,16 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = GetNextLowerTxDr( getPhy->Datarate, AU915_TX_MIN_DATARATE );
             break;
         }
+        case PHY_BANDWIDTH:
+        {
+            phyParam.Value = RegionCommonGetBandwidth( BandwidthsAU915, sizeof( BandwidthsAU915 ) / sizeof( BandwidthsAU915[0] ), getPhy->Datarate );
+            break;
+        }
+        case PHY_SYMBOL_TIME:
+        {
+            phyParam.Value = RegionCommonGetSymbolTime( DataratesAU915, BandwidthsAU915, sizeof( DataratesAU915 ), getPhy->Datarate );
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = AU915_DEFAULT_TX_POWER;
@@ -263,12 +272,12 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_DEF_MAX_EIRP:
         {
-            phyParam.fValue = AU915_DEFAULT_MAX_EIRP;
+            phyParam.Value = AU915_DEFAULT_MAX_EIRP;
             break;
         }
         case PHY_DEF_ANTENNA_GAIN:
         {
-            phyParam.fValue = AU915_DEFAULT_ANTENNA_GAIN;
+            phyParam.Value = AU915_DEFAULT_ANTENNA_GAIN;
             break;
         }
         case PHY_NB_JOIN_TRIALS:
@@ -313,6 +322,12 @@ void RegionAU915InitDefaults( InitType_t type )
                 Channels[i].Band = 0;
             }
 
+            // Channels supporting each tx datarate
+            for( int8_t dr = DR_0; dr <= AU915_TX_MAX_DATARATE; dr++ )
+            {
+                RegionCommonChanDrMask( Channels, AU915_MAX_NB_CHANNELS, dr, ChannelsDrMask[dr] );
+            }
+
             // Initialize channels default mask
             ChannelsDefaultMask[0] = 0xFFFF;
             ChannelsDefaultMask[1] = 0xFFFF;
@@ -491,7 +506,7 @@ bool RegionAU915AdrNext( AdrNextParams_t* adrNext, int8_t* drOut, int8_t* txPowO
 
 void RegionAU915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    uint32_t tSymbol = 0;
     uint32_t radioWakeUpTime;
 
     // Get the datarate, perform a boundary check
@@ -769,20 +784,29 @@ bool RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTx = 0;
-    uint8_t enabledChannels[AU915_MAX_NB_CHANNELS] = { 0 };
+    uint16_t enabledMask[CHANNELS_MASK_SIZE] = { 0 };
     TimerTime_t nextTxDelay = 0;
+    uint16_t queryMaskRemaining[CHANNELS_MASK_SIZE];
+    uint16_t* channelsMaskRemaining = ChannelsMaskRemaining;
+
+    if( nextChanParams->Query == true )
+    {
+        // A query works on a copy of the mask, the channel plan stays untouched
+        RegionCommonChanMaskCopy( queryMaskRemaining, ChannelsMaskRemaining, CHANNELS_MASK_SIZE );
+        channelsMaskRemaining = queryMaskRemaining;
+    }
 
     // Count 125kHz channels
-    if( RegionCommonCountChannels( ChannelsMaskRemaining, 0, 4 ) == 0 )
+    if( RegionCommonCountChannels( channelsMaskRemaining, 0, 4 ) == 0 )
     { // Reactivate default channels
-        RegionCommonChanMaskCopy( ChannelsMaskRemaining, ChannelsMask, 4  );
+        RegionCommonChanMaskCopy( channelsMaskRemaining, ChannelsMask, 4  );
     }
     // Check other channels
     if( nextChanParams->Datarate >= DR_6 )
     {
-        if( ( ChannelsMaskRemaining[4] & 0x00FF ) == 0 )
+        if( ( channelsMaskRemaining[4] & 0x00FF ) == 0 )
         {
-            ChannelsMaskRemaining[4] = ChannelsMask[4];
+            channelsMaskRemaining[4] = ChannelsMask[4];
         }
     }
 
@@ -795,9 +819,8 @@ bool RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
         nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, Bands, AU915_MAX_NB_BANDS );
 
         // Search how many channels are enabled
-        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate,
-                                                      ChannelsMaskRemaining, Channels,
-                                                      Bands, enabledChannels, &delayTx );
+        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate, channelsMaskRemaining,
+                                                      Bands, enabledMask, &delayTx );
     }
     else
     {
@@ -808,9 +831,9 @@ bool RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
     if( nbEnabledChannels > 0 )
     {
         // We found a valid channel
-        *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+        *channel = RegionCommonSelectChannel( enabledMask, CHANNELS_MASK_SIZE, nbEnabledChannels, nextChanParams->BusyChannelsMask );
         // Disable the channel in the mask
-        RegionCommonChanDisable( ChannelsMaskRemaining, *channel, AU915_MAX_NB_CHANNELS - 8 );
+        RegionCommonChanDisable( channelsMaskRemaining, *channel, AU915_MAX_NB_CHANNELS - 8 );
 
         *time = 0;
         return true;
@@ -861,3 +884,32 @@ uint8_t RegionAU915ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
     }
     return datarate;
 }
+
+/*!
+ * AU915 region operations
+ */
+const RegionOps_t RegionAU915Ops =
+{
+    .GetPhyParam = RegionAU915GetPhyParam,
+    .SetBandTxDone = RegionAU915SetBandTxDone,
+    .InitDefaults = RegionAU915InitDefaults,
+    .Verify = RegionAU915Verify,
+    .ApplyCFList = RegionAU915ApplyCFList,
+    .ChanMaskSet = RegionAU915ChanMaskSet,
+    .AdrNext = RegionAU915AdrNext,
+    .ComputeRxWindowParameters = RegionAU915ComputeRxWindowParameters,
+    .RxConfig = RegionAU915RxConfig,
+    .TxConfig = RegionAU915TxConfig,
+    .LinkAdrReq = RegionAU915LinkAdrReq,
+    .RxParamSetupReq = RegionAU915RxParamSetupReq,
+    .NewChannelReq = RegionAU915NewChannelReq,
+    .TxParamSetupReq = RegionAU915TxParamSetupReq,
+    .DlChannelReq = RegionAU915DlChannelReq,
+    .AlternateDr = RegionAU915AlternateDr,
+    .CalcBackOff = RegionAU915CalcBackOff,
+    .NextChannel = RegionAU915NextChannel,
+    .ChannelAdd = RegionAU915ChannelAdd,
+    .ChannelsRemove = RegionAU915ChannelsRemove,
+    .SetContinuousWave = RegionAU915SetContinuousWave,
+    .ApplyDrOffset = RegionAU915ApplyDrOffset,
+};
@@ -96,14 +96,14 @@
 #define AU915_DEFAULT_TX_POWER                      TX_POWER_0
 
 /*!
- * Default Max EIRP
+ * Default Max EIRP in half dB, 30 dBm
  */
-#define AU915_DEFAULT_MAX_EIRP                      30.0f
+#define AU915_DEFAULT_MAX_EIRP                      60
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define AU915_DEFAULT_ANTENNA_GAIN                  2.15f
+#define AU915_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -450,6 +450,11 @@ void RegionAU915SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionAU915ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionAU915Ops;
+
 /*! \} defgroup REGIONAU915 */
 
 #endif // __REGION_AU915_H__
@@ -60,6 +60,11 @@ static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Enabled channels supporting each tx datarate
+ */
+static uint16_t ChannelsDrMask[CN470_TX_MAX_DATARATE + 1][CHANNELS_MASK_SIZE];
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -100,35 +105,29 @@ static int8_t LimitTxPower( int8_t txPower, int8_t maxBandTxPower, int8_t datara
     return txPowerResult;
 }
 
-static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
+static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, Band_t* bands, uint16_t* enabledMask, uint8_t* delayTx )
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTransmission = 0;
 
-    for( uint8_t i = 0, k = 0; i < CN470_MAX_NB_CHANNELS; i += 16, k++ )
+    for( uint8_t k = 0; k < CHANNELS_MASK_SIZE; k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        if( datarate <= CN470_TX_MAX_DATARATE )
+        { // Keep the enabled channels supporting the given datarate
+            enabledMask[k] = channelsMask[k] & ChannelsDrMask[datarate][k];
+        }
+        else
         {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
+            enabledMask[k] = 0;
         }
     }
+    nbEnabledChannels = RegionCommonCountChannels( enabledMask, 0, CHANNELS_MASK_SIZE );
+
+    if( bands[0].TimeOff > 0 )
+    { // Check if the band is available for transmission, all the channels are in band 0
+        delayTransmission = nbEnabledChannels;
+        nbEnabledChannels = 0;
+    }
 
     *delayTx = delayTransmission;
     return nbEnabledChannels;
@@ -160,6 +159,16 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = GetNextLowerTxDr( getPhy->Datarate, CN470_TX_MIN_DATARATE );
             break;
         }
+        case PHY_BANDWIDTH:
+        {
+            phyParam.Value = RegionCommonGetBandwidth( BandwidthsCN470, sizeof( BandwidthsCN470 ) / sizeof( BandwidthsCN470[0] ), getPhy->Datarate );
+            break;
+        }
+        case PHY_SYMBOL_TIME:
+        {
+            phyParam.Value = RegionCommonGetSymbolTime( DataratesCN470, BandwidthsCN470, sizeof( DataratesCN470 ), getPhy->Datarate );
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = CN470_DEFAULT_TX_POWER;
@@ -258,12 +267,12 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_DEF_MAX_EIRP:
         {
-            phyParam.fValue = CN470_DEFAULT_MAX_EIRP;
+            phyParam.Value = CN470_DEFAULT_MAX_EIRP;
             break;
         }
         case PHY_DEF_ANTENNA_GAIN:
         {
-            phyParam.fValue = CN470_DEFAULT_ANTENNA_GAIN;
+            phyParam.Value = CN470_DEFAULT_ANTENNA_GAIN;
             break;
         }
         case PHY_NB_JOIN_TRIALS:
@@ -301,6 +310,12 @@ void RegionCN470InitDefaults( InitType_t type )
                 Channels[i].Band = 0;
             }
 
+            // Channels supporting each tx datarate
+            for( int8_t dr = DR_0; dr <= CN470_TX_MAX_DATARATE; dr++ )
+            {
+                RegionCommonChanDrMask( Channels, CN470_MAX_NB_CHANNELS, dr, ChannelsDrMask[dr] );
+            }
+
             // Initialize the channels default mask
             ChannelsDefaultMask[0] = 0xFFFF;
             ChannelsDefaultMask[1] = 0xFFFF;
@@ -455,7 +470,7 @@ bool RegionCN470AdrNext( AdrNextParams_t* adrNext, int8_t* drOut, int8_t* txPowO
 
 void RegionCN470ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    uint32_t tSymbol = 0;
     uint32_t radioWakeUpTime;
 
     // Get the datarate, perform a boundary check
@@ -725,18 +740,27 @@ bool RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTx = 0;
-    uint8_t enabledChannels[CN470_MAX_NB_CHANNELS] = { 0 };
+    uint16_t enabledMask[CHANNELS_MASK_SIZE] = { 0 };
     TimerTime_t nextTxDelay = 0;
+    uint16_t queryMask[CHANNELS_MASK_SIZE];
+    uint16_t* channelsMask = ChannelsMask;
+
+    if( nextChanParams->Query == true )
+    {
+        // A query works on a copy of the mask, the channel plan stays untouched
+        RegionCommonChanMaskCopy( queryMask, ChannelsMask, CHANNELS_MASK_SIZE );
+        channelsMask = queryMask;
+    }
 
     // Count 125kHz channels
-    if( RegionCommonCountChannels( ChannelsMask, 0, 6 ) == 0 )
+    if( RegionCommonCountChannels( channelsMask, 0, 6 ) == 0 )
     { // Reactivate default channels
-        ChannelsMask[0] = 0xFFFF;
-        ChannelsMask[1] = 0xFFFF;
-        ChannelsMask[2] = 0xFFFF;
-        ChannelsMask[3] = 0xFFFF;
-        ChannelsMask[4] = 0xFFFF;
-        ChannelsMask[5] = 0xFFFF;
+        channelsMask[0] = 0xFFFF;
+        channelsMask[1] = 0xFFFF;
+        channelsMask[2] = 0xFFFF;
+        channelsMask[3] = 0xFFFF;
+        channelsMask[4] = 0xFFFF;
+        channelsMask[5] = 0xFFFF;
     }
 
     if( nextChanParams->AggrTimeOff <= TimerGetElapsedTime( nextChanParams->LastAggrTx ) )
@@ -748,9 +772,8 @@ bool RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
         nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, Bands, CN470_MAX_NB_BANDS );
 
         // Search how many channels are enabled
-        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate,
-                                                      ChannelsMask, Channels,
-                                                      Bands, enabledChannels, &delayTx );
+        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate, channelsMask,
+                                                      Bands, enabledMask, &delayTx );
     }
     else
     {
@@ -761,7 +784,7 @@ bool RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
     if( nbEnabledChannels > 0 )
     {
         // We found a valid channel
-        *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+        *channel = RegionCommonSelectChannel( enabledMask, CHANNELS_MASK_SIZE, nbEnabledChannels, nextChanParams->BusyChannelsMask );
 
         *time = 0;
         return true;
@@ -812,3 +835,32 @@ uint8_t RegionCN470ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
     }
     return datarate;
 }
+
+/*!
+ * CN470 region operations
+ */
+const RegionOps_t RegionCN470Ops =
+{
+    .GetPhyParam = RegionCN470GetPhyParam,
+    .SetBandTxDone = RegionCN470SetBandTxDone,
+    .InitDefaults = RegionCN470InitDefaults,
+    .Verify = RegionCN470Verify,
+    .ApplyCFList = RegionCN470ApplyCFList,
+    .ChanMaskSet = RegionCN470ChanMaskSet,
+    .AdrNext = RegionCN470AdrNext,
+    .ComputeRxWindowParameters = RegionCN470ComputeRxWindowParameters,
+    .RxConfig = RegionCN470RxConfig,
+    .TxConfig = RegionCN470TxConfig,
+    .LinkAdrReq = RegionCN470LinkAdrReq,
+    .RxParamSetupReq = RegionCN470RxParamSetupReq,
+    .NewChannelReq = RegionCN470NewChannelReq,
+    .TxParamSetupReq = RegionCN470TxParamSetupReq,
+    .DlChannelReq = RegionCN470DlChannelReq,
+    .AlternateDr = RegionCN470AlternateDr,
+    .CalcBackOff = RegionCN470CalcBackOff,
+    .NextChannel = RegionCN470NextChannel,
+    .ChannelAdd = RegionCN470ChannelAdd,
+    .ChannelsRemove = RegionCN470ChannelsRemove,
+    .SetContinuousWave = RegionCN470SetContinuousWave,
+    .ApplyDrOffset = RegionCN470ApplyDrOffset,
+};
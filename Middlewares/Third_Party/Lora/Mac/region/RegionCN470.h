@@ -96,14 +96,14 @@
 #define CN470_DEFAULT_TX_POWER                    TX_POWER_0
 
 /*!
- * Default Max EIRP
+ * Default Max EIRP in half dB, 19.15 dBm, rounded up as the antenna gain
  */
-#define CN470_DEFAULT_MAX_EIRP                      19.15f
+#define CN470_DEFAULT_MAX_EIRP                      39
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define CN470_DEFAULT_ANTENNA_GAIN                  2.15f
+#define CN470_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -436,6 +436,11 @@ void RegionCN470SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionCN470ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionCN470Ops;
+
 /*! \} defgroup REGIONCN470 */
 
 #endif // __REGION_CN470_H__
@@ -21,12 +21,14 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #include <stdbool.h>
 #include <string.h>
 #include <stdint.h>
-#include <math.h>
 
+#include "radio.h"
 #include "timer.h"
 #include "utilities.h"
 #include "LoRaMac.h"
+#include "Region.h"
 #include "RegionCommon.h"
+#include "debug.h"
 
 
 
@@ -34,21 +36,124 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define BACKOFF_DC_10_HOURS     1000
 #define BACKOFF_DC_24_HOURS     10000
 
+/*!
+ * Observation period of the duty cycle regulation, in ms
+ */
+#define DC_OBSERVATION_PERIOD   3600000
+
+#if ( REGION_COMMON_DC_WINDOW_FRAMES == 1 ) || ( REGION_COMMON_DC_WINDOW_FRAMES > 255 )
+#error "REGION_COMMON_DC_WINDOW_FRAMES must be 0 or in the range 2 to 255"
+#endif
+
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+/*!
+ * Selection weights of a channel. The worst channel keeps a quarter of the
+ * weight of the best one, so every enabled channel remains in use.
+ */
+#define CHANNEL_WEIGHT_MIN      4
+#define CHANNEL_WEIGHT_MAX      16
+
+/*!
+ * Statistics of the channels, indexed by channel id
+ */
+static RegionCommonChannelStats_t ChannelStats[REGION_COMMON_STATS_MAX_CHANNELS];
+#endif
+
 
 
 static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
 {
-    uint8_t nbActiveBits = 0;
+    uint32_t bits = mask;
 
-    for( uint8_t j = 0; j < nbBits; j++ )
+    if( nbBits < 16 )
+    {
+        bits &= ( 1 << nbBits ) - 1;
+    }
+
+    // Parallel bit count, the core has no population count instruction
+    bits = bits - ( ( bits >> 1 ) & 0x5555 );
+    bits = ( bits & 0x3333 ) + ( ( bits >> 2 ) & 0x3333 );
+    bits = ( bits + ( bits >> 4 ) ) & 0x0F0F;
+    return ( uint8_t )( ( bits + ( bits >> 8 ) ) & 0x1F );
+}
+
+static bool ChannelBusy( uint16_t* busyMask, uint8_t id )
+{
+    return ( busyMask != NULL ) && ( ( busyMask[id / 16] & ( 1 << ( id % 16 ) ) ) != 0 );
+}
+
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+static uint8_t ChannelWeight( uint8_t id )
+{
+    RegionCommonChannelStats_t* stats;
+
+    if( id >= REGION_COMMON_STATS_MAX_CHANNELS )
+    {
+        return CHANNEL_WEIGHT_MAX;
+    }
+    stats = &ChannelStats[id];
+    // Channels without history are tried first
+    if( stats->Attempts == 0 )
+    {
+        return CHANNEL_WEIGHT_MAX;
+    }
+    return CHANNEL_WEIGHT_MIN + ( ( CHANNEL_WEIGHT_MAX - CHANNEL_WEIGHT_MIN ) * MIN( stats->Acks, stats->Attempts ) ) / stats->Attempts;
+}
+#endif
+
+#if ( REGION_COMMON_DC_WINDOW_FRAMES > 0 )
+static void BandWindowDrop( Band_t* band )
+{
+    band->WindowFrames--;
+    for( uint8_t i = 0; i < band->WindowFrames; i++ )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
+        band->WindowEnd[i] = band->WindowEnd[i + 1];
+        band->WindowAirtime[i] = band->WindowAirtime[i + 1];
+    }
+}
+
+static TimerTime_t BandWindowTimeOff( Band_t* band, TimerTime_t txTimeOnAir )
+{
+    TimerTime_t budget = DC_OBSERVATION_PERIOD / band->DCycle;
+    TimerTime_t airtime = 0;
+    TimerTime_t timeOff = 0;
+    uint8_t i;
+
+    // CalcBackOff runs on every scheduling attempt, record each frame only
+    // once
+    if( ( txTimeOnAir > 0 ) &&
+        ( ( band->WindowFrames == 0 ) || ( band->WindowEnd[band->WindowFrames - 1] != band->LastTxDoneTime ) ) )
+    {
+        // Forget the frames out of the hour before this one
+        while( ( band->WindowFrames > 0 ) && ( ( band->LastTxDoneTime - band->WindowEnd[0] ) >= DC_OBSERVATION_PERIOD ) )
+        {
+            BandWindowDrop( band );
+        }
+        // Out of room, the oldest frame leaves the window with the next one
+        if( band->WindowFrames == REGION_COMMON_DC_WINDOW_FRAMES )
         {
-            nbActiveBits++;
+            band->WindowAirtime[1] += band->WindowAirtime[0];
+            BandWindowDrop( band );
         }
+        band->WindowEnd[band->WindowFrames] = band->LastTxDoneTime;
+        band->WindowAirtime[band->WindowFrames] = txTimeOnAir;
+        band->WindowFrames++;
+    }
+
+    for( i = 0; i < band->WindowFrames; i++ )
+    {
+        airtime += band->WindowAirtime[i];
+    }
+    // Reopen the band once enough of the oldest frames are out of the hour
+    // for the longest frame to fit
+    for( i = 0; ( i < band->WindowFrames ) && ( ( airtime + REGION_COMMON_DC_MAX_FRAME_AIRTIME ) > budget ); i++ )
+    {
+        airtime -= band->WindowAirtime[i];
+        timeOff = band->WindowEnd[i] + DC_OBSERVATION_PERIOD - band->LastTxDoneTime;
     }
-    return nbActiveBits;
+    return timeOff;
 }
+#endif
 
 
 
@@ -137,6 +242,50 @@ uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uin
     return nbChannels;
 }
 
+uint8_t RegionCommonGetNthChannel( uint16_t* channelsMask, uint8_t nbMasks, uint8_t n )
+{
+    for( uint8_t i = 0; i < nbMasks; i++ )
+    {
+        uint16_t mask = channelsMask[i];
+        uint8_t nbChannels = CountChannels( mask, 16 );
+
+        if( n < nbChannels )
+        {
+            // Clear the n lowest active channels, the one we look for is then the lowest
+            for( ; n > 0; n-- )
+            {
+                mask &= mask - 1;
+            }
+            for( uint8_t j = 0; j < 16; j++ )
+            {
+                if( ( mask & ( 1 << j ) ) != 0 )
+                {
+                    return ( i * 16 ) + j;
+                }
+            }
+        }
+        n -= nbChannels;
+    }
+    return nbMasks * 16;
+}
+
+void RegionCommonChanDrMask( ChannelParams_t* channels, uint8_t nbChannels, int8_t dr, uint16_t* drMask )
+{
+    for( uint8_t i = 0; i < ( ( nbChannels + 15 ) / 16 ); i++ )
+    {
+        drMask[i] = 0;
+    }
+
+    for( uint8_t i = 0; i < nbChannels; i++ )
+    {
+        if( ( channels[i].Frequency != 0 ) &&
+            ( RegionCommonValueInRange( dr, channels[i].DrRange.Fields.Min, channels[i].DrRange.Fields.Max ) == 1 ) )
+        {
+            drMask[i / 16] |= 1 << ( i % 16 );
+        }
+    }
+}
+
 void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len )
 {
     if( ( channelsMaskDest != NULL ) && ( channelsMaskSrc != NULL ) )
@@ -293,27 +442,76 @@ uint8_t RegionCommonLinkAdrReqVerifyParams( RegionCommonLinkAdrReqVerifyParams_t
     return status;
 }
 
-double RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth )
+/*!
+ * \brief Signed integer division rounded towards plus infinity
+ *
+ * \param [IN] num Numerator
+ *
+ * \param [IN] den Denominator, strictly positive
+ *
+ * \retval Returns ceil( num / den ).
+ */
+static int32_t RegionCommonDivCeil( int32_t num, int32_t den )
+{
+    int32_t quotient = num / den;
+
+    // The C division truncates towards zero, only a positive rest rounds up
+    if( ( num % den ) > 0 )
+    {
+        quotient++;
+    }
+    return quotient;
+}
+
+uint32_t RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth )
+{
+    return ( ( uint32_t )( 1 << phyDr ) * 1000000 ) / bandwidth;
+}
+
+uint32_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
 {
-    return ( ( double )( 1 << phyDr ) / ( double )bandwidth ) * 1000;
+    return ( 8 * 1000 ) / phyDr; // 1 symbol equals 1 byte, phyDr in kbps
+}
+
+uint32_t RegionCommonGetBandwidth( const uint32_t* bandwidths, uint8_t nbDatarates, int8_t datarate )
+{
+    if( ( datarate < 0 ) || ( datarate >= nbDatarates ) )
+    {
+        return 0;
+    }
+    return bandwidths[datarate];
 }
 
-double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
+uint32_t RegionCommonGetSymbolTime( const uint8_t* datarates, const uint32_t* bandwidths, uint8_t nbDatarates, int8_t datarate )
 {
-    return ( 8.0 / ( double )phyDr ); // 1 symbol equals 1 byte
+    if( ( datarate < 0 ) || ( datarate >= nbDatarates ) || ( datarates[datarate] == 0 ) )
+    {
+        return 0;
+    }
+    if( bandwidths[datarate] == 0 )
+    { // FSK
+        return RegionCommonComputeSymbolTimeFsk( datarates[datarate] );
+    }
+    return RegionCommonComputeSymbolTimeLoRa( datarates[datarate], bandwidths[datarate] );
 }
 
-void RegionCommonComputeRxWindowParameters( double tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset )
+void RegionCommonComputeRxWindowParameters( uint32_t tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset )
 {
-    *windowTimeout = MAX( ( uint32_t )ceil( ( ( 2 * minRxSymbols - 8 ) * tSymbol + 2 * rxError ) / tSymbol ), minRxSymbols ); // Computed number of symbols
-    *windowOffset = ( int32_t )ceil( ( 4.0 * tSymbol ) - ( ( *windowTimeout * tSymbol ) / 2.0 ) - wakeUpTime );
+    int32_t timeout;
+
+    // Computed number of symbols
+    timeout = RegionCommonDivCeil( ( 2 * minRxSymbols - 8 ) * ( int32_t )tSymbol + 2 * ( int32_t )rxError * 1000, tSymbol );
+    *windowTimeout = MAX( timeout, minRxSymbols );
+    // 4 * tSymbol - windowTimeout * tSymbol / 2 - wakeUpTime, rounded up to the ms
+    *windowOffset = RegionCommonDivCeil( 8 * ( int32_t )tSymbol - ( int32_t )( *windowTimeout * tSymbol ) - 2000 * ( int32_t )wakeUpTime, 2000 );
 }
 
-int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float antennaGain )
+int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, int8_t maxEirp, int8_t antennaGain )
 {
     int8_t phyTxPower = 0;
 
-    phyTxPower = ( int8_t )floor( ( maxEirp - ( txPowerIndex * 2U ) ) - antennaGain );
+    // In half dB, each TX power index taking 2 dB off, rounded down to the dB
+    phyTxPower = ( int8_t )-RegionCommonDivCeil( antennaGain + ( txPowerIndex * 4 ) - maxEirp, 2 );
 
     return phyTxPower;
 }
@@ -352,7 +550,11 @@ void RegionCommonCalcBackOff( RegionCommonCalcBackOffParams_t* calcBackOffParams
     {
         if( calcBackOffParams->DutyCycleEnabled == true )
         {
+#if ( REGION_COMMON_DC_WINDOW_FRAMES > 0 )
+            calcBackOffParams->Bands[bandIdx].TimeOff = BandWindowTimeOff( &calcBackOffParams->Bands[bandIdx], calcBackOffParams->TxTimeOnAir );
+#else
             calcBackOffParams->Bands[bandIdx].TimeOff = calcBackOffParams->TxTimeOnAir * dutyCycle - calcBackOffParams->TxTimeOnAir;
+#endif
         }
         else
         {
@@ -360,3 +562,547 @@ void RegionCommonCalcBackOff( RegionCommonCalcBackOffParams_t* calcBackOffParams
         }
     }
 }
+
+LoRaMacStatus_t RegionCommonChannelAdd( const RegionCommonChannelPlan_t* plan, ChannelAddParams_t* channelAdd )
+{
+    uint8_t band = 0;
+    bool drInvalid = false;
+    bool freqInvalid = false;
+    uint8_t id = channelAdd->ChannelId;
+
+    if( id >= plan->MaxNbChannels )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    // Validate the datarate range
+    if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Min, plan->TxMinDatarate, plan->TxMaxDatarate ) == false )
+    {
+        drInvalid = true;
+    }
+    if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Max, plan->TxMinDatarate, plan->TxMaxDatarate ) == false )
+    {
+        drInvalid = true;
+    }
+    if( channelAdd->NewChannel->DrRange.Fields.Min > channelAdd->NewChannel->DrRange.Fields.Max )
+    {
+        drInvalid = true;
+    }
+
+    // Default channels don't accept all values
+    if( id < plan->NbDefaultChannels )
+    {
+        if( channelAdd->NewChannel->DrRange.Fields.Min > plan->DefaultChannelsMaxMinDr )
+        {
+            drInvalid = true;
+        }
+        if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Max, plan->DefaultChannelsMinMaxDr, plan->TxMaxDatarate ) == false )
+        {
+            drInvalid = true;
+        }
+        // We are not allowed to change the frequency
+        if( channelAdd->NewChannel->Frequency != plan->Channels[id].Frequency )
+        {
+            freqInvalid = true;
+        }
+    }
+
+    // Check frequency
+    if( freqInvalid == false )
+    {
+        if( plan->VerifyTxFreq( channelAdd->NewChannel->Frequency, &band ) == false )
+        {
+            freqInvalid = true;
+        }
+    }
+
+    // Check status
+    if( ( drInvalid == true ) && ( freqInvalid == true ) )
+    {
+        return LORAMAC_STATUS_FREQ_AND_DR_INVALID;
+    }
+    if( drInvalid == true )
+    {
+        return LORAMAC_STATUS_DATARATE_INVALID;
+    }
+    if( freqInvalid == true )
+    {
+        return LORAMAC_STATUS_FREQUENCY_INVALID;
+    }
+
+    memcpy( &( plan->Channels[id] ), channelAdd->NewChannel, sizeof( plan->Channels[id] ) );
+    plan->Channels[id].Band = band;
+    plan->ChannelsMask[0] |= ( 1 << id );
+    return LORAMAC_STATUS_OK;
+}
+
+bool RegionCommonChannelsRemove( const RegionCommonChannelPlan_t* plan, ChannelRemoveParams_t* channelRemove )
+{
+    uint8_t id = channelRemove->ChannelId;
+
+    if( id < plan->NbDefaultChannels )
+    {
+        return false;
+    }
+
+    // Remove the channel from the list of channels
+    plan->Channels[id] = ( ChannelParams_t ){ 0, 0, { 0 }, 0 };
+
+    return RegionCommonChanDisable( plan->ChannelsMask, id, plan->MaxNbChannels );
+}
+
+uint8_t RegionCommonNewChannelReq( const RegionCommonChannelPlan_t* plan, NewChannelReqParams_t* newChannelReq )
+{
+    uint8_t status = 0x03;
+    ChannelAddParams_t channelAdd;
+    ChannelRemoveParams_t channelRemove;
+
+    if( newChannelReq->NewChannel->Frequency == 0 )
+    {
+        channelRemove.ChannelId = newChannelReq->ChannelId;
+
+        // Remove
+        if( RegionCommonChannelsRemove( plan, &channelRemove ) == false )
+        {
+            status &= 0xFC;
+        }
+    }
+    else
+    {
+        channelAdd.NewChannel = newChannelReq->NewChannel;
+        channelAdd.ChannelId = newChannelReq->ChannelId;
+
+        switch( RegionCommonChannelAdd( plan, &channelAdd ) )
+        {
+            case LORAMAC_STATUS_OK:
+            {
+                break;
+            }
+            case LORAMAC_STATUS_FREQUENCY_INVALID:
+            {
+                status &= 0xFE;
+                break;
+            }
+            case LORAMAC_STATUS_DATARATE_INVALID:
+            {
+                status &= 0xFD;
+                break;
+            }
+            case LORAMAC_STATUS_FREQ_AND_DR_INVALID:
+            {
+                status &= 0xFC;
+                break;
+            }
+            default:
+            {
+                status &= 0xFC;
+                break;
+            }
+        }
+    }
+
+    return status;
+}
+
+uint8_t RegionCommonDlChannelReq( const RegionCommonChannelPlan_t* plan, DlChannelReqParams_t* dlChannelReq )
+{
+    uint8_t status = 0x03;
+    uint8_t band = 0;
+
+    // Verify if the frequency is supported
+    if( plan->VerifyTxFreq( dlChannelReq->Rx1Frequency, &band ) == false )
+    {
+        status &= 0xFE;
+    }
+
+    // Verify if an uplink frequency exists
+    if( plan->Channels[dlChannelReq->ChannelId].Frequency == 0 )
+    {
+        status &= 0xFD;
+    }
+
+    // Apply Rx1 frequency, if the status is OK
+    if( status == 0x03 )
+    {
+        plan->Channels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
+    }
+
+    return status;
+}
+
+uint8_t RegionCommonLinkAdrReq( const RegionCommonChannelPlan_t* plan, LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, int8_t* txPowOut, uint8_t* nbRepOut, uint8_t* nbBytesParsed )
+{
+    uint8_t status = 0x07;
+    RegionCommonLinkAdrParams_t linkAdrParams = { 0 };
+    uint8_t nextIndex = 0;
+    uint8_t bytesProcessed = 0;
+    uint16_t chMask = 0;
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    RegionCommonLinkAdrReqVerifyParams_t linkAdrVerifyParams;
+
+    while( bytesProcessed < linkAdrReq->PayloadSize )
+    {
+        // Get ADR request parameters
+        nextIndex = RegionCommonParseLinkAdrReq( &( linkAdrReq->Payload[bytesProcessed] ), &linkAdrParams );
+
+        if( nextIndex == 0 )
+            break; // break loop, since no more request has been found
+
+        // Update bytes processed
+        bytesProcessed += nextIndex;
+
+        // Revert status, as we only check the last ADR request for the channel mask KO
+        status = 0x07;
+
+        // Setup temporary channels mask
+        chMask = linkAdrParams.ChMask;
+
+        // Verify channels mask
+        if( ( linkAdrParams.ChMaskCtrl == 0 ) && ( chMask == 0 ) )
+        {
+            status &= 0xFE; // Channel mask KO
+        }
+        else if( ( ( linkAdrParams.ChMaskCtrl >= 1 ) && ( linkAdrParams.ChMaskCtrl <= 5 )) ||
+                ( linkAdrParams.ChMaskCtrl >= 7 ) )
+        {
+            // RFU
+            status &= 0xFE; // Channel mask KO
+        }
+        else
+        {
+            for( uint8_t i = 0; i < plan->MaxNbChannels; i++ )
+            {
+                if( linkAdrParams.ChMaskCtrl == 6 )
+                {
+                    if( plan->Channels[i].Frequency != 0 )
+                    {
+                        chMask |= 1 << i;
+                    }
+                }
+                else
+                {
+                    if( ( ( chMask & ( 1 << i ) ) != 0 ) &&
+                        ( plan->Channels[i].Frequency == 0 ) )
+                    {// Trying to enable an undefined channel
+                        status &= 0xFE; // Channel mask KO
+                    }
+                }
+            }
+        }
+    }
+
+    // Get the minimum possible datarate
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    getPhy.UplinkDwellTime = linkAdrReq->UplinkDwellTime;
+    phyParam = plan->GetPhyParam( &getPhy );
+
+    linkAdrVerifyParams.Status = status;
+    linkAdrVerifyParams.AdrEnabled = linkAdrReq->AdrEnabled;
+    linkAdrVerifyParams.Datarate = linkAdrParams.Datarate;
+    linkAdrVerifyParams.TxPower = linkAdrParams.TxPower;
+    linkAdrVerifyParams.NbRep = linkAdrParams.NbRep;
+    linkAdrVerifyParams.CurrentDatarate = linkAdrReq->CurrentDatarate;
+    linkAdrVerifyParams.CurrentTxPower = linkAdrReq->CurrentTxPower;
+    linkAdrVerifyParams.CurrentNbRep = linkAdrReq->CurrentNbRep;
+    linkAdrVerifyParams.NbChannels = plan->MaxNbChannels;
+    linkAdrVerifyParams.ChannelsMask = &chMask;
+    linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
+    linkAdrVerifyParams.MaxDatarate = plan->TxMaxDatarate;
+    linkAdrVerifyParams.Channels = plan->Channels;
+    linkAdrVerifyParams.MinTxPower = plan->MinTxPower;
+    linkAdrVerifyParams.MaxTxPower = plan->MaxTxPower;
+
+    // Verify the parameters and update, if necessary
+    status = RegionCommonLinkAdrReqVerifyParams( &linkAdrVerifyParams, &linkAdrParams.Datarate, &linkAdrParams.TxPower, &linkAdrParams.NbRep );
+
+    // Update channelsMask if everything is correct
+    if( status == 0x07 )
+    {
+        // The dynamic plans hold up to 16 channels, in a single mask word
+        plan->ChannelsMask[0] = chMask;
+    }
+
+    // Update status variables
+    *drOut = linkAdrParams.Datarate;
+    *txPowOut = linkAdrParams.TxPower;
+    *nbRepOut = linkAdrParams.NbRep;
+    *nbBytesParsed = bytesProcessed;
+
+    return status;
+}
+
+uint8_t RegionCommonRxParamSetupReq( const RegionCommonChannelPlan_t* plan, RxParamSetupReqParams_t* rxParamSetupReq )
+{
+    uint8_t status = 0x07;
+
+    // Verify radio frequency
+    if( Radio.CheckRfFrequency( rxParamSetupReq->Frequency ) == false )
+    {
+        status &= 0xFE; // Channel frequency KO
+    }
+
+    // Verify datarate
+    if( RegionCommonValueInRange( rxParamSetupReq->Datarate, plan->RxMinDatarate, plan->RxMaxDatarate ) == false )
+    {
+        status &= 0xFD; // Datarate KO
+    }
+
+    // Verify datarate offset
+    if( RegionCommonValueInRange( rxParamSetupReq->DrOffset, plan->MinRx1DrOffset, plan->MaxRx1DrOffset ) == false )
+    {
+        status &= 0xFB; // Rx1DrOffset range KO
+    }
+
+    return status;
+}
+
+bool RegionCommonRxConfig( const RegionCommonChannelPlan_t* plan, RxConfigParams_t* rxConfig, int8_t* datarate )
+{
+    RadioModems_t modem;
+    int8_t dr = rxConfig->Datarate;
+    uint8_t maxPayload = 0;
+    int8_t phyDr = 0;
+    uint32_t frequency = rxConfig->Frequency;
+
+    if( Radio.GetStatus( ) != RF_IDLE )
+    {
+        return false;
+    }
+
+    if( rxConfig->Window == 0 )
+    {
+        // Apply window 1 frequency
+        frequency = plan->Channels[rxConfig->Channel].Frequency;
+        // Apply the alternative RX 1 window frequency, if it is available
+        if( plan->Channels[rxConfig->Channel].Rx1Frequency != 0 )
+        {
+            frequency = plan->Channels[rxConfig->Channel].Rx1Frequency;
+        }
+    }
+
+    // Read the physical datarate from the datarates table
+    phyDr = plan->Datarates[dr];
+
+    Radio.SetChannel( frequency );
+
+    // Radio configuration
+    if( dr == plan->FskDatarate )
+    {
+        modem = MODEM_FSK;
+        Radio.SetRxConfig( modem, 50000, phyDr * 1000, 0, 83333, 5, rxConfig->WindowTimeout, false, 0, true, 0, 0, false, rxConfig->RxContinuous );
+    }
+    else
+    {
+        modem = MODEM_LORA;
+        Radio.SetRxConfig( modem, rxConfig->Bandwidth, phyDr, 1, 0, 8, rxConfig->WindowTimeout, false, 0, false, 0, 0, true, rxConfig->RxContinuous );
+    }
+
+    if( rxConfig->RepeaterSupport == true )
+    {
+        maxPayload = plan->MaxPayloadOfDatarateRepeater[dr];
+    }
+    else
+    {
+        maxPayload = plan->MaxPayloadOfDatarate[dr];
+    }
+
+    Radio.SetMaxPayloadLength( modem, maxPayload + LORA_MAC_FRMPAYLOAD_OVERHEAD );
+    DBG_PRINTF( "RX on freq %d Hz at DR %d\n\r", frequency, dr );
+
+    *datarate = (uint8_t) dr;
+    return true;
+}
+
+uint8_t RegionCommonSelectChannelIndex( uint8_t* channels, uint8_t nbChannels, uint16_t* busyMask )
+{
+    uint16_t total = 0;
+    int32_t pick = 0;
+    uint8_t index = 0;
+    uint8_t i;
+
+    for( i = 0; i < nbChannels; i++ )
+    {
+        if( ChannelBusy( busyMask, channels[i] ) == true )
+        {
+            continue;
+        }
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+        total += ChannelWeight( channels[i] );
+#else
+        total++;
+#endif
+    }
+    if( total == 0 )
+    { // All the channels are busy, select among all of them
+        return RegionCommonSelectChannelIndex( channels, nbChannels, NULL );
+    }
+
+    pick = randr( 0, total - 1 );
+    for( i = 0; i < nbChannels; i++ )
+    {
+        if( ChannelBusy( busyMask, channels[i] ) == true )
+        {
+            continue;
+        }
+        index = i;
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+        pick -= ChannelWeight( channels[i] );
+#else
+        pick--;
+#endif
+        if( pick < 0 )
+        {
+            break;
+        }
+    }
+    return index;
+}
+
+uint8_t RegionCommonSelectChannel( uint16_t* channelsMask, uint8_t nbMasks, uint8_t nbEnabledChannels, uint16_t* busyMask )
+{
+    uint16_t freeMask[REGION_COMMON_BUSY_MASK_SIZE];
+    uint8_t nbFreeChannels;
+
+    if( busyMask != NULL )
+    {
+        for( uint8_t i = 0; i < nbMasks; i++ )
+        {
+            freeMask[i] = channelsMask[i] & ~busyMask[i];
+        }
+        nbFreeChannels = RegionCommonCountChannels( freeMask, 0, nbMasks );
+        // Leave the busy channels out, unless all the channels are busy
+        if( nbFreeChannels > 0 )
+        {
+            channelsMask = freeMask;
+            nbEnabledChannels = nbFreeChannels;
+        }
+    }
+
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    uint16_t total = 0;
+    int32_t pick = 0;
+    uint8_t id = 0;
+
+    for( uint8_t i = 0; i < ( nbMasks * 16 ); i++ )
+    {
+        if( ( channelsMask[i / 16] & ( 1 << ( i % 16 ) ) ) != 0 )
+        {
+            total += ChannelWeight( i );
+        }
+    }
+    pick = randr( 0, total - 1 );
+    for( uint8_t i = 0; i < ( nbMasks * 16 ); i++ )
+    {
+        if( ( channelsMask[i / 16] & ( 1 << ( i % 16 ) ) ) != 0 )
+        {
+            id = i;
+            pick -= ChannelWeight( id );
+            if( pick < 0 )
+            {
+                break;
+            }
+        }
+    }
+    return id;
+#else
+    return RegionCommonGetNthChannel( channelsMask, nbMasks, randr( 0, nbEnabledChannels - 1 ) );
+#endif
+}
+
+void RegionCommonChannelStatsReset( void )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    memset1( ( uint8_t* )ChannelStats, 0, sizeof( ChannelStats ) );
+#endif
+}
+
+void RegionCommonChannelStatsTx( uint8_t channel )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    RegionCommonChannelStats_t* stats;
+
+    if( channel >= REGION_COMMON_STATS_MAX_CHANNELS )
+    {
+        return;
+    }
+    stats = &ChannelStats[channel];
+    // Halve the history before it saturates, recent uplinks weigh more
+    if( stats->Attempts == 0xFF )
+    {
+        stats->Attempts >>= 1;
+        stats->Acks >>= 1;
+    }
+    stats->Attempts++;
+#endif
+}
+
+void RegionCommonChannelStatsAck( uint8_t channel )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    RegionCommonChannelStats_t* stats;
+
+    if( channel >= REGION_COMMON_STATS_MAX_CHANNELS )
+    {
+        return;
+    }
+    stats = &ChannelStats[channel];
+    if( stats->Acks < stats->Attempts )
+    {
+        stats->Acks++;
+    }
+#endif
+}
+
+void RegionCommonChannelStatsRx( uint8_t channel, int16_t rssi, int8_t snr )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    RegionCommonChannelStats_t* stats;
+
+    if( channel >= REGION_COMMON_STATS_MAX_CHANNELS )
+    {
+        return;
+    }
+    stats = &ChannelStats[channel];
+    if( stats->Downlinks < 0xFF )
+    {
+        stats->Downlinks++;
+    }
+    stats->Rssi = rssi;
+    stats->Snr = snr;
+#endif
+}
+
+void RegionCommonChannelStatsRxTimeout( uint8_t channel )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    if( ( channel < REGION_COMMON_STATS_MAX_CHANNELS ) && ( ChannelStats[channel].RxTimeouts < 0xFF ) )
+    {
+        ChannelStats[channel].RxTimeouts++;
+    }
+#endif
+}
+
+void RegionCommonChannelStatsBusy( uint8_t channel )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    if( ( channel < REGION_COMMON_STATS_MAX_CHANNELS ) && ( ChannelStats[channel].Busy < 0xFF ) )
+    {
+        ChannelStats[channel].Busy++;
+    }
+#endif
+}
+
+bool RegionCommonChannelStatsGet( uint8_t channel, RegionCommonChannelStats_t* stats )
+{
+#if ( REGION_COMMON_CHANNEL_STATS > 0 )
+    if( channel >= REGION_COMMON_STATS_MAX_CHANNELS )
+    {
+        return false;
+    }
+    *stats = ChannelStats[channel];
+    return true;
+#else
+    return false;
+#endif
+}
@@ -35,6 +35,76 @@
 #ifndef __REGIONCOMMON_H__
 #define __REGIONCOMMON_H__
 
+/*!
+ * Longest time-on-air of a frame, in ms, kept in reserve in the duty cycle
+ * window (REGION_COMMON_DC_WINDOW_FRAMES): a band reopens only once the
+ * next frame, whatever its length, fits in the hour. Defaults to a 64 bytes
+ * PHY payload at SF12/125 kHz.
+ */
+#ifndef REGION_COMMON_DC_MAX_FRAME_AIRTIME
+#define REGION_COMMON_DC_MAX_FRAME_AIRTIME          2794
+#endif
+
+/*!
+ * Set to 1 to keep statistics per channel and to favour, in the channel
+ * selection, the channels on which the acknowledgements get through.
+ * 0 selects the channels uniformly.
+ *
+ * US915, US915-Hybrid and AU915 draw their 125 kHz channels from
+ * ChannelsMaskRemaining, which hands out every enabled channel once before
+ * it is reloaded, so that the hopping uses all channels equally. There the
+ * weighting only changes the order within a round, not how often a channel
+ * is used; the statistics are still kept.
+ */
+#ifndef REGION_COMMON_CHANNEL_STATS
+#define REGION_COMMON_CHANNEL_STATS                 0
+#endif
+
+/*!
+ * Number of channels covered by the channel statistics
+ */
+#define REGION_COMMON_STATS_MAX_CHANNELS            96
+
+/*!
+ * Number of 16 bit words of a mask of busy channels, one bit for each of
+ * the 96 channels of CN470
+ */
+#define REGION_COMMON_BUSY_MASK_SIZE                6
+
+typedef struct sRegionCommonChannelStats
+{
+    /*!
+     * Uplinks sent on the channel which requested an acknowledgement.
+     */
+    uint8_t Attempts;
+    /*!
+     * Acknowledgements received for these uplinks.
+     */
+    uint8_t Acks;
+    /*!
+     * Downlinks received in the receive windows of the uplinks on the
+     * channel, acknowledgements or not.
+     */
+    uint8_t Downlinks;
+    /*!
+     * Receive windows of the uplinks on the channel which timed out or
+     * received no valid frame.
+     */
+    uint8_t RxTimeouts;
+    /*!
+     * RSSI of the last downlink.
+     */
+    int16_t Rssi;
+    /*!
+     * SNR of the last downlink.
+     */
+    int8_t Snr;
+    /*!
+     * Times the channel was found busy before an uplink.
+     */
+    uint8_t Busy;
+}RegionCommonChannelStats_t;
+
 typedef struct sRegionCommonLinkAdrParams
 {
     /*!
@@ -159,6 +229,91 @@ typedef struct sRegionCommonCalcBackOffParams
     TimerTime_t TxTimeOnAir;
 }RegionCommonCalcBackOffParams_t;
 
+typedef struct sRegionCommonChannelPlan
+{
+    /*!
+     * A pointer to region specific channels.
+     */
+    ChannelParams_t* Channels;
+    /*!
+     * A pointer to region specific channels mask.
+     */
+    uint16_t* ChannelsMask;
+    /*!
+     * Maximum number of channels of the region.
+     */
+    uint8_t MaxNbChannels;
+    /*!
+     * Number of default channels. They cannot be removed and their
+     * frequency cannot be changed.
+     */
+    uint8_t NbDefaultChannels;
+    /*!
+     * Minimum TX datarate of the region.
+     */
+    int8_t TxMinDatarate;
+    /*!
+     * Maximum TX datarate of the region.
+     */
+    int8_t TxMaxDatarate;
+    /*!
+     * Highest minimum datarate a default channel accepts.
+     */
+    int8_t DefaultChannelsMaxMinDr;
+    /*!
+     * Lowest maximum datarate a default channel accepts.
+     */
+    int8_t DefaultChannelsMinMaxDr;
+    /*!
+     * Minimum RX datarate of the region.
+     */
+    int8_t RxMinDatarate;
+    /*!
+     * Maximum RX datarate of the region.
+     */
+    int8_t RxMaxDatarate;
+    /*!
+     * Minimum RX1 datarate offset.
+     */
+    uint8_t MinRx1DrOffset;
+    /*!
+     * Maximum RX1 datarate offset.
+     */
+    uint8_t MaxRx1DrOffset;
+    /*!
+     * Minimum TX power of the region.
+     */
+    int8_t MinTxPower;
+    /*!
+     * Maximum TX power of the region.
+     */
+    int8_t MaxTxPower;
+    /*!
+     * Datarate of the FSK modulation, -1 if the region has none.
+     */
+    int8_t FskDatarate;
+    /*!
+     * Spreading factors, or FSK bitrates in kbps, of the datarates.
+     */
+    const uint8_t* Datarates;
+    /*!
+     * Maximum downlink payload size of each datarate.
+     */
+    const uint8_t* MaxPayloadOfDatarate;
+    /*!
+     * Maximum downlink payload size of each datarate behind a repeater.
+     */
+    const uint8_t* MaxPayloadOfDatarateRepeater;
+    /*!
+     * Verifies an uplink frequency and returns its band.
+     */
+    bool ( *VerifyTxFreq )( uint32_t freq, uint8_t* band );
+    /*!
+     * GetPhyParam function of the region.
+     */
+    PhyParam_t ( *GetPhyParam )( GetPhyParams_t* getPhy );
+}RegionCommonChannelPlan_t;
+
 /*!
  * \brief Calculates the join duty cycle.
  *        This is a generic function and valid for all regions.
@@ -232,6 +387,35 @@ bool RegionCommonChanDisable( uint16_t* channelsMask, uint8_t id, uint8_t maxCha
  */
 uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uint8_t stopIdx );
 
+/*!
+ * \brief Gets the id of the n-th active channel in a given channels mask.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] channelsMask The channels mask of the region.
+ *
+ * \param [IN] nbMasks Number of 16 bits masks in channelsMask.
+ *
+ * \param [IN] n Rank of the channel among the active ones, starting at 0.
+ *
+ * \retval Returns the channel id, or nbMasks * 16 if less than n + 1
+ *         channels are active.
+ */
+uint8_t RegionCommonGetNthChannel( uint16_t* channelsMask, uint8_t nbMasks, uint8_t n );
+
+/*!
+ * \brief Builds the mask of the enabled channels supporting a datarate.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] channels The channels of the region.
+ *
+ * \param [IN] nbChannels Number of channels of the region.
+ *
+ * \param [IN] dr The datarate.
+ *
+ * \param [OUT] drMask The channels mask built, ( nbChannels + 15 ) / 16 masks long.
+ */
+void RegionCommonChanDrMask( ChannelParams_t* channels, uint8_t nbChannels, int8_t dr, uint16_t* drMask );
+
 /*!
  * \brief Copy a channels mask.
  *        This is a generic function and valid for all regions.
@@ -309,9 +493,9 @@ uint8_t RegionCommonLinkAdrReqVerifyParams( RegionCommonLinkAdrReqVerifyParams_t
  *
  * \param [IN] bandwidth Bandwidth to use.
  *
- * \retval Returns the symbol time.
+ * \retval Returns the symbol time in us.
  */
-double RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
+uint32_t RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
 
 /*!
  * \brief Computes the symbol time for FSK modulation.
@@ -320,14 +504,43 @@ double RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
  *
  * \param [IN] bandwidth Bandwidth to use.
  *
- * \retval Returns the symbol time.
+ * \retval Returns the symbol time in us.
+ */
+uint32_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
+
+/*!
+ * \brief Reads the bandwidth of a datarate in the table of a region.
+ *
+ * \param [IN] bandwidths Bandwidths of the region in Hz, 0 for FSK.
+ *
+ * \param [IN] nbDatarates Number of datarates in the table.
+ *
+ * \param [IN] datarate Datarate.
+ *
+ * \retval Returns the bandwidth in Hz, 0 for a datarate out of the table.
+ */
+uint32_t RegionCommonGetBandwidth( const uint32_t* bandwidths, uint8_t nbDatarates, int8_t datarate );
+
+/*!
+ * \brief Computes the symbol time of a datarate from the tables of a region.
+ *
+ * \param [IN] datarates Spreading factors of the region, FSK bitrate in kbps.
+ *
+ * \param [IN] bandwidths Bandwidths of the region in Hz, 0 for FSK.
+ *
+ * \param [IN] nbDatarates Number of datarates in the tables.
+ *
+ * \param [IN] datarate Datarate.
+ *
+ * \retval Returns the symbol time in us, 0 for a RFU datarate or a datarate
+ *         out of the tables.
  */
-double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
+uint32_t RegionCommonGetSymbolTime( const uint8_t* datarates, const uint32_t* bandwidths, uint8_t nbDatarates, int8_t datarate );
 
 /*!
  * \brief Computes the RX window timeout and the RX window offset.
  *
- * \param [IN] tSymbol Symbol timeout.
+ * \param [IN] tSymbol Symbol time in us.
  *
  * \param [IN] minRxSymbols Minimum required number of symbols to detect an Rx frame.
  *
@@ -340,20 +553,23 @@ double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
  *
  * \param [OUT] windowOffset RX window time offset to be applied to the RX delay.
  */
-void RegionCommonComputeRxWindowParameters( double tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset );
+void RegionCommonComputeRxWindowParameters( uint32_t tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset );
 
 /*!
  * \brief Computes the txPower, based on the max EIRP and the antenna gain.
  *
+ * \remark Both are in half dB, rounded up when not a multiple of it, so that
+ *         the 2.15 dBi antenna gain and an EIRP of x.15 dBm cancel exactly.
+ *
  * \param [IN] txPower TX power index.
  *
- * \param [IN] maxEirp Maximum EIRP.
+ * \param [IN] maxEirp Maximum EIRP [half dB].
  *
- * \param [IN] antennaGain Antenna gain.
+ * \param [IN] antennaGain Antenna gain [half dB].
  *
  * \retval Returns the physical TX power.
  */
-int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float antennaGain );
+int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, int8_t maxEirp, int8_t antennaGain );
 
 /*!
  * \brief Calculates the duty cycle for the current band.
@@ -362,6 +578,189 @@ int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float ant
  */
 void RegionCommonCalcBackOff( RegionCommonCalcBackOffParams_t* calcBackOffParams );
 
+/*!
+ * \brief Adds a channel to a region with a dynamic channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] channelAdd A pointer to the function parameters.
+ *
+ * \retval Status of the operation.
+ */
+LoRaMacStatus_t RegionCommonChannelAdd( const RegionCommonChannelPlan_t* plan, ChannelAddParams_t* channelAdd );
+
+/*!
+ * \brief Removes a channel from a region with a dynamic channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] channelRemove A pointer to the function parameters.
+ *
+ * \retval Returns true, if the channel was removed.
+ */
+bool RegionCommonChannelsRemove( const RegionCommonChannelPlan_t* plan, ChannelRemoveParams_t* channelRemove );
+
+/*!
+ * \brief Handles the NewChannelReq MAC command for a region with a dynamic
+ *        channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] newChannelReq A pointer to the function parameters.
+ *
+ * \retval Returns the status of the operation, according to the LoRaMAC specification.
+ */
+uint8_t RegionCommonNewChannelReq( const RegionCommonChannelPlan_t* plan, NewChannelReqParams_t* newChannelReq );
+
+/*!
+ * \brief Handles the DlChannelReq MAC command for a region with a dynamic
+ *        channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] dlChannelReq A pointer to the function parameters.
+ *
+ * \retval Returns the status of the operation, according to the LoRaMAC specification.
+ */
+uint8_t RegionCommonDlChannelReq( const RegionCommonChannelPlan_t* plan, DlChannelReqParams_t* dlChannelReq );
+
+/*!
+ * \brief Handles the LinkAdrReq MAC command for a region with a dynamic
+ *        channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] linkAdrReq A pointer to the function parameters.
+ *
+ * \param [OUT] drOut The datarate which was applied.
+ *
+ * \param [OUT] txPowOut The TX power which was applied.
+ *
+ * \param [OUT] nbRepOut The number of repetitions to apply.
+ *
+ * \param [OUT] nbBytesParsed The number of bytes parsed.
+ *
+ * \retval Returns the status of the operation, according to the LoRaMAC specification.
+ */
+uint8_t RegionCommonLinkAdrReq( const RegionCommonChannelPlan_t* plan, LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, int8_t* txPowOut, uint8_t* nbRepOut, uint8_t* nbBytesParsed );
+
+/*!
+ * \brief Handles the RxParamSetupReq MAC command for a region with a
+ *        dynamic channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] rxParamSetupReq A pointer to the function parameters.
+ *
+ * \retval Returns the status of the operation, according to the LoRaMAC specification.
+ */
+uint8_t RegionCommonRxParamSetupReq( const RegionCommonChannelPlan_t* plan, RxParamSetupReqParams_t* rxParamSetupReq );
+
+/*!
+ * \brief Configures the radio for a receive window of a region with a
+ *        dynamic channel plan.
+ *
+ * \param [IN] plan Channel plan of the region.
+ *
+ * \param [IN] rxConfig A pointer to the function parameters.
+ *
+ * \param [OUT] datarate The datarate index which was set.
+ *
+ * \retval Returns true, if the configuration was applied successfully.
+ */
+bool RegionCommonRxConfig( const RegionCommonChannelPlan_t* plan, RxConfigParams_t* rxConfig, int8_t* datarate );
+
+/*!
+ * \brief Selects a channel among the enabled channels of a list.
+ *        The channels are weighted by their statistics when
+ *        REGION_COMMON_CHANNEL_STATS is set, else they are equally likely.
+ *
+ * \param [IN] channels List of the enabled channels.
+ *
+ * \param [IN] nbChannels Number of channels in the list, at least 1.
+ *
+ * \param [IN] busyMask Channels left out unless they are all busy, or NULL.
+ *
+ * \retval Index in the list of the selected channel.
+ */
+uint8_t RegionCommonSelectChannelIndex( uint8_t* channels, uint8_t nbChannels, uint16_t* busyMask );
+
+/*!
+ * \brief Selects a channel among the enabled channels of a mask.
+ *        The channels are weighted by their statistics when
+ *        REGION_COMMON_CHANNEL_STATS is set, else they are equally likely.
+ *        With the remaining channels mask of US915, US915-Hybrid and
+ *        AU915 the weights only order the channels within a round.
+ *
+ * \param [IN] channelsMask Mask of the enabled channels.
+ *
+ * \param [IN] nbMasks Number of 16 bit masks.
+ *
+ * \param [IN] nbEnabledChannels Number of bits set in the mask, at least 1.
+ *
+ * \param [IN] busyMask Channels left out unless they are all busy, or NULL.
+ *                      REGION_COMMON_BUSY_MASK_SIZE words.
+ *
+ * \retval Id of the selected channel.
+ */
+uint8_t RegionCommonSelectChannel( uint16_t* channelsMask, uint8_t nbMasks, uint8_t nbEnabledChannels, uint16_t* busyMask );
+
+/*!
+ * \brief Clears the channel statistics.
+ */
+void RegionCommonChannelStatsReset( void );
+
+/*!
+ * \brief Records an uplink which requested an acknowledgement.
+ *
+ * \param [IN] channel Channel of the uplink.
+ */
+void RegionCommonChannelStatsTx( uint8_t channel );
+
+/*!
+ * \brief Records the acknowledgement of an uplink.
+ *
+ * \param [IN] channel Channel of the uplink.
+ */
+void RegionCommonChannelStatsAck( uint8_t channel );
+
+/*!
+ * \brief Records a downlink received in a receive window of an uplink.
+ *
+ * \param [IN] channel Channel of the uplink.
+ *
+ * \param [IN] rssi RSSI of the downlink.
+ *
+ * \param [IN] snr SNR of the downlink.
+ */
+void RegionCommonChannelStatsRx( uint8_t channel, int16_t rssi, int8_t snr );
+
+/*!
+ * \brief Records a receive window of an uplink which timed out or received
+ *        no valid frame.
+ *
+ * \param [IN] channel Channel of the uplink.
+ */
+void RegionCommonChannelStatsRxTimeout( uint8_t channel );
+
+/*!
+ * \brief Records a channel found busy by the carrier sense.
+ *
+ * \param [IN] channel Channel found busy.
+ */
+void RegionCommonChannelStatsBusy( uint8_t channel );
+
+/*!
+ * \brief Gets the statistics of a channel.
+ *
+ * \param [IN] channel Channel id.
+ *
+ * \param [OUT] stats Statistics of the channel.
+ *
+ * \retval Returns false if the statistics are disabled or the channel is out of range.
+ */
+bool RegionCommonChannelStatsGet( uint8_t channel, RegionCommonChannelStats_t* stats );
+
 /*! \} defgroup REGIONCOMMON */
 
 #endif // __REGIONCOMMON_H__
@@ -100,7 +100,7 @@ static int8_t LimitTxPower( int8_t txPower, int8_t maxBandTxPower, int8_t datara
     return txPowerResult;
 }
 
-static bool VerifyTxFreq( uint32_t freq )
+static bool VerifyTxFreq( uint32_t freq, uint8_t *band )
 {
     // Check radio driver support
     if( Radio.CheckRfFrequency( freq ) == false )
@@ -115,6 +115,33 @@ static bool VerifyTxFreq( uint32_t freq )
     return true;
 }
 
+/*!
+ * Channel plan handled by the common channel functions
+ */
+static const RegionCommonChannelPlan_t ChannelPlan =
+{
+    .Channels = Channels,
+    .ChannelsMask = ChannelsMask,
+    .MaxNbChannels = EU433_MAX_NB_CHANNELS,
+    .NbDefaultChannels = EU433_NUMB_DEFAULT_CHANNELS,
+    .TxMinDatarate = EU433_TX_MIN_DATARATE,
+    .TxMaxDatarate = EU433_TX_MAX_DATARATE,
+    .DefaultChannelsMaxMinDr = DR_0,
+    .DefaultChannelsMinMaxDr = DR_5,
+    .RxMinDatarate = EU433_RX_MIN_DATARATE,
+    .RxMaxDatarate = EU433_RX_MAX_DATARATE,
+    .MinRx1DrOffset = EU433_MIN_RX1_DR_OFFSET,
+    .MaxRx1DrOffset = EU433_MAX_RX1_DR_OFFSET,
+    .MinTxPower = EU433_MIN_TX_POWER,
+    .MaxTxPower = EU433_MAX_TX_POWER,
+    .FskDatarate = DR_7,
+    .Datarates = DataratesEU433,
+    .MaxPayloadOfDatarate = MaxPayloadOfDatarateEU433,
+    .MaxPayloadOfDatarateRepeater = MaxPayloadOfDatarateRepeaterEU433,
+    .VerifyTxFreq = VerifyTxFreq,
+    .GetPhyParam = RegionEU433GetPhyParam
+};
+
 static uint8_t CountNbOfEnabledChannels( bool joined, uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
 {
     uint8_t nbEnabledChannels = 0;
@@ -182,6 +209,16 @@ PhyParam_t RegionEU433GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = GetNextLowerTxDr( getPhy->Datarate, EU433_TX_MIN_DATARATE );
             break;
         }
+        case PHY_BANDWIDTH:
+        {
+            phyParam.Value = RegionCommonGetBandwidth( BandwidthsEU433, sizeof( BandwidthsEU433 ) / sizeof( BandwidthsEU433[0] ), getPhy->Datarate );
+            break;
+        }
+        case PHY_SYMBOL_TIME:
+        {
+            phyParam.Value = RegionCommonGetSymbolTime( DataratesEU433, BandwidthsEU433, sizeof( DataratesEU433 ), getPhy->Datarate );
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = EU433_DEFAULT_TX_POWER;
@@ -280,12 +317,12 @@ PhyParam_t RegionEU433GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_DEF_MAX_EIRP:
         {
-            phyParam.fValue = EU433_DEFAULT_MAX_EIRP;
+            phyParam.Value = EU433_DEFAULT_MAX_EIRP;
             break;
         }
         case PHY_DEF_ANTENNA_GAIN:
         {
-            phyParam.fValue = EU433_DEFAULT_ANTENNA_GAIN;
+            phyParam.Value = EU433_DEFAULT_ANTENNA_GAIN;
             break;
         }
         case PHY_NB_JOIN_TRIALS:
@@ -314,7 +351,8 @@ void RegionEU433InitDefaults( InitType_t type )
     {
         case INIT_TYPE_INIT:
         {
-            // Channels
+            // Channels, those a previous session added dropped
+            memset1( ( uint8_t* )Channels, 0, sizeof( Channels ) );
             Channels[0] = ( ChannelParams_t ) EU433_LC1;
             Channels[1] = ( ChannelParams_t ) EU433_LC2;
             Channels[2] = ( ChannelParams_t ) EU433_LC3;
@@ -513,7 +551,7 @@ bool RegionEU433AdrNext( AdrNextParams_t* adrNext, int8_t* drOut, int8_t* txPowO
 
 void RegionEU433ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    uint32_t tSymbol = 0;
     uint32_t radioWakeUpTime;
 
     // Get the datarate, perform a boundary check
@@ -535,58 +573,7 @@ void RegionEU433ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
 
 bool RegionEU433RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
 {
-    RadioModems_t modem;
-    int8_t dr = rxConfig->Datarate;
-    uint8_t maxPayload = 0;
-    int8_t phyDr = 0;
-    uint32_t frequency = rxConfig->Frequency;
-
-    if( Radio.GetStatus( ) != RF_IDLE )
-    {
-        return false;
-    }
-
-    if( rxConfig->Window == 0 )
-    {
-        // Apply window 1 frequency
-        frequency = Channels[rxConfig->Channel].Frequency;
-        // Apply the alternative RX 1 window frequency, if it is available
-        if( Channels[rxConfig->Channel].Rx1Frequency != 0 )
-        {
-            frequency = Channels[rxConfig->Channel].Rx1Frequency;
-        }
-    }
-
-    // Read the physical datarate from the datarates table
-    phyDr = DataratesEU433[dr];
-
-    Radio.SetChannel( frequency );
-
-    // Radio configuration
-    if( dr == DR_7 )
-    {
-        modem = MODEM_FSK;
-        Radio.SetRxConfig( modem, 50000, phyDr * 1000, 0, 83333, 5, rxConfig->WindowTimeout, false, 0, true, 0, 0, false, rxConfig->RxContinuous );
-    }
-    else
-    {
-        modem = MODEM_LORA;
-        Radio.SetRxConfig( modem, rxConfig->Bandwidth, phyDr, 1, 0, 8, rxConfig->WindowTimeout, false, 0, false, 0, 0, true, rxConfig->RxContinuous );
-    }
-
-    if( rxConfig->RepeaterSupport == true )
-    {
-        maxPayload = MaxPayloadOfDatarateRepeaterEU433[dr];
-    }
-    else
-    {
-        maxPayload = MaxPayloadOfDatarateEU433[dr];
-    }
-    Radio.SetMaxPayloadLength( modem, maxPayload + LORA_MAC_FRMPAYLOAD_OVERHEAD );
-    DBG_PRINTF( "RX on freq %d Hz at DR %d\n\r", frequency, dr );
-
-    *datarate = (uint8_t) dr;
-    return true;
+    return RegionCommonRxConfig( &ChannelPlan, rxConfig, datarate );
 }
 
 bool RegionEU433TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir )
@@ -626,184 +613,17 @@ bool RegionEU433TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime
 
 uint8_t RegionEU433LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, int8_t* txPowOut, uint8_t* nbRepOut, uint8_t* nbBytesParsed )
 {
-    uint8_t status = 0x07;
-    RegionCommonLinkAdrParams_t linkAdrParams;
-    uint8_t nextIndex = 0;
-    uint8_t bytesProcessed = 0;
-    uint16_t chMask = 0;
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-    RegionCommonLinkAdrReqVerifyParams_t linkAdrVerifyParams;
-
-    while( bytesProcessed < linkAdrReq->PayloadSize )
-    {
-        // Get ADR request parameters
-        nextIndex = RegionCommonParseLinkAdrReq( &( linkAdrReq->Payload[bytesProcessed] ), &linkAdrParams );
-
-        if( nextIndex == 0 )
-            break; // break loop, since no more request has been found
-
-        // Update bytes processed
-        bytesProcessed += nextIndex;
-
-        // Revert status, as we only check the last ADR request for the channel mask KO
-        status = 0x07;
-
-        // Setup temporary channels mask
-        chMask = linkAdrParams.ChMask;
-
-        // Verify channels mask
-        if( ( linkAdrParams.ChMaskCtrl == 0 ) && ( chMask == 0 ) )
-        {
-            status &= 0xFE; // Channel mask KO
-        }
-        else if( ( ( linkAdrParams.ChMaskCtrl >= 1 ) && ( linkAdrParams.ChMaskCtrl <= 5 )) ||
-                ( linkAdrParams.ChMaskCtrl >= 7 ) )
-        {
-            // RFU
-            status &= 0xFE; // Channel mask KO
-        }
-        else
-        {
-            for( uint8_t i = 0; i < EU433_MAX_NB_CHANNELS; i++ )
-            {
-                if( linkAdrParams.ChMaskCtrl == 6 )
-                {
-                    if( Channels[i].Frequency != 0 )
-                    {
-                        chMask |= 1 << i;
-                    }
-                }
-                else
-                {
-                    if( ( ( chMask & ( 1 << i ) ) != 0 ) &&
-                        ( Channels[i].Frequency == 0 ) )
-                    {// Trying to enable an undefined channel
-                        status &= 0xFE; // Channel mask KO
-                    }
-                }
-            }
-        }
-    }
-
-        // Get the minimum possible datarate
-    getPhy.Attribute = PHY_MIN_TX_DR;
-    getPhy.UplinkDwellTime = linkAdrReq->UplinkDwellTime;
-    phyParam = RegionEU433GetPhyParam( &getPhy );
-
-    linkAdrVerifyParams.Status = status;
-    linkAdrVerifyParams.AdrEnabled = linkAdrReq->AdrEnabled;
-    linkAdrVerifyParams.Datarate = linkAdrParams.Datarate;
-    linkAdrVerifyParams.TxPower = linkAdrParams.TxPower;
-    linkAdrVerifyParams.NbRep = linkAdrParams.NbRep;
-    linkAdrVerifyParams.CurrentDatarate = linkAdrReq->CurrentDatarate;
-    linkAdrVerifyParams.CurrentTxPower = linkAdrReq->CurrentTxPower;
-    linkAdrVerifyParams.CurrentNbRep = linkAdrReq->CurrentNbRep;
-    linkAdrVerifyParams.NbChannels = EU433_MAX_NB_CHANNELS;
-    linkAdrVerifyParams.ChannelsMask = &chMask;
-    linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
-    linkAdrVerifyParams.MaxDatarate = EU433_TX_MAX_DATARATE;
-    linkAdrVerifyParams.Channels = Channels;
-    linkAdrVerifyParams.MinTxPower = EU433_MIN_TX_POWER;
-    linkAdrVerifyParams.MaxTxPower = EU433_MAX_TX_POWER;
-
-    // Verify the parameters and update, if necessary
-    status = RegionCommonLinkAdrReqVerifyParams( &linkAdrVerifyParams, &linkAdrParams.Datarate, &linkAdrParams.TxPower, &linkAdrParams.NbRep );
-
-    // Update channelsMask if everything is correct
-    if( status == 0x07 )
-    {
-        // Set the channels mask to a default value
-        memset( ChannelsMask, 0, sizeof( ChannelsMask ) );
-        // Update the channels mask
-        ChannelsMask[0] = chMask;
-    }
-
-    // Update status variables
-    *drOut = linkAdrParams.Datarate;
-    *txPowOut = linkAdrParams.TxPower;
-    *nbRepOut = linkAdrParams.NbRep;
-    *nbBytesParsed = bytesProcessed;
-
-    return status;
+    return RegionCommonLinkAdrReq( &ChannelPlan, linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed );
 }
 
 uint8_t RegionEU433RxParamSetupReq( RxParamSetupReqParams_t* rxParamSetupReq )
 {
-    uint8_t status = 0x07;
-
-    // Verify radio frequency
-    if( Radio.CheckRfFrequency( rxParamSetupReq->Frequency ) == false )
-    {
-        status &= 0xFE; // Channel frequency KO
-    }
-
-    // Verify datarate
-    if( RegionCommonValueInRange( rxParamSetupReq->Datarate, EU433_RX_MIN_DATARATE, EU433_RX_MAX_DATARATE ) == false )
-    {
-        status &= 0xFD; // Datarate KO
-    }
-
-    // Verify datarate offset
-    if( RegionCommonValueInRange( rxParamSetupReq->DrOffset, EU433_MIN_RX1_DR_OFFSET, EU433_MAX_RX1_DR_OFFSET ) == false )
-    {
-        status &= 0xFB; // Rx1DrOffset range KO
-    }
-
-    return status;
+    return RegionCommonRxParamSetupReq( &ChannelPlan, rxParamSetupReq );
 }
 
 uint8_t RegionEU433NewChannelReq( NewChannelReqParams_t* newChannelReq )
 {
-    uint8_t status = 0x03;
-    ChannelAddParams_t channelAdd;
-    ChannelRemoveParams_t channelRemove;
-
-    if( newChannelReq->NewChannel->Frequency == 0 )
-    {
-        channelRemove.ChannelId = newChannelReq->ChannelId;
-
-        // Remove
-        if( RegionEU433ChannelsRemove( &channelRemove ) == false )
-        {
-            status &= 0xFC;
-        }
-    }
-    else
-    {
-        channelAdd.NewChannel = newChannelReq->NewChannel;
-        channelAdd.ChannelId = newChannelReq->ChannelId;
-
-        switch( RegionEU433ChannelAdd( &channelAdd ) )
-        {
-            case LORAMAC_STATUS_OK:
-            {
-                break;
-            }
-            case LORAMAC_STATUS_FREQUENCY_INVALID:
-            {
-                status &= 0xFE;
-                break;
-            }
-            case LORAMAC_STATUS_DATARATE_INVALID:
-            {
-                status &= 0xFD;
-                break;
-            }
-            case LORAMAC_STATUS_FREQ_AND_DR_INVALID:
-            {
-                status &= 0xFC;
-                break;
-            }
-            default:
-            {
-                status &= 0xFC;
-                break;
-            }
-        }
-    }
-
-    return status;
+    return RegionCommonNewChannelReq( &ChannelPlan, newChannelReq );
 }
 
 int8_t RegionEU433TxParamSetupReq( TxParamSetupReqParams_t* txParamSetupReq )
@@ -813,27 +633,7 @@ int8_t RegionEU433TxParamSetupReq( TxParamSetupReqParams_t* txParamSetupReq )
 
 uint8_t RegionEU433DlChannelReq( DlChannelReqParams_t* dlChannelReq )
 {
-    uint8_t status = 0x03;
-
-    // Verify if the frequency is supported
-    if( VerifyTxFreq( dlChannelReq->Rx1Frequency ) == false )
-    {
-        status &= 0xFE;
-    }
-
-    // Verify if an uplink frequency exists
-    if( Channels[dlChannelReq->ChannelId].Frequency == 0 )
-    {
-        status &= 0xFD;
-    }
-
-    // Apply Rx1 frequency, if the status is OK
-    if( status == 0x03 )
-    {
-        Channels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
-    }
-
-    return status;
+    return RegionCommonDlChannelReq( &ChannelPlan, dlChannelReq );
 }
 
 int8_t RegionEU433AlternateDr( AlternateDrParams_t* alternateDr )
@@ -889,10 +689,19 @@ bool RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
     uint8_t delayTx = 0;
     uint8_t enabledChannels[EU433_MAX_NB_CHANNELS] = { 0 };
     TimerTime_t nextTxDelay = 0;
+    uint16_t queryMask[CHANNELS_MASK_SIZE];
+    uint16_t* channelsMask = ChannelsMask;
+
+    if( nextChanParams->Query == true )
+    {
+        // A query works on a copy of the mask, the channel plan stays untouched
+        RegionCommonChanMaskCopy( queryMask, ChannelsMask, CHANNELS_MASK_SIZE );
+        channelsMask = queryMask;
+    }
 
-    if( RegionCommonCountChannels( ChannelsMask, 0, 1 ) == 0 )
+    if( RegionCommonCountChannels( channelsMask, 0, 1 ) == 0 )
     { // Reactivate default channels
-        ChannelsMask[0] |= LC( 1 ) + LC( 2 ) + LC( 3 );
+        channelsMask[0] |= LC( 1 ) + LC( 2 ) + LC( 3 );
     }
 
     if( nextChanParams->AggrTimeOff <= TimerGetElapsedTime( nextChanParams->LastAggrTx ) )
@@ -905,8 +714,18 @@ bool RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
 
         // Search how many channels are enabled
         nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Joined, nextChanParams->Datarate,
-                                                      ChannelsMask, Channels,
+                                                      channelsMask, Channels,
                                                       Bands, enabledChannels, &delayTx );
+
+        if( ( nbEnabledChannels == 0 ) && ( delayTx == 0 ) && ( nextChanParams->Query == true ) )
+        {
+            // The datarate fits no channel, count the default channels the
+            // actual call restores
+            channelsMask[0] |= LC( 1 ) + LC( 2 ) + LC( 3 );
+            nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Joined, nextChanParams->Datarate,
+                                                          channelsMask, Channels,
+                                                          Bands, enabledChannels, &delayTx );
+        }
     }
     else
     {
@@ -917,7 +736,7 @@ bool RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
     if( nbEnabledChannels > 0 )
     {
         // We found a valid channel
-        *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+        *channel = enabledChannels[RegionCommonSelectChannelIndex( enabledChannels, nbEnabledChannels, nextChanParams->BusyChannelsMask )];
 
         *time = 0;
         return true;
@@ -931,7 +750,7 @@ bool RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
             return true;
         }
         // Datarate not supported by any channel, restore defaults
-        ChannelsMask[0] |= LC( 1 ) + LC( 2 ) + LC( 3 );
+        channelsMask[0] |= LC( 1 ) + LC( 2 ) + LC( 3 );
         *time = 0;
         return false;
     }
@@ -939,92 +758,12 @@ bool RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel,
 
 LoRaMacStatus_t RegionEU433ChannelAdd( ChannelAddParams_t* channelAdd )
 {
-    uint8_t band = 0;
-    bool drInvalid = false;
-    bool freqInvalid = false;
-    uint8_t id = channelAdd->ChannelId;
-
-    if( id >= EU433_MAX_NB_CHANNELS )
-    {
-        return LORAMAC_STATUS_PARAMETER_INVALID;
-    }
-
-    // Validate the datarate range
-    if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Min, EU433_TX_MIN_DATARATE, EU433_TX_MAX_DATARATE ) == false )
-    {
-        drInvalid = true;
-    }
-    if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Max, EU433_TX_MIN_DATARATE, EU433_TX_MAX_DATARATE ) == false )
-    {
-        drInvalid = true;
-    }
-    if( channelAdd->NewChannel->DrRange.Fields.Min > channelAdd->NewChannel->DrRange.Fields.Max )
-    {
-        drInvalid = true;
-    }
-
-    // Default channels don't accept all values
-    if( id < EU433_NUMB_DEFAULT_CHANNELS )
-    {
-        // Validate the datarate range for min: must be DR_0
-        if( channelAdd->NewChannel->DrRange.Fields.Min > DR_0 )
-        {
-            drInvalid = true;
-        }
-        // Validate the datarate range for max: must be DR_5 <= Max <= TX_MAX_DATARATE
-        if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Max, DR_5, EU433_TX_MAX_DATARATE ) == false )
-        {
-            drInvalid = true;
-        }
-        // We are not allowed to change the frequency
-        if( channelAdd->NewChannel->Frequency != Channels[id].Frequency )
-        {
-            freqInvalid = true;
-        }
-    }
-
-    // Check frequency
-    if( freqInvalid == false )
-    {
-        if( VerifyTxFreq( channelAdd->NewChannel->Frequency ) == false )
-        {
-            freqInvalid = true;
-        }
-    }
-
-    // Check status
-    if( ( drInvalid == true ) && ( freqInvalid == true ) )
-    {
-        return LORAMAC_STATUS_FREQ_AND_DR_INVALID;
-    }
-    if( drInvalid == true )
-    {
-        return LORAMAC_STATUS_DATARATE_INVALID;
-    }
-    if( freqInvalid == true )
-    {
-        return LORAMAC_STATUS_FREQUENCY_INVALID;
-    }
-
-    memcpy( &(Channels[id]), channelAdd->NewChannel, sizeof( Channels[id] ) );
-    Channels[id].Band = band;
-    ChannelsMask[0] |= ( 1 << id );
-    return LORAMAC_STATUS_OK;
+    return RegionCommonChannelAdd( &ChannelPlan, channelAdd );
 }
 
 bool RegionEU433ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 {
-    uint8_t id = channelRemove->ChannelId;
-
-    if( id < EU433_NUMB_DEFAULT_CHANNELS )
-    {
-        return false;
-    }
-
-    // Remove the channel from the list of channels
-    Channels[id] = ( ChannelParams_t ){ 0, 0, { 0 }, 0 };
-
-    return RegionCommonChanDisable( ChannelsMask, id, EU433_MAX_NB_CHANNELS );
+    return RegionCommonChannelsRemove( &ChannelPlan, channelRemove );
 }
 
 void RegionEU433SetContinuousWave( ContinuousWaveParams_t* continuousWave )
@@ -1049,3 +788,32 @@ uint8_t RegionEU433ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
     }
     return datarate;
 }
+
+/*!
+ * EU433 region operations
+ */
+const RegionOps_t RegionEU433Ops =
+{
+    .GetPhyParam = RegionEU433GetPhyParam,
+    .SetBandTxDone = RegionEU433SetBandTxDone,
+    .InitDefaults = RegionEU433InitDefaults,
+    .Verify = RegionEU433Verify,
+    .ApplyCFList = RegionEU433ApplyCFList,
+    .ChanMaskSet = RegionEU433ChanMaskSet,
+    .AdrNext = RegionEU433AdrNext,
+    .ComputeRxWindowParameters = RegionEU433ComputeRxWindowParameters,
+    .RxConfig = RegionEU433RxConfig,
+    .TxConfig = RegionEU433TxConfig,
+    .LinkAdrReq = RegionEU433LinkAdrReq,
+    .RxParamSetupReq = RegionEU433RxParamSetupReq,
+    .NewChannelReq = RegionEU433NewChannelReq,
+    .TxParamSetupReq = RegionEU433TxParamSetupReq,
+    .DlChannelReq = RegionEU433DlChannelReq,
+    .AlternateDr = RegionEU433AlternateDr,
+    .CalcBackOff = RegionEU433CalcBackOff,
+    .NextChannel = RegionEU433NextChannel,
+    .ChannelAdd = RegionEU433ChannelAdd,
+    .ChannelsRemove = RegionEU433ChannelsRemove,
+    .SetContinuousWave = RegionEU433SetContinuousWave,
+    .ApplyDrOffset = RegionEU433ApplyDrOffset,
+};
@@ -106,14 +106,14 @@
 #define EU433_DEFAULT_TX_POWER                      TX_POWER_0
 
 /*!
- * Default Max EIRP
+ * Default Max EIRP in half dB, 12.15 dBm, rounded up as the antenna gain
  */
-#define EU433_DEFAULT_MAX_EIRP                      12.15f
+#define EU433_DEFAULT_MAX_EIRP                      25
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define EU433_DEFAULT_ANTENNA_GAIN                  2.15f
+#define EU433_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -461,6 +461,11 @@ void RegionEU433SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionEU433ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionEU433Ops;
+
 /*! \} defgroup REGIONEU433 */
 
 #endif // __REGION_EU433_H__
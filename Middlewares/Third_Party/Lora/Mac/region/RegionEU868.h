@@ -106,14 +106,14 @@
 #define EU868_DEFAULT_TX_POWER                      TX_POWER_0
 
 /*!
- * Default Max EIRP
+ * Default Max EIRP in half dB, 16 dBm
  */
-#define EU868_DEFAULT_MAX_EIRP                      16.0f
+#define EU868_DEFAULT_MAX_EIRP                      32
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define EU868_DEFAULT_ANTENNA_GAIN                  2.15f
+#define EU868_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -482,6 +482,11 @@ void RegionEU868SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionEU868ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionEU868Ops;
+
 /*! \} defgroup REGIONEU868 */
 
 #endif // __REGION_EU868_H__
@@ -106,14 +106,14 @@
 #define IN865_DEFAULT_TX_POWER                      TX_POWER_0
 
 /*!
- * Default Max EIRP
+ * Default Max EIRP in half dB, 30 dBm
  */
-#define IN865_DEFAULT_MAX_EIRP                      30.0f
+#define IN865_DEFAULT_MAX_EIRP                      60
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define IN865_DEFAULT_ANTENNA_GAIN                  2.15f
+#define IN865_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -463,6 +463,11 @@ void RegionIN865SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionIN865ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionIN865Ops;
+
 /*! \} defgroup REGIONIN865 */
 
 #endif // __REGION_IN865_H__
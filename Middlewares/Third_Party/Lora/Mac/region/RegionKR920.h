@@ -106,19 +106,19 @@
 #define KR920_DEFAULT_TX_POWER                      TX_POWER_0
 
 /*!
- * Default Max EIRP for frequency 920.9 MHz - 921.9 MHz
+ * Default Max EIRP for frequency 920.9 MHz - 921.9 MHz, in half dB
  */
-#define KR920_DEFAULT_MAX_EIRP_LOW                  10.0f
+#define KR920_DEFAULT_MAX_EIRP_LOW                  20
 
 /*!
- * Default Max EIRP for frequency 922.1 MHz - 923.3 MHz
+ * Default Max EIRP for frequency 922.1 MHz - 923.3 MHz, in half dB
  */
-#define KR920_DEFAULT_MAX_EIRP_HIGH                 14.0f
+#define KR920_DEFAULT_MAX_EIRP_HIGH                 28
 
 /*!
- * Default antenna gain
+ * Default antenna gain in half dB, 2.15 dBi rounded up
  */
-#define KR920_DEFAULT_ANTENNA_GAIN                  2.15f
+#define KR920_DEFAULT_ANTENNA_GAIN                  5
 
 /*!
  * ADR Ack limit
@@ -473,6 +473,11 @@ void RegionKR920SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionKR920ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionKR920Ops;
+
 /*! \} defgroup REGIONKR920 */
 
 #endif // __REGION_KR920_H__
@@ -65,6 +65,11 @@ static uint16_t ChannelsMaskRemaining[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Enabled channels supporting each tx datarate
+ */
+static uint16_t ChannelsDrMask[US915_HYBRID_TX_MAX_DATARATE + 1][CHANNELS_MASK_SIZE];
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -205,35 +210,29 @@ static bool ValidateChannelsMask( uint16_t* channelsMask )
     return chanMaskState;
 }
 
-static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
+static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, Band_t* bands, uint16_t* enabledMask, uint8_t* delayTx )
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTransmission = 0;
 
-    for( uint8_t i = 0, k = 0; i < US915_HYBRID_MAX_NB_CHANNELS; i += 16, k++ )
+    for( uint8_t k = 0; k < CHANNELS_MASK_SIZE; k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        if( datarate <= US915_HYBRID_TX_MAX_DATARATE )
+        { // Keep the enabled channels supporting the given datarate
+            enabledMask[k] = channelsMask[k] & ChannelsDrMask[datarate][k];
+        }
+        else
         {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
+            enabledMask[k] = 0;
         }
     }
+    nbEnabledChannels = RegionCommonCountChannels( enabledMask, 0, CHANNELS_MASK_SIZE );
+
+    if( bands[0].TimeOff > 0 )
+    { // Check if the band is available for transmission, all the channels are in band 0
+        delayTransmission = nbEnabledChannels;
+        nbEnabledChannels = 0;
+    }
 
     *delayTx = delayTransmission;
     return nbEnabledChannels;
@@ -265,6 +264,16 @@ PhyParam_t RegionUS915HybridGetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = GetNextLowerTxDr( getPhy->Datarate, US915_HYBRID_TX_MIN_DATARATE );
             break;
         }
+        case PHY_BANDWIDTH:
+        {
+            phyParam.Value = RegionCommonGetBandwidth( BandwidthsUS915_HYBRID, sizeof( BandwidthsUS915_HYBRID ) / sizeof( BandwidthsUS915_HYBRID[0] ), getPhy->Datarate );
+            break;
+        }
+        case PHY_SYMBOL_TIME:
+        {
+            phyParam.Value = RegionCommonGetSymbolTime( DataratesUS915_HYBRID, BandwidthsUS915_HYBRID, sizeof( DataratesUS915_HYBRID ), getPhy->Datarate );
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = US915_HYBRID_DEFAULT_TX_POWER;
@@ -364,7 +373,7 @@ PhyParam_t RegionUS915HybridGetPhyParam( GetPhyParams_t* getPhy )
         case PHY_DEF_MAX_EIRP:
         case PHY_DEF_ANTENNA_GAIN:
         {
-            phyParam.fValue = 0;
+            phyParam.Value = 0;
             break;
         }
         case PHY_NB_JOIN_TRIALS:
@@ -409,6 +418,12 @@ void RegionUS915HybridInitDefaults( InitType_t type )
                 Channels[i].Band = 0;
             }
 
+            // Channels supporting each tx datarate
+            for( int8_t dr = DR_0; dr <= US915_HYBRID_TX_MAX_DATARATE; dr++ )
+            {
+                RegionCommonChanDrMask( Channels, US915_HYBRID_MAX_NB_CHANNELS, dr, ChannelsDrMask[dr] );
+            }
+
             // ChannelsMask
             ChannelsDefaultMask[0] = 0x00FF;
             ChannelsDefaultMask[1] = 0x0000;
@@ -587,7 +602,7 @@ bool RegionUS915HybridAdrNext( AdrNextParams_t* adrNext, int8_t* drOut, int8_t*
 
 void RegionUS915HybridComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    uint32_t tSymbol = 0;
     uint32_t radioWakeUpTime;
 
     // Get the datarate, perform a boundary check
@@ -870,20 +885,29 @@ bool RegionUS915HybridNextChannel( NextChanParams_t* nextChanParams, uint8_t* ch
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTx = 0;
-    uint8_t enabledChannels[US915_HYBRID_MAX_NB_CHANNELS] = { 0 };
+    uint16_t enabledMask[CHANNELS_MASK_SIZE] = { 0 };
     TimerTime_t nextTxDelay = 0;
+    uint16_t queryMaskRemaining[CHANNELS_MASK_SIZE];
+    uint16_t* channelsMaskRemaining = ChannelsMaskRemaining;
+
+    if( nextChanParams->Query == true )
+    {
+        // A query works on a copy of the mask, the channel plan stays untouched
+        RegionCommonChanMaskCopy( queryMaskRemaining, ChannelsMaskRemaining, CHANNELS_MASK_SIZE );
+        channelsMaskRemaining = queryMaskRemaining;
+    }
 
     // Count 125kHz channels
-    if( RegionCommonCountChannels( ChannelsMaskRemaining, 0, 4 ) == 0 )
+    if( RegionCommonCountChannels( channelsMaskRemaining, 0, 4 ) == 0 )
     { // Reactivate default channels
-        RegionCommonChanMaskCopy( ChannelsMaskRemaining, ChannelsMask, 4  );
+        RegionCommonChanMaskCopy( channelsMaskRemaining, ChannelsMask, 4  );
     }
     // Check other channels
     if( nextChanParams->Datarate >= DR_4 )
     {
-        if( ( ChannelsMaskRemaining[4] & 0x00FF ) == 0 )
+        if( ( channelsMaskRemaining[4] & 0x00FF ) == 0 )
         {
-            ChannelsMaskRemaining[4] = ChannelsMask[4];
+            channelsMaskRemaining[4] = ChannelsMask[4];
         }
     }
 
@@ -896,9 +920,8 @@ bool RegionUS915HybridNextChannel( NextChanParams_t* nextChanParams, uint8_t* ch
         nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, Bands, US915_HYBRID_MAX_NB_BANDS );
 
         // Search how many channels are enabled
-        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate,
-                                                      ChannelsMaskRemaining, Channels,
-                                                      Bands, enabledChannels, &delayTx );
+        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate, channelsMaskRemaining,
+                                                      Bands, enabledMask, &delayTx );
     }
     else
     {
@@ -909,9 +932,9 @@ bool RegionUS915HybridNextChannel( NextChanParams_t* nextChanParams, uint8_t* ch
     if( nbEnabledChannels > 0 )
     {
         // We found a valid channel
-        *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+        *channel = RegionCommonSelectChannel( enabledMask, CHANNELS_MASK_SIZE, nbEnabledChannels, nextChanParams->BusyChannelsMask );
         // Disable the channel in the mask
-        RegionCommonChanDisable( ChannelsMaskRemaining, *channel, US915_HYBRID_MAX_NB_CHANNELS - 8 );
+        RegionCommonChanDisable( channelsMaskRemaining, *channel, US915_HYBRID_MAX_NB_CHANNELS - 8 );
 
         *time = 0;
         return true;
@@ -962,3 +985,32 @@ uint8_t RegionUS915HybridApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, in
     }
     return datarate;
 }
+
+/*!
+ * US915 hybrid region operations
+ */
+const RegionOps_t RegionUS915HybridOps =
+{
+    .GetPhyParam = RegionUS915HybridGetPhyParam,
+    .SetBandTxDone = RegionUS915HybridSetBandTxDone,
+    .InitDefaults = RegionUS915HybridInitDefaults,
+    .Verify = RegionUS915HybridVerify,
+    .ApplyCFList = RegionUS915HybridApplyCFList,
+    .ChanMaskSet = RegionUS915HybridChanMaskSet,
+    .AdrNext = RegionUS915HybridAdrNext,
+    .ComputeRxWindowParameters = RegionUS915HybridComputeRxWindowParameters,
+    .RxConfig = RegionUS915HybridRxConfig,
+    .TxConfig = RegionUS915HybridTxConfig,
+    .LinkAdrReq = RegionUS915HybridLinkAdrReq,
+    .RxParamSetupReq = RegionUS915HybridRxParamSetupReq,
+    .NewChannelReq = RegionUS915HybridNewChannelReq,
+    .TxParamSetupReq = RegionUS915HybridTxParamSetupReq,
+    .DlChannelReq = RegionUS915HybridDlChannelReq,
+    .AlternateDr = RegionUS915HybridAlternateDr,
+    .CalcBackOff = RegionUS915HybridCalcBackOff,
+    .NextChannel = RegionUS915HybridNextChannel,
+    .ChannelAdd = RegionUS915HybridChannelAdd,
+    .ChannelsRemove = RegionUS915HybridChannelsRemove,
+    .SetContinuousWave = RegionUS915HybridSetContinuousWave,
+    .ApplyDrOffset = RegionUS915HybridApplyDrOffset,
+};
@@ -96,9 +96,9 @@
 #define US915_HYBRID_DEFAULT_TX_POWER               TX_POWER_0
 
 /*!
- * Default Max ERP
+ * Default Max ERP in half dB, 30 dBm
  */
-#define US915_HYBRID_DEFAULT_MAX_ERP                30.0f
+#define US915_HYBRID_DEFAULT_MAX_ERP                60
 
 /*!
  * ADR Ack limit
@@ -443,6 +443,11 @@ void RegionUS915HybridSetContinuousWave( ContinuousWaveParams_t* continuousWave
  */
 uint8_t RegionUS915HybridApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * \brief Operations of the region, dispatched to by Region.c.
+ */
+extern const RegionOps_t RegionUS915HybridOps;
+
 /*! \} defgroup REGIONUS915HYB */
 
 #endif // __REGION_US915_HYBRID_H__
@@ -131,6 +131,15 @@ struct Radio_s
      * \retval isFree         [true: Channel is free, false: Channel is not free]
      */
     bool    ( *IsChannelFree )( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
+    /*!
+     * \brief Sets the radio in reception on the channel without reception
+     *        interrupts, Radio.Rssi then measures it. Radio.Standby or
+     *        Radio.Sleep ends it. Non-blocking counterpart of IsChannelFree
+     *
+     * \param [IN] modem      Radio modem to be used [0: FSK, 1: LoRa]
+     * \param [IN] freq       Channel RF frequency
+     */
+    void    ( *StartCarrierSense )( RadioModems_t modem, uint32_t freq );
     /*!
      * \brief Generates a 32 bits random value based on the RSSI readings
      *
@@ -0,0 +1,302 @@
+ /******************************************************************************
+  * @file    energy.c
+  * @brief   energy accounting of the MCU and radio power states
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+  
+  
+/* Includes ------------------------------------------------------------------*/
+#include "hw.h"
+#include "energy.h"
+
+#ifdef ENERGY_LEDGER
+
+/* Private typedef -----------------------------------------------------------*/
+/*!
+ * Accounting of one power domain: the state it is in and when it entered it
+ */
+typedef struct
+{
+  e_Energy_State_t State;
+  uint32_t Since;
+} EnergyDomain_t;
+
+/* Private define ------------------------------------------------------------*/
+/* Default currents in uA, may be overridden in hw_conf.h */
+#ifndef ENERGY_MCU_RUN_CURRENT
+#define ENERGY_MCU_RUN_CURRENT           5000
+#endif
+#ifndef ENERGY_MCU_SLEEP_CURRENT
+#define ENERGY_MCU_SLEEP_CURRENT         1400
+#endif
+#ifndef ENERGY_MCU_STOP_CURRENT
+#define ENERGY_MCU_STOP_CURRENT          2
+#endif
+#ifndef ENERGY_RADIO_SLEEP_CURRENT
+#define ENERGY_RADIO_SLEEP_CURRENT       1
+#endif
+#ifndef ENERGY_RADIO_STANDBY_CURRENT
+#define ENERGY_RADIO_STANDBY_CURRENT     1600
+#endif
+#ifndef ENERGY_RADIO_RX_CURRENT
+#define ENERGY_RADIO_RX_CURRENT          11500
+#endif
+#ifndef ENERGY_RADIO_TX_RFO_CURRENT
+#define ENERGY_RADIO_TX_RFO_CURRENT      29000
+#endif
+#ifndef ENERGY_RADIO_TX_BOOST_CURRENT
+#define ENERGY_RADIO_TX_BOOST_CURRENT    90000
+#endif
+#ifndef ENERGY_RADIO_TX_20DBM_CURRENT
+#define ENERGY_RADIO_TX_20DBM_CURRENT    120000
+#endif
+
+/* Supply voltage in mV used to turn charge into energy */
+#ifndef ENERGY_SUPPLY_VOLTAGE
+#define ENERGY_SUPPLY_VOLTAGE            3300
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Energy_Current[ENERGY_STATE_MAX] =
+{
+  ENERGY_MCU_RUN_CURRENT,
+  ENERGY_MCU_SLEEP_CURRENT,
+  ENERGY_MCU_STOP_CURRENT,
+  ENERGY_RADIO_SLEEP_CURRENT,
+  ENERGY_RADIO_STANDBY_CURRENT,
+  ENERGY_RADIO_RX_CURRENT,
+  ENERGY_RADIO_TX_RFO_CURRENT,
+  ENERGY_RADIO_TX_BOOST_CURRENT,
+  ENERGY_RADIO_TX_20DBM_CURRENT,
+};
+
+/*!
+ * Time spent in each state, in RTC ticks
+ */
+static uint32_t Energy_Residency[ENERGY_STATE_MAX];
+
+/*!
+ * Charge drawn in each state, in uA.tick
+ */
+static uint64_t Energy_Charge[ENERGY_STATE_MAX];
+
+static EnergyDomain_t Energy_Mcu = { ENERGY_MCU_RUN, 0 };
+
+static EnergyDomain_t Energy_Radio = { ENERGY_RADIO_SLEEP, 0 };
+
+static uint64_t Energy_UplinkMark = 0;
+
+static uint32_t Energy_Uplink = 0;
+
+static bool Energy_UplinkPending = false;
+
+static bool Energy_Initialized = false;
+
+/* Private function prototypes -----------------------------------------------*/
+/*!
+ * @brief Charges the time elapsed in the current state of a domain and
+ *        moves the domain to a new state
+ */
+static void Energy_Transition( EnergyDomain_t *domain, e_Energy_State_t state );
+
+/*!
+ * @brief Brings the counters up to date and returns the total charge
+ * @retval charge [uA.tick]
+ */
+static uint64_t Energy_Settle( void );
+
+/* Exported functions ---------------------------------------------------------*/
+
+void Energy_Init( void )
+{
+  uint32_t now = HW_RTC_GetTimerValue( );
+
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  Energy_Mcu.State = ENERGY_MCU_RUN;
+  Energy_Mcu.Since = now;
+  Energy_Radio.State = ENERGY_RADIO_SLEEP;
+  Energy_Radio.Since = now;
+  Energy_Initialized = true;
+
+  RESTORE_PRIMASK( );
+
+  Energy_Reset( );
+}
+
+void Energy_SetMcuState( e_Energy_State_t state )
+{
+  Energy_Transition( &Energy_Mcu, state );
+}
+
+void Energy_SetRadioState( e_Energy_State_t state )
+{
+  Energy_Transition( &Energy_Radio, state );
+}
+
+void Energy_SetRadioTx( int8_t power )
+{
+  if( power > 17 )
+  {
+    Energy_Transition( &Energy_Radio, ENERGY_RADIO_TX_20DBM );
+  }
+  else if( power > 14 )
+  {
+    Energy_Transition( &Energy_Radio, ENERGY_RADIO_TX_BOOST );
+  }
+  else
+  {
+    Energy_Transition( &Energy_Radio, ENERGY_RADIO_TX_RFO );
+  }
+}
+
+void Energy_SetCurrent( e_Energy_State_t state, uint32_t current )
+{
+  if( state >= ENERGY_STATE_MAX )
+  {
+    return;
+  }
+  /* charge the elapsed time with the previous figure */
+  Energy_Settle( );
+
+  Energy_Current[state] = current;
+}
+
+uint32_t Energy_GetCurrent( e_Energy_State_t state )
+{
+  if( state >= ENERGY_STATE_MAX )
+  {
+    return 0;
+  }
+  return Energy_Current[state];
+}
+
+uint32_t Energy_GetResidency( e_Energy_State_t state )
+{
+  if( state >= ENERGY_STATE_MAX )
+  {
+    return 0;
+  }
+  Energy_Settle( );
+
+  return HW_RTC_Tick2ms( Energy_Residency[state] );
+}
+
+uint32_t Energy_GetCharge( void )
+{
+  return ( uint32_t )( Energy_Settle( ) / HW_RTC_ms2Tick( 3600000 ) );
+}
+
+void Energy_UplinkStart( void )
+{
+  Energy_UplinkMark = Energy_Settle( );
+  Energy_UplinkPending = true;
+}
+
+void Energy_UplinkAbort( void )
+{
+  Energy_UplinkPending = false;
+}
+
+void Energy_UplinkEnd( void )
+{
+  uint64_t charge;
+
+  if( Energy_UplinkPending == false )
+  {
+    return;
+  }
+  Energy_UplinkPending = false;
+
+  charge = Energy_Settle( ) - Energy_UplinkMark;
+
+  /* uA.tick -> uC -> uJ */
+  Energy_Uplink = ( uint32_t )( ( charge * ENERGY_SUPPLY_VOLTAGE ) / ( ( uint64_t )HW_RTC_ms2Tick( 1000 ) * 1000 ) );
+}
+
+uint32_t Energy_GetUplinkEnergy( void )
+{
+  return Energy_Uplink;
+}
+
+void Energy_Reset( void )
+{
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  Energy_Transition( &Energy_Mcu, Energy_Mcu.State );
+  Energy_Transition( &Energy_Radio, Energy_Radio.State );
+
+  for( uint8_t i = 0; i < ENERGY_STATE_MAX; i++ )
+  {
+    Energy_Residency[i] = 0;
+    Energy_Charge[i] = 0;
+  }
+  Energy_UplinkMark = 0;
+  Energy_Uplink = 0;
+  Energy_UplinkPending = false;
+
+  RESTORE_PRIMASK( );
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Energy_Transition( EnergyDomain_t *domain, e_Energy_State_t state )
+{
+  uint32_t now;
+  uint32_t elapsed;
+
+  if( Energy_Initialized == false )
+  {
+    return;
+  }
+
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  now = HW_RTC_GetTimerValue( );
+  elapsed = now - domain->Since; /* intentional wrap around */
+
+  Energy_Residency[domain->State] += elapsed;
+  Energy_Charge[domain->State] += ( uint64_t )elapsed * Energy_Current[domain->State];
+
+  domain->State = state;
+  domain->Since = now;
+
+  RESTORE_PRIMASK( );
+}
+
+static uint64_t Energy_Settle( void )
+{
+  uint64_t total = 0;
+
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  Energy_Transition( &Energy_Mcu, Energy_Mcu.State );
+  Energy_Transition( &Energy_Radio, Energy_Radio.State );
+
+  for( uint8_t i = 0; i < ENERGY_STATE_MAX; i++ )
+  {
+    total += Energy_Charge[i];
+  }
+
+  RESTORE_PRIMASK( );
+
+  return total;
+}
+#endif /* ENERGY_LEDGER */
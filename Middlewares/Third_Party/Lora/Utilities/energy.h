@@ -0,0 +1,170 @@
+ /******************************************************************************
+  * @file    energy.h
+  * @brief   Header for driver energy.c module
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ENERGY_H__
+#define __ENERGY_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/*!
+ * Power states tracked by the energy ledger. The MCU states and the radio
+ * states are accounted independently, one of each is always active.
+ */
+typedef enum
+{
+  ENERGY_MCU_RUN = 0,
+  ENERGY_MCU_SLEEP,
+  ENERGY_MCU_STOP,
+  ENERGY_RADIO_SLEEP,
+  ENERGY_RADIO_STANDBY,
+  ENERGY_RADIO_RX,
+  ENERGY_RADIO_TX_RFO,
+  ENERGY_RADIO_TX_BOOST,
+  ENERGY_RADIO_TX_20DBM,
+  ENERGY_STATE_MAX,
+} e_Energy_State_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* External variables --------------------------------------------------------*/
+/* Exported macros -----------------------------------------------------------*/
+#ifndef ENERGY_LEDGER
+/*
+ * The ledger is only built when ENERGY_LEDGER is defined (see the Makefile),
+ * the hooks of the radio driver, of the low power manager and of the
+ * application then compile to nothing
+ */
+#define Energy_Init( )                   ( ( void )0 )
+#define Energy_SetMcuState( state )      ( ( void )0 )
+#define Energy_SetRadioState( state )    ( ( void )0 )
+#define Energy_SetRadioTx( power )       ( ( void )0 )
+#define Energy_UplinkStart( )            ( ( void )0 )
+#define Energy_UplinkAbort( )            ( ( void )0 )
+#define Energy_UplinkEnd( )              ( ( void )0 )
+#else
+/* Exported functions ------------------------------------------------------- */ 
+
+/*!
+ * @brief Resets the ledger and starts accounting with the MCU running
+ *        and the radio asleep
+ * @note  Must be called once the RTC is initialized
+ */
+void Energy_Init( void );
+
+/*!
+ * @brief Records a transition of the MCU power state
+ *
+ * @param [IN] state ENERGY_MCU_RUN, ENERGY_MCU_SLEEP or ENERGY_MCU_STOP
+ */
+void Energy_SetMcuState( e_Energy_State_t state );
+
+/*!
+ * @brief Records a transition of the radio power state
+ *
+ * @param [IN] state ENERGY_RADIO_SLEEP, ENERGY_RADIO_STANDBY or ENERGY_RADIO_RX
+ */
+void Energy_SetRadioState( e_Energy_State_t state );
+
+/*!
+ * @brief Records the start of a radio transmission
+ * @note  The TX state is selected from the power the same way the
+ *        board selects the PA output
+ *
+ * @param [IN] power RF output power [dBm]
+ */
+void Energy_SetRadioTx( int8_t power );
+
+/*!
+ * @brief Sets the current drawn in the given state
+ *
+ * @param [IN] state   power state
+ * @param [IN] current current [uA]
+ */
+void Energy_SetCurrent( e_Energy_State_t state, uint32_t current );
+
+/*!
+ * @brief Gets the current drawn in the given state
+ *
+ * @param [IN] state power state
+ * @retval current [uA]
+ */
+uint32_t Energy_GetCurrent( e_Energy_State_t state );
+
+/*!
+ * @brief Gets the time spent in the given state since the last reset
+ *
+ * @param [IN] state power state
+ * @retval residency [ms]
+ */
+uint32_t Energy_GetResidency( e_Energy_State_t state );
+
+/*!
+ * @brief Gets the charge drawn by the MCU and the radio since the last reset
+ *
+ * @param none
+ * @retval charge [uAh]
+ */
+uint32_t Energy_GetCharge( void );
+
+/*!
+ * @brief Marks the start of an uplink, from the request to the end of the
+ *        receive windows
+ * @param none
+ * @retval none
+ */
+void Energy_UplinkStart( void );
+
+/*!
+ * @brief Cancels the uplink started by Energy_UplinkStart, when the request
+ *        has been rejected
+ * @param none
+ * @retval none
+ */
+void Energy_UplinkAbort( void );
+
+/*!
+ * @brief Marks the end of an uplink and latches its energy
+ * @note  Does nothing if no uplink has been started
+ * @param none
+ * @retval none
+ */
+void Energy_UplinkEnd( void );
+
+/*!
+ * @brief Gets the energy drawn by the last completed uplink
+ *
+ * @param none
+ * @retval energy [uJ]
+ */
+uint32_t Energy_GetUplinkEnergy( void );
+
+/*!
+ * @brief Clears the residency and charge counters
+ * @param none
+ * @retval none
+ */
+void Energy_Reset( void );
+#endif /* ENERGY_LEDGER */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENERGY_H__ */
@@ -47,6 +47,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "hw.h"
 #include "low_power.h"
+#include "energy.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -125,11 +126,15 @@ void LowPower_Handler( void )
     
     DBG_PRINTF_CRITICAL("dz\n\r");
     
+    Energy_SetMcuState( ENERGY_MCU_STOP );
+    
     HW_EnterStopMode( );
     
     /* mcu dependent. to be implemented by user*/
     HW_ExitStopMode();
     
+    Energy_SetMcuState( ENERGY_MCU_RUN );
+    
     DBG_GPIO_SET(GPIOB, GPIO_PIN_15);
     
     HW_RTC_setMcuWakeUpTime( );
@@ -138,12 +143,21 @@ void LowPower_Handler( void )
   {
     DBG_PRINTF_CRITICAL("z\n\r");
     
-    HW_EnterSleepMode( );
+    LowPower_Sleep( );
 
     DBG_GPIO_SET(GPIOB, GPIO_PIN_14);
   }
   
 }
+
+void LowPower_Sleep( void )
+{
+  Energy_SetMcuState( ENERGY_MCU_SLEEP );
+  
+  HW_EnterSleepMode( );
+
+  Energy_SetMcuState( ENERGY_MCU_RUN );
+}
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
 
 
@@ -89,6 +89,13 @@ uint32_t LowPower_GetState( void );
  */
 void LowPower_Handler( void );
 
+/*!
+ * @brief Enters ARM cortex sleep mode until the next interrupt
+ * @param none
+ * @retval none
+ */
+void LowPower_Sleep( void );
+
 #ifdef __cplusplus
 }
 #endif
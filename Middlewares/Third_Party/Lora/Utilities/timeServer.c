@@ -62,7 +62,7 @@ Maintainer: Miguel Luis, Gregory Cristian and Wael Guibene
 #include <time.h>
 #include "hw.h"
 #include "timeServer.h"
-//#include "low_power.h"
+#include "low_power.h"
 
 
 /*!
@@ -87,6 +87,26 @@ Maintainer: Miguel Luis, Gregory Cristian and Wael Guibene
  */
 static TimerEvent_t *TimerListHead = NULL;
 
+/*!
+ * Alarm currently programmed for the list, in ticks from TimerContext
+ */
+static uint32_t TimerAlarm = 0;
+
+/*!
+ * Timer used by TimerDelayMs
+ */
+static TimerEvent_t DelayTimer;
+
+/*!
+ * Set by the DelayTimer callback when the delay has elapsed
+ */
+static volatile bool DelayExpired = false;
+
+/*!
+ * \brief DelayTimer callback
+ */
+static void TimerDelayOnEvent( void );
+
 /*!
  * \brief Adds or replace the head timer of the list.
  *
@@ -111,6 +131,10 @@ static void TimerInsertTimer( TimerEvent_t *obj );
 
 /*!
  * \brief Sets a timeout with the duration "timestamp"
+ *
+ * \remark The timeout is deferred within the slack of the timers due first
+ *         so that the timers expiring right after are served by the same
+ *         wake-up
  * 
  * \param [IN] timestamp Delay duration
  */
@@ -130,6 +154,7 @@ void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) )
 {
   obj->Timestamp = 0;
   obj->ReloadValue = 0;
+  obj->Slack = 0;
   obj->IsRunning = false;
   obj->Callback = callback;
   obj->Next = NULL;
@@ -169,6 +194,12 @@ void TimerStart( TimerEvent_t *obj )
     else
     {
       TimerInsertTimer( obj);
+
+      /* the running alarm was deferred past the expiry of this timer */
+      if( ( TimerListHead->IsRunning == true ) && ( ( obj->Timestamp + obj->Slack ) < TimerAlarm ) )
+      {
+        TimerSetTimeout( TimerListHead );
+      }
     }
   }
   RESTORE_PRIMASK( );
@@ -251,7 +282,7 @@ void TimerIrqHandler( void )
 
 
   // remove all the expired object from the list
-  while( ( TimerListHead != NULL ) && ( TimerListHead->Timestamp < HW_RTC_GetTimerElapsedTime(  )  ))
+  while( ( TimerListHead != NULL ) && ( TimerListHead->Timestamp <= HW_RTC_GetTimerElapsedTime(  )  ))
   {
    cur = TimerListHead;
    TimerListHead = TimerListHead->Next;
@@ -377,6 +408,46 @@ void TimerSetValue( TimerEvent_t *obj, uint32_t value )
   obj->ReloadValue = ticks;
 }
 
+void TimerSetSlack( TimerEvent_t *obj, uint32_t slack )
+{
+  obj->Slack = HW_RTC_ms2Tick( slack );
+}
+
+static void TimerDelayOnEvent( void )
+{
+  DelayExpired = true;
+}
+
+void TimerDelayMs( uint32_t delay )
+{
+  if( ( __get_IPSR( ) != 0 ) || ( __get_PRIMASK( ) != 0 ) )
+  {
+    /* the timer interrupt can not be served from here: busy wait */
+    HW_RTC_DelayMs( delay );
+    return;
+  }
+
+  DelayExpired = false;
+  TimerInit( &DelayTimer, TimerDelayOnEvent );
+  TimerSetValue( &DelayTimer, delay );
+  TimerStart( &DelayTimer );
+
+  while( DelayExpired == false )
+  {
+    BACKUP_PRIMASK();
+
+    DISABLE_IRQ( );
+
+    /* an interrupt pending since DISABLE_IRQ wakes the core up at once */
+    if( DelayExpired == false )
+    {
+      LowPower_Sleep( );
+    }
+
+    RESTORE_PRIMASK( );
+  }
+}
+
 TimerTime_t TimerGetCurrentTime( void )
 {
   uint32_t now = HW_RTC_GetTimerValue( );
@@ -394,6 +465,8 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t past )
 static void TimerSetTimeout( TimerEvent_t *obj )
 {
   int32_t minTicks= HW_RTC_GetMinimumTimeout( );
+  TimerEvent_t* cur;
+  uint32_t alarm;
   obj->IsRunning = true; 
 
   //in case deadline too soon
@@ -401,6 +474,19 @@ static void TimerSetTimeout( TimerEvent_t *obj )
   {
     obj->Timestamp = HW_RTC_GetTimerElapsedTime(  ) + minTicks;
   }
-  HW_RTC_SetAlarm( obj->Timestamp );
+
+  /* defer the alarm up to the earliest latest expiry of the timers it covers */
+  alarm = obj->Timestamp + obj->Slack;
+  for( cur = obj->Next; ( cur != NULL ) && ( cur->Timestamp <= alarm ); cur = cur->Next )
+  {
+    if( ( cur->Timestamp + cur->Slack ) < alarm )
+    {
+      alarm = cur->Timestamp + cur->Slack;
+    }
+  }
+  /* a timer due within the minimum timeout must not pull the alarm before it */
+  alarm = MAX( alarm, obj->Timestamp );
+  TimerAlarm = alarm;
+  HW_RTC_SetAlarm( alarm );
 }
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
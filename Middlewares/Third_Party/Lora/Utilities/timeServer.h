@@ -79,6 +79,7 @@ typedef struct TimerEvent_s
 {
     uint32_t Timestamp;         //! Expiring timer value in ticks from TimerContext
     uint32_t ReloadValue;       //! Reload Value when Timer is restarted
+    uint32_t Slack;             //! Tolerated expiry delay in ticks, 0 when exact
     bool IsRunning;             //! Is the timer currently running
     void ( *Callback )( void ); //! Timer IRQ callback function
     struct TimerEvent_s *Next;  //! Pointer to the next Timer object.
@@ -139,6 +140,30 @@ void TimerReset( TimerEvent_t *obj );
  */
 void TimerSetValue( TimerEvent_t *obj, uint32_t value );
 
+/*!
+ * \brief Set the delay the timer tolerates on its expiry
+ *
+ * \remark The wake-up of a timer with slack is deferred, within its slack,
+ *         to serve the timers expiring right after it at once.
+ *         Takes effect at the next start of the timer.
+ *
+ * \param [IN] obj   Structure containing the timer object parameters
+ * \param [IN] slack Tolerated delay in ms [0: exact expiry]
+ */
+void TimerSetSlack( TimerEvent_t *obj, uint32_t slack );
+
+/*!
+ * \brief Waits for at least the given delay with the MCU in sleep mode
+ *
+ * \remark The delay is served by the timer server, hence rounded up to the
+ *         minimum alarm timeout. Stop mode is not used as it would release
+ *         the radio IOs. From an interrupt handler or with the interrupts
+ *         masked the timer can not expire and the delay busy waits instead.
+ *
+ * \param [IN] delay Delay in ms
+ */
+void TimerDelayMs( uint32_t delay );
+
 
 /*!
  * \brief Read the current time
@@ -0,0 +1,120 @@
+ /******************************************************************************
+  * @file    trace.c
+  * @brief   trace ring of the radio and MAC events
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+  
+  
+/* Includes ------------------------------------------------------------------*/
+#include "hw.h"
+#include "trace.h"
+
+#ifdef TRACE_RING
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Number of entries of the ring, a power of 2. May be overridden in hw_conf.h */
+#ifndef TRACE_DEPTH
+#define TRACE_DEPTH                      64
+#endif
+
+#if ( TRACE_DEPTH == 0 ) || ( ( TRACE_DEPTH & ( TRACE_DEPTH - 1 ) ) != 0 ) || ( TRACE_DEPTH > 0x8000 )
+#error "TRACE_DEPTH must be a power of 2, at most 0x8000"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static Trace_Entry_t Trace_Ring[TRACE_DEPTH];
+
+/*!
+ * Number of entries recorded since the last reset, the next entry being
+ * written at Trace_Total % TRACE_DEPTH
+ */
+static uint32_t Trace_Total = 0;
+
+/*!
+ * Set while the ring is read, events are dropped
+ */
+static volatile bool Trace_Frozen = false;
+
+/* Private function prototypes -----------------------------------------------*/
+/* Exported functions ---------------------------------------------------------*/
+
+void Trace_Record( e_Trace_Event_t event, uint8_t arg1, uint16_t arg2 )
+{
+  Trace_Entry_t *entry;
+  uint32_t time;
+
+  if( Trace_Frozen == true )
+  {
+    return;
+  }
+  /* Read outside of the critical section, entries may then be a few ticks
+   * out of order */
+  time = HW_RTC_GetTimestamp( );
+
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  entry = &Trace_Ring[Trace_Total & ( TRACE_DEPTH - 1 )];
+  Trace_Total++;
+
+  entry->Time = time;
+  entry->Event = ( uint8_t )event;
+  entry->Arg1 = arg1;
+  entry->Arg2 = arg2;
+
+  RESTORE_PRIMASK( );
+}
+
+uint16_t Trace_GetCount( void )
+{
+  return ( Trace_Total < TRACE_DEPTH ) ? Trace_Total : TRACE_DEPTH;
+}
+
+void Trace_Freeze( bool freeze )
+{
+  Trace_Frozen = freeze;
+}
+
+bool Trace_Read( uint16_t index, Trace_Entry_t *entry )
+{
+  uint32_t oldest;
+  bool found = false;
+
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  if( index < Trace_GetCount( ) )
+  {
+    oldest = Trace_Total - Trace_GetCount( );
+    *entry = Trace_Ring[( oldest + index ) & ( TRACE_DEPTH - 1 )];
+    found = true;
+  }
+
+  RESTORE_PRIMASK( );
+
+  return found;
+}
+
+void Trace_Reset( void )
+{
+  BACKUP_PRIMASK();
+
+  DISABLE_IRQ( );
+
+  Trace_Total = 0;
+
+  RESTORE_PRIMASK( );
+}
+#endif /* TRACE_RING */
@@ -0,0 +1,117 @@
+ /******************************************************************************
+  * @file    trace.h
+  * @brief   Header for driver trace.c module
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported types ------------------------------------------------------------*/
+/*!
+ * Events recorded in the trace ring
+ */
+typedef enum
+{
+  TRACE_RADIO_OPMODE = 0,   /* Arg1: op mode, Arg2: modem */
+  TRACE_RADIO_DIO,          /* Arg1: DIO index, Arg2: radio state */
+  TRACE_RADIO_TIMEOUT,      /* Arg1: radio state, Arg2: 0 */
+  TRACE_RADIO_SET_RX,       /* Arg1: continuous, Arg2: timeout [ms] */
+  TRACE_RADIO_SET_TX,       /* Arg1: 0, Arg2: timeout [ms] */
+  TRACE_MAC_RX_WINDOW,      /* Arg1: RX slot, Arg2: window delay [ms] */
+  TRACE_MAC_TX_TIMEOUT,     /* Arg1: 0, Arg2: 0 */
+  TRACE_MAC_RX_TIMEOUT,     /* Arg1: RX slot, Arg2: 0 */
+  TRACE_MAC_RX_ERROR,       /* Arg1: RX slot, Arg2: 0 */
+  TRACE_RADIO_SPI_ERROR,    /* Arg1: register address, Arg2: size */
+  TRACE_EVENT_MAX,
+} e_Trace_Event_t;
+
+/*!
+ * Trace entry, 8 bytes
+ */
+typedef struct
+{
+  uint32_t Time;            /* RTC ticks, wraps around every hour */
+  uint8_t Event;            /* e_Trace_Event_t */
+  uint8_t Arg1;
+  uint16_t Arg2;
+} Trace_Entry_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* External variables --------------------------------------------------------*/
+/* Exported macros -----------------------------------------------------------*/
+#ifndef TRACE_RING
+/*
+ * The ring is only built when TRACE_RING is defined (see the Makefile), the
+ * records of the radio driver and of the MAC then compile to nothing
+ */
+#define Trace_Record( event, arg1, arg2 )   ( ( void )0 )
+#else
+/* Exported functions ------------------------------------------------------- */ 
+
+/*!
+ * @brief Records an event in the trace ring, overwriting the oldest entry
+ *        when the ring is full
+ *
+ * @param [IN] event event id
+ * @param [IN] arg1  first event argument
+ * @param [IN] arg2  second event argument
+ */
+void Trace_Record( e_Trace_Event_t event, uint8_t arg1, uint16_t arg2 );
+
+/*!
+ * @brief Gets the number of entries held in the trace ring
+ *
+ * @param none
+ * @retval number of entries
+ */
+uint16_t Trace_GetCount( void );
+
+/*!
+ * @brief Freezes the trace ring, events are dropped until it is released.
+ *        Keeps the entries from being overwritten while they are read.
+ *
+ * @param [IN] freeze true to freeze the ring, false to release it
+ */
+void Trace_Freeze( bool freeze );
+
+/*!
+ * @brief Reads an entry of the trace ring
+ * @note  The ring should be frozen while several entries are read
+ *
+ * @param [IN]  index entry index, 0 being the oldest entry
+ * @param [OUT] entry copy of the entry
+ * @retval false if there is no entry at this index
+ */
+bool Trace_Read( uint16_t index, Trace_Entry_t *entry );
+
+/*!
+ * @brief Clears the trace ring
+ * @param none
+ * @retval none
+ */
+void Trace_Reset( void );
+#endif /* TRACE_RING */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H__ */
@@ -129,6 +129,9 @@ typedef enum eATEerror
 #define AT_CERTIF     "+CERTIF"
 #define AT_CHANMASK   "+CHANMASK"
 #define AT_CHANDEFMASK "+CHANDEFMASK"
+#define AT_ENERGY     "+ENERGY"
+#define AT_TRACE      "+TRACE"
+#define AT_NEXTTX     "+NEXTTX"
 
 /* Exported functions ------------------------------------------------------- */
 
@@ -702,6 +705,57 @@ ATEerror_t at_ChannelDefaultMask_get(const char *param);
  */
 ATEerror_t at_ChannelDefaultMask_set(const char *param);
 
+/**
+ * @brief  Print the charge drawn in mAh, the energy of the last uplink in uJ
+ *         and the residency in ms of each power state
+ * @param  String parameter
+ * @retval AT_OK
+ */
+ATEerror_t at_Energy_get(const char *param);
+
+/**
+ * @brief  Set the current in uA drawn in a power state
+ * @param  String parameter
+ * @retval AT_OK, or an appropriate AT_xxx error code
+ */
+ATEerror_t at_Energy_set(const char *param);
+
+/**
+ * @brief  Clear the energy counters
+ * @param  String parameter
+ * @retval AT_OK
+ */
+ATEerror_t at_Energy_reset(const char *param);
+
+/**
+ * @brief  Dump the radio/MAC trace ring, oldest entry first
+ * @param  String parameter
+ * @retval AT_OK
+ */
+ATEerror_t at_Trace_get(const char *param);
+
+/**
+ * @brief  Clear the radio/MAC trace ring
+ * @param  String parameter
+ * @retval AT_OK
+ */
+ATEerror_t at_Trace_reset(const char *param);
+
+/**
+ * @brief  Print the time in ms until the next uplink can go out
+ * @param  String parameter
+ * @retval AT_OK, or an appropriate AT_xxx error code
+ */
+ATEerror_t at_NextTx_get(const char *param);
+
+/**
+ * @brief  Print the time in ms until an uplink of the given payload size
+ *         can go out, after checking that it fits the current datarate
+ * @param  String parameter
+ * @retval AT_OK, or an appropriate AT_xxx error code
+ */
+ATEerror_t at_NextTx_set(const char *param);
+
 #ifdef __cplusplus
 }
 #endif
@@ -118,6 +118,15 @@ uint32_t HW_RTC_GetTimerElapsedTime(void);
  */
 uint32_t HW_RTC_GetTimerValue(void);
 
+/**
+ * @brief  Get a time stamp for event traces, cheaper than HW_RTC_GetTimerValue
+ * @note   Only the minutes, seconds and sub-seconds are read, the time stamp
+ *         wraps around every hour
+ * @param  None
+ * @retval time stamp in ticks
+ */
+uint32_t HW_RTC_GetTimestamp(void);
+
 /**
  * @brief  Set the RTC timer Reference
  * @param  None
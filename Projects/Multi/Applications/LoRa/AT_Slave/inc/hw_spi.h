@@ -115,6 +115,18 @@ void HW_SPI_IoDeInit(void);
  */
 uint16_t HW_SPI_InOut(uint16_t outData);
 
+/**
+ * @brief Sends and receives a block of bytes in a single burst
+ *
+ * @param  [IN] txBuffer Bytes to be sent [NULL: sends zeros]
+ * @param  [OUT] rxBuffer Received bytes [NULL: discarded]
+ * @param  [IN] size Number of bytes to be transferred
+ * @retval false when the SPI stopped responding and the transfer was
+ *         abandoned, the bytes not received are then 0
+ * @note The busy flag is only waited for at the end of the burst.
+ */
+bool HW_SPI_Transfer(uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size);
+
 
 
 #ifdef __cplusplus
@@ -271,6 +271,13 @@ void lora_fsm( LoRaMacRegion_t region );
  */
 void TriggerReinit();
 
+/**
+ * @brief switches to another band, keeping the session of the band we leave
+ * @param [IN] region band to switch to
+ * @retval LoRa status (ok, busy or region not supported)
+ */
+LoRaMacStatus_t lora_region_switch(LoRaMacRegion_t region);
+
 /**
  * @brief functionl requesting loRa state machine to send data 
  * @note function to link in mode TX_ON_EVENT 
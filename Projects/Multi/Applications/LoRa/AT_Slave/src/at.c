@@ -60,6 +60,8 @@
 #include "version.h"
 #include "hw_msp.h"
 #include "test_rf.h"
+#include "energy.h"
+#include "trace.h"
 
 /* External variables --------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
@@ -277,8 +279,16 @@ ATEerror_t at_Band_set(const char *param)
     return AT_PARAM_ERROR;
   }
   if (region != globalRegion) {
+	  switch (lora_region_switch(region))
+	  {
+	    case LORAMAC_STATUS_OK:
+	      break;
+	    case LORAMAC_STATUS_BUSY:
+	      return AT_BUSY_ERROR;
+	    default:
+	      return AT_PARAM_ERROR;
+	  }
 	  globalRegion = region;
-	  TriggerReinit();
   }
   return AT_OK;
 }
@@ -1121,6 +1131,110 @@ ATEerror_t at_bat_get(const char *param)
   return AT_OK;
 }
 
+#ifdef ENERGY_LEDGER
+ATEerror_t at_Energy_get(const char *param)
+{
+  uint32_t charge = Energy_GetCharge();
+  uint8_t i;
+
+  AT_PRINTF("+OK=");
+  AT_PRINTF("%u.%03u,%u", (unsigned)(charge / 1000), (unsigned)(charge % 1000),
+            (unsigned)Energy_GetUplinkEnergy());
+  for (i = 0; i < ENERGY_STATE_MAX; i++)
+  {
+    AT_PRINTF(",%u", (unsigned)Energy_GetResidency((e_Energy_State_t)i));
+  }
+  AT_PRINTF("\r");
+  return AT_OK;
+}
+
+ATEerror_t at_Energy_set(const char *param)
+{
+  uint8_t state;
+  uint32_t current;
+
+  if (tiny_sscanf(param, "%hhu,%lu", &state, &current) != 2)
+  {
+    return AT_PARAM_ERROR;
+  }
+  if (state >= ENERGY_STATE_MAX)
+  {
+    return AT_PARAM_ERROR;
+  }
+  Energy_SetCurrent((e_Energy_State_t)state, current);
+  return AT_OK;
+}
+
+ATEerror_t at_Energy_reset(const char *param)
+{
+  Energy_Reset();
+  return AT_OK;
+}
+#endif
+
+#ifdef TRACE_RING
+ATEerror_t at_Trace_get(const char *param)
+{
+  Trace_Entry_t entry;
+  uint16_t count;
+  uint16_t i;
+
+  /* keep the entries from being overwritten while they are printed */
+  Trace_Freeze(true);
+  count = Trace_GetCount();
+
+  AT_PRINTF("+OK=");
+  for (i = 0; i < count; i++)
+  {
+    if (Trace_Read(i, &entry) == false)
+    {
+      break;
+    }
+    AT_PRINTF("%s%08x%02x%02x%04x", (i == 0) ? "" : ",", (unsigned)entry.Time,
+              (unsigned)entry.Event, (unsigned)entry.Arg1, (unsigned)entry.Arg2);
+  }
+  AT_PRINTF("\r");
+  Trace_Freeze(false);
+  return AT_OK;
+}
+
+ATEerror_t at_Trace_reset(const char *param)
+{
+  Trace_Reset();
+  return AT_OK;
+}
+#endif
+
+ATEerror_t at_NextTx_get(const char *param)
+{
+  MibRequestConfirm_t mib;
+  LoRaMacStatus_t status;
+
+  mib.Type = MIB_NEXT_TX_DELAY;
+  status = LoRaMacMibGetRequestConfirm(&mib);
+  CHECK_STATUS(status);
+  AT_PRINTF("+OK=");
+  print_u(mib.Param.NextTxDelay);
+
+  return AT_OK;
+}
+
+ATEerror_t at_NextTx_set(const char *param)
+{
+  LoRaMacTxInfo_t txInfo;
+  LoRaMacStatus_t status;
+  uint8_t size;
+
+  if (tiny_sscanf(param, "%hhu", &size) != 1)
+  {
+    return AT_PARAM_ERROR;
+  }
+  status = LoRaMacQueryTxPossible(size, &txInfo);
+  CHECK_STATUS(status);
+
+  return at_NextTx_get(param);
+}
+
 ATEerror_t at_test_txTone(const char *param)
 {
   return TST_TxTone(param, strlen(param));
@@ -655,6 +655,43 @@ static const struct ATCommand_s ATCommand[] =
     .set = at_ChannelDefaultMask_set,
     .run = at_return_error,
   },
+
+#ifdef ENERGY_LEDGER
+  {
+    .string = AT_ENERGY,
+    .size_string = sizeof(AT_ENERGY) - 1,
+#ifndef NO_HELP
+    .help_string = "AT"AT_ENERGY ": Get the energy used (mAh,uplink uJ,state ms...), set a state current (<state>,<uA>) or clear the counters\r\n",
+#endif
+    .get = at_Energy_get,
+    .set = at_Energy_set,
+    .run = at_Energy_reset,
+  },
+#endif
+
+#ifdef TRACE_RING
+  {
+    .string = AT_TRACE,
+    .size_string = sizeof(AT_TRACE) - 1,
+#ifndef NO_HELP
+    .help_string = "AT"AT_TRACE ": Dump the radio/MAC event trace (16 hex chars per entry: time,event,arg1,arg2) or clear it\r\n",
+#endif
+    .get = at_Trace_get,
+    .set = at_return_error,
+    .run = at_Trace_reset,
+  },
+#endif
+
+  {
+    .string = AT_NEXTTX,
+    .size_string = sizeof(AT_NEXTTX) - 1,
+#ifndef NO_HELP
+    .help_string = "AT"AT_NEXTTX ": Get the time in ms until the next uplink can go out, optionally for a payload size\r\n",
+#endif
+    .get = at_NextTx_get,
+    .set = at_NextTx_set,
+    .run = at_return_error,
+  },
 };
 
 
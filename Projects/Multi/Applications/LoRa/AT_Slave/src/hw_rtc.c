@@ -390,6 +390,25 @@ uint32_t HW_RTC_GetTimerValue(void)
   return(CalendarValue);
 }
 
+uint32_t HW_RTC_GetTimestamp(void)
+{
+  uint32_t ssr;
+  uint32_t tr;
+  uint32_t seconds;
+
+  /* same coherency check as HW_RTC_GetCalendarValue, without the date */
+  do
+  {
+    ssr = RTC->SSR;
+    tr = RTC->TR;
+  } while (ssr != RTC->SSR);
+
+  seconds = HW_RTC_Bcd2ToByte((uint8_t)((tr & (RTC_TR_MNT | RTC_TR_MNU)) >> 8U)) * SecondsInMinute +
+            HW_RTC_Bcd2ToByte((uint8_t)(tr & (RTC_TR_ST | RTC_TR_SU)));
+
+  return (seconds << N_PREDIV_S) + (PREDIV_S - READ_BIT(ssr, RTC_SSR_SS));
+}
+
 void HW_RTC_StopAlarm(void)
 {
   /* Clear RTC Alarm Flag */
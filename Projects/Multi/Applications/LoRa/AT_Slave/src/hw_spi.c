@@ -64,6 +64,10 @@ Maintainer: Miguel Luis and Gregory Cristian
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+/* Polls of a status flag after which the SPI is considered stuck, far more
+ * than a byte takes at the slowest SPI clock */
+#define SPI_FLAG_TIMEOUT   1000
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
@@ -191,6 +195,75 @@ uint16_t HW_SPI_InOut(uint16_t txData)
   return rx_data;
 }
 
+bool HW_SPI_Transfer(uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size)
+{
+  uint16_t i;
+  uint16_t polls;
+  uint8_t rx_data;
+  bool done = true;
+
+  /* Check if the SPI is already enabled. Enable otherwise */
+  if (LL_SPI_IsEnabled(SPI1) == RESET)
+  {
+    LL_SPI_Enable(SPI1);
+  }
+
+  for (i = 0; i < size; i++)
+  {
+    /* A single byte in flight: an interrupt taken between two bytes only
+     * stretches the clock, it cannot make the receiver overrun. The data
+     * register is free again once the previous byte has been received */
+    LL_SPI_TransmitData8(SPI1, (txBuffer != NULL) ? txBuffer[i] : 0);
+
+    polls = SPI_FLAG_TIMEOUT;
+    while ((LL_SPI_IsActiveFlag_RXNE(SPI1) == RESET) && (--polls > 0))
+    {
+      ;
+    }
+    if (polls == 0)
+    {
+      /* Give up rather than spin forever with NSS held low, the bytes not
+       * received read as 0 */
+      if (rxBuffer != NULL)
+      {
+        memset1(&rxBuffer[i], 0, size - i);
+      }
+      done = false;
+      break;
+    }
+
+    rx_data = LL_SPI_ReceiveData8(SPI1);
+    if (rxBuffer != NULL)
+    {
+      rxBuffer[i] = rx_data;
+    }
+  }
+
+  /* Wait until Busy flag is reset, once for the whole transfer */
+  polls = SPI_FLAG_TIMEOUT;
+  while ((LL_SPI_IsActiveFlag_BSY(SPI1) != RESET) && (--polls > 0))
+  {
+    ;
+  }
+  if (polls == 0)
+  {
+    done = false;
+  }
+
+  /* Leave the peripheral clean for the next transfer if a byte was lost
+   * or arrived after the transfer was abandoned */
+  if (LL_SPI_IsActiveFlag_OVR(SPI1) != RESET)
+  {
+    LL_SPI_ClearFlag_OVR(SPI1);
+  }
+  else if (LL_SPI_IsActiveFlag_RXNE(SPI1) != RESET)
+  {
+    (void)LL_SPI_ReceiveData8(SPI1);
+  }
+
+  return done;
+}
+
 /* Private functions ---------------------------------------------------------*/
 
 static uint32_t SpiFrequency(uint32_t hz)
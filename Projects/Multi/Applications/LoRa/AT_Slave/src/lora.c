@@ -64,6 +64,7 @@ Maintainer: Miguel Luis, Gregory Cristian and Wael Guibene
 #include "LoRaMac.h"
 #include "lora.h"
 #include "tiny_sscanf.h"
+#include "energy.h"
 
 static lora_configuration_t lora_config = 
 {
@@ -226,6 +227,24 @@ void TriggerReinit() {
 	DeviceState = DEVICE_STATE_INIT ;
 }
 
+LoRaMacStatus_t lora_region_switch(LoRaMacRegion_t region)
+{
+  LoRaMacStatus_t status;
+
+  if (DeviceState == DEVICE_STATE_INIT)
+  {
+    /* the stack is not started yet, it will start on the new region */
+    return LORAMAC_STATUS_OK;
+  }
+
+  status = LoRaMacSwitchRegion(region);
+  if (status == LORAMAC_STATUS_OK)
+  {
+    lora_config_duty_cycle_set((region == LORAMAC_REGION_EU868) ? ENABLE : DISABLE);
+  }
+  return status;
+}
+
 /*!
  * \brief   Prepares the payload of the frame
  *
@@ -264,10 +283,12 @@ static bool SendFrame( void )
             mcpsReq.Req.Confirmed.Datarate = LoRaParamInit->TxDatarate;
         }
     }
+    Energy_UplinkStart( );
     if( LoRaMacMcpsRequest( &mcpsReq ) == LORAMAC_STATUS_OK )
     {
         return false;
     }
+    Energy_UplinkAbort( );
     return true;
 }
 
@@ -337,6 +358,7 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
                 break;
         }
     }
+    Energy_UplinkEnd( );
     NextTx = true;
 }
 
@@ -62,6 +62,7 @@ Maintainer: Miguel Luis, Gregory Cristian and Wael Guibene
 #include "hw.h"
 #include "low_power.h"
 #include "lora.h"
+#include "energy.h"
 #include "timeServer.h"
 #include "version.h"
 #include "command.h"
@@ -292,6 +293,9 @@ int main(void)
   /* Configure the hardware*/
   HW_Init();
 
+  /* Start the energy accounting */
+  Energy_Init();
+
   /* Configure Debug mode */
   //DBG_Init();
 
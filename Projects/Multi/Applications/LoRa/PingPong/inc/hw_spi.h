@@ -93,6 +93,16 @@ void HW_SPI_DeInit( void );
  */
 uint16_t HW_SPI_InOut( uint16_t outData );
 
+/*!
+ * @brief Sends and receives a block of bytes in a single burst
+ *
+ * @param [IN] txBuffer Bytes to be sent [NULL: sends zeros]
+ * @param [OUT] rxBuffer Received bytes [NULL: discarded]
+ * @param [IN] size Number of bytes to be transferred
+ * @retval false when the transfer was abandoned
+ */
+bool HW_SPI_Transfer( uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size );
+
 
 
 #ifdef __cplusplus
@@ -181,6 +181,22 @@ uint16_t HW_SPI_InOut( uint16_t txData )
   return rxData;
 }
 
+bool HW_SPI_Transfer( uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size )
+{
+  uint16_t i;
+  uint8_t rxData;
+
+  for( i = 0; i < size; i++ )
+  {
+    rxData = HW_SPI_InOut( ( txBuffer != NULL ) ? txBuffer[i] : 0 );
+    if( rxBuffer != NULL )
+    {
+      rxBuffer[i] = rxData;
+    }
+  }
+  return true;
+}
+
 /* Private functions ---------------------------------------------------------*/
 
 static uint32_t SpiFrequency( uint32_t hz )
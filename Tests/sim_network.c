@@ -0,0 +1,1213 @@
+ /******************************************************************************
+  * @file    sim_network.c
+  * @brief   host simulation of LoRaWAN nodes sharing the channels of one
+  *          gateway, each node the LoRaMac layer, the regions and the SX1276
+  *          driver on the emulated radio in a process of its own
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/*
+ * The MAC, the regions and the driver keep their state in file-scope
+ * statics, so every node runs in a process forked from the simulator, with
+ * its own timer stub, emulated radio and network server stand-in. The parent
+ * is the channel and the gateway: it moves the time forward in lockstep,
+ * always to the first timer expiry among the nodes, and only that node runs
+ * until its timers are served. The nodes report the frames they start and
+ * end to send on a socket, so every frame that overlaps an uplink is known
+ * when the uplink ends and the gateway decides whether it got it:
+ *  - the SNR of the uplink must reach the floor of its spreading factor,
+ *    the path loss grows with the distance of the node as in LoRaSim
+ *  - another uplink on the same channel and spreading factor not weaker by
+ *    CAPTURE_THRESHOLD overlapping it destroys it, the spreading factors are
+ *    taken as orthogonal
+ *  - the gateway must not be transmitting, and a demodulator must be free
+ *    when it starts
+ * The node hands the uplinks the gateway got to its network server stand-in,
+ * with the SNR the gateway saw, in the window the gateway has free for the
+ * answer, RX1 first, none when both are taken or the node cannot hear it.
+ * The answers are join accepts, acks and the LinkAdrReq of the stand-in ADR,
+ * they reach the node when sent. The gateway has no duty cycle.
+ *
+ * An interferer near the gateway may destroy a share of the uplinks sent on
+ * LOSSY_FREQUENCY, whatever their strength.
+ *
+ * Every node joins first, adds the five channels a network server gives in
+ * the CFList of its join accept, then sends uplinks at exponentially
+ * distributed intervals, an uplink arriving while the MAC is busy is
+ * dropped. The energy ledger counts the radio states of the driver, the MCU
+ * in stop mode, and measures each uplink from its request to its confirm:
+ * the report gives the charge of the nodes in mAh, the energy of an uplink
+ * and the time the radios spent in each state. Built with
+ * REGION_COMMON_CHANNEL_STATS (sim_network_stats),
+ * the MAC weights the channel selection with the acknowledgements each
+ * channel got, which the confirmed uplinks and a lossy channel bring out.
+ *
+ *   sim_network [-n nodes] [-t hours] [-p period] [-s size] [-c confirmed]
+ *               [-r radius] [-d datarate] [-l loss] [-a] [-x seed] [-q]
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "timer.h"
+#include "LoRaMac.h"
+#include "region/Region.h"
+#include "region/RegionCommon.h"
+#include "radio.h"
+#include "sx1276.h"
+#include "sx1276_emu.h"
+#include "ns_stub.h"
+#include "timer_stub.h"
+#include "energy.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define MAX_NODES                                   1000
+
+/*!
+ * Log-distance path loss of LoRaSim at 868 MHz, the reference loss at the
+ * reference distance [dB, m]
+ */
+#define PATH_LOSS_D0                                40.0
+#define PATH_LOSS_PL0                               127.41
+#define PATH_LOSS_GAMMA                             2.08
+
+/*!
+ * Noise figure of the receivers [dB]
+ */
+#define NOISE_FIGURE                                6.0
+
+/*!
+ * Power advantage an uplink needs over the ones it overlaps [dB]
+ */
+#define CAPTURE_THRESHOLD                           6.0
+
+/*!
+ * Uplinks the gateway demodulates at once
+ */
+#define GATEWAY_DEMODULATORS                        8
+
+/*!
+ * Output power of the gateway [dBm]
+ */
+#define GATEWAY_TX_POWER                            14
+
+/*!
+ * Size of the answers of the stand-in, a join accept or an empty frame with
+ * a LinkAdrReq, to book the gateway [bytes]
+ */
+#define ANSWER_SIZE                                 17
+
+/*!
+ * Receive delays and RX2 channel of the EU868 plan, as the stand-in answers
+ * [ms, Hz]
+ */
+#define JOIN_ACCEPT_DELAY1                          5000
+#define RECEIVE_DELAY1                              1000
+#define RX2_EXTRA_DELAY                             1000
+#define RX2_FREQUENCY                               869525000
+
+/*!
+ * Join trials per join request, the datarate goes down to DR0 on the 48th,
+ * and the wait before a join request after a failed one [ms]
+ */
+#define JOIN_TRIALS                                 48
+#define JOIN_RETRY_DELAY                            10000
+
+/*!
+ * Trials of the confirmed uplinks
+ */
+#define CONFIRMED_TRIALS                            4
+
+/*!
+ * Time the uplinks stay on the books of the gateway after their end [ms]
+ */
+#define AIR_KEEP                                    10000
+
+/*!
+ * Channels the nodes add after the join, the CFList of the usual EU868
+ * network servers [Hz]
+ */
+#define EXTRA_CHANNELS                              5
+#define EXTRA_CHANNEL_FIRST                         867100000
+#define EXTRA_CHANNEL_STEP                          200000
+
+/*!
+ * Channel the interferer of the -l option sits on [Hz]
+ */
+#define LOSSY_FREQUENCY                             867500000
+
+/* Private typedef -----------------------------------------------------------*/
+
+/*!
+ * Messages between the gateway and the nodes
+ */
+typedef enum
+{
+    MSG_ADVANCE,                   //! To the node: run the timers up to Time
+    MSG_IDLE,                      //! To the gateway: timers served, the next one expires at Time
+    MSG_TX_START,                  //! To the gateway: a frame starts at Time
+    MSG_TX_END,                    //! To the gateway: the frame started at Time ends, waits for the verdict
+    MSG_VERDICT,                   //! To the node: the uplink reached the gateway or not
+    MSG_DOWNLINK,                  //! To the gateway: the answer starts at Time, none without Duration
+    MSG_STOP,                      //! To the node: the simulation ends at Time, send the statistics
+}MsgType_t;
+
+typedef struct
+{
+    MsgType_t Type;
+    uint32_t Time;                 //! [ms]
+    bool Pending;                  //! MSG_IDLE: a timer runs
+    uint32_t Duration;             //! [ms]
+    uint32_t Frequency;            //! [Hz]
+    uint8_t Sf;
+    uint8_t Bw;
+    bool Lora;
+    int8_t Power;                  //! Output power [dBm]
+    bool Join;                     //! Join request
+    bool Delivered;                //! MSG_VERDICT
+    int8_t Snr;                    //! MSG_VERDICT: SNR at the gateway [dB]
+    uint8_t Window;                //! MSG_VERDICT: window of the answer, 0 for none
+}Msg_t;
+
+/*!
+ * What a node did, it sends them at the end
+ */
+typedef struct
+{
+    uint32_t JoinRequests;         //! Join requests sent
+    uint32_t JoinTime;             //! Time of the join [ms], UINT32_MAX when it did not join
+    uint32_t Requests;             //! Uplinks the application asked for
+    uint32_t Dropped;              //! Uplinks the MAC refused, busy
+    uint32_t Sent;                 //! Uplinks sent at least once
+    uint32_t Transmissions;        //! Data frames sent, retransmissions included
+    uint32_t Delivered;            //! Uplinks the network server got
+    uint32_t Acked;                //! Confirmed uplinks acknowledged
+    uint32_t Airtime;              //! Time on air, join requests included [ms]
+    uint64_t DutyCycleWait;        //! Sum of the waits from the request to the first transmission [ms]
+    uint8_t Datarate;              //! Datarate at the end
+    uint8_t TxPower;               //! TX power index at the end
+    uint32_t Charge;               //! Charge drawn [uAh]
+    uint32_t Measured;             //! Uplinks measured by the ledger, from the request to the confirm
+    uint64_t UplinkEnergy;         //! Sum of the energy of the uplinks measured [uJ]
+    uint32_t RadioTime[4];         //! Time the radio spent asleep, in standby, receiving and transmitting [ms]
+}NodeStats_t;
+
+/*!
+ * Uplink on the books of the gateway
+ */
+typedef struct
+{
+    uint16_t Node;
+    uint32_t Start;
+    uint32_t End;
+    uint32_t Frequency;
+    uint8_t Sf;
+    uint8_t Bw;
+    bool Lora;
+    double Rssi;
+}AirUplink_t;
+
+/*!
+ * Fates of the uplinks at the gateway
+ */
+typedef enum
+{
+    FATE_DELIVERED,
+    FATE_WEAK,                     //! Below the floor of the spreading factor
+    FATE_GATEWAY_TX,               //! The gateway was transmitting
+    FATE_NO_DEMODULATOR,           //! Every demodulator was busy
+    FATE_COLLISION,                //! Destroyed by another uplink
+    FATE_INTERFERENCE,             //! Destroyed by the interferer of the lossy channel
+    FATE_MAX,
+}Fate_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/*!
+ * Parameters of the run
+ */
+static uint16_t NodeCount = 100;
+static uint32_t Hours = 6;
+static uint32_t Period = 600;
+static uint8_t PayloadSize = 20;
+static uint8_t ConfirmedShare = 0;
+static double Radius = 500;
+static uint8_t Datarate = DR_0;
+static uint8_t LossShare = 0;
+static bool AdrOn = true;
+static uint32_t Seed = 1;
+static bool Quiet = false;
+
+/*!
+ * SNR the spreading factors 7 to 12 demodulate at [dB]
+ */
+static const double SnrFloor[6] = { -7.5, -10, -12.5, -15, -17.5, -20 };
+
+static const char* FateNames[FATE_MAX] = { "delivered", "below sensitivity", "gateway transmitting", "no demodulator", "collision",
+                                           "interference" };
+
+/* Node process --------------------------------------------------------------*/
+
+static int NodeSocket;
+static uint16_t NodeIndex;
+static uint32_t NodeRandomState;
+
+static uint8_t AppKey[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                              0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static uint8_t AppEui[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01 };
+static uint8_t DevEui[8] = { 0x00, 0x80, 0xE1, 0x15, 0x00, 0x00, 0x00, 0x00 };
+
+static LoRaMacPrimitives_t Primitives;
+static LoRaMacCallback_t Callbacks;
+static TimerEvent_t AppTimer;
+static bool Joined = false;
+static bool FirstTxPending = false;
+static uint32_t RequestTime = 0;
+static bool UplinkPending = false;
+static bool DeliveredAny = false;
+static uint32_t DeliveredFCnt = 0;
+static uint8_t Payload[NS_STUB_MAX_PAYLOAD];
+static NodeStats_t Stats;
+
+/* Gateway -------------------------------------------------------------------*/
+
+static int Sockets[MAX_NODES];
+static pid_t Pids[MAX_NODES];
+static double PathLoss[MAX_NODES];
+static double Distance[MAX_NODES];
+static uint32_t NextExpiry[MAX_NODES];
+static bool Pending[MAX_NODES];
+static uint32_t Fates[MAX_NODES][FATE_MAX];
+static uint32_t Downlinks[MAX_NODES];
+static NodeStats_t NodeStats[MAX_NODES];
+static uint32_t GatewayRandomState;
+
+/*!
+ * Data frames sent, and on the lossy channel
+ */
+static uint64_t DataFrames = 0;
+static uint64_t LossyFrames = 0;
+
+static AirUplink_t *Air;
+static uint32_t AirCount = 0;
+static uint32_t AirSize = 0;
+
+/*!
+ * Frames of the gateway, start and end [ms]
+ */
+static uint32_t (*GatewayTx)[2];
+static uint32_t GatewayTxCount = 0;
+static uint32_t GatewayTxSize = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Fail( const char *what )
+{
+    perror( what );
+    exit( 1 );
+}
+
+static void SendMsg( int fd, const void *buffer, size_t size )
+{
+    const uint8_t *data = buffer;
+
+    while( size > 0 )
+    {
+        ssize_t done = write( fd, data, size );
+
+        if( done <= 0 )
+        {
+            Fail( "write" );
+        }
+        data += done;
+        size -= done;
+    }
+}
+
+static void ReceiveMsg( int fd, void *buffer, size_t size )
+{
+    uint8_t *data = buffer;
+
+    while( size > 0 )
+    {
+        ssize_t done = read( fd, data, size );
+
+        if( done <= 0 )
+        {
+            Fail( "read" );
+        }
+        data += done;
+        size -= done;
+    }
+}
+
+/*!
+ * \brief xorshift32 generator of the simulation, apart from the one of the
+ *        MAC
+ */
+static uint32_t Random( uint32_t *state )
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*!
+ * \brief Uniform in [0, 1)
+ */
+static double RandomUniform( uint32_t *state )
+{
+    return ( Random( state ) >> 8 ) / 16777216.0;
+}
+
+/*!
+ * \brief Noise power in the bandwidth of a LoRa RegModemConfig1 index [dBm]
+ */
+static double NoiseFloor( uint8_t bw )
+{
+    return -174 + 10 * log10( ( bw == 9 ) ? 500e3 : ( ( bw == 8 ) ? 250e3 : 125e3 ) ) + NOISE_FIGURE;
+}
+
+/*!
+ * \brief Time on air of an answer of the stand-in [ms]
+ */
+static uint32_t AnswerTimeOnAir( uint8_t sf, uint8_t bw )
+{
+    SX1276EmuFrame_t frame;
+
+    memset( &frame, 0, sizeof( frame ) );
+    frame.Lora = true;
+    frame.Sf = sf;
+    frame.Bw = bw;
+    frame.IqInverted = true;
+    frame.Size = ANSWER_SIZE;
+    return SX1276EmuFrameTimeOnAir( &frame );
+}
+
+/* Node process --------------------------------------------------------------*/
+
+/*!
+ * \brief Schedules the next uplink of the application, exponentially
+ *        distributed intervals
+ */
+static void ScheduleUplink( void )
+{
+    double delay = -log( 1.0 - RandomUniform( &NodeRandomState ) ) * Period * 1000.0;
+
+    TimerSetValue( &AppTimer, ( delay < 1 ) ? 1 : ( uint32_t )delay );
+    TimerStart( &AppTimer );
+}
+
+static void RequestJoin( void )
+{
+    MlmeReq_t mlmeReq;
+
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.DevEui = DevEui;
+    mlmeReq.Req.Join.AppEui = AppEui;
+    mlmeReq.Req.Join.AppKey = AppKey;
+    mlmeReq.Req.Join.NbTrials = JOIN_TRIALS;
+    if( LoRaMacMlmeRequest( &mlmeReq ) != LORAMAC_STATUS_OK )
+    {
+        TimerSetValue( &AppTimer, JOIN_RETRY_DELAY );
+        TimerStart( &AppTimer );
+    }
+}
+
+static void RequestUplink( void )
+{
+    McpsReq_t mcpsReq;
+    bool waiting = FirstTxPending;
+    uint32_t requestTime = RequestTime;
+
+    for( uint8_t i = 0; i < PayloadSize; i++ )
+    {
+        Payload[i] = ( uint8_t )Random( &NodeRandomState );
+    }
+    if( ( Random( &NodeRandomState ) % 100 ) < ConfirmedShare )
+    {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = 2;
+        mcpsReq.Req.Confirmed.fBuffer = Payload;
+        mcpsReq.Req.Confirmed.fBufferSize = PayloadSize;
+        mcpsReq.Req.Confirmed.NbTrials = CONFIRMED_TRIALS;
+        mcpsReq.Req.Confirmed.Datarate = Datarate;
+    }
+    else
+    {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = 2;
+        mcpsReq.Req.Unconfirmed.fBuffer = Payload;
+        mcpsReq.Req.Unconfirmed.fBufferSize = PayloadSize;
+        mcpsReq.Req.Unconfirmed.Datarate = Datarate;
+    }
+    // Without a wait the frame starts within the request, a busy MAC may
+    // still hold the previous one
+    Stats.Requests++;
+    FirstTxPending = true;
+    RequestTime = TimerGetCurrentTime( );
+    // A request the busy MAC refuses must not restart the measure of the
+    // uplink it holds
+    if( UplinkPending == false )
+    {
+        Energy_UplinkStart( );
+    }
+    if( LoRaMacMcpsRequest( &mcpsReq ) != LORAMAC_STATUS_OK )
+    {
+        if( UplinkPending == false )
+        {
+            Energy_UplinkAbort( );
+        }
+        FirstTxPending = waiting;
+        RequestTime = requestTime;
+        Stats.Dropped++;
+        return;
+    }
+    UplinkPending = true;
+}
+
+static void OnAppTimerEvent( void )
+{
+    if( Joined == false )
+    {
+        RequestJoin( );
+        return;
+    }
+    RequestUplink( );
+    ScheduleUplink( );
+}
+
+static void OnMcpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+    if( UplinkPending == true )
+    {
+        UplinkPending = false;
+        Energy_UplinkEnd( );
+        Stats.UplinkEnergy += Energy_GetUplinkEnergy( );
+        Stats.Measured++;
+    }
+    if( ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) && ( mcpsConfirm->AckReceived == true ) )
+    {
+        Stats.Acked++;
+    }
+}
+
+static void OnMcpsIndication( McpsIndication_t *mcpsIndication )
+{
+}
+
+static void OnMlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+    MibRequestConfirm_t mibReq;
+    double delay;
+
+    if( mlmeConfirm->MlmeRequest != MLME_JOIN )
+    {
+        return;
+    }
+    if( mlmeConfirm->Status != LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        delay = JOIN_RETRY_DELAY * ( 1.0 + RandomUniform( &NodeRandomState ) );
+        TimerSetValue( &AppTimer, ( uint32_t )delay );
+        TimerStart( &AppTimer );
+        return;
+    }
+    Joined = true;
+    Stats.JoinTime = TimerGetCurrentTime( );
+    for( uint8_t i = 0; i < EXTRA_CHANNELS; i++ )
+    {
+        ChannelParams_t channel = { EXTRA_CHANNEL_FIRST + i * EXTRA_CHANNEL_STEP, 0, { .Fields = { .Min = DR_0, .Max = DR_5 } }, 0 };
+
+        LoRaMacChannelAdd( 3 + i, channel );
+    }
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = Datarate;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = AdrOn;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    ScheduleUplink( );
+}
+
+static uint8_t GetBatteryLevel( void )
+{
+    return 254;
+}
+
+static void FillTxMsg( Msg_t *msg, MsgType_t type, const SX1276EmuFrame_t *frame )
+{
+    memset( msg, 0, sizeof( *msg ) );
+    msg->Type = type;
+    msg->Time = frame->Start;
+    msg->Duration = frame->Duration;
+    msg->Frequency = frame->Frequency;
+    msg->Sf = frame->Sf;
+    msg->Bw = frame->Bw;
+    msg->Lora = frame->Lora;
+    msg->Power = ( int8_t )frame->Rssi;
+    msg->Join = ( frame->Size > 0 ) && ( ( frame->Payload[0] & 0xE0 ) == 0x00 );
+}
+
+/*!
+ * \brief Tells the gateway a frame starts
+ */
+static void OnTxStart( const SX1276EmuFrame_t *frame )
+{
+    Msg_t msg;
+
+    FillTxMsg( &msg, MSG_TX_START, frame );
+    SendMsg( NodeSocket, &msg, sizeof( msg ) );
+
+    Stats.Airtime += frame->Duration;
+    if( msg.Join == true )
+    {
+        Stats.JoinRequests++;
+        return;
+    }
+    Stats.Transmissions++;
+    if( FirstTxPending == true )
+    {
+        FirstTxPending = false;
+        Stats.Sent++;
+        Stats.DutyCycleWait += frame->Start - RequestTime;
+    }
+}
+
+/*!
+ * \brief Hands the frame to the network server stand-in when the gateway got
+ *        it, tells the gateway the answer the stand-in put on the air
+ */
+static void OnTxEnd( const SX1276EmuFrame_t *frame )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    SX1276EmuFrame_t uplink = *frame;
+    uint32_t uplinks = ns->Uplinks;
+    uint32_t downlinks = ns->Downlinks;
+    Msg_t msg;
+
+    FillTxMsg( &msg, MSG_TX_END, frame );
+    SendMsg( NodeSocket, &msg, sizeof( msg ) );
+    ReceiveMsg( NodeSocket, &msg, sizeof( msg ) );
+
+    if( msg.Delivered == true )
+    {
+        uplink.Snr = msg.Snr;
+        NsStubSetRxWindow( msg.Window );
+        NsStubOnUplink( &uplink );
+        if( ( ns->Uplinks != uplinks ) && ( ( DeliveredAny == false ) || ( ns->FCntUp != DeliveredFCnt ) ) )
+        {
+            DeliveredAny = true;
+            DeliveredFCnt = ns->FCntUp;
+            Stats.Delivered++;
+        }
+    }
+
+    memset( &msg, 0, sizeof( msg ) );
+    msg.Type = MSG_DOWNLINK;
+    if( ns->Downlinks != downlinks )
+    {
+        msg.Time = ns->DownlinkStart;
+        msg.Duration = ns->DownlinkDuration;
+    }
+    SendMsg( NodeSocket, &msg, sizeof( msg ) );
+}
+
+static void NodeStart( void )
+{
+    TimerStubReset( 0 );
+    SX1276EmuReset( );
+    SX1276EmuSetWidebandNoise( 0x9E3779B9 * ( NodeIndex + 1 ) ^ Seed, 50 );
+    SX1276EmuSetTxStartHandler( OnTxStart );
+    SX1276EmuSetTxHandler( OnTxEnd );
+    NsStubInit( NS_STUB_EU868, AppKey );
+    Energy_Init( );
+    Energy_SetMcuState( ENERGY_MCU_STOP );
+    Radio.IoInit( );
+
+    DevEui[6] = ( uint8_t )( NodeIndex >> 8 );
+    DevEui[7] = ( uint8_t )NodeIndex;
+    memset( &Stats, 0, sizeof( Stats ) );
+    Stats.JoinTime = UINT32_MAX;
+
+    Primitives.MacMcpsConfirm = OnMcpsConfirm;
+    Primitives.MacMcpsIndication = OnMcpsIndication;
+    Primitives.MacMlmeConfirm = OnMlmeConfirm;
+    Callbacks.GetBatteryLevel = GetBatteryLevel;
+    if( LoRaMacInitialization( &Primitives, &Callbacks, LORAMAC_REGION_EU868 ) != LORAMAC_STATUS_OK )
+    {
+        fprintf( stderr, "node %u: LoRaMacInitialization failed\n", NodeIndex );
+        _exit( 1 );
+    }
+
+    // The nodes power up within the first minute
+    TimerInit( &AppTimer, OnAppTimerEvent );
+    TimerSetValue( &AppTimer, 1 + Random( &NodeRandomState ) % 60000 );
+    TimerStart( &AppTimer );
+}
+
+/*!
+ * \brief Serves the gateway until it stops the simulation
+ */
+static void NodeRun( void )
+{
+    MibRequestConfirm_t mibReq;
+    Msg_t msg;
+
+    NodeStart( );
+    for( ;; )
+    {
+        TimerTime_t expiry = 0;
+
+        memset( &msg, 0, sizeof( msg ) );
+        msg.Type = MSG_IDLE;
+        msg.Pending = TimerStubGetNextExpiry( &expiry );
+        msg.Time = expiry;
+        SendMsg( NodeSocket, &msg, sizeof( msg ) );
+
+        ReceiveMsg( NodeSocket, &msg, sizeof( msg ) );
+        if( msg.Type == MSG_STOP )
+        {
+            break;
+        }
+        TimerStubAdvance( msg.Time - TimerGetCurrentTime( ) );
+    }
+
+    TimerStubAdvance( msg.Time - TimerGetCurrentTime( ) );
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    Stats.Datarate = mibReq.Param.ChannelsDatarate;
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    Stats.TxPower = mibReq.Param.ChannelsTxPower;
+    Stats.Charge = Energy_GetCharge( );
+    Stats.RadioTime[0] = Energy_GetResidency( ENERGY_RADIO_SLEEP );
+    Stats.RadioTime[1] = Energy_GetResidency( ENERGY_RADIO_STANDBY );
+    Stats.RadioTime[2] = Energy_GetResidency( ENERGY_RADIO_RX );
+    Stats.RadioTime[3] = Energy_GetResidency( ENERGY_RADIO_TX_RFO ) + Energy_GetResidency( ENERGY_RADIO_TX_BOOST ) +
+                         Energy_GetResidency( ENERGY_RADIO_TX_20DBM );
+    SendMsg( NodeSocket, &Stats, sizeof( Stats ) );
+}
+
+/* Gateway -------------------------------------------------------------------*/
+
+static bool Overlap( uint32_t start1, uint32_t end1, uint32_t start2, uint32_t end2 )
+{
+    return ( ( int32_t )( start1 - end2 ) < 0 ) && ( ( int32_t )( start2 - end1 ) < 0 );
+}
+
+/*!
+ * \brief Tells whether the gateway transmits within the interval
+ */
+static bool GatewayTransmits( uint32_t start, uint32_t end )
+{
+    for( uint32_t i = 0; i < GatewayTxCount; i++ )
+    {
+        if( Overlap( start, end, GatewayTx[i][0], GatewayTx[i][1] ) == true )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void GatewayBook( uint32_t start, uint32_t end )
+{
+    if( GatewayTxCount == GatewayTxSize )
+    {
+        GatewayTxSize = ( GatewayTxSize > 0 ) ? 2 * GatewayTxSize : 64;
+        GatewayTx = realloc( GatewayTx, GatewayTxSize * sizeof( *GatewayTx ) );
+        if( GatewayTx == NULL )
+        {
+            Fail( "realloc" );
+        }
+    }
+    GatewayTx[GatewayTxCount][0] = start;
+    GatewayTx[GatewayTxCount][1] = end;
+    GatewayTxCount++;
+}
+
+static void AirAdd( uint16_t node, const Msg_t *msg )
+{
+    AirUplink_t *uplink;
+
+    if( AirCount == AirSize )
+    {
+        AirSize = ( AirSize > 0 ) ? 2 * AirSize : 64;
+        Air = realloc( Air, AirSize * sizeof( *Air ) );
+        if( Air == NULL )
+        {
+            Fail( "realloc" );
+        }
+    }
+    uplink = &Air[AirCount++];
+    uplink->Node = node;
+    uplink->Start = msg->Time;
+    uplink->End = msg->Time + msg->Duration;
+    uplink->Frequency = msg->Frequency;
+    uplink->Sf = msg->Sf;
+    uplink->Bw = msg->Bw;
+    uplink->Lora = msg->Lora;
+    uplink->Rssi = msg->Power - PathLoss[node];
+}
+
+/*!
+ * \brief Forgets the uplinks and the gateway frames over for long
+ */
+static void Prune( uint32_t now )
+{
+    uint32_t kept = 0;
+
+    for( uint32_t i = 0; i < AirCount; i++ )
+    {
+        if( ( int32_t )( now - Air[i].End ) < AIR_KEEP )
+        {
+            Air[kept++] = Air[i];
+        }
+    }
+    AirCount = kept;
+    kept = 0;
+    for( uint32_t i = 0; i < GatewayTxCount; i++ )
+    {
+        if( ( int32_t )( now - GatewayTx[i][1] ) < AIR_KEEP )
+        {
+            GatewayTx[kept][0] = GatewayTx[i][0];
+            GatewayTx[kept][1] = GatewayTx[i][1];
+            kept++;
+        }
+    }
+    GatewayTxCount = kept;
+}
+
+/*!
+ * \brief Decides the fate of the uplink at its end
+ */
+static Fate_t UplinkFate( const AirUplink_t *uplink, double *snr )
+{
+    uint8_t locked = 0;
+
+    *snr = uplink->Rssi - NoiseFloor( uplink->Bw );
+    // FSK frames are taken as heard when the signal is 18 dB over the noise
+    if( ( uplink->Lora == true ) ? ( *snr < SnrFloor[uplink->Sf - 7] ) : ( *snr < 18 ) )
+    {
+        return FATE_WEAK;
+    }
+    if( GatewayTransmits( uplink->Start, uplink->End ) == true )
+    {
+        return FATE_GATEWAY_TX;
+    }
+    for( uint32_t i = 0; i < AirCount; i++ )
+    {
+        const AirUplink_t *other = &Air[i];
+
+        if( other == uplink )
+        {
+            continue;
+        }
+        if( ( ( int32_t )( other->Start - uplink->Start ) < 0 ) && ( ( int32_t )( other->End - uplink->Start ) > 0 ) )
+        {
+            locked++;
+        }
+    }
+    if( locked >= GATEWAY_DEMODULATORS )
+    {
+        return FATE_NO_DEMODULATOR;
+    }
+    for( uint32_t i = 0; i < AirCount; i++ )
+    {
+        const AirUplink_t *other = &Air[i];
+
+        if( ( other != uplink ) && ( other->Frequency == uplink->Frequency ) && ( other->Lora == uplink->Lora ) &&
+            ( ( uplink->Lora == false ) || ( ( other->Sf == uplink->Sf ) && ( other->Bw == uplink->Bw ) ) ) &&
+            ( Overlap( uplink->Start, uplink->End, other->Start, other->End ) == true ) &&
+            ( other->Rssi > uplink->Rssi - CAPTURE_THRESHOLD ) )
+        {
+            return FATE_COLLISION;
+        }
+    }
+    if( ( uplink->Frequency == LOSSY_FREQUENCY ) && ( ( Random( &GatewayRandomState ) % 100 ) < LossShare ) )
+    {
+        return FATE_INTERFERENCE;
+    }
+    return FATE_DELIVERED;
+}
+
+/*!
+ * \brief Picks the window of the answer to an uplink the gateway got, the
+ *        first the gateway has free and the node can hear the gateway in
+ */
+static uint8_t AnswerWindow( uint16_t node, const AirUplink_t *uplink, bool join )
+{
+    uint32_t rx1 = uplink->End + ( ( join == true ) ? JOIN_ACCEPT_DELAY1 : RECEIVE_DELAY1 );
+    uint32_t rx2 = rx1 + RX2_EXTRA_DELAY;
+    double snr1 = GATEWAY_TX_POWER - PathLoss[node] - NoiseFloor( uplink->Bw );
+    double snr2 = GATEWAY_TX_POWER - PathLoss[node] - NoiseFloor( 7 );
+
+    if( ( uplink->Lora == true ) && ( snr1 >= SnrFloor[uplink->Sf - 7] ) &&
+        ( GatewayTransmits( rx1, rx1 + AnswerTimeOnAir( uplink->Sf, uplink->Bw ) ) == false ) )
+    {
+        return 1;
+    }
+    if( ( snr2 >= SnrFloor[12 - 7] ) && ( GatewayTransmits( rx2, rx2 + AnswerTimeOnAir( 12, 7 ) ) == false ) )
+    {
+        return 2;
+    }
+    return 0;
+}
+
+/*!
+ * \brief Serves the messages of the node running its timers until it is idle
+ */
+static void GatewayServe( uint16_t node )
+{
+    Msg_t msg;
+
+    for( ;; )
+    {
+        ReceiveMsg( Sockets[node], &msg, sizeof( msg ) );
+        switch( msg.Type )
+        {
+        case MSG_IDLE:
+            Pending[node] = msg.Pending;
+            NextExpiry[node] = msg.Time;
+            return;
+        case MSG_TX_START:
+            AirAdd( node, &msg );
+            break;
+        case MSG_TX_END:
+        {
+            AirUplink_t *uplink = NULL;
+            bool join = msg.Join;
+            double snr = 0;
+            Fate_t fate;
+
+            for( uint32_t i = 0; i < AirCount; i++ )
+            {
+                if( ( Air[i].Node == node ) && ( Air[i].Start == msg.Time ) )
+                {
+                    uplink = &Air[i];
+                }
+            }
+            if( uplink == NULL )
+            {
+                fprintf( stderr, "node %u: frame ended without a start\n", node );
+                exit( 1 );
+            }
+            fate = UplinkFate( uplink, &snr );
+            Fates[node][fate]++;
+            if( join == false )
+            {
+                DataFrames++;
+                LossyFrames += ( uplink->Frequency == LOSSY_FREQUENCY ) ? 1 : 0;
+            }
+
+            memset( &msg, 0, sizeof( msg ) );
+            msg.Type = MSG_VERDICT;
+            msg.Delivered = ( fate == FATE_DELIVERED );
+            msg.Snr = ( int8_t )( ( snr > 20 ) ? 20 : floor( snr + 0.5 ) );
+            if( msg.Delivered == true )
+            {
+                msg.Window = AnswerWindow( node, uplink, join );
+            }
+            SendMsg( Sockets[node], &msg, sizeof( msg ) );
+
+            ReceiveMsg( Sockets[node], &msg, sizeof( msg ) );
+            if( msg.Duration > 0 )
+            {
+                GatewayBook( msg.Time, msg.Time + msg.Duration );
+                Downlinks[node]++;
+            }
+            break;
+        }
+        default:
+            fprintf( stderr, "node %u: unexpected message %u\n", node, msg.Type );
+            exit( 1 );
+        }
+    }
+}
+
+static void StartNodes( void )
+{
+    uint32_t state = Seed;
+
+    GatewayRandomState = Seed * 0x9E3779B9u;
+    if( GatewayRandomState == 0 )
+    {
+        GatewayRandomState = 1;
+    }
+    fflush( stdout );
+    for( uint16_t i = 0; i < NodeCount; i++ )
+    {
+        int pair[2];
+        double distance = Radius * sqrt( RandomUniform( &state ) );
+
+        if( distance < 1 )
+        {
+            distance = 1;
+        }
+        Distance[i] = distance;
+        PathLoss[i] = PATH_LOSS_PL0 + 10 * PATH_LOSS_GAMMA * log10( distance / PATH_LOSS_D0 );
+
+        if( socketpair( AF_UNIX, SOCK_STREAM, 0, pair ) != 0 )
+        {
+            Fail( "socketpair" );
+        }
+        Pids[i] = fork( );
+        if( Pids[i] < 0 )
+        {
+            Fail( "fork" );
+        }
+        if( Pids[i] == 0 )
+        {
+            for( uint16_t j = 0; j < i; j++ )
+            {
+                close( Sockets[j] );
+            }
+            close( pair[0] );
+            NodeSocket = pair[1];
+            NodeIndex = i;
+            NodeRandomState = ( Seed * 2654435761u ) ^ ( 0x5BD1E995u * ( i + 1 ) );
+            if( NodeRandomState == 0 )
+            {
+                NodeRandomState = 1;
+            }
+            NodeRun( );
+            _exit( 0 );
+        }
+        close( pair[1] );
+        Sockets[i] = pair[0];
+        GatewayServe( i );
+    }
+}
+
+/*!
+ * \brief Moves the time forward in lockstep, the node with the first timer
+ *        runs, up to the end of the simulation
+ */
+static void Run( uint32_t end )
+{
+    for( ;; )
+    {
+        int32_t first = -1;
+        Msg_t msg;
+
+        for( uint16_t i = 0; i < NodeCount; i++ )
+        {
+            if( ( Pending[i] == true ) && ( ( first < 0 ) || ( ( int32_t )( NextExpiry[i] - NextExpiry[first] ) < 0 ) ) )
+            {
+                first = i;
+            }
+        }
+        if( ( first < 0 ) || ( ( int32_t )( NextExpiry[first] - end ) > 0 ) )
+        {
+            break;
+        }
+        Prune( NextExpiry[first] );
+        memset( &msg, 0, sizeof( msg ) );
+        msg.Type = MSG_ADVANCE;
+        msg.Time = NextExpiry[first];
+        SendMsg( Sockets[first], &msg, sizeof( msg ) );
+        GatewayServe( first );
+    }
+
+    for( uint16_t i = 0; i < NodeCount; i++ )
+    {
+        Msg_t msg;
+
+        memset( &msg, 0, sizeof( msg ) );
+        msg.Type = MSG_STOP;
+        msg.Time = end;
+        SendMsg( Sockets[i], &msg, sizeof( msg ) );
+        ReceiveMsg( Sockets[i], &NodeStats[i], sizeof( NodeStats[i] ) );
+        close( Sockets[i] );
+        waitpid( Pids[i], NULL, 0 );
+    }
+}
+
+static void Report( void )
+{
+    uint32_t fates[FATE_MAX] = { 0 };
+    uint32_t datarates[6] = { 0 };
+    uint64_t requests = 0;
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    uint64_t sent = 0;
+    uint64_t transmissions = 0;
+    uint64_t airtime = 0;
+    uint64_t wait = 0;
+    uint64_t charge = 0;
+    uint64_t measured = 0;
+    uint64_t uplinkEnergy = 0;
+    uint64_t radioTime[4] = { 0 };
+    uint64_t downlinks = 0;
+    uint32_t joined = 0;
+
+    if( Quiet == false )
+    {
+        printf( "node  dist[m]  dr pwr  joined[s] requests dropped delivered  ratio  airtime[ms] wait[ms] charge[mAh] uplink[mJ]\n" );
+    }
+    for( uint16_t i = 0; i < NodeCount; i++ )
+    {
+        const NodeStats_t *s = &NodeStats[i];
+
+        for( uint8_t f = 0; f < FATE_MAX; f++ )
+        {
+            fates[f] += Fates[i][f];
+        }
+        if( s->Datarate < 6 )
+        {
+            datarates[s->Datarate]++;
+        }
+        requests += s->Requests;
+        delivered += s->Delivered;
+        dropped += s->Dropped;
+        sent += s->Sent;
+        transmissions += s->Transmissions;
+        airtime += s->Airtime;
+        wait += s->DutyCycleWait;
+        charge += s->Charge;
+        measured += s->Measured;
+        uplinkEnergy += s->UplinkEnergy;
+        for( uint8_t r = 0; r < 4; r++ )
+        {
+            radioTime[r] += s->RadioTime[r];
+        }
+        downlinks += Downlinks[i];
+        joined += ( s->JoinTime != UINT32_MAX ) ? 1 : 0;
+        if( Quiet == false )
+        {
+            printf( "%4u %8.0f %3u %3u %10.1f %8u %7u %9u %6.3f %12u %8.0f %11.3f %10.2f\n", i, Distance[i], s->Datarate, s->TxPower,
+                    ( s->JoinTime != UINT32_MAX ) ? s->JoinTime / 1000.0 : -1.0, s->Requests, s->Dropped, s->Delivered,
+                    ( s->Requests > 0 ) ? ( double )s->Delivered / s->Requests : 0.0, s->Airtime,
+                    ( s->Sent > 0 ) ? ( double )s->DutyCycleWait / s->Sent : 0.0, s->Charge / 1000.0,
+                    ( s->Measured > 0 ) ? s->UplinkEnergy / 1000.0 / s->Measured : 0.0 );
+        }
+    }
+
+    printf( "%u nodes within %.0f m, %u h, an uplink of %u bytes every %u s, %u%% confirmed, ADR %s\n",
+            NodeCount, Radius, Hours, PayloadSize, Period, ConfirmedShare, ( AdrOn == true ) ? "on" : "off" );
+    printf( "channel selection      %s, %u%% lost on %.1f MHz\n",
+            ( REGION_COMMON_CHANNEL_STATS > 0 ) ? "weighted by the acknowledgements" : "uniform",
+            LossShare, LOSSY_FREQUENCY / 1e6 );
+    printf( "joined                 %u of %u\n", joined, NodeCount );
+    printf( "uplinks requested      %llu, dropped busy %llu, sent %llu, frames %llu\n",
+            ( unsigned long long )requests, ( unsigned long long )dropped, ( unsigned long long )sent, ( unsigned long long )transmissions );
+    printf( "delivery ratio         %.4f\n", ( requests > 0 ) ? ( double )delivered / requests : 0.0 );
+    for( uint8_t f = 0; f < FATE_MAX; f++ )
+    {
+        printf( "frames %-22s %u\n", FateNames[f], fates[f] );
+    }
+    printf( "lossy channel frames   %llu of %llu data frames\n",
+            ( unsigned long long )LossyFrames, ( unsigned long long )DataFrames );
+    printf( "downlinks              %llu\n", ( unsigned long long )downlinks );
+    printf( "datarates at the end   DR0 %u, DR1 %u, DR2 %u, DR3 %u, DR4 %u, DR5 %u\n",
+            datarates[0], datarates[1], datarates[2], datarates[3], datarates[4], datarates[5] );
+    printf( "airtime per node       %.0f ms\n", ( double )airtime / NodeCount );
+    printf( "duty cycle wait        %.0f ms per uplink\n", ( sent > 0 ) ? ( double )wait / sent : 0.0 );
+    printf( "charge per node        %.3f mAh, %.2f uAh per uplink delivered\n",
+            charge / 1000.0 / NodeCount, ( delivered > 0 ) ? ( double )charge / delivered : 0.0 );
+    printf( "energy per uplink      %.2f mJ from the request to the confirm, %llu uplinks measured\n",
+            ( measured > 0 ) ? uplinkEnergy / 1000.0 / measured : 0.0, ( unsigned long long )measured );
+    printf( "radio time per node    sleep %.0f s, standby %.1f s, rx %.1f s, tx %.1f s\n",
+            radioTime[0] / 1000.0 / NodeCount, radioTime[1] / 1000.0 / NodeCount,
+            radioTime[2] / 1000.0 / NodeCount, radioTime[3] / 1000.0 / NodeCount );
+}
+
+static void Usage( void )
+{
+    fprintf( stderr, "usage: sim_network [-n nodes] [-t hours] [-p period] [-s size] [-c confirmed]\n"
+                     "                   [-r radius] [-d datarate] [-l loss] [-a] [-x seed] [-q]\n"
+                     "  -n nodes      number of nodes, up to %u [%u]\n"
+                     "  -t hours      simulated time [%u]\n"
+                     "  -p period     mean interval between the uplinks of a node [%u s]\n"
+                     "  -s size       application payload [%u bytes]\n"
+                     "  -c confirmed  share of confirmed uplinks [%u %%]\n"
+                     "  -r radius     nodes placed uniformly within [%.0f m]\n"
+                     "  -d datarate   datarate after the join [DR%u]\n"
+                     "  -l loss       share of the uplinks on %.1f MHz an interferer destroys [%u %%]\n"
+                     "  -a            ADR off\n"
+                     "  -x seed       seed of the placement and the traffic [%u]\n"
+                     "  -q            totals only\n",
+             MAX_NODES, NodeCount, Hours, Period, PayloadSize, ConfirmedShare, Radius, Datarate,
+             LOSSY_FREQUENCY / 1e6, LossShare, Seed );
+    exit( 2 );
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main( int argc, char **argv )
+{
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:t:p:s:c:r:d:l:ax:q" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            NodeCount = atoi( optarg );
+            break;
+        case 't':
+            Hours = atoi( optarg );
+            break;
+        case 'p':
+            Period = atoi( optarg );
+            break;
+        case 's':
+            PayloadSize = atoi( optarg );
+            break;
+        case 'c':
+            ConfirmedShare = atoi( optarg );
+            break;
+        case 'r':
+            Radius = atof( optarg );
+            break;
+        case 'd':
+            Datarate = atoi( optarg );
+            break;
+        case 'l':
+            LossShare = atoi( optarg );
+            break;
+        case 'a':
+            AdrOn = false;
+            break;
+        case 'x':
+            Seed = strtoul( optarg, NULL, 0 );
+            break;
+        case 'q':
+            Quiet = true;
+            break;
+        default:
+            Usage( );
+        }
+    }
+    if( ( NodeCount == 0 ) || ( NodeCount > MAX_NODES ) || ( Hours == 0 ) || ( Hours > 24 * 30 ) || ( Period == 0 ) ||
+        ( PayloadSize > 51 ) || ( ConfirmedShare > 100 ) || ( Radius <= 0 ) || ( Datarate > DR_5 ) || ( LossShare > 100 ) ||
+        ( Seed == 0 ) )
+    {
+        Usage( );
+    }
+
+    StartNodes( );
+    Run( Hours * 3600 * 1000 );
+    Report( );
+    return 0;
+}
@@ -0,0 +1,31 @@
+ /******************************************************************************
+  * @file    debug.h
+  * @brief   host build of the LoRa middleware, traces are dropped
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Exported macros -----------------------------------------------------------*/
+#define DBG_PRINTF(...)
+#define PRINTF(...)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DEBUG_H__ */
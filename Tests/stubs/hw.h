@@ -0,0 +1,117 @@
+ /******************************************************************************
+  * @file    hw.h
+  * @brief   host stand-in of the hardware layer used by the radio driver and
+  *          the timer server, the SPI bus and the GPIOs lead to the SX1276
+  *          emulator, the RTC to the RTC stub, or to the timer stub for the
+  *          energy ledger
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HW_H__
+#define __HW_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "hw_conf.h"
+#include "utilities.h"
+#include "debug.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/*!
+ * GPIO port, only its address is used
+ */
+typedef struct sGpioPort
+{
+    uint32_t Id;
+}GPIO_TypeDef;
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+}GPIO_InitTypeDef;
+
+typedef enum
+{
+    e_LOW_POWER_RTC = ( 1 << 0 ),
+    e_LOW_POWER_GPS = ( 1 << 1 ),
+    e_LOW_POWER_UART = ( 1 << 2 ),
+}e_LOW_POWER_State_Id_t;
+
+/* Exported constants --------------------------------------------------------*/
+
+#define RESET                                       0
+#define SET                                         1
+
+#define GPIO_MODE_INPUT                             0x00
+#define GPIO_MODE_OUTPUT_PP                         0x01
+#define GPIO_NOPULL                                 0x00
+#define GPIO_PULLUP                                 0x01
+#define GPIO_PULLDOWN                               0x02
+#define GPIO_SPEED_HIGH                             0x03
+
+extern GPIO_TypeDef HwStubGpioA;
+extern GPIO_TypeDef HwStubGpioC;
+
+#define RADIO_RESET_PORT                            ( &HwStubGpioC )
+#define RADIO_RESET_PIN                             0x0001
+#define RADIO_NSS_PORT                              ( &HwStubGpioA )
+#define RADIO_NSS_PIN                               0x8000
+
+/* Exported functions ------------------------------------------------------- */
+
+void HW_GPIO_Init( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_InitTypeDef *initStruct );
+
+void HW_GPIO_Write( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, uint32_t value );
+
+uint32_t HW_GPIO_Read( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin );
+
+uint16_t HW_SPI_InOut( uint16_t txData );
+
+bool HW_SPI_Transfer( uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size );
+
+void HW_RTC_StopAlarm( void );
+
+uint32_t HW_RTC_GetMinimumTimeout( void );
+
+void HW_RTC_SetAlarm( uint32_t timeout );
+
+uint32_t HW_RTC_GetTimerElapsedTime( void );
+
+uint32_t HW_RTC_GetTimerValue( void );
+
+uint32_t HW_RTC_SetTimerContext( void );
+
+uint32_t HW_RTC_GetTimerContext( void );
+
+void HW_RTC_DelayMs( uint32_t delay );
+
+uint32_t HW_RTC_ms2Tick( uint32_t timeMicroSec );
+
+uint32_t HW_RTC_Tick2ms( uint32_t tick );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HW_H__ */
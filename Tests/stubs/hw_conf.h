@@ -0,0 +1,50 @@
+ /******************************************************************************
+  * @file    hw_conf.h
+  * @brief   host build configuration of the LoRa middleware
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HW_CONF_H__
+#define __HW_CONF_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported macros -----------------------------------------------------------*/
+
+/*!
+ * The CMSIS definitions used by the middleware headers, the application
+ * hw_conf.h pulls them from the MCU headers
+ */
+#define __STATIC_INLINE                  static inline
+#define __CLZ( value )                   ( ( uint8_t )( ( value ) ? __builtin_clz( value ) : 32 ) )
+
+/*!
+ * Interrupt masking of the critical sections, the host tests run on a single
+ * thread and the emulated radio interrupts are called from the timer stub
+ */
+#define __get_IPSR( )                    ( ( uint32_t )0 )
+#define __get_PRIMASK( )                 ( ( uint32_t )0 )
+#define __set_PRIMASK( mask )            ( ( void )( mask ) )
+#define __disable_irq( )                 ( ( void )0 )
+#define __enable_irq( )                  ( ( void )0 )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HW_CONF_H__ */
@@ -0,0 +1,516 @@
+ /******************************************************************************
+  * @file    ns_stub.c
+  * @brief   host stand-in of a LoRaWAN network server, it serves the frames
+  *          the emulated radio sends and puts its answers on the air
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/*
+ * The stand-in knows a single device, by its AppKey. It checks the MIC of the
+ * frames and decrypts them with the LoRaMac crypto functions, and encrypts
+ * the join accept with the AES decryption, built in for the host tests with
+ * AES_DEC_PREKEYED. The answers start the receive delay after the end of the
+ * uplink, on the channel and datarate of the chosen window, with the RX1
+ * datarate offset 0.
+ *
+ * On the EU868 plan the stand-in runs the ADR of the uplinks with the ADR bit
+ * set: the best SNR of the last ADR_HISTORY uplinks at the same datarate and
+ * power, less the SNR the datarate demodulates at and ADR_MARGIN, buys a
+ * datarate step up to DR5, then a power step down, every ADR_STEP dB, a
+ * negative margin buys the power steps back. A LinkAdrReq goes with the next
+ * answer whenever the result differs from what the device uses, until a
+ * LinkAdrAns accepts it.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "aes.h"
+#include "LoRaMacCrypto.h"
+#include "ns_stub.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define MTYPE_JOIN_REQUEST                          0x00
+#define MTYPE_JOIN_ACCEPT                           0x20
+#define MTYPE_UNCONFIRMED_UP                        0x40
+#define MTYPE_UNCONFIRMED_DOWN                      0x60
+#define MTYPE_CONFIRMED_UP                          0x80
+#define MTYPE_CONFIRMED_DOWN                        0xA0
+#define MTYPE_MASK                                  0xE0
+
+#define FCTRL_ADR                                   0x80
+#define FCTRL_ADR_ACK_REQ                           0x40
+#define FCTRL_ACK                                   0x20
+#define FCTRL_FOPTS_LEN_MASK                        0x0F
+
+#define CID_LINK_ADR                                0x03
+#define LINK_ADR_ANS_OK                             0x07
+
+#define UP_LINK                                     0
+#define DOWN_LINK                                   1
+
+#define JOIN_REQUEST_SIZE                           23
+#define MIC_SIZE                                    4
+
+/*!
+ * Receive delays of the LoRaWAN regional parameters, the join accept sets
+ * RxDelay to 1 s [ms]
+ */
+#define JOIN_ACCEPT_DELAY1                          5000
+#define RECEIVE_DELAY1                              1000
+#define RX2_EXTRA_DELAY                             1000
+
+#define NET_ID                                      0x000013
+#define DEV_ADDR_BASE                               0x26011000
+
+/*!
+ * ADR of the EU868 plan, the margins in dB
+ */
+#define ADR_HISTORY                                 10
+#define ADR_MARGIN                                  10
+#define ADR_STEP                                    3
+#define ADR_MAX_DATARATE                            5
+#define ADR_MAX_TX_POWER                            7
+
+/*!
+ * Channels 0 to 2 enabled, one transmission per uplink
+ */
+#define ADR_CH_MASK                                 0x0007
+#define ADR_REDUNDANCY                              0x01
+
+/* Private variables ---------------------------------------------------------*/
+
+static NsStubPlan_t Plan;
+static uint8_t AppKey[16];
+static uint8_t NwkSKey[16];
+static uint8_t AppSKey[16];
+static uint32_t AppNonce = 0;
+static uint32_t FCntDown = 0;
+static uint8_t RxWindow = 1;
+
+/*!
+ * DevNonces used, one bit each
+ */
+static uint8_t DevNonces[65536 / 8];
+
+/*!
+ * Downlink queued
+ */
+static bool DownlinkPending = false;
+static bool DownlinkConfirmed = false;
+static uint8_t DownlinkPort = 0;
+static uint8_t DownlinkSize = 0;
+static uint8_t DownlinkPayload[NS_STUB_MAX_PAYLOAD];
+
+/*!
+ * SNR the datarates DR0 to DR5 of the EU868 plan demodulate at [0.1 dB]
+ */
+static const int16_t AdrRequiredSnr[ADR_MAX_DATARATE + 1] = { -200, -175, -150, -125, -100, -75 };
+
+/*!
+ * SNRs of the last uplinks at the datarate and the power the device uses,
+ * the power it accepted last and the one asked for
+ */
+static int8_t AdrSnr[ADR_HISTORY];
+static uint8_t AdrCount = 0;
+static uint8_t AdrDatarate = 0;
+static uint8_t AdrTxPower = 0;
+static uint8_t AdrRequestedTxPower = 0;
+
+static NsStubStatus_t Status;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t ReadLe( const uint8_t *buffer, uint8_t size )
+{
+    uint32_t value = 0;
+
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        value |= ( uint32_t )buffer[i] << ( 8 * i );
+    }
+    return value;
+}
+
+static void WriteLe( uint8_t *buffer, uint32_t value, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        buffer[i] = ( uint8_t )( value >> ( 8 * i ) );
+    }
+}
+
+/*!
+ * \brief Returns the size of the answer of an uplink MAC command, after its
+ *        CID, -1 for an unknown command
+ */
+static int8_t MacAnswerSize( uint8_t cid )
+{
+    switch( cid )
+    {
+    case 0x02: // LinkCheckReq
+    case 0x04: // DutyCycleAns
+    case 0x08: // RxTimingSetupAns
+    case 0x09: // TxParamSetupAns
+        return 0;
+    case 0x03: // LinkAdrAns
+    case 0x05: // RxParamSetupAns
+    case 0x07: // NewChannelAns
+    case 0x0A: // DlChannelAns
+        return 1;
+    case 0x06: // DevStatusAns
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+/*!
+ * \brief Runs the ADR on an uplink with the ADR bit set
+ *
+ * \param [IN] frame Uplink
+ * \param [IN] fOpts MAC commands of the uplink
+ * \param [IN] fOptsLen Size of the MAC commands
+ * \param [OUT] linkAdrReq LinkAdrReq to send, CID included
+ * \retval true when the LinkAdrReq is to be sent
+ */
+static bool RunAdr( const SX1276EmuFrame_t *frame, const uint8_t *fOpts, uint8_t fOptsLen, uint8_t *linkAdrReq )
+{
+    uint8_t datarate;
+    uint8_t txPower;
+    bool accepted = false;
+    int8_t snrMax;
+    int16_t steps;
+
+    if( ( Plan != NS_STUB_EU868 ) || ( frame->Lora == false ) || ( frame->Bw != 7 ) || ( frame->Sf < 7 ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < fOptsLen; )
+    {
+        int8_t size = MacAnswerSize( fOpts[i] );
+
+        if( size < 0 )
+        {
+            break;
+        }
+        if( ( fOpts[i] == CID_LINK_ADR ) && ( ( fOpts[i + 1] & LINK_ADR_ANS_OK ) == LINK_ADR_ANS_OK ) )
+        {
+            accepted = ( AdrTxPower != AdrRequestedTxPower );
+            AdrTxPower = AdrRequestedTxPower;
+            Status.TxPower = AdrTxPower;
+        }
+        i += 1 + size;
+    }
+
+    // The history restarts with the datarate or the power
+    datarate = 12 - frame->Sf;
+    if( ( datarate != AdrDatarate ) || ( accepted == true ) )
+    {
+        AdrDatarate = datarate;
+        AdrCount = 0;
+    }
+    AdrSnr[AdrCount % ADR_HISTORY] = frame->Snr;
+    AdrCount++;
+    if( AdrCount < ADR_HISTORY )
+    {
+        return false;
+    }
+
+    snrMax = AdrSnr[0];
+    for( uint8_t i = 1; i < ADR_HISTORY; i++ )
+    {
+        if( AdrSnr[i] > snrMax )
+        {
+            snrMax = AdrSnr[i];
+        }
+    }
+    steps = ( snrMax * 10 - AdrRequiredSnr[datarate] - ADR_MARGIN * 10 );
+    steps = ( steps >= 0 ) ? steps / ( ADR_STEP * 10 ) : -( ( -steps + ADR_STEP * 10 - 1 ) / ( ADR_STEP * 10 ) );
+    txPower = AdrTxPower;
+    while( ( steps > 0 ) && ( datarate < ADR_MAX_DATARATE ) )
+    {
+        datarate++;
+        steps--;
+    }
+    while( ( steps > 0 ) && ( txPower < ADR_MAX_TX_POWER ) )
+    {
+        txPower++;
+        steps--;
+    }
+    while( ( steps < 0 ) && ( txPower > 0 ) )
+    {
+        txPower--;
+        steps++;
+    }
+    if( ( datarate == AdrDatarate ) && ( txPower == AdrTxPower ) )
+    {
+        return false;
+    }
+
+    AdrRequestedTxPower = txPower;
+    linkAdrReq[0] = CID_LINK_ADR;
+    linkAdrReq[1] = ( datarate << 4 ) | txPower;
+    WriteLe( linkAdrReq + 2, ADR_CH_MASK, 2 );
+    linkAdrReq[4] = ADR_REDUNDANCY;
+    Status.LinkAdrReqs++;
+    return true;
+}
+
+/*!
+ * \brief Puts an answer to the uplink on the air, in the window set
+ */
+static void Answer( const SX1276EmuFrame_t *uplink, const uint8_t *payload, uint8_t size, uint32_t delay1 )
+{
+    SX1276EmuFrame_t frame;
+
+    if( RxWindow == 0 )
+    {
+        return;
+    }
+    memset( &frame, 0, sizeof( frame ) );
+    frame.Start = uplink->Start + uplink->Duration + delay1 + ( ( RxWindow == 2 ) ? RX2_EXTRA_DELAY : 0 );
+    frame.Lora = true;
+    frame.IqInverted = true;
+    frame.Rssi = NS_STUB_RSSI;
+    frame.Snr = NS_STUB_SNR;
+    frame.Size = size;
+    memcpy( frame.Payload, payload, size );
+
+    if( RxWindow == 2 )
+    {
+        frame.Sf = 12;
+        frame.Bw = ( Plan == NS_STUB_US915 ) ? 9 : 7;
+        frame.Frequency = ( Plan == NS_STUB_US915 ) ? 923300000 : 869525000;
+    }
+    else if( Plan == NS_STUB_US915 )
+    {
+        // 125 kHz channels 0 to 63, 500 kHz channels 64 to 71, the carrier
+        // is within a synthesizer step of the channel
+        uint8_t channel = ( uplink->Bw == 7 ) ? ( uplink->Frequency - 902300000 + 100000 ) / 200000 :
+                                                64 + ( uplink->Frequency - 903000000 + 800000 ) / 1600000;
+
+        frame.Frequency = 923300000 + ( channel % 8 ) * 600000;
+        frame.Bw = 9;
+        frame.Sf = ( uplink->Bw == 7 ) ? uplink->Sf : 7;
+    }
+    else
+    {
+        frame.Frequency = uplink->Frequency;
+        frame.Lora = uplink->Lora;
+        frame.Sf = uplink->Sf;
+        frame.Bw = uplink->Bw;
+        frame.Bitrate = uplink->Bitrate;
+    }
+    frame.Duration = SX1276EmuFrameTimeOnAir( &frame );
+    SX1276EmuPutOnAir( &frame );
+    Status.Downlinks++;
+    Status.DownlinkStart = frame.Start;
+    Status.DownlinkDuration = frame.Duration;
+}
+
+static void OnJoinRequest( const SX1276EmuFrame_t *frame )
+{
+    uint8_t accept[17];
+    uint8_t encrypted[17];
+    aes_context aes;
+    uint16_t devNonce;
+    uint32_t mic;
+
+    if( frame->Size != JOIN_REQUEST_SIZE )
+    {
+        return;
+    }
+    LoRaMacJoinComputeMic( frame->Payload, JOIN_REQUEST_SIZE - MIC_SIZE, AppKey, &mic );
+    if( mic != ReadLe( frame->Payload + JOIN_REQUEST_SIZE - MIC_SIZE, MIC_SIZE ) )
+    {
+        Status.MicErrors++;
+        return;
+    }
+    devNonce = ( uint16_t )ReadLe( frame->Payload + 17, 2 );
+    if( ( DevNonces[devNonce / 8] & ( 1 << ( devNonce % 8 ) ) ) != 0 )
+    {
+        Status.DevNonceReuses++;
+        return;
+    }
+    DevNonces[devNonce / 8] |= 1 << ( devNonce % 8 );
+
+    AppNonce++;
+    Status.JoinRequests++;
+    Status.DevAddr = DEV_ADDR_BASE + Status.JoinRequests;
+    Status.FCntUp = 0;
+    FCntDown = 0;
+    Status.TxPower = 0;
+    AdrCount = 0;
+    AdrTxPower = 0;
+    AdrRequestedTxPower = 0;
+
+    accept[0] = MTYPE_JOIN_ACCEPT;
+    WriteLe( accept + 1, AppNonce, 3 );
+    WriteLe( accept + 4, NET_ID, 3 );
+    WriteLe( accept + 7, Status.DevAddr, 4 );
+    // RX1 datarate offset 0, RX2 datarate of the plan, RxDelay 1 s
+    accept[11] = ( Plan == NS_STUB_US915 ) ? 8 : 0;
+    accept[12] = 1;
+    LoRaMacJoinComputeMic( accept, 13, AppKey, &mic );
+    WriteLe( accept + 13, mic, MIC_SIZE );
+
+    LoRaMacJoinComputeSKeys( AppKey, accept + 1, devNonce, NwkSKey, AppSKey );
+
+    // The device decrypts the join accept with the AES encryption
+    memset( &aes, 0, sizeof( aes ) );
+    aes_set_key( AppKey, 16, &aes );
+    encrypted[0] = accept[0];
+    aes_decrypt( accept + 1, encrypted + 1, &aes );
+
+    Answer( frame, encrypted, sizeof( encrypted ), JOIN_ACCEPT_DELAY1 );
+}
+
+static void OnDataUplink( const SX1276EmuFrame_t *frame )
+{
+    uint8_t down[1 + 4 + 1 + 2 + 5 + 1 + NS_STUB_MAX_PAYLOAD + MIC_SIZE];
+    uint8_t linkAdrReq[5];
+    bool adr = false;
+    uint8_t fOptsLen;
+    uint8_t index;
+    uint16_t fCnt16;
+    uint32_t fCnt;
+    uint32_t mic;
+    bool confirmed = ( frame->Payload[0] & MTYPE_MASK ) == MTYPE_CONFIRMED_UP;
+
+    if( ( frame->Size < 1 + 4 + 1 + 2 + MIC_SIZE ) || ( ReadLe( frame->Payload + 1, 4 ) != Status.DevAddr ) )
+    {
+        return;
+    }
+    fOptsLen = frame->Payload[5] & FCTRL_FOPTS_LEN_MASK;
+    fCnt16 = ( uint16_t )ReadLe( frame->Payload + 6, 2 );
+    fCnt = ( Status.FCntUp & 0xFFFF0000 ) | fCnt16;
+    if( ( Status.Uplinks > 0 ) && ( fCnt < Status.FCntUp ) )
+    {
+        fCnt += 0x10000;
+    }
+    LoRaMacComputeMic( frame->Payload, frame->Size - MIC_SIZE, NwkSKey, Status.DevAddr, UP_LINK, fCnt, &mic );
+    if( mic != ReadLe( frame->Payload + frame->Size - MIC_SIZE, MIC_SIZE ) )
+    {
+        Status.MicErrors++;
+        return;
+    }
+
+    Status.Uplinks++;
+    Status.FCntUp = fCnt;
+    Status.Lora = frame->Lora;
+    Status.Confirmed = confirmed;
+    Status.Ack = ( frame->Payload[5] & FCTRL_ACK ) != 0;
+    Status.Port = 0;
+    Status.Size = 0;
+    if( ( frame->Payload[5] & FCTRL_ADR ) != 0 )
+    {
+        adr = RunAdr( frame, frame->Payload + 8, fOptsLen, linkAdrReq );
+    }
+    index = 8 + fOptsLen;
+    if( index < frame->Size - MIC_SIZE )
+    {
+        Status.Port = frame->Payload[index++];
+        Status.Size = frame->Size - MIC_SIZE - index;
+        LoRaMacPayloadDecrypt( frame->Payload + index, Status.Size, ( Status.Port == 0 ) ? NwkSKey : AppSKey,
+                               Status.DevAddr, UP_LINK, fCnt, Status.Payload );
+    }
+
+    if( ( confirmed == false ) && ( DownlinkPending == false ) && ( adr == false ) &&
+        ( ( frame->Payload[5] & FCTRL_ADR_ACK_REQ ) == 0 ) )
+    {
+        return;
+    }
+
+    down[0] = ( ( DownlinkPending == true ) && ( DownlinkConfirmed == true ) ) ? MTYPE_CONFIRMED_DOWN : MTYPE_UNCONFIRMED_DOWN;
+    WriteLe( down + 1, Status.DevAddr, 4 );
+    down[5] = ( confirmed == true ) ? FCTRL_ACK : 0;
+    WriteLe( down + 6, FCntDown, 2 );
+    index = 8;
+    if( adr == true )
+    {
+        down[5] |= sizeof( linkAdrReq );
+        memcpy( down + index, linkAdrReq, sizeof( linkAdrReq ) );
+        index += sizeof( linkAdrReq );
+    }
+    if( DownlinkPending == true )
+    {
+        down[index++] = DownlinkPort;
+        LoRaMacPayloadEncrypt( DownlinkPayload, DownlinkSize, AppSKey, Status.DevAddr, DOWN_LINK, FCntDown, down + index );
+        index += DownlinkSize;
+        DownlinkPending = false;
+    }
+    LoRaMacComputeMic( down, index, NwkSKey, Status.DevAddr, DOWN_LINK, FCntDown, &mic );
+    WriteLe( down + index, mic, MIC_SIZE );
+    index += MIC_SIZE;
+    FCntDown++;
+
+    Answer( frame, down, index, RECEIVE_DELAY1 );
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void NsStubInit( NsStubPlan_t plan, const uint8_t *appKey )
+{
+    Plan = plan;
+    memcpy( AppKey, appKey, sizeof( AppKey ) );
+    memset( DevNonces, 0, sizeof( DevNonces ) );
+    memset( &Status, 0, sizeof( Status ) );
+    DownlinkPending = false;
+    RxWindow = 1;
+    AppNonce = 0;
+    FCntDown = 0;
+    AdrCount = 0;
+    AdrDatarate = 0;
+    AdrTxPower = 0;
+    AdrRequestedTxPower = 0;
+}
+
+void NsStubOnUplink( const SX1276EmuFrame_t *frame )
+{
+    if( ( frame->Size == 0 ) || ( frame->IqInverted == true ) )
+    {
+        return;
+    }
+    switch( frame->Payload[0] & MTYPE_MASK )
+    {
+    case MTYPE_JOIN_REQUEST:
+        OnJoinRequest( frame );
+        break;
+    case MTYPE_UNCONFIRMED_UP:
+    case MTYPE_CONFIRMED_UP:
+        OnDataUplink( frame );
+        break;
+    default:
+        break;
+    }
+}
+
+void NsStubQueueDownlink( uint8_t port, const uint8_t *payload, uint8_t size, bool confirmed )
+{
+    DownlinkPending = true;
+    DownlinkConfirmed = confirmed;
+    DownlinkPort = port;
+    DownlinkSize = ( size < NS_STUB_MAX_PAYLOAD ) ? size : NS_STUB_MAX_PAYLOAD;
+    memcpy( DownlinkPayload, payload, DownlinkSize );
+}
+
+void NsStubSetRxWindow( uint8_t window )
+{
+    RxWindow = window;
+}
+
+const NsStubStatus_t* NsStubGetStatus( void )
+{
+    return &Status;
+}
@@ -0,0 +1,123 @@
+ /******************************************************************************
+  * @file    ns_stub.h
+  * @brief   host stand-in of a LoRaWAN network server, it serves the frames
+  *          the emulated radio sends and puts its answers on the air
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NS_STUB_H__
+#define __NS_STUB_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "sx1276_emu.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+/*!
+ * Largest application payload the stand-in handles [bytes]
+ */
+#define NS_STUB_MAX_PAYLOAD                         242
+
+/*!
+ * Signal strength and signal to noise ratio of the frames the stand-in puts
+ * on the air
+ */
+#define NS_STUB_RSSI                                -80
+#define NS_STUB_SNR                                 8
+
+/* Exported types ------------------------------------------------------------*/
+
+/*!
+ * Channel plans the stand-in answers on
+ */
+typedef enum
+{
+    NS_STUB_EU868,                 //! RX1 on the uplink channel and datarate, RX2 on 869.525 MHz SF12
+    NS_STUB_US915,                 //! RX1 on the 500 kHz downlink channels, RX2 on 923.3 MHz SF12
+}NsStubPlan_t;
+
+/*!
+ * What the stand-in has seen and done
+ */
+typedef struct
+{
+    uint32_t JoinRequests;         //! Join requests accepted
+    uint32_t DevNonceReuses;       //! Join requests with a DevNonce already used, rejected
+    uint32_t Uplinks;              //! Data frames accepted
+    uint32_t MicErrors;            //! Frames dropped on their MIC
+    uint32_t Downlinks;            //! Frames put on the air
+    uint32_t DownlinkStart;        //! Start of the last frame put on the air [ms]
+    uint32_t DownlinkDuration;     //! Time on air of the last frame put on the air [ms]
+    uint32_t LinkAdrReqs;          //! LinkAdrReq commands sent
+    uint8_t TxPower;               //! TX power index the device accepted last
+    uint32_t DevAddr;              //! Device address given by the last join accept
+    uint32_t FCntUp;               //! Counter of the last data frame
+    bool Lora;                     //! Modulation of the last data frame
+    bool Confirmed;                //! Last data frame confirmed
+    bool Ack;                      //! ACK bit of the last data frame
+    uint8_t Port;                  //! Port of the last data frame, 0 without payload
+    uint8_t Size;                  //! Payload size of the last data frame
+    uint8_t Payload[NS_STUB_MAX_PAYLOAD]; //! Payload of the last data frame, decrypted
+}NsStubStatus_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/*!
+ * \brief Forgets the device and the DevNonces used, answers in RX1
+ *
+ * \param [IN] plan Channel plan
+ * \param [IN] appKey Application key of the device
+ */
+void NsStubInit( NsStubPlan_t plan, const uint8_t *appKey );
+
+/*!
+ * \brief Serves a frame sent by the device, a join request with a join
+ *        accept, a confirmed data frame, one with a downlink queued, one with
+ *        the ADR ACK request bit set or one the ADR of the EU868 plan
+ *        answers with a LinkAdrReq, with a downlink. The emulator takes it
+ *        as its Tx handler.
+ */
+void NsStubOnUplink( const SX1276EmuFrame_t *frame );
+
+/*!
+ * \brief Queues the payload of the next downlink
+ *
+ * \param [IN] port Port, 1 to 223
+ * \param [IN] payload Payload
+ * \param [IN] size Payload size
+ * \param [IN] confirmed The device acknowledges it on its next uplink
+ */
+void NsStubQueueDownlink( uint8_t port, const uint8_t *payload, uint8_t size, bool confirmed );
+
+/*!
+ * \brief Sets the reception window the answers are sent in
+ *
+ * \param [IN] window 1 or 2, 0 not to answer
+ */
+void NsStubSetRxWindow( uint8_t window );
+
+/*!
+ * \brief Returns what the stand-in has seen and done
+ */
+const NsStubStatus_t* NsStubGetStatus( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NS_STUB_H__ */
@@ -0,0 +1,205 @@
+ /******************************************************************************
+  * @file    radio_stub.c
+  * @brief   host stand-in of the radio driver for the region layer tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "utilities.h"
+#include "radio_stub.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/*!
+ * Frequency range of the SX1276 synthesizer, in Hz
+ */
+#define RADIO_STUB_MIN_FREQUENCY                    137000000
+#define RADIO_STUB_MAX_FREQUENCY                    1020000000
+
+/* Private functions ---------------------------------------------------------*/
+
+static void RadioStubIoInit( void )
+{
+}
+
+static uint32_t RadioStubInit( RadioEvents_t *events )
+{
+    return 0;
+}
+
+static RadioState_t RadioStubGetStatus( void )
+{
+    return RadioStub.Status;
+}
+
+static void RadioStubSetModem( RadioModems_t modem )
+{
+}
+
+static void RadioStubSetChannel( uint32_t freq )
+{
+    RadioStub.Frequency = freq;
+}
+
+static bool RadioStubIsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime )
+{
+    RadioStub.ChannelFreeCalls++;
+    return RadioStub.ChannelFree;
+}
+
+static void RadioStubStartCarrierSense( RadioModems_t modem, uint32_t freq )
+{
+    RadioStub.CarrierSenseCalls++;
+    RadioStub.Frequency = freq;
+}
+
+static uint32_t RadioStubRandom( void )
+{
+    return ( uint32_t )randr( 0, 0x7FFFFFFF );
+}
+
+static void RadioStubSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
+                                  uint32_t datarate, uint8_t coderate,
+                                  uint32_t bandwidthAfc, uint16_t preambleLen,
+                                  uint16_t symbTimeout, bool fixLen,
+                                  uint8_t payloadLen,
+                                  bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                  bool iqInverted, bool rxContinuous )
+{
+    RadioStub.RxModem = modem;
+    RadioStub.RxBandwidth = bandwidth;
+    RadioStub.RxDatarate = datarate;
+    RadioStub.RxSymbTimeout = symbTimeout;
+    RadioStub.RxContinuous = rxContinuous;
+}
+
+static void RadioStubSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
+                                  uint32_t bandwidth, uint32_t datarate,
+                                  uint8_t coderate, uint16_t preambleLen,
+                                  bool fixLen, bool crcOn, bool freqHopOn,
+                                  uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+    RadioStub.TxModem = modem;
+    RadioStub.TxPower = power;
+    RadioStub.TxBandwidth = bandwidth;
+    RadioStub.TxDatarate = datarate;
+}
+
+static bool RadioStubCheckRfFrequency( uint32_t frequency )
+{
+    return ( frequency >= RADIO_STUB_MIN_FREQUENCY ) && ( frequency <= RADIO_STUB_MAX_FREQUENCY );
+}
+
+static uint32_t RadioStubTimeOnAir( RadioModems_t modem, uint8_t pktLen )
+{
+    return RadioStub.TimeOnAir;
+}
+
+static void RadioStubSend( uint8_t *buffer, uint8_t size )
+{
+}
+
+static void RadioStubSleep( void )
+{
+}
+
+static void RadioStubRx( uint32_t timeout )
+{
+}
+
+static void RadioStubSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
+{
+}
+
+static int16_t RadioStubRssi( RadioModems_t modem )
+{
+    return -120;
+}
+
+static void RadioStubWrite( uint8_t addr, uint8_t data )
+{
+}
+
+static uint8_t RadioStubRead( uint8_t addr )
+{
+    return 0;
+}
+
+static void RadioStubWriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
+{
+}
+
+static void RadioStubReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
+{
+    memset( buffer, 0, size );
+}
+
+static void RadioStubSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+    RadioStub.MaxPayloadModem = modem;
+    RadioStub.MaxPayloadLength = max;
+}
+
+static void RadioStubSetPublicNetwork( bool enable )
+{
+}
+
+static uint32_t RadioStubGetWakeUpTime( void )
+{
+    return RadioStub.WakeUpTime;
+}
+
+/* Exported variables --------------------------------------------------------*/
+
+RadioStub_t RadioStub;
+
+const struct Radio_s Radio =
+{
+    RadioStubIoInit,
+    RadioStubIoInit,
+    RadioStubInit,
+    RadioStubGetStatus,
+    RadioStubSetModem,
+    RadioStubSetChannel,
+    RadioStubIsChannelFree,
+    RadioStubStartCarrierSense,
+    RadioStubRandom,
+    RadioStubSetRxConfig,
+    RadioStubSetTxConfig,
+    RadioStubCheckRfFrequency,
+    RadioStubTimeOnAir,
+    RadioStubSend,
+    RadioStubSleep,
+    RadioStubSleep,
+    RadioStubRx,
+    RadioStubSleep,
+    RadioStubSetTxContinuousWave,
+    RadioStubRssi,
+    RadioStubWrite,
+    RadioStubRead,
+    RadioStubWriteBuffer,
+    RadioStubReadBuffer,
+    RadioStubSetMaxPayloadLength,
+    RadioStubSetPublicNetwork,
+    RadioStubGetWakeUpTime
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+void RadioStubReset( void )
+{
+    memset( &RadioStub, 0, sizeof( RadioStub ) );
+    RadioStub.ChannelFree = true;
+    RadioStub.TimeOnAir = 100;
+    RadioStub.Status = RF_IDLE;
+    RadioStub.WakeUpTime = 1;
+}
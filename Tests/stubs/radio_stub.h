@@ -0,0 +1,99 @@
+ /******************************************************************************
+  * @file    radio_stub.h
+  * @brief   host stand-in of the radio driver for the region layer tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RADIO_STUB_H__
+#define __RADIO_STUB_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "radio.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/*!
+ * \brief Answers of the stub and what the caller last configured
+ */
+typedef struct sRadioStub
+{
+    /*!
+     * Answer of Radio.IsChannelFree
+     */
+    bool ChannelFree;
+    /*!
+     * Number of Radio.IsChannelFree calls
+     */
+    uint32_t ChannelFreeCalls;
+    /*!
+     * Number of Radio.StartCarrierSense calls
+     */
+    uint32_t CarrierSenseCalls;
+    /*!
+     * Answer of Radio.TimeOnAir, in ms
+     */
+    uint32_t TimeOnAir;
+    /*!
+     * Answer of Radio.GetStatus
+     */
+    RadioState_t Status;
+    /*!
+     * Answer of Radio.GetRadioWakeUpTime, in ms
+     */
+    uint32_t WakeUpTime;
+    /*!
+     * Last Radio.SetChannel frequency
+     */
+    uint32_t Frequency;
+    /*!
+     * Last Radio.SetTxConfig parameters
+     */
+    RadioModems_t TxModem;
+    int8_t TxPower;
+    uint32_t TxBandwidth;
+    uint32_t TxDatarate;
+    /*!
+     * Last Radio.SetRxConfig parameters
+     */
+    RadioModems_t RxModem;
+    uint32_t RxBandwidth;
+    uint32_t RxDatarate;
+    uint16_t RxSymbTimeout;
+    bool RxContinuous;
+    /*!
+     * Last Radio.SetMaxPayloadLength parameters
+     */
+    RadioModems_t MaxPayloadModem;
+    uint8_t MaxPayloadLength;
+}RadioStub_t;
+
+/* External variables --------------------------------------------------------*/
+extern RadioStub_t RadioStub;
+
+/* Exported functions ------------------------------------------------------- */
+
+/*!
+ * \brief Restores the default answers: channels free, 100 ms time on air
+ */
+void RadioStubReset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RADIO_STUB_H__ */
@@ -0,0 +1,167 @@
+ /******************************************************************************
+  * @file    rtc_stub.c
+  * @brief   host stand-in of the RTC under the timer server, driven by the
+  *          tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include "hw.h"
+#include "low_power.h"
+#include "timeServer.h"
+#include "rtc_stub.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/*!
+ * Conversions of hw_rtc.c, 1024 ticks per second
+ */
+#define CONV_NUMER                                  125
+#define CONV_DENOM                                  128
+
+/* Private variables ---------------------------------------------------------*/
+
+static uint32_t RtcNow = 0;
+static uint32_t RtcContext = 0;
+static uint32_t RtcAlarm = 0;
+static bool RtcAlarmArmed = false;
+
+static uint32_t RtcWakeUps = 0;
+static uint32_t RtcMissedAlarms = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/*!
+ * \brief Serves the alarm, the time at its expiry
+ */
+static void RtcStubAlarm( void )
+{
+    if( ( int32_t )( RtcAlarm - RtcNow ) > 0 )
+    {
+        RtcNow = RtcAlarm;
+    }
+    RtcAlarmArmed = false;
+    RtcWakeUps++;
+    TimerIrqHandler( );
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void HW_RTC_StopAlarm( void )
+{
+    RtcAlarmArmed = false;
+}
+
+uint32_t HW_RTC_GetMinimumTimeout( void )
+{
+    return RTC_STUB_MIN_ALARM_DELAY;
+}
+
+void HW_RTC_SetAlarm( uint32_t timeout )
+{
+    RtcAlarm = RtcContext + timeout;
+    RtcAlarmArmed = true;
+    if( ( int32_t )( RtcAlarm - RtcNow ) < RTC_STUB_MIN_ALARM_DELAY )
+    {
+        // Already matched or about to be while the alarm is being set
+        RtcAlarmArmed = false;
+        RtcMissedAlarms++;
+    }
+}
+
+uint32_t HW_RTC_GetTimerElapsedTime( void )
+{
+    return RtcNow - RtcContext;
+}
+
+uint32_t HW_RTC_GetTimerValue( void )
+{
+    return RtcNow;
+}
+
+uint32_t HW_RTC_SetTimerContext( void )
+{
+    RtcContext = RtcNow;
+    return RtcContext;
+}
+
+uint32_t HW_RTC_GetTimerContext( void )
+{
+    return RtcContext;
+}
+
+void HW_RTC_DelayMs( uint32_t delay )
+{
+    RtcNow += HW_RTC_ms2Tick( delay );
+}
+
+uint32_t HW_RTC_ms2Tick( uint32_t timeMicroSec )
+{
+    return ( uint32_t )( ( ( uint64_t )timeMicroSec * CONV_DENOM ) / CONV_NUMER );
+}
+
+uint32_t HW_RTC_Tick2ms( uint32_t tick )
+{
+    return ( uint32_t )( ( ( uint64_t )tick * CONV_NUMER ) / CONV_DENOM );
+}
+
+void LowPower_Sleep( void )
+{
+    // The only wake-up source of the host is the alarm
+    if( RtcAlarmArmed == true )
+    {
+        RtcStubAlarm( );
+    }
+}
+
+void RtcStubReset( uint32_t now )
+{
+    RtcNow = now;
+    RtcContext = now;
+    RtcAlarmArmed = false;
+    RtcWakeUps = 0;
+    RtcMissedAlarms = 0;
+}
+
+void RtcStubRun( uint32_t ticks )
+{
+    uint32_t target = RtcNow + ticks;
+
+    while( ( RtcAlarmArmed == true ) && ( ( int32_t )( RtcAlarm - target ) <= 0 ) )
+    {
+        RtcStubAlarm( );
+    }
+    if( ( int32_t )( target - RtcNow ) > 0 )
+    {
+        RtcNow = target;
+    }
+}
+
+void RtcStubSpend( uint32_t ticks )
+{
+    RtcNow += ticks;
+}
+
+uint32_t RtcStubNow( void )
+{
+    return RtcNow;
+}
+
+uint32_t RtcStubWakeUps( void )
+{
+    return RtcWakeUps;
+}
+
+uint32_t RtcStubMissedAlarms( void )
+{
+    return RtcMissedAlarms;
+}
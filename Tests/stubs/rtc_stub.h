@@ -0,0 +1,79 @@
+ /******************************************************************************
+  * @file    rtc_stub.h
+  * @brief   host stand-in of the RTC under the timer server, driven by the
+  *          tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTC_STUB_H__
+#define __RTC_STUB_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/*!
+ * Alarms closer than this to the current time are missed, as by hw_rtc.c
+ */
+#define RTC_STUB_MIN_ALARM_DELAY                    3
+
+/* Exported functions ------------------------------------------------------- */
+
+/*!
+ * \brief Stops the alarm, clears the counters and sets the current time
+ *
+ * \param [IN] now Current time in ticks
+ */
+void RtcStubReset( uint32_t now );
+
+/*!
+ * \brief Moves the time forward, serving the alarm with TimerIrqHandler
+ *        each time it goes off on the way
+ *
+ * \param [IN] ticks Time to move forward
+ */
+void RtcStubRun( uint32_t ticks );
+
+/*!
+ * \brief Moves the time forward without serving the alarm, as a callback
+ *        running for that long does
+ *
+ * \param [IN] ticks Time to move forward
+ */
+void RtcStubSpend( uint32_t ticks );
+
+/*!
+ * \brief Returns the current time in ticks
+ */
+uint32_t RtcStubNow( void );
+
+/*!
+ * \brief Returns the number of alarms that went off
+ */
+uint32_t RtcStubWakeUps( void );
+
+/*!
+ * \brief Returns the number of alarms set closer than
+ *        RTC_STUB_MIN_ALARM_DELAY to the current time, they never go off
+ */
+uint32_t RtcStubMissedAlarms( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RTC_STUB_H__ */
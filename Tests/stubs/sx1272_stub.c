@@ -0,0 +1,91 @@
+ /******************************************************************************
+  * @file    sx1272_stub.c
+  * @brief   host stand-in of the SX1272 behind the SPI bus, a register file
+  *          only, for the parts of the driver that need no radio events
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "hw.h"
+#include "timeServer.h"
+
+/* Private variables ---------------------------------------------------------*/
+
+static uint8_t Regs[0x80];
+
+/*!
+ * SPI transaction in progress [NSS low], its address and direction
+ */
+static bool SpiSelected = false;
+static bool SpiAddressed = false;
+static bool SpiWrite = false;
+static uint8_t SpiAddr = 0;
+
+/* Hardware layer ------------------------------------------------------------*/
+
+GPIO_TypeDef HwStubGpioA = { 0 };
+GPIO_TypeDef HwStubGpioC = { 2 };
+
+void HW_GPIO_Init( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_InitTypeDef *initStruct )
+{
+}
+
+void HW_GPIO_Write( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, uint32_t value )
+{
+    if( ( GPIOx == RADIO_NSS_PORT ) && ( GPIO_Pin == RADIO_NSS_PIN ) )
+    {
+        SpiSelected = ( value == 0 );
+        SpiAddressed = false;
+    }
+}
+
+uint32_t HW_GPIO_Read( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin )
+{
+    return 0;
+}
+
+uint16_t HW_SPI_InOut( uint16_t txData )
+{
+    uint8_t value = 0;
+
+    if( SpiSelected == false )
+    {
+        return 0;
+    }
+    if( SpiAddressed == false )
+    {
+        SpiAddressed = true;
+        SpiWrite = ( txData & 0x80 ) != 0;
+        SpiAddr = txData & 0x7F;
+        return 0;
+    }
+    if( SpiWrite == true )
+    {
+        Regs[SpiAddr] = ( uint8_t )txData;
+    }
+    else
+    {
+        value = Regs[SpiAddr];
+    }
+    // Burst access, the FIFO address is not incremented
+    if( SpiAddr != 0 )
+    {
+        SpiAddr = ( SpiAddr + 1 ) & 0x7F;
+    }
+    return value;
+}
+
+void DelayMs( uint32_t ms )
+{
+    TimerDelayMs( ms );
+}
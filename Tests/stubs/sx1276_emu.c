@@ -0,0 +1,1328 @@
+ /******************************************************************************
+  * @file    sx1276_emu.c
+  * @brief   host emulator of the SX1276 behind the SPI bus, the NSS and reset
+  *          lines and the DIO interrupts, it also plays the board driver
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/*
+ * The emulator holds the register file of both modems and the 256 bytes data
+ * buffer, and runs the operating modes of the LoRa modem on the timer stub:
+ * - Tx ends with TxDone after the time on air of the datasheet, rounded up to
+ *   the ms
+ * - Rx catches the frame set by SX1276EmuSetRxFrame, or the first frame on
+ *   the air it can lock on, with RxDone, a single reception without one ends
+ *   with RxTimeout after RegSymbTimeout symbols
+ * - CAD ends with CadDone after 2 symbols, with CadDetected when the channel
+ *   is busy
+ * The flags masked by RegIrqFlagsMask are not raised, the others are routed
+ * to the DIO handlers the driver registers as set in RegDioMapping1.
+ * The wideband RSSI follows a noise source while the receiver runs, with a
+ * new measurement every ms, and holds its last reading otherwise.
+ *
+ * The FSK packet engine is minimal: Tx takes the whole packet from the FIFO,
+ * asking for the chunks on FifoEmpty, and ends with PacketSent; Rx catches a
+ * frame on the air and raises SyncAddress then PayloadReady with the whole
+ * packet in the FIFO. Its timeouts are left to the MCU timers of the driver.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include "hw.h"
+#include "radio.h"
+#include "sx1276.h"
+#include "timer_stub.h"
+#include "sx1276_emu.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/*!
+ * Time taken on the SPI bus by each byte and by the NSS framing of a
+ * transaction [us]
+ */
+#define SPI_BYTE_TIME                               2
+#define SPI_NSS_TIME                                2
+
+/*!
+ * Registers paged by RegOpMode LongRangeMode
+ */
+#define REG_PAGE_START                              0x0D
+#define REG_PAGE_END                                0x3F
+
+#define RSSI_OFFSET_LF                              -164
+#define RSSI_OFFSET_HF                              -157
+
+/*!
+ * Signal strength read by the RSSI registers [dBm]
+ */
+#define RSSI_IDLE                                   -120
+#define RSSI_BUSY                                   -60
+
+/*!
+ * Preamble symbols the LoRa modem needs to lock on a frame
+ */
+#define PREAMBLE_LOCK_SYMBOLS                       4
+
+/*!
+ * Preamble, sync word and CRC sizes of the FSK frames on the air, as sent by
+ * the LoRaWAN stack [bytes]
+ */
+#define FSK_PREAMBLE_SIZE                           5
+#define FSK_SYNC_SIZE                               3
+#define FSK_CRC_SIZE                                2
+
+/*!
+ * A frame less than this weaker than another one on the same channel is
+ * corrupted by it [dB]
+ */
+#define CAPTURE_THRESHOLD                           6
+
+/* Private typedef -----------------------------------------------------------*/
+
+typedef enum
+{
+    EMU_EVENT_NONE = 0,
+    EMU_EVENT_TX_DONE,
+    EMU_EVENT_RX_DONE,
+    EMU_EVENT_RX_TIMEOUT,
+    EMU_EVENT_CAD_DONE,
+}EmuEvent_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+GPIO_TypeDef HwStubGpioA = { 0 };
+GPIO_TypeDef HwStubGpioC = { 2 };
+
+/*!
+ * Register file, the FSK page [0] holds the common registers
+ */
+static uint8_t Regs[2][0x80];
+
+static uint8_t Fifo[256];
+
+/*!
+ * SPI transaction in progress [NSS low], its address and direction
+ */
+static bool SpiSelected = false;
+static bool SpiAddressed = false;
+static bool SpiWrite = false;
+static uint8_t SpiAddr = 0;
+
+/*!
+ * Bus time not yet moved to the timer stub [us]
+ */
+static uint32_t SpiTime = 0;
+
+/*!
+ * Number of NSS framed transactions
+ */
+static uint32_t SpiTransactions = 0;
+
+/*!
+ * SPI transaction recorder
+ */
+static SX1276EmuSpiRecord_t SpiLog[SX1276_EMU_SPI_LOG_SIZE];
+static uint16_t SpiLogCount = 0;
+
+/*!
+ * Next HW_SPI_Transfer stops responding half way through
+ */
+static bool SpiFail = false;
+
+static TimerEvent_t EventTimer;
+static EmuEvent_t Event = EMU_EVENT_NONE;
+
+static uint8_t RxFrame[256];
+static uint8_t RxFrameSize = 0;
+static bool RxFramePending = false;
+static int16_t RxFrameRssi = 0;
+static int8_t RxFrameSnr = 0;
+
+static bool ChannelBusy = false;
+static bool DioLost = false;
+static uint32_t RandomCalls = 0;
+
+/*!
+ * Frames on the air, the id of the one being received, 0 for none
+ */
+static SX1276EmuFrame_t AirFrames[SX1276_EMU_AIR_FRAMES];
+static uint32_t AirFrameIds[SX1276_EMU_AIR_FRAMES];
+static uint8_t AirFrameCount = 0;
+static uint32_t AirFrameNextId = 1;
+static uint32_t RxAirFrameId = 0;
+static bool RxFrameCorrupted = false;
+static uint32_t Collisions = 0;
+
+/*!
+ * Time the receiver and the transmitter started [ms]
+ */
+static uint32_t RxStartTime = 0;
+static uint32_t TxStartTime = 0;
+
+static SX1276EmuTxHandler_t *TxHandler = NULL;
+static SX1276EmuTxHandler_t *TxStartHandler = NULL;
+
+/*!
+ * RF output power the board was last asked for [dBm]
+ */
+static int8_t TxPower = 0;
+
+/*!
+ * FSK packet engine FIFO
+ */
+static uint8_t FskFifo[256];
+static uint16_t FskFifoCount = 0;
+static uint16_t FskFifoRead = 0;
+
+/*!
+ * State of the wideband RSSI noise, the last reading, the time it was taken
+ * and the share of its LSB at 1 [%]
+ */
+static uint32_t Noise = 1;
+static uint8_t WidebandRssi = 0;
+static TimerTime_t WidebandTime = 0;
+static uint8_t WidebandOnes = 50;
+
+/*!
+ * Wideband RSSI reads while receiving and while not
+ */
+static uint32_t WidebandReads[2];
+
+static DioIrqHandler *DioHandlers[6];
+
+/*!
+ * LoRa bandwidths of RegModemConfig1 [Hz]
+ */
+static const double Bandwidths[10] = { 7810, 10420, 15630, 20830, 31250, 41670, 62500, 125000, 250000, 500000 };
+
+/* Private functions ---------------------------------------------------------*/
+
+static bool LoRaMode( void )
+{
+    return ( Regs[0][REG_OPMODE] & RFLR_OPMODE_LONGRANGEMODE_ON ) != 0;
+}
+
+static uint8_t OpMode( void )
+{
+    return Regs[0][REG_OPMODE] & ~RFLR_OPMODE_MASK;
+}
+
+static uint8_t* Reg( uint8_t addr )
+{
+    addr &= 0x7F;
+    if( ( addr >= REG_PAGE_START ) && ( addr <= REG_PAGE_END ) && LoRaMode( ) )
+    {
+        return &Regs[1][addr];
+    }
+    return &Regs[0][addr];
+}
+
+static void ResetRegisters( void )
+{
+    memset( Regs, 0, sizeof( Regs ) );
+    memset( Fifo, 0, sizeof( Fifo ) );
+
+    Regs[0][REG_OPMODE] = 0x09;
+    Regs[0][REG_FRFMSB] = 0x6C;
+    Regs[0][REG_FRFMID] = 0x80;
+    Regs[0][REG_PACONFIG] = 0x4F;
+    Regs[0][REG_LNA] = 0x20;
+    Regs[0][REG_VERSION] = 0x12;
+
+    // FSK page
+    Regs[0][REG_SYNCCONFIG] = 0x93;
+    Regs[0][REG_PACKETCONFIG1] = 0x90;
+    Regs[0][REG_PAYLOADLENGTH] = 0x40;
+    Regs[0][REG_IMAGECAL] = 0x82;
+
+    // LoRa page
+    Regs[1][REG_LR_FIFOTXBASEADDR] = 0x80;
+    Regs[1][REG_LR_MODEMCONFIG1] = 0x72;
+    Regs[1][REG_LR_MODEMCONFIG2] = 0x70;
+    Regs[1][REG_LR_SYMBTIMEOUTLSB] = 0x64;
+    Regs[1][REG_LR_PREAMBLELSB] = 0x08;
+    Regs[1][REG_LR_PAYLOADLENGTH] = 0x01;
+    Regs[1][REG_LR_PAYLOADMAXLENGTH] = 0xFF;
+    Regs[1][REG_LR_HOPPERIOD] = 0xFF;
+    Regs[1][REG_LR_MODEMCONFIG3] = 0x04;
+    Regs[1][REG_LR_DETECTOPTIMIZE] = 0xC3;
+    Regs[1][REG_LR_INVERTIQ] = 0x27;
+    Regs[1][REG_LR_DETECTIONTHRESHOLD] = 0x0A;
+    Regs[1][REG_LR_SYNCWORD] = 0x12;
+    Regs[1][REG_LR_INVERTIQ2] = 0x1D;
+
+    TimerStop( &EventTimer );
+    Event = EMU_EVENT_NONE;
+    RxAirFrameId = 0;
+    FskFifoCount = 0;
+    FskFifoRead = 0;
+}
+
+/*!
+ * \brief LoRa symbol time with the modem registers as they are [us]
+ */
+static double SymbolTime( void )
+{
+    uint8_t bw = Regs[1][REG_LR_MODEMCONFIG1] >> 4;
+    uint8_t sf = Regs[1][REG_LR_MODEMCONFIG2] >> 4;
+
+    if( bw > 9 )
+    {
+        bw = 9;
+    }
+    if( sf < 6 )
+    {
+        sf = 6;
+    }
+    else if( sf > 12 )
+    {
+        sf = 12;
+    }
+    return ( double )( 1 << sf ) * 1e6 / Bandwidths[bw];
+}
+
+/*!
+ * \brief Carrier frequency set in RegFrf [Hz]
+ */
+static uint32_t Frequency( void )
+{
+    uint32_t frf = ( ( uint32_t )Regs[0][REG_FRFMSB] << 16 ) | ( ( uint32_t )Regs[0][REG_FRFMID] << 8 ) | Regs[0][REG_FRFLSB];
+
+    return ( uint32_t )( frf * FREQ_STEP );
+}
+
+/*!
+ * \brief FSK bit rate set in RegBitrate [bps]
+ */
+static uint32_t FskBitrate( void )
+{
+    uint16_t bitrate = ( ( uint16_t )Regs[0][REG_BITRATEMSB] << 8 ) | Regs[0][REG_BITRATELSB];
+
+    return ( bitrate > 0 ) ? ( uint32_t )( XTAL_FREQ / bitrate ) : 0;
+}
+
+/*!
+ * \brief FSK time on air with the packet registers as they are [us]
+ */
+static double FskTimeOnAir( uint8_t size )
+{
+    uint16_t preambleLen = ( ( uint16_t )Regs[0][REG_PREAMBLEMSB] << 8 ) | Regs[0][REG_PREAMBLELSB];
+    uint8_t syncSize = ( Regs[0][REG_SYNCCONFIG] & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1;
+    uint8_t lengthSize = ( ( Regs[0][REG_PACKETCONFIG1] & RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) != 0 ) ? 1 : 0;
+    uint8_t crcSize = ( ( Regs[0][REG_PACKETCONFIG1] & RF_PACKETCONFIG1_CRC_ON ) != 0 ) ? 2 : 0;
+
+    return ( preambleLen + syncSize + lengthSize + size + crcSize ) * 8e6 / FskBitrate( );
+}
+
+/*!
+ * \brief Size of the FSK packet in the FIFO, length byte included
+ */
+static uint16_t FskPacketSize( void )
+{
+    if( ( Regs[0][REG_PACKETCONFIG1] & RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) == 0 )
+    {
+        return Regs[0][REG_PAYLOADLENGTH];
+    }
+    return ( FskFifoCount > 0 ) ? FskFifo[0] + 1 : 1;
+}
+
+/*!
+ * \brief Tells whether a frame on the air and the radio are on the same
+ *        channel, LoRa frames also with the same spreading factor and
+ *        bandwidth
+ */
+static bool SameChannel( const SX1276EmuFrame_t *frame, bool lora, uint8_t sf, uint8_t bw, uint32_t frequency )
+{
+    double halfBandwidth = ( lora == true ) ? Bandwidths[bw] / 2 : 50000;
+
+    if( frame->Lora != lora )
+    {
+        return false;
+    }
+    if( ( lora == true ) && ( ( frame->Sf != sf ) || ( frame->Bw != bw ) ) )
+    {
+        return false;
+    }
+    return fabs( ( double )frame->Frequency - frequency ) <= halfBandwidth;
+}
+
+/*!
+ * \brief Signal strength of the strongest frame on the air on the carrier
+ *        frequency now, RSSI_IDLE when none
+ */
+static int16_t AirRssi( void )
+{
+    uint32_t now = TimerGetCurrentTime( );
+    int16_t rssi = RSSI_IDLE;
+
+    if( ChannelBusy == true )
+    {
+        return RSSI_BUSY;
+    }
+    for( uint8_t i = 0; i < AirFrameCount; i++ )
+    {
+        const SX1276EmuFrame_t *frame = &AirFrames[i];
+
+        if( ( ( int32_t )( now - frame->Start ) >= 0 ) && ( ( now - frame->Start ) < frame->Duration ) &&
+            ( fabs( ( double )frame->Frequency - Frequency( ) ) <= 100000 ) && ( frame->Rssi > rssi ) )
+        {
+            rssi = frame->Rssi;
+        }
+    }
+    return rssi;
+}
+
+/*!
+ * \brief Tells whether a LoRa frame with the spreading factor and the
+ *        bandwidth of the modem is on the air on the carrier frequency now
+ */
+static bool AirLoRaActivity( void )
+{
+    uint32_t now = TimerGetCurrentTime( );
+
+    for( uint8_t i = 0; i < AirFrameCount; i++ )
+    {
+        const SX1276EmuFrame_t *frame = &AirFrames[i];
+
+        if( ( ( int32_t )( now - frame->Start ) >= 0 ) && ( ( now - frame->Start ) < frame->Duration ) &&
+            ( SameChannel( frame, true, Regs[1][REG_LR_MODEMCONFIG2] >> 4, Regs[1][REG_LR_MODEMCONFIG1] >> 4, Frequency( ) ) == true ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Tells whether the frame being received overlaps another one on its
+ *        channel not weaker by CAPTURE_THRESHOLD
+ */
+static bool AirCollision( void )
+{
+    const SX1276EmuFrame_t *rx = NULL;
+
+    for( uint8_t i = 0; i < AirFrameCount; i++ )
+    {
+        if( AirFrameIds[i] == RxAirFrameId )
+        {
+            rx = &AirFrames[i];
+        }
+    }
+    if( rx == NULL )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < AirFrameCount; i++ )
+    {
+        const SX1276EmuFrame_t *frame = &AirFrames[i];
+
+        if( ( AirFrameIds[i] != RxAirFrameId ) &&
+            ( ( int32_t )( frame->Start - ( rx->Start + rx->Duration ) ) < 0 ) &&
+            ( ( int32_t )( rx->Start - ( frame->Start + frame->Duration ) ) < 0 ) &&
+            ( SameChannel( frame, rx->Lora, rx->Sf, rx->Bw, rx->Frequency ) == true ) &&
+            ( frame->Rssi > rx->Rssi - CAPTURE_THRESHOLD ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Starts the operating mode event, it fires after the given time
+ *        rounded up to the ms
+ *
+ * \retval Time the event fires after [ms]
+ */
+static uint32_t StartEvent( EmuEvent_t event, double time )
+{
+    uint32_t ms = ( uint32_t )ceil( time / 1000 );
+
+    if( ms == 0 )
+    {
+        ms = 1;
+    }
+    Event = event;
+    TimerSetValue( &EventTimer, ms );
+    TimerStart( &EventTimer );
+    return ms;
+}
+
+/*!
+ * \brief Catches the frame on the air the receiver locks on first, the
+ *        reception ends with it
+ *
+ * \retval true when a frame is caught
+ */
+static bool CatchAirFrame( void )
+{
+    bool lora = LoRaMode( );
+    uint8_t sf = Regs[1][REG_LR_MODEMCONFIG2] >> 4;
+    uint8_t bw = Regs[1][REG_LR_MODEMCONFIG1] >> 4;
+    bool iqInverted = ( Regs[1][REG_LR_INVERTIQ] & RFLR_INVERTIQ_RX_ON ) != 0;
+    uint16_t preambleLen = ( Regs[1][REG_LR_PREAMBLEMSB] << 8 ) | Regs[1][REG_LR_PREAMBLELSB];
+    uint16_t symbTimeout = ( ( Regs[1][REG_LR_MODEMCONFIG2] & 0x03 ) << 8 ) | Regs[1][REG_LR_SYMBTIMEOUTLSB];
+    uint32_t bitrate = FskBitrate( );
+    double now = TimerGetCurrentTime( ) * 1000.0;
+    double open = RxStartTime * 1000.0;
+    double firstLock = 0;
+    int16_t caught = -1;
+
+    for( uint8_t i = 0; i < AirFrameCount; i++ )
+    {
+        const SX1276EmuFrame_t *frame = &AirFrames[i];
+        double start = frame->Start * 1000.0;
+        double lock;
+
+        if( ( ( start + frame->Duration * 1000.0 ) <= now ) ||
+            ( SameChannel( frame, lora, sf, bw, Frequency( ) ) == false ) )
+        {
+            continue;
+        }
+        if( lora == true )
+        {
+            // The modem locks within the preamble, and within the symbol
+            // timeout of a single reception
+            lock = ( ( open > start ) ? open : start ) + PREAMBLE_LOCK_SYMBOLS * SymbolTime( );
+            if( ( frame->IqInverted != iqInverted ) ||
+                ( lock > ( start + ( preambleLen + 4.25 ) * SymbolTime( ) ) ) ||
+                ( ( OpMode( ) == RFLR_OPMODE_RECEIVER_SINGLE ) && ( lock > ( open + symbTimeout * SymbolTime( ) ) ) ) )
+            {
+                continue;
+            }
+        }
+        else
+        {
+            // The packet engine needs a preamble byte before the sync word
+            lock = start + ( FSK_PREAMBLE_SIZE + FSK_SYNC_SIZE ) * 8e6 / bitrate;
+            if( ( ( frame->Bitrate * 20 ) < ( bitrate * 19 ) ) || ( ( frame->Bitrate * 20 ) > ( bitrate * 21 ) ) ||
+                ( open > ( start + ( FSK_PREAMBLE_SIZE - 1 ) * 8e6 / bitrate ) ) )
+            {
+                continue;
+            }
+        }
+        if( ( caught < 0 ) || ( lock < firstLock ) )
+        {
+            caught = i;
+            firstLock = lock;
+        }
+    }
+    if( caught < 0 )
+    {
+        return false;
+    }
+
+    memcpy( RxFrame, AirFrames[caught].Payload, AirFrames[caught].Size );
+    RxFrameSize = AirFrames[caught].Size;
+    RxFrameRssi = AirFrames[caught].Rssi;
+    RxFrameSnr = AirFrames[caught].Snr;
+    RxAirFrameId = AirFrameIds[caught];
+    StartEvent( EMU_EVENT_RX_DONE, ( AirFrames[caught].Start + AirFrames[caught].Duration ) * 1000.0 - now );
+    return true;
+}
+
+/*!
+ * \brief Hands the frame being sent to a handler
+ *
+ * \param [IN] handler Handler, nothing is done without
+ * \param [IN] duration Time on air of the frame [ms]
+ */
+static void SendTxFrame( SX1276EmuTxHandler_t *handler, uint32_t duration )
+{
+    SX1276EmuFrame_t frame;
+
+    if( handler == NULL )
+    {
+        return;
+    }
+    memset( &frame, 0, sizeof( frame ) );
+    frame.Start = TxStartTime;
+    frame.Duration = duration;
+    frame.Frequency = Frequency( );
+    frame.Rssi = TxPower;
+    frame.Lora = LoRaMode( );
+    if( frame.Lora == true )
+    {
+        frame.Sf = Regs[1][REG_LR_MODEMCONFIG2] >> 4;
+        frame.Bw = Regs[1][REG_LR_MODEMCONFIG1] >> 4;
+        frame.IqInverted = ( Regs[1][REG_LR_INVERTIQ] & ~RFLR_INVERTIQ_TX_MASK ) == RFLR_INVERTIQ_TX_ON;
+        frame.Size = Regs[1][REG_LR_PAYLOADLENGTH];
+        for( uint16_t i = 0; i < frame.Size; i++ )
+        {
+            frame.Payload[i] = Fifo[( uint8_t )( Regs[1][REG_LR_FIFOTXBASEADDR] + i )];
+        }
+    }
+    else
+    {
+        uint8_t offset = ( ( Regs[0][REG_PACKETCONFIG1] & RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) != 0 ) ? 1 : 0;
+
+        frame.Bitrate = FskBitrate( );
+        frame.Size = FskPacketSize( ) - offset;
+        memcpy( frame.Payload, FskFifo + offset, frame.Size );
+    }
+    handler( &frame );
+}
+
+/*!
+ * \brief Raises the unmasked flags and the DIO lines they are mapped to
+ */
+static void RaiseIrq( uint8_t flags )
+{
+    uint8_t mapping = Regs[0][REG_LR_DIOMAPPING1];
+    static const uint8_t dioFlags[4][4] =
+    {
+        { RFLR_IRQFLAGS_RXDONE, RFLR_IRQFLAGS_TXDONE, RFLR_IRQFLAGS_CADDONE, 0 },
+        { RFLR_IRQFLAGS_RXTIMEOUT, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL, RFLR_IRQFLAGS_CADDETECTED, 0 },
+        { RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL, 0 },
+        { RFLR_IRQFLAGS_CADDONE, RFLR_IRQFLAGS_VALIDHEADER, RFLR_IRQFLAGS_PAYLOADCRCERROR, 0 },
+    };
+
+    flags &= ~Regs[1][REG_LR_IRQFLAGSMASK];
+    Regs[1][REG_LR_IRQFLAGS] |= flags;
+
+    for( uint8_t dio = 0; dio < 4; dio++ )
+    {
+        uint8_t map = ( mapping >> ( 6 - 2 * dio ) ) & 0x03;
+
+        if( ( ( dioFlags[dio][map] & flags ) != 0 ) && ( DioHandlers[dio] != NULL ) && ( DioLost == false ) )
+        {
+            DioHandlers[dio]( );
+        }
+    }
+}
+
+/*!
+ * \brief Ends the FSK packet engine operations, the engine stays in its mode
+ *        until the driver leaves it
+ */
+static void OnFskEvent( EmuEvent_t event )
+{
+    uint8_t offset = ( ( Regs[0][REG_PACKETCONFIG1] & RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) != 0 ) ? 1 : 0;
+
+    switch( event )
+    {
+    case EMU_EVENT_TX_DONE:
+        SendTxFrame( TxHandler, TimerGetCurrentTime( ) - TxStartTime );
+        FskFifoCount = 0;
+        FskFifoRead = 0;
+        Regs[0][REG_IRQFLAGS2] |= RF_IRQFLAGS2_PACKETSENT;
+        // DIO0 is PacketSent in Tx
+        if( DioHandlers[0] != NULL )
+        {
+            DioHandlers[0]( );
+        }
+        break;
+    case EMU_EVENT_RX_DONE:
+        RxFrameCorrupted = AirCollision( );
+        if( RxFrameCorrupted == true )
+        {
+            Collisions++;
+        }
+        FskFifo[0] = RxFrameSize;
+        memcpy( FskFifo + offset, RxFrame, RxFrameSize );
+        FskFifoCount = RxFrameSize + offset;
+        FskFifoRead = 0;
+        // DIO2 is SyncAddress and DIO0 PayloadReady in Rx, the signal strength
+        // is read on the sync word
+        Regs[0][REG_IRQFLAGS1] |= RF_IRQFLAGS1_SYNCADDRESSMATCH;
+        if( DioHandlers[2] != NULL )
+        {
+            DioHandlers[2]( );
+        }
+        RxAirFrameId = 0;
+        Regs[0][REG_IRQFLAGS2] |= ( RxFrameCorrupted == true ) ? RF_IRQFLAGS2_PAYLOADREADY : ( RF_IRQFLAGS2_PAYLOADREADY | RF_IRQFLAGS2_CRCOK );
+        if( DioHandlers[0] != NULL )
+        {
+            DioHandlers[0]( );
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void OnEvent( void )
+{
+    EmuEvent_t event = Event;
+    uint8_t rxBase = Regs[1][REG_LR_FIFORXBASEADDR];
+    uint32_t frf;
+    int16_t rssi;
+
+    Event = EMU_EVENT_NONE;
+    if( LoRaMode( ) == false )
+    {
+        OnFskEvent( event );
+        return;
+    }
+    switch( event )
+    {
+    case EMU_EVENT_TX_DONE:
+        SendTxFrame( TxHandler, TimerGetCurrentTime( ) - TxStartTime );
+        Regs[0][REG_OPMODE] = ( Regs[0][REG_OPMODE] & RFLR_OPMODE_MASK ) | RFLR_OPMODE_STANDBY;
+        RaiseIrq( RFLR_IRQFLAGS_TXDONE );
+        break;
+    case EMU_EVENT_RX_DONE:
+        RxFrameCorrupted = AirCollision( );
+        if( RxFrameCorrupted == true )
+        {
+            Collisions++;
+        }
+        RxAirFrameId = 0;
+        for( uint16_t i = 0; i < RxFrameSize; i++ )
+        {
+            Fifo[( uint8_t )( rxBase + i )] = RxFrame[i];
+        }
+        // Signal strength the driver computes back within 1 dB
+        frf = ( ( uint32_t )Regs[0][REG_FRFMSB] << 16 ) | ( ( uint32_t )Regs[0][REG_FRFMID] << 8 ) | Regs[0][REG_FRFLSB];
+        rssi = RxFrameRssi - ( ( ( frf * FREQ_STEP ) > RF_MID_BAND_THRESH ) ? RSSI_OFFSET_HF : RSSI_OFFSET_LF );
+        if( RxFrameSnr < 0 )
+        {
+            rssi -= RxFrameSnr;
+        }
+        rssi = ( rssi * 16 + 8 ) / 17;
+        Regs[1][REG_LR_PKTRSSIVALUE] = ( rssi < 0 ) ? 0 : ( ( rssi > 255 ) ? 255 : rssi );
+        Regs[1][REG_LR_PKTSNRVALUE] = ( uint8_t )( RxFrameSnr * 4 );
+        Regs[1][REG_LR_FIFORXCURRENTADDR] = rxBase;
+        Regs[1][REG_LR_RXNBBYTES] = RxFrameSize;
+        RxFramePending = false;
+        if( OpMode( ) == RFLR_OPMODE_RECEIVER_SINGLE )
+        {
+            Regs[0][REG_OPMODE] = ( Regs[0][REG_OPMODE] & RFLR_OPMODE_MASK ) | RFLR_OPMODE_STANDBY;
+        }
+        RaiseIrq( ( RxFrameCorrupted == true ) ? ( RFLR_IRQFLAGS_VALIDHEADER | RFLR_IRQFLAGS_RXDONE | RFLR_IRQFLAGS_PAYLOADCRCERROR ) :
+                                                  ( RFLR_IRQFLAGS_VALIDHEADER | RFLR_IRQFLAGS_RXDONE ) );
+        break;
+    case EMU_EVENT_RX_TIMEOUT:
+        Regs[0][REG_OPMODE] = ( Regs[0][REG_OPMODE] & RFLR_OPMODE_MASK ) | RFLR_OPMODE_STANDBY;
+        RaiseIrq( RFLR_IRQFLAGS_RXTIMEOUT );
+        break;
+    case EMU_EVENT_CAD_DONE:
+        Regs[0][REG_OPMODE] = ( Regs[0][REG_OPMODE] & RFLR_OPMODE_MASK ) | RFLR_OPMODE_STANDBY;
+        RaiseIrq( ( ( ChannelBusy == true ) || ( AirLoRaActivity( ) == true ) ) ? ( RFLR_IRQFLAGS_CADDONE | RFLR_IRQFLAGS_CADDETECTED ) :
+                                                                                 RFLR_IRQFLAGS_CADDONE );
+        break;
+    default:
+        break;
+    }
+}
+
+/*!
+ * \brief Starts the operating mode of the FSK packet engine
+ */
+static void WriteFskOpMode( void )
+{
+    switch( OpMode( ) )
+    {
+    case RF_OPMODE_TRANSMITTER:
+        TxStartTime = TimerGetCurrentTime( );
+        Regs[0][REG_IRQFLAGS2] &= ~RF_IRQFLAGS2_PACKETSENT;
+        // The FIFO empties as fast as the driver fills it, the driver writes
+        // the next chunk on FifoEmpty (DIO1)
+        while( ( FskFifoCount < FskPacketSize( ) ) && ( DioHandlers[1] != NULL ) )
+        {
+            uint16_t count = FskFifoCount;
+
+            DioHandlers[1]( );
+            if( FskFifoCount == count )
+            {
+                break;
+            }
+        }
+        SendTxFrame( TxStartHandler,
+                     StartEvent( EMU_EVENT_TX_DONE, FskTimeOnAir( FskPacketSize( ) -
+                                 ( ( ( Regs[0][REG_PACKETCONFIG1] & RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) != 0 ) ? 1 : 0 ) ) ) );
+        break;
+    case RF_OPMODE_RECEIVER:
+        RxStartTime = TimerGetCurrentTime( );
+        FskFifoCount = 0;
+        FskFifoRead = 0;
+        Regs[0][REG_IRQFLAGS1] &= ~RF_IRQFLAGS1_SYNCADDRESSMATCH;
+        Regs[0][REG_IRQFLAGS2] &= ~( RF_IRQFLAGS2_PAYLOADREADY | RF_IRQFLAGS2_CRCOK );
+        CatchAirFrame( );
+        break;
+    case RF_OPMODE_SLEEP:
+        FskFifoCount = 0;
+        FskFifoRead = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/*!
+ * \brief Writes RegOpMode and starts the operating mode
+ */
+static void WriteOpMode( uint8_t value )
+{
+    // The modem can only be changed in sleep mode
+    if( OpMode( ) != RFLR_OPMODE_SLEEP )
+    {
+        value = ( value & RFLR_OPMODE_LONGRANGEMODE_MASK ) | ( Regs[0][REG_OPMODE] & RFLR_OPMODE_LONGRANGEMODE_ON );
+    }
+    Regs[0][REG_OPMODE] = value;
+
+    TimerStop( &EventTimer );
+    Event = EMU_EVENT_NONE;
+    RxAirFrameId = 0;
+    if( LoRaMode( ) == false )
+    {
+        WriteFskOpMode( );
+        return;
+    }
+
+    switch( OpMode( ) )
+    {
+    case RFLR_OPMODE_TRANSMITTER:
+        TxStartTime = TimerGetCurrentTime( );
+        SendTxFrame( TxStartHandler, StartEvent( EMU_EVENT_TX_DONE, SX1276EmuTimeOnAir( Regs[1][REG_LR_PAYLOADLENGTH] ) ) );
+        break;
+    case RFLR_OPMODE_RECEIVER:
+    case RFLR_OPMODE_RECEIVER_SINGLE:
+        RxStartTime = TimerGetCurrentTime( );
+        if( RxFramePending == true )
+        {
+            StartEvent( EMU_EVENT_RX_DONE, SX1276EmuTimeOnAir( RxFrameSize ) );
+        }
+        else if( ( CatchAirFrame( ) == false ) && ( OpMode( ) == RFLR_OPMODE_RECEIVER_SINGLE ) )
+        {
+            uint16_t symbTimeout = ( ( Regs[1][REG_LR_MODEMCONFIG2] & 0x03 ) << 8 ) | Regs[1][REG_LR_SYMBTIMEOUTLSB];
+
+            StartEvent( EMU_EVENT_RX_TIMEOUT, symbTimeout * SymbolTime( ) );
+        }
+        break;
+    case RFLR_OPMODE_CAD:
+        StartEvent( EMU_EVENT_CAD_DONE, 2 * SymbolTime( ) );
+        break;
+    default:
+        break;
+    }
+}
+
+static void WriteRegister( uint8_t addr, uint8_t value )
+{
+    if( ( addr == REG_FIFO ) && ( LoRaMode( ) == false ) )
+    {
+        if( FskFifoCount < sizeof( FskFifo ) )
+        {
+            FskFifo[FskFifoCount++] = value;
+        }
+        return;
+    }
+    if( addr == REG_FIFO )
+    {
+        Fifo[Regs[1][REG_LR_FIFOADDRPTR]++] = value;
+        return;
+    }
+    if( addr == REG_OPMODE )
+    {
+        WriteOpMode( value );
+        return;
+    }
+    if( addr == REG_VERSION )
+    {
+        return;
+    }
+    if( LoRaMode( ) == true )
+    {
+        if( addr == REG_LR_IRQFLAGS )
+        {
+            Regs[1][REG_LR_IRQFLAGS] &= ~value;
+            return;
+        }
+    }
+    else if( addr == REG_IMAGECAL )
+    {
+        // The calibration completes at once
+        value &= ~( RF_IMAGECAL_IMAGECAL_START | RF_IMAGECAL_IMAGECAL_RUNNING );
+    }
+    else if( ( addr == REG_IRQFLAGS1 ) || ( addr == REG_IRQFLAGS2 ) )
+    {
+        Regs[0][addr] &= ~value;
+        return;
+    }
+    *Reg( addr ) = value;
+}
+
+static uint8_t ReadRegister( uint8_t addr )
+{
+    int16_t rssi = ( RxAirFrameId != 0 ) ? RxFrameRssi : AirRssi( );
+
+    if( ( addr == REG_FIFO ) && ( LoRaMode( ) == false ) )
+    {
+        return ( FskFifoRead < FskFifoCount ) ? FskFifo[FskFifoRead++] : 0;
+    }
+    if( addr == REG_FIFO )
+    {
+        return Fifo[Regs[1][REG_LR_FIFOADDRPTR]++];
+    }
+    if( LoRaMode( ) == true )
+    {
+        switch( addr )
+        {
+        case REG_LR_RSSIVALUE:
+            return ( uint8_t )( rssi - RSSI_OFFSET_HF );
+        case REG_LR_RSSIWIDEBAND:
+            // The register follows the noise while the receiver runs and
+            // keeps the last reading otherwise. Reads within the same ms
+            // return the same measurement.
+            if( ( OpMode( ) == RFLR_OPMODE_RECEIVER ) || ( OpMode( ) == RFLR_OPMODE_RECEIVER_SINGLE ) ||
+                ( OpMode( ) == RFLR_OPMODE_CAD ) )
+            {
+                if( ( WidebandReads[1] == 0 ) || ( WidebandTime != TimerGetCurrentTime( ) ) )
+                {
+                    // xorshift32 stands for the thermal noise
+                    Noise ^= Noise << 13;
+                    Noise ^= Noise >> 17;
+                    Noise ^= Noise << 5;
+                    WidebandRssi = ( ( Noise >> 24 ) & 0xFE ) | ( ( ( Noise % 100 ) < WidebandOnes ) ? 1 : 0 );
+                    WidebandTime = TimerGetCurrentTime( );
+                }
+                WidebandReads[1]++;
+            }
+            else
+            {
+                WidebandReads[0]++;
+            }
+            return WidebandRssi;
+        default:
+            break;
+        }
+    }
+    else if( addr == REG_RSSIVALUE )
+    {
+        return ( uint8_t )( -2 * rssi );
+    }
+    return *Reg( addr );
+}
+
+/*!
+ * \brief Moves the bus time to the timer stub by whole ms
+ */
+static void SpiClock( uint32_t time )
+{
+    SpiTime += time;
+    if( SpiTime >= 1000 )
+    {
+        TimerDelayMs( SpiTime / 1000 );
+        SpiTime %= 1000;
+    }
+}
+
+/*!
+ * \brief One byte on the SPI bus, the first of a transaction is the address
+ */
+static uint8_t SpiByte( uint8_t data )
+{
+    uint8_t value = 0;
+
+    SpiClock( SPI_BYTE_TIME );
+    if( SpiSelected == false )
+    {
+        return 0;
+    }
+    if( SpiAddressed == false )
+    {
+        SpiAddressed = true;
+        SpiWrite = ( data & 0x80 ) != 0;
+        SpiAddr = data & 0x7F;
+        if( SpiLogCount < SX1276_EMU_SPI_LOG_SIZE )
+        {
+            SpiLog[SpiLogCount].Addr = SpiAddr;
+            SpiLog[SpiLogCount].Write = SpiWrite;
+            SpiLog[SpiLogCount].Lora = ( Regs[0][REG_OPMODE] & RFLR_OPMODE_LONGRANGEMODE_ON ) != 0;
+            SpiLog[SpiLogCount].Size = 0;
+            SpiLogCount++;
+        }
+        return 0;
+    }
+    if( ( SpiLogCount > 0 ) && ( SpiLogCount <= SX1276_EMU_SPI_LOG_SIZE ) )
+    {
+        SpiLog[SpiLogCount - 1].Size++;
+    }
+    if( SpiWrite == true )
+    {
+        WriteRegister( SpiAddr, data );
+    }
+    else
+    {
+        value = ReadRegister( SpiAddr );
+    }
+    // Burst access, the FIFO address is not incremented
+    if( SpiAddr != REG_FIFO )
+    {
+        SpiAddr = ( SpiAddr + 1 ) & 0x7F;
+    }
+    return value;
+}
+
+/* Board driver --------------------------------------------------------------*/
+
+static void SX1276EmuSetXO( uint8_t state )
+{
+}
+
+static uint32_t SX1276EmuGetWakeTime( void )
+{
+    return 0;
+}
+
+static void SX1276EmuIoIrqInit( DioIrqHandler **irqHandlers )
+{
+    for( uint8_t i = 0; i < 6; i++ )
+    {
+        DioHandlers[i] = irqHandlers[i];
+        if( irqHandlers[i] == NULL )
+        {
+            break;
+        }
+    }
+}
+
+static void SX1276EmuSetRfTxPower( int8_t power )
+{
+    TxPower = power;
+}
+
+static void SX1276EmuSetAntSwLowPower( bool status )
+{
+}
+
+static void SX1276EmuSetAntSw( uint8_t opMode )
+{
+}
+
+static LoRaBoardCallback_t BoardCallbacks = { SX1276EmuSetXO,
+                                              SX1276EmuGetWakeTime,
+                                              SX1276EmuIoIrqInit,
+                                              SX1276EmuSetRfTxPower,
+                                              SX1276EmuSetAntSwLowPower,
+                                              SX1276EmuSetAntSw };
+
+void SX1276IoInit( void )
+{
+    SX1276BoardInit( &BoardCallbacks );
+}
+
+void SX1276IoDeInit( void )
+{
+}
+
+bool SX1276CheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+/*!
+ * \brief Counts the random values the driver gives
+ */
+static uint32_t EmuRandom( void )
+{
+    RandomCalls++;
+    return SX1276Random( );
+}
+
+/*!
+ * Radio driver structure initialization
+ */
+const struct Radio_s Radio =
+{
+    SX1276IoInit,
+    SX1276IoDeInit,
+    SX1276Init,
+    SX1276GetStatus,
+    SX1276SetModem,
+    SX1276SetChannel,
+    SX1276IsChannelFree,
+    SX1276StartCarrierSense,
+    EmuRandom,
+    SX1276SetRxConfig,
+    SX1276SetTxConfig,
+    SX1276CheckRfFrequency,
+    SX1276GetTimeOnAir,
+    SX1276Send,
+    SX1276SetSleep,
+    SX1276SetStby,
+    SX1276SetRx,
+    SX1276StartCad,
+    SX1276SetTxContinuousWave,
+    SX1276ReadRssi,
+    SX1276Write,
+    SX1276Read,
+    SX1276WriteBuffer,
+    SX1276ReadBuffer,
+    SX1276SetMaxPayloadLength,
+    SX1276SetPublicNetwork,
+    SX1276GetRadioWakeUpTime
+};
+
+/* Hardware layer ------------------------------------------------------------*/
+
+void HW_GPIO_Init( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_InitTypeDef *initStruct )
+{
+}
+
+void HW_GPIO_Write( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, uint32_t value )
+{
+    if( ( GPIOx == RADIO_NSS_PORT ) && ( GPIO_Pin == RADIO_NSS_PIN ) )
+    {
+        if( ( SpiSelected == false ) && ( value == 0 ) )
+        {
+            SpiTransactions++;
+        }
+        SpiSelected = ( value == 0 );
+        SpiAddressed = false;
+        SpiClock( SPI_NSS_TIME );
+    }
+    else if( ( GPIOx == RADIO_RESET_PORT ) && ( GPIO_Pin == RADIO_RESET_PIN ) && ( value == 0 ) )
+    {
+        ResetRegisters( );
+    }
+}
+
+uint32_t HW_GPIO_Read( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin )
+{
+    return 0;
+}
+
+uint16_t HW_SPI_InOut( uint16_t txData )
+{
+    return SpiByte( ( uint8_t )txData );
+}
+
+bool HW_SPI_Transfer( uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size )
+{
+    // A failing bus moves half the bytes, the others read as 0 as on the
+    // target
+    uint16_t moved = ( SpiFail == true ) ? size / 2 : size;
+
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        uint8_t value = ( i < moved ) ? SpiByte( ( txBuffer != NULL ) ? txBuffer[i] : 0 ) : 0;
+
+        if( rxBuffer != NULL )
+        {
+            rxBuffer[i] = value;
+        }
+    }
+    if( SpiFail == true )
+    {
+        SpiFail = false;
+        return false;
+    }
+    return true;
+}
+
+void DelayMs( uint32_t ms )
+{
+    TimerDelayMs( ms );
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void SX1276EmuReset( void )
+{
+    TimerInit( &EventTimer, OnEvent );
+    ResetRegisters( );
+    SpiSelected = false;
+    SpiTime = 0;
+    SpiTransactions = 0;
+    SpiLogCount = 0;
+    SpiFail = false;
+    RxFramePending = false;
+    ChannelBusy = false;
+    DioLost = false;
+    RandomCalls = 0;
+    Noise = 1;
+    WidebandRssi = 0;
+    WidebandTime = 0;
+    WidebandOnes = 50;
+    WidebandReads[0] = 0;
+    WidebandReads[1] = 0;
+    AirFrameCount = 0;
+    Collisions = 0;
+    TxHandler = NULL;
+    TxStartHandler = NULL;
+    TxPower = 0;
+}
+
+uint8_t SX1276EmuGetRegister( bool lora, uint8_t addr )
+{
+    addr &= 0x7F;
+    if( ( addr >= REG_PAGE_START ) && ( addr <= REG_PAGE_END ) && ( lora == true ) )
+    {
+        return Regs[1][addr];
+    }
+    return Regs[0][addr];
+}
+
+const uint8_t* SX1276EmuGetFifo( void )
+{
+    return Fifo;
+}
+
+double SX1276EmuTimeOnAir( uint8_t size )
+{
+    uint8_t sf = Regs[1][REG_LR_MODEMCONFIG2] >> 4;
+    uint8_t cr = ( Regs[1][REG_LR_MODEMCONFIG1] >> 1 ) & 0x07;
+    uint8_t implicitHeader = Regs[1][REG_LR_MODEMCONFIG1] & 0x01;
+    uint8_t crcOn = ( Regs[1][REG_LR_MODEMCONFIG2] >> 2 ) & 0x01;
+    uint8_t ldro = ( Regs[1][REG_LR_MODEMCONFIG3] >> 3 ) & 0x01;
+    uint16_t preambleLen = ( Regs[1][REG_LR_PREAMBLEMSB] << 8 ) | Regs[1][REG_LR_PREAMBLELSB];
+    double nPayload;
+
+    if( sf < 6 )
+    {
+        sf = 6;
+    }
+    else if( sf > 12 )
+    {
+        sf = 12;
+    }
+    nPayload = ceil( ( 8.0 * size - 4 * sf + 28 + 16 * crcOn - 20 * implicitHeader ) /
+                     ( 4.0 * ( sf - 2 * ldro ) ) ) * ( cr + 4 );
+
+    return ( preambleLen + 4.25 + 8 + ( ( nPayload > 0 ) ? nPayload : 0 ) ) * SymbolTime( );
+}
+
+void SX1276EmuSetRxFrame( const uint8_t *payload, uint8_t size, int16_t rssi, int8_t snr )
+{
+    RxFramePending = ( payload != NULL );
+    if( payload != NULL )
+    {
+        memcpy( RxFrame, payload, size );
+    }
+    RxFrameSize = size;
+    RxFrameRssi = rssi;
+    RxFrameSnr = snr;
+}
+
+void SX1276EmuSetChannelBusy( bool busy )
+{
+    ChannelBusy = busy;
+}
+
+void SX1276EmuSetDioLost( bool lost )
+{
+    DioLost = lost;
+}
+
+uint32_t SX1276EmuGetRandomCalls( void )
+{
+    return RandomCalls;
+}
+
+void SX1276EmuSetWidebandNoise( uint32_t seed, uint8_t ones )
+{
+    Noise = ( seed != 0 ) ? seed : 1;
+    WidebandOnes = ones;
+}
+
+uint32_t SX1276EmuGetWidebandReads( bool receiving )
+{
+    return WidebandReads[( receiving == true ) ? 1 : 0];
+}
+
+uint32_t SX1276EmuGetSpiTransactions( void )
+{
+    return SpiTransactions;
+}
+
+void SX1276EmuClearSpiLog( void )
+{
+    SpiLogCount = 0;
+}
+
+const SX1276EmuSpiRecord_t* SX1276EmuGetSpiLog( uint16_t *count )
+{
+    *count = SpiLogCount;
+    return SpiLog;
+}
+
+void SX1276EmuFailSpi( void )
+{
+    SpiFail = true;
+}
+
+void SX1276EmuSetTxHandler( SX1276EmuTxHandler_t *handler )
+{
+    TxHandler = handler;
+}
+
+void SX1276EmuSetTxStartHandler( SX1276EmuTxHandler_t *handler )
+{
+    TxStartHandler = handler;
+}
+
+void SX1276EmuPutOnAir( const SX1276EmuFrame_t *frame )
+{
+    uint32_t now = TimerGetCurrentTime( );
+    uint8_t count = 0;
+
+    // Forget the frames over, but the one being received
+    for( uint8_t i = 0; i < AirFrameCount; i++ )
+    {
+        if( ( ( int32_t )( AirFrames[i].Start + AirFrames[i].Duration - now ) > 0 ) || ( AirFrameIds[i] == RxAirFrameId ) )
+        {
+            AirFrames[count] = AirFrames[i];
+            AirFrameIds[count] = AirFrameIds[i];
+            count++;
+        }
+    }
+    if( count == SX1276_EMU_AIR_FRAMES )
+    {
+        memmove( AirFrames, AirFrames + 1, ( count - 1 ) * sizeof( AirFrames[0] ) );
+        memmove( AirFrameIds, AirFrameIds + 1, ( count - 1 ) * sizeof( AirFrameIds[0] ) );
+        count--;
+    }
+    AirFrames[count] = *frame;
+    if( AirFrames[count].Duration == 0 )
+    {
+        AirFrames[count].Duration = SX1276EmuFrameTimeOnAir( frame );
+    }
+    AirFrameIds[count] = AirFrameNextId++;
+    AirFrameCount = count + 1;
+
+    // A receiver still looking for a preamble may lock on it
+    if( ( Event != EMU_EVENT_RX_DONE ) && ( RxAirFrameId == 0 ) &&
+        ( ( OpMode( ) == RFLR_OPMODE_RECEIVER ) || ( ( LoRaMode( ) == true ) && ( OpMode( ) == RFLR_OPMODE_RECEIVER_SINGLE ) ) ) )
+    {
+        CatchAirFrame( );
+    }
+}
+
+uint32_t SX1276EmuGetCollisions( void )
+{
+    return Collisions;
+}
+
+uint32_t SX1276EmuFrameTimeOnAir( const SX1276EmuFrame_t *frame )
+{
+    double time;
+
+    if( frame->Lora == true )
+    {
+        uint8_t sf = ( frame->Sf < 6 ) ? 6 : ( ( frame->Sf > 12 ) ? 12 : frame->Sf );
+        double symbolTime = ( double )( 1 << sf ) * 1e6 / Bandwidths[( frame->Bw > 9 ) ? 9 : frame->Bw];
+        uint8_t ldro = ( symbolTime > 16000 ) ? 1 : 0;
+        uint8_t crcOn = ( frame->IqInverted == true ) ? 0 : 1;
+        double nPayload = ceil( ( 8.0 * frame->Size - 4 * sf + 28 + 16 * crcOn ) / ( 4.0 * ( sf - 2 * ldro ) ) ) * 5;
+
+        // Preamble of 8 symbols, explicit header, coding rate 4/5
+        time = ( 8 + 4.25 + 8 + ( ( nPayload > 0 ) ? nPayload : 0 ) ) * symbolTime;
+    }
+    else
+    {
+        time = ( FSK_PREAMBLE_SIZE + FSK_SYNC_SIZE + 1 + frame->Size + FSK_CRC_SIZE ) * 8e6 / frame->Bitrate;
+    }
+    return ( uint32_t )ceil( time / 1000 );
+}
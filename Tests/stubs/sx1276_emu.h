@@ -0,0 +1,219 @@
+ /******************************************************************************
+  * @file    sx1276_emu.h
+  * @brief   host emulator of the SX1276 behind the SPI bus, the NSS and reset
+  *          lines and the DIO interrupts, it also plays the board driver
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SX1276_EMU_H__
+#define __SX1276_EMU_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/*!
+ * Number of SPI transactions the recorder keeps, the later ones are counted
+ * only
+ */
+#define SX1276_EMU_SPI_LOG_SIZE                     512
+
+/*!
+ * Number of frames the air holds at once, the oldest make room
+ */
+#define SX1276_EMU_AIR_FRAMES                       16
+
+/* Exported types ------------------------------------------------------------*/
+
+/*!
+ * NSS framed SPI transaction seen by the emulator
+ */
+typedef struct
+{
+    uint8_t Addr;                  //! First register address
+    bool Write;                    //! Direction
+    bool Lora;                     //! Page of the registers 0x0D to 0x3F
+    uint16_t Size;                 //! Data bytes after the address
+}SX1276EmuSpiRecord_t;
+
+/*!
+ * Frame on the air, sent by the emulated radio or by the tests
+ */
+typedef struct
+{
+    uint32_t Start;                //! Start of the preamble, time of the timer stub [ms]
+    uint32_t Duration;             //! Time on air [ms], 0 to compute it
+    uint32_t Frequency;            //! Center frequency [Hz]
+    bool Lora;                     //! LoRa or FSK modulation
+    uint8_t Sf;                    //! LoRa spreading factor
+    uint8_t Bw;                    //! LoRa bandwidth, RegModemConfig1 index
+    bool IqInverted;               //! LoRa I and Q inverted, as the downlinks
+    uint32_t Bitrate;              //! FSK bit rate [bps]
+    int16_t Rssi;                  //! Signal strength at the receiver, the output power of the frames sent [dBm]
+    int8_t Snr;                    //! Signal to noise ratio at the receiver [dB]
+    uint8_t Size;                  //! Payload size
+    uint8_t Payload[255];          //! Payload
+}SX1276EmuFrame_t;
+
+/*!
+ * Handler of the frames the emulated radio sends
+ */
+typedef void ( SX1276EmuTxHandler_t )( const SX1276EmuFrame_t *frame );
+
+/* Exported functions ------------------------------------------------------- */
+
+/*!
+ * \brief Powers the emulated radio up, its registers at their reset values,
+ *        the air quiet and nothing to receive
+ *
+ * \remark The emulator runs its events on the timer stub, call it after
+ *         TimerStubReset
+ */
+void SX1276EmuReset( void );
+
+/*!
+ * \brief Returns a register without the side effects of an SPI read
+ *
+ * \param [IN] lora Page of the registers 0x0D to 0x3F [false: FSK, true: LoRa]
+ * \param [IN] addr Register address
+ */
+uint8_t SX1276EmuGetRegister( bool lora, uint8_t addr );
+
+/*!
+ * \brief Returns the data buffer of the LoRa modem
+ */
+const uint8_t* SX1276EmuGetFifo( void );
+
+/*!
+ * \brief Time on air of a LoRa packet with the modem registers as they are,
+ *        computed in floating point from the formula of the datasheet
+ *
+ * \param [IN] size Payload size
+ * \retval Time on air in us
+ */
+double SX1276EmuTimeOnAir( uint8_t size );
+
+/*!
+ * \brief Sets the frame the next LoRa reception catches, its preamble
+ *        starting with the reception
+ *
+ * \param [IN] payload Payload of the frame, NULL for none
+ * \param [IN] size Payload size
+ * \param [IN] rssi Signal strength of the frame [dBm]
+ * \param [IN] snr Signal to noise ratio of the frame [dB]
+ */
+void SX1276EmuSetRxFrame( const uint8_t *payload, uint8_t size, int16_t rssi, int8_t snr );
+
+/*!
+ * \brief Sets whether another node transmits, seen by the RSSI and the CAD
+ */
+void SX1276EmuSetChannelBusy( bool busy );
+
+/*!
+ * \brief Sets whether the LoRa interrupts are lost on their way to the MCU,
+ *        their flags still rise
+ */
+void SX1276EmuSetDioLost( bool lost );
+
+/*!
+ * \brief Sets the noise the wideband RSSI follows while receiving
+ *
+ * \param [IN] seed Seed of the noise
+ * \param [IN] ones Share of the readings with their LSB at 1 [%]
+ */
+void SX1276EmuSetWidebandNoise( uint32_t seed, uint8_t ones );
+
+/*!
+ * \brief Returns the number of wideband RSSI reads
+ *
+ * \param [IN] receiving Reads while receiving or while the register held
+ *                       its last reading
+ */
+uint32_t SX1276EmuGetWidebandReads( bool receiving );
+
+/*!
+ * \brief Returns the number of Radio.Random calls since the reset
+ */
+uint32_t SX1276EmuGetRandomCalls( void );
+
+/*!
+ * \brief Returns the number of NSS framed SPI transactions since the reset
+ *        of the emulator
+ */
+uint32_t SX1276EmuGetSpiTransactions( void );
+
+/*!
+ * \brief Empties the SPI transaction recorder
+ */
+void SX1276EmuClearSpiLog( void );
+
+/*!
+ * \brief Returns the SPI transactions recorded since the last clear
+ *
+ * \param [OUT] count Number of records
+ */
+const SX1276EmuSpiRecord_t* SX1276EmuGetSpiLog( uint16_t *count );
+
+/*!
+ * \brief Makes the next HW_SPI_Transfer stop responding half way through
+ */
+void SX1276EmuFailSpi( void );
+
+/*!
+ * \brief Sets the handler of the frames the emulated radio sends, called at
+ *        the end of the transmission
+ *
+ * \param [IN] handler Handler, NULL for none
+ */
+void SX1276EmuSetTxHandler( SX1276EmuTxHandler_t *handler );
+
+/*!
+ * \brief Sets the handler of the frames the emulated radio starts to send,
+ *        called at the start of the transmission with the time on air the
+ *        transmission will last
+ *
+ * \param [IN] handler Handler, NULL for none
+ */
+void SX1276EmuSetTxStartHandler( SX1276EmuTxHandler_t *handler );
+
+/*!
+ * \brief Puts a frame on the air. The emulated radio receives it when its
+ *        receiver matches the frequency and the modulation and locks on the
+ *        preamble, a frame on the same channel less than 6 dB weaker
+ *        overlapping it corrupts it
+ *
+ * \remark The LoRa frames with I and Q inverted have no payload CRC, as the
+ *         LoRaWAN downlinks, when the time on air is computed
+ */
+void SX1276EmuPutOnAir( const SX1276EmuFrame_t *frame );
+
+/*!
+ * \brief Returns the number of frames received corrupted by another one
+ */
+uint32_t SX1276EmuGetCollisions( void );
+
+/*!
+ * \brief Returns the time on air of a frame [ms], rounded up
+ */
+uint32_t SX1276EmuFrameTimeOnAir( const SX1276EmuFrame_t *frame );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SX1276_EMU_H__ */
@@ -0,0 +1,188 @@
+ /******************************************************************************
+  * @file    timer_stub.c
+  * @brief   host stand-in of the timer server, driven by the tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdbool.h>
+#include "hw.h"
+#include "timer_stub.h"
+
+/* Private variables ---------------------------------------------------------*/
+
+/*!
+ * Running timers, unsorted. Timestamp holds the absolute expiry time in ms
+ */
+static TimerEvent_t *TimerListHead = NULL;
+
+/*!
+ * Current time in ms
+ */
+static TimerTime_t TimerStubNow = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/*!
+ * \brief Returns the running timer expiring first, NULL when none runs
+ */
+static TimerEvent_t* TimerStubFirst( void )
+{
+    TimerEvent_t* first = TimerListHead;
+
+    for( TimerEvent_t* cur = TimerListHead; cur != NULL; cur = cur->Next )
+    {
+        if( ( int32_t )( cur->Timestamp - first->Timestamp ) < 0 )
+        {
+            first = cur;
+        }
+    }
+    return first;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) )
+{
+    obj->Timestamp = 0;
+    obj->ReloadValue = 0;
+    obj->Slack = 0;
+    obj->IsRunning = false;
+    obj->Callback = callback;
+    obj->Next = NULL;
+}
+
+void TimerStart( TimerEvent_t *obj )
+{
+    TimerStop( obj );
+    obj->Timestamp = TimerStubNow + obj->ReloadValue;
+    obj->IsRunning = true;
+    obj->Next = TimerListHead;
+    TimerListHead = obj;
+}
+
+void TimerStop( TimerEvent_t *obj )
+{
+    for( TimerEvent_t** cur = &TimerListHead; *cur != NULL; cur = &( *cur )->Next )
+    {
+        if( *cur == obj )
+        {
+            *cur = obj->Next;
+            break;
+        }
+    }
+    obj->Next = NULL;
+    obj->IsRunning = false;
+}
+
+void TimerReset( TimerEvent_t *obj )
+{
+    TimerStart( obj );
+}
+
+void TimerSetValue( TimerEvent_t *obj, uint32_t value )
+{
+    TimerStop( obj );
+    obj->Timestamp = value;
+    obj->ReloadValue = value;
+}
+
+void TimerSetSlack( TimerEvent_t *obj, uint32_t slack )
+{
+    obj->Slack = slack;
+}
+
+void TimerIrqHandler( void )
+{
+    TimerEvent_t* first;
+
+    while( ( ( first = TimerStubFirst( ) ) != NULL ) &&
+           ( ( int32_t )( first->Timestamp - TimerStubNow ) <= 0 ) )
+    {
+        TimerStop( first );
+        if( first->Callback != NULL )
+        {
+            first->Callback( );
+        }
+    }
+}
+
+void TimerDelayMs( uint32_t delay )
+{
+    // Busy wait of the firmware, the timers expiring meanwhile run on the next advance
+    TimerStubNow += delay;
+}
+
+TimerTime_t TimerGetCurrentTime( void )
+{
+    return TimerStubNow;
+}
+
+TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime )
+{
+    return TimerStubNow - savedTime;
+}
+
+void TimerStubReset( TimerTime_t now )
+{
+    while( TimerListHead != NULL )
+    {
+        TimerStop( TimerListHead );
+    }
+    TimerStubNow = now;
+}
+
+void TimerStubAdvance( TimerTime_t delay )
+{
+    TimerTime_t target = TimerStubNow + delay;
+    TimerEvent_t* first;
+
+    while( ( ( first = TimerStubFirst( ) ) != NULL ) &&
+           ( ( int32_t )( first->Timestamp - target ) <= 0 ) )
+    {
+        if( ( int32_t )( first->Timestamp - TimerStubNow ) > 0 )
+        {
+            TimerStubNow = first->Timestamp;
+        }
+        TimerIrqHandler( );
+    }
+    TimerStubNow = target;
+}
+
+bool TimerStubGetNextExpiry( TimerTime_t *expiry )
+{
+    TimerEvent_t* first = TimerStubFirst( );
+
+    if( first == NULL )
+    {
+        return false;
+    }
+    *expiry = first->Timestamp;
+    return true;
+}
+
+/* RTC of the energy ledger, a tick per ms on the time of the stub -----------*/
+
+uint32_t HW_RTC_GetTimerValue( void )
+{
+    return TimerStubNow;
+}
+
+uint32_t HW_RTC_ms2Tick( uint32_t timeMicroSec )
+{
+    return timeMicroSec;
+}
+
+uint32_t HW_RTC_Tick2ms( uint32_t tick )
+{
+    return tick;
+}
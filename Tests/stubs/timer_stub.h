@@ -0,0 +1,55 @@
+ /******************************************************************************
+  * @file    timer_stub.h
+  * @brief   host stand-in of the timer server, driven by the tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TIMER_STUB_H__
+#define __TIMER_STUB_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "timer.h"
+
+/* Exported functions ------------------------------------------------------- */
+
+/*!
+ * \brief Drops every running timer and sets the current time
+ *
+ * \param [IN] now Current time in ms
+ */
+void TimerStubReset( TimerTime_t now );
+
+/*!
+ * \brief Moves the time forward, calling the callbacks of the timers that
+ *        expire on the way in expiry order
+ *
+ * \param [IN] delay Time to move forward, in ms
+ */
+void TimerStubAdvance( TimerTime_t delay );
+
+/*!
+ * \brief Gets the expiry of the running timer expiring first
+ *
+ * \param [OUT] expiry Expiry time in ms
+ * \retval false when no timer runs
+ */
+bool TimerStubGetNextExpiry( TimerTime_t *expiry );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMER_STUB_H__ */
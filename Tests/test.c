@@ -0,0 +1,75 @@
+ /******************************************************************************
+  * @file    test.c
+  * @brief   checks and timing of the host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include "test.h"
+
+/* Private variables ---------------------------------------------------------*/
+static char TestCaseName[96] = "";
+static uint32_t TestChecks = 0;
+static uint32_t TestFailures = 0;
+
+/* Exported functions --------------------------------------------------------*/
+
+void TestCase( const char* format, ... )
+{
+    va_list args;
+
+    va_start( args, format );
+    vsnprintf( TestCaseName, sizeof( TestCaseName ), format, args );
+    va_end( args );
+}
+
+void TestCheck( bool cond, const char* text, const char* file, int line )
+{
+    TestChecks++;
+    if( cond == false )
+    {
+        TestFailures++;
+        printf( "%s:%d: %s: failed: %s\n", file, line, TestCaseName, text );
+    }
+}
+
+void TestCheckEqual( int64_t actual, int64_t expected, const char* text, const char* file, int line )
+{
+    TestChecks++;
+    if( actual != expected )
+    {
+        TestFailures++;
+        printf( "%s:%d: %s: failed: %s is %lld, expected %lld\n", file, line, TestCaseName,
+                text, ( long long )actual, ( long long )expected );
+    }
+}
+
+uint64_t TestClockNs( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint64_t )now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void TestBenchReport( const char* label, uint64_t elapsedNs, uint32_t iterations )
+{
+    printf( "  %-40s %8llu ns/call\n", label, ( unsigned long long )( elapsedNs / iterations ) );
+}
+
+int TestSummary( void )
+{
+    printf( "%u checks, %u failures\n", TestChecks, TestFailures );
+    return ( TestFailures == 0 ) ? 0 : 1;
+}
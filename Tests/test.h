@@ -0,0 +1,83 @@
+ /******************************************************************************
+  * @file    test.h
+  * @brief   checks and timing of the host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Exported macros -----------------------------------------------------------*/
+
+/*!
+ * \brief Counts a check, reports its location when the condition is false
+ */
+#define TEST_CHECK( cond )                          TestCheck( ( cond ), #cond, __FILE__, __LINE__ )
+
+/*!
+ * \brief Counts a check, reports both values when they differ
+ */
+#define TEST_CHECK_EQUAL( actual, expected )        TestCheckEqual( ( int64_t )( actual ), ( int64_t )( expected ), #actual, __FILE__, __LINE__ )
+
+/*!
+ * \brief Runs a statement the given number of times and prints the mean
+ *        duration of one run in ns
+ */
+#define TEST_BENCH( label, iterations, ... )                                \
+    do                                                                      \
+    {                                                                       \
+        uint64_t benchStart = TestClockNs( );                               \
+        for( uint32_t benchRun = 0; benchRun < ( iterations ); benchRun++ ) \
+        {                                                                   \
+            __VA_ARGS__;                                                    \
+        }                                                                   \
+        TestBenchReport( label, TestClockNs( ) - benchStart, iterations );  \
+    }while( 0 )
+
+/* Exported functions ------------------------------------------------------- */
+
+/*!
+ * \brief Names the test case the following failures belong to
+ */
+void TestCase( const char* format, ... );
+
+void TestCheck( bool cond, const char* text, const char* file, int line );
+
+void TestCheckEqual( int64_t actual, int64_t expected, const char* text, const char* file, int line );
+
+/*!
+ * \brief Monotonic time in ns
+ */
+uint64_t TestClockNs( void );
+
+void TestBenchReport( const char* label, uint64_t elapsedNs, uint32_t iterations );
+
+/*!
+ * \brief Prints the number of checks and failures
+ *
+ * \retval Returns the process exit status, non-zero on failure
+ */
+int TestSummary( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TEST_H__ */
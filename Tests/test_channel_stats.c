@@ -0,0 +1,200 @@
+ /******************************************************************************
+  * @file    test_channel_stats.c
+  * @brief   host test of the channel statistics and of the weighted channel
+  *          selection, REGION_COMMON_CHANNEL_STATS > 0
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "region/Region.h"
+#include "region/RegionCommon.h"
+#include "radio_stub.h"
+#include "timer_stub.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#if ( REGION_COMMON_CHANNEL_STATS == 0 )
+#error "Build with REGION_COMMON_CHANNEL_STATS > 0"
+#endif
+
+#define NB_UPLINKS                                  16000
+
+/* Private functions ---------------------------------------------------------*/
+
+static void ResetRegion( LoRaMacRegion_t region )
+{
+    RadioStubReset( );
+    TimerStubReset( 3600000 );
+    RegionInitDefaults( region, INIT_TYPE_INIT );
+    RegionCommonChannelStatsReset( );
+}
+
+static uint8_t NextChannel( LoRaMacRegion_t region )
+{
+    NextChanParams_t nextChan;
+    TimerTime_t aggregatedTimeOff = 0;
+    TimerTime_t time = 0;
+    uint8_t channel = 0xFF;
+
+    nextChan.AggrTimeOff = 0;
+    nextChan.LastAggrTx = 0;
+    nextChan.Datarate = DR_0;
+    nextChan.Joined = true;
+    nextChan.DutyCycleEnabled = false;
+    nextChan.Query = false;
+    nextChan.BusyChannelsMask = NULL;
+    TEST_CHECK( RegionNextChannel( region, &nextChan, &channel, &time, &aggregatedTimeOff ) );
+    TEST_CHECK_EQUAL( time, 0 );
+    return channel;
+}
+
+/*!
+ * \brief Confirmed uplink on a channel, acknowledged or not
+ */
+static void ConfirmedUplink( uint8_t channel, bool acked )
+{
+    RegionCommonChannelStatsTx( channel );
+    if( acked == true )
+    {
+        RegionCommonChannelStatsRx( channel, -80, 7 );
+        RegionCommonChannelStatsAck( channel );
+    }
+    else
+    {
+        RegionCommonChannelStatsRxTimeout( channel );
+        RegionCommonChannelStatsRxTimeout( channel );
+    }
+}
+
+static void TestRecord( void )
+{
+    RegionCommonChannelStats_t stats;
+
+    TestCase( "channel statistics record" );
+    RegionCommonChannelStatsReset( );
+    ConfirmedUplink( 5, true );
+    ConfirmedUplink( 5, false );
+    // Unconfirmed uplink, with and without a downlink
+    RegionCommonChannelStatsRx( 5, -100, -3 );
+    RegionCommonChannelStatsRxTimeout( 5 );
+    RegionCommonChannelStatsBusy( 5 );
+    TEST_CHECK( RegionCommonChannelStatsGet( 5, &stats ) );
+    TEST_CHECK_EQUAL( stats.Attempts, 2 );
+    TEST_CHECK_EQUAL( stats.Acks, 1 );
+    TEST_CHECK_EQUAL( stats.Downlinks, 2 );
+    TEST_CHECK_EQUAL( stats.RxTimeouts, 3 );
+    TEST_CHECK_EQUAL( stats.Busy, 1 );
+    TEST_CHECK_EQUAL( stats.Rssi, -100 );
+    TEST_CHECK_EQUAL( stats.Snr, -3 );
+
+    TestCase( "channel statistics limits" );
+    // An acknowledgement without an attempt is ignored
+    RegionCommonChannelStatsAck( 6 );
+    TEST_CHECK( RegionCommonChannelStatsGet( 6, &stats ) );
+    TEST_CHECK_EQUAL( stats.Acks, 0 );
+    // The attempts and acks are halved before they saturate, the other
+    // counters stop at 255
+    for( uint16_t i = 0; i < 400; i++ )
+    {
+        ConfirmedUplink( 7, ( i % 4 ) != 0 );
+    }
+    TEST_CHECK( RegionCommonChannelStatsGet( 7, &stats ) );
+    TEST_CHECK( stats.Attempts < 0xFF );
+    TEST_CHECK( stats.Acks <= stats.Attempts );
+    TEST_CHECK_EQUAL( stats.Downlinks, 0xFF );
+    TEST_CHECK_EQUAL( stats.RxTimeouts, 200 );
+    TEST_CHECK( RegionCommonChannelStatsGet( REGION_COMMON_STATS_MAX_CHANNELS, &stats ) == false );
+    RegionCommonChannelStatsTx( REGION_COMMON_STATS_MAX_CHANNELS );
+
+    RegionCommonChannelStatsReset( );
+    TEST_CHECK( RegionCommonChannelStatsGet( 7, &stats ) );
+    TEST_CHECK_EQUAL( stats.Attempts, 0 );
+    TEST_CHECK_EQUAL( stats.Downlinks, 0 );
+}
+
+/*!
+ * \brief A channel which loses every acknowledgement gets fewer uplinks, yet
+ *        stays in use
+ */
+static void TestWeightedSelection( void )
+{
+    ChannelParams_t newChannel = { 0, 0, { .Fields = { .Min = DR_0, .Max = DR_5 } }, 0 };
+    ChannelAddParams_t channelAdd = { &newChannel, 0 };
+    uint32_t used[16] = { 0 };
+    uint8_t channel;
+
+    TestCase( "EU868 weighted channel selection" );
+    ResetRegion( LORAMAC_REGION_EU868 );
+    for( uint8_t i = 3; i < 8; i++ )
+    {
+        newChannel.Frequency = 867100000 + ( i - 3 ) * 200000;
+        channelAdd.ChannelId = i;
+        TEST_CHECK_EQUAL( RegionChannelAdd( LORAMAC_REGION_EU868, &channelAdd ), LORAMAC_STATUS_OK );
+    }
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        channel = NextChannel( LORAMAC_REGION_EU868 );
+        TEST_CHECK( channel < 8 );
+        used[channel]++;
+        ConfirmedUplink( channel, channel != 4 );
+    }
+    // Weight 4 against 16 for the 7 other channels
+    TEST_CHECK( used[4] > ( NB_UPLINKS / 60 ) );
+    TEST_CHECK( used[4] < ( NB_UPLINKS / 16 ) );
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        TEST_CHECK( ( i == 4 ) || ( used[i] > ( NB_UPLINKS / 10 ) ) );
+    }
+    printf( "EU868 weighted selection: %u of %u uplinks on the unacknowledged channel, %u uniformly\n",
+            ( unsigned )used[4], NB_UPLINKS, NB_UPLINKS / 8 );
+}
+
+/*!
+ * \brief The remaining channels mask of US915 uses every channel once per
+ *        round, whatever the weights
+ */
+static void TestRoundRobinSelection( void )
+{
+    uint32_t used[72] = { 0 };
+    uint8_t channel;
+
+    TestCase( "US915 selection rounds" );
+    ResetRegion( LORAMAC_REGION_US915 );
+    for( uint32_t i = 0; i < 64 * 50; i++ )
+    {
+        channel = NextChannel( LORAMAC_REGION_US915 );
+        TEST_CHECK( channel < 64 );
+        used[channel]++;
+        ConfirmedUplink( channel, channel != 10 );
+    }
+    for( uint8_t i = 0; i < 64; i++ )
+    {
+        TEST_CHECK_EQUAL( used[i], 50 );
+    }
+}
+
+int main( void )
+{
+    srand1( 1 );
+
+    TestRecord( );
+    TestWeightedSelection( );
+    TestRoundRobinSelection( );
+
+    return TestSummary( );
+}
@@ -0,0 +1,381 @@
+ /******************************************************************************
+  * @file    test_dc_budget.c
+  * @brief   host simulation of traffic against the duty cycle window of the
+  *          region layer, REGION_COMMON_DC_WINDOW_FRAMES > 0, and against
+  *          the time-off after every frame
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "region/Region.h"
+#include "region/RegionCommon.h"
+#include "radio_stub.h"
+#include "timer_stub.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#if ( REGION_COMMON_DC_WINDOW_FRAMES == 0 )
+#error "Build with REGION_COMMON_DC_WINDOW_FRAMES > 0"
+#endif
+
+#define HOUR                                        3600000
+
+/*!
+ * Duty cycle of the band of the EU868 default channels
+ */
+#define BAND_DCYCLE                                 100
+
+/*!
+ * Airtime allowed in any one hour window on the default channels
+ */
+#define HOURLY_AIRTIME                              ( HOUR / BAND_DCYCLE )
+
+#define MAX_FRAMES                                  4096
+
+/*!
+ * Length of the traffic simulations
+ */
+#define TRAFFIC_DURATION                            ( 7 * HOUR )
+
+/* Private typedef -----------------------------------------------------------*/
+
+typedef struct sFrame
+{
+    TimerTime_t Start;
+    TimerTime_t TimeOnAir;
+}Frame_t;
+
+/*!
+ * Frames queued by the application and what the band let through
+ */
+typedef struct sTraffic
+{
+    uint32_t Sent;
+    TimerTime_t Airtime;
+    TimerTime_t Latency;
+    TimerTime_t MaxHourlyAirtime;
+}Traffic_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static Frame_t Frames[MAX_FRAMES];
+static uint16_t NbFrames;
+
+/*!
+ * Frames queued by the application, Start holding the time they are queued
+ */
+static Frame_t Queue[MAX_FRAMES];
+static uint16_t QueueSize;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void ResetRegion( void )
+{
+    RadioStubReset( );
+    TimerStubReset( HOUR );
+    RegionInitDefaults( LORAMAC_REGION_EU868, INIT_TYPE_INIT );
+    NbFrames = 0;
+}
+
+/*!
+ * \brief Time to wait before the next uplink may go out, with the duty cycle
+ *        enforced
+ *
+ * \param [IN] window Joined, the band spends its duty cycle over the window.
+ *                    Otherwise the region applies the time-off after every
+ *                    frame, 1% on the default channels like the band.
+ */
+static TimerTime_t NextTxDelay( uint8_t* channel, bool window )
+{
+    NextChanParams_t nextChan;
+    TimerTime_t aggregatedTimeOff = 0;
+    TimerTime_t time = 0;
+
+    nextChan.AggrTimeOff = 0;
+    nextChan.LastAggrTx = 0;
+    nextChan.Datarate = DR_0;
+    nextChan.Joined = window;
+    nextChan.DutyCycleEnabled = true;
+    nextChan.Query = false;
+    nextChan.BusyChannelsMask = NULL;
+    TEST_CHECK( RegionNextChannel( LORAMAC_REGION_EU868, &nextChan, channel, &time, &aggregatedTimeOff ) );
+    return time;
+}
+
+/*!
+ * \brief Transmits a frame now, records it and computes the band time-off
+ */
+static void Send( uint8_t channel, TimerTime_t timeOnAir, bool window )
+{
+    SetBandTxDoneParams_t txDone;
+    CalcBackOffParams_t calcBackOff;
+
+    if( NbFrames < MAX_FRAMES )
+    {
+        Frames[NbFrames].Start = TimerGetCurrentTime( );
+        Frames[NbFrames].TimeOnAir = timeOnAir;
+        NbFrames++;
+    }
+    TimerStubAdvance( timeOnAir );
+
+    txDone.Channel = channel;
+    txDone.Joined = window;
+    txDone.LastTxDoneTime = TimerGetCurrentTime( );
+    RegionSetBandTxDone( LORAMAC_REGION_EU868, &txDone );
+
+    calcBackOff.Joined = window;
+    calcBackOff.LastTxIsJoinRequest = false;
+    calcBackOff.DutyCycleEnabled = true;
+    calcBackOff.Channel = channel;
+    calcBackOff.ElapsedTime = 0;
+    calcBackOff.TxTimeOnAir = timeOnAir;
+    RegionCalcBackOff( LORAMAC_REGION_EU868, &calcBackOff );
+}
+
+/*!
+ * \brief Sends as many frames as the band allows, back to back
+ *
+ * \retval Returns the number of frames sent before the band closed
+ */
+static uint16_t Burst( TimerTime_t timeOnAir )
+{
+    uint16_t nbFrames = 0;
+    uint8_t channel;
+
+    while( NextTxDelay( &channel, true ) == 0 )
+    {
+        Send( channel, timeOnAir, true );
+        nbFrames++;
+    }
+    return nbFrames;
+}
+
+/*!
+ * \brief Largest airtime of the recorded frames in any one hour window
+ *
+ * The largest window either starts at the start of a frame or ends at the
+ * end of one, the frames partly out of the window are cut.
+ */
+static TimerTime_t MaxHourlyAirtime( void )
+{
+    TimerTime_t maxAirtime = 0;
+
+    for( uint16_t i = 0; i < NbFrames; i++ )
+    {
+        TimerTime_t from = Frames[i].Start;
+        TimerTime_t to = Frames[i].Start + Frames[i].TimeOnAir;
+        TimerTime_t forward = 0;
+        TimerTime_t backward = 0;
+
+        for( uint16_t j = 0; j < NbFrames; j++ )
+        {
+            TimerTime_t start = Frames[j].Start;
+            TimerTime_t end = Frames[j].Start + Frames[j].TimeOnAir;
+
+            // Window [from, from + HOUR)
+            if( ( end > from ) && ( start < ( from + HOUR ) ) )
+            {
+                forward += MIN( end, from + HOUR ) - MAX( start, from );
+            }
+            // Window [to - HOUR, to)
+            if( ( end > ( to - HOUR ) ) && ( start < to ) )
+            {
+                backward += MIN( end, to ) - MAX( start, to - HOUR );
+            }
+        }
+        maxAirtime = MAX( maxAirtime, MAX( forward, backward ) );
+    }
+    return maxAirtime;
+}
+
+static void TestBurst( void )
+{
+    TimerTime_t timeOnAir = 3000;
+    TimerTime_t delay;
+    uint8_t channel;
+
+    TestCase( "EU868 burst of %u ms frames", timeOnAir );
+    ResetRegion( );
+    // The band stays open while the longest frame still fits in the hour
+    TEST_CHECK_EQUAL( Burst( timeOnAir ), ( HOURLY_AIRTIME - REGION_COMMON_DC_MAX_FRAME_AIRTIME ) / timeOnAir + 1 );
+    TEST_CHECK( MaxHourlyAirtime( ) <= HOURLY_AIRTIME );
+    // and reopens when the first frame is out of the hour
+    delay = NextTxDelay( &channel, true );
+    TEST_CHECK_EQUAL( delay, Frames[0].Start + timeOnAir + HOUR - TimerGetCurrentTime( ) );
+    TimerStubAdvance( delay - 1 );
+    TEST_CHECK( NextTxDelay( &channel, true ) > 0 );
+    // Each frame of the burst goes out when the one it replaces is out of
+    // the hour, the burst repeats an hour after the first one
+    TimerStubAdvance( 1 );
+    TEST_CHECK_EQUAL( Burst( timeOnAir ), ( HOURLY_AIRTIME - REGION_COMMON_DC_MAX_FRAME_AIRTIME ) / timeOnAir + 1 );
+    TEST_CHECK_EQUAL( Frames[NbFrames - 1].Start, Frames[NbFrames / 2 - 1].Start + timeOnAir + HOUR );
+    TEST_CHECK( MaxHourlyAirtime( ) <= HOURLY_AIRTIME );
+
+    TestCase( "EU868 burst of frames of the longest time-on-air" );
+    ResetRegion( );
+    TEST_CHECK_EQUAL( Burst( REGION_COMMON_DC_MAX_FRAME_AIRTIME ), HOURLY_AIRTIME / REGION_COMMON_DC_MAX_FRAME_AIRTIME );
+    TEST_CHECK( MaxHourlyAirtime( ) <= HOURLY_AIRTIME );
+
+    // More frames than the window holds, the oldest ones are merged and
+    // leave the window with the next one, never earlier
+    timeOnAir = 1000;
+    TestCase( "EU868 burst of %u ms frames, %u in the window", timeOnAir, REGION_COMMON_DC_WINDOW_FRAMES );
+    ResetRegion( );
+    TEST_CHECK_EQUAL( Burst( timeOnAir ), ( HOURLY_AIRTIME - REGION_COMMON_DC_MAX_FRAME_AIRTIME ) / timeOnAir + 1 );
+    delay = NextTxDelay( &channel, true );
+    TEST_CHECK( delay >= ( Frames[2].Start + timeOnAir + HOUR - TimerGetCurrentTime( ) ) );
+    TEST_CHECK( delay <= ( Frames[NbFrames - REGION_COMMON_DC_WINDOW_FRAMES].Start + timeOnAir + HOUR - TimerGetCurrentTime( ) ) );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        TimerStubAdvance( NextTxDelay( &channel, true ) );
+        TEST_CHECK( Burst( timeOnAir ) > 0 );
+        TEST_CHECK( MaxHourlyAirtime( ) <= HOURLY_AIRTIME );
+    }
+
+    printf( "EU868 burst of 3000 ms frames: %u frames back to back, 1 with the time-off after every frame\n",
+            ( unsigned )( ( HOURLY_AIRTIME - REGION_COMMON_DC_MAX_FRAME_AIRTIME ) / 3000 + 1 ) );
+}
+
+/*!
+ * \brief Queues the traffic of the simulation, frames of random length
+ *        either all at once or in bursts after random idle periods
+ */
+static void QueueTraffic( bool greedy )
+{
+    TimerTime_t now = HOUR;
+
+    QueueSize = 0;
+    while( ( now < TRAFFIC_DURATION ) && ( QueueSize < MAX_FRAMES ) )
+    {
+        Queue[QueueSize].Start = now;
+        Queue[QueueSize].TimeOnAir = randr( 36, REGION_COMMON_DC_MAX_FRAME_AIRTIME );
+        QueueSize++;
+        if( ( greedy == false ) && ( randr( 0, 7 ) == 0 ) )
+        {
+            now += randr( 0, 2 * HOUR );
+        }
+    }
+}
+
+/*!
+ * \brief Sends the queued frames as soon as the band allows and checks
+ *        every one hour window
+ */
+static void RunTraffic( bool window, Traffic_t* traffic )
+{
+    TimerTime_t delay;
+    uint16_t next = 0;
+    uint8_t channel;
+
+    ResetRegion( );
+    traffic->Sent = 0;
+    traffic->Airtime = 0;
+    traffic->Latency = 0;
+    while( ( TimerGetCurrentTime( ) < TRAFFIC_DURATION ) && ( next < QueueSize ) )
+    {
+        if( Queue[next].Start > TimerGetCurrentTime( ) )
+        {
+            TimerStubAdvance( Queue[next].Start - TimerGetCurrentTime( ) );
+            continue;
+        }
+        delay = NextTxDelay( &channel, window );
+        if( delay > 0 )
+        {
+            TimerStubAdvance( delay );
+            continue;
+        }
+        traffic->Latency += TimerGetCurrentTime( ) - Queue[next].Start;
+        Send( channel, Queue[next].TimeOnAir, window );
+        traffic->Sent++;
+        traffic->Airtime += Queue[next].TimeOnAir;
+        next++;
+    }
+    TEST_CHECK( NbFrames < MAX_FRAMES );
+
+    // The time-off after every frame lets the last frame of an hour out of
+    // the hour, only the window is held to it
+    traffic->MaxHourlyAirtime = MaxHourlyAirtime( );
+    TEST_CHECK( ( window == false ) || ( traffic->MaxHourlyAirtime <= HOURLY_AIRTIME ) );
+}
+
+/*!
+ * \brief Runs the same traffic with the window and with the time-off after
+ *        every frame
+ */
+static void TestTraffic( uint32_t seed, bool greedy, Traffic_t* window, Traffic_t* baseline )
+{
+    TestCase( "EU868 %s traffic, seed %u", greedy ? "greedy" : "bursty", seed );
+    srand1( seed );
+    QueueTraffic( greedy );
+    RunTraffic( true, window );
+    RunTraffic( false, baseline );
+    if( greedy == true )
+    {
+        // Steady traffic, the window keeps the longest frame in reserve
+        TEST_CHECK( ( window->Airtime * 10 ) >= ( baseline->Airtime * 9 ) );
+    }
+    else
+    {
+        TEST_CHECK( window->Sent >= baseline->Sent );
+        TEST_CHECK( window->Latency <= baseline->Latency );
+    }
+}
+
+static void PrintTraffic( const char* name, const Traffic_t* window, const Traffic_t* baseline )
+{
+    printf( "EU868 %s traffic over %u h: %u frames, %u ms on air, %u s mean latency with the window, "
+            "%u frames, %u ms on air, %u s mean latency with the time-off after every frame\n",
+            name, ( unsigned )( ( TRAFFIC_DURATION - HOUR ) / HOUR ),
+            ( unsigned )window->Sent, ( unsigned )window->Airtime, ( unsigned )( window->Latency / MAX( window->Sent, 1 ) / 1000 ),
+            ( unsigned )baseline->Sent, ( unsigned )baseline->Airtime, ( unsigned )( baseline->Latency / MAX( baseline->Sent, 1 ) / 1000 ) );
+}
+
+int main( void )
+{
+    Traffic_t window[2] = { { 0 } };
+    Traffic_t baseline[2] = { { 0 } };
+    TimerTime_t maxAirtime[2] = { 0 };
+
+    srand1( 1 );
+
+    TestBurst( );
+    for( uint8_t i = 0; i < 20; i++ )
+    {
+        for( uint8_t greedy = 0; greedy < 2; greedy++ )
+        {
+            Traffic_t w;
+            Traffic_t b;
+
+            TestTraffic( i + 1, greedy, &w, &b );
+            window[greedy].Sent += w.Sent;
+            window[greedy].Airtime += w.Airtime;
+            window[greedy].Latency += w.Latency;
+            baseline[greedy].Sent += b.Sent;
+            baseline[greedy].Airtime += b.Airtime;
+            baseline[greedy].Latency += b.Latency;
+            maxAirtime[0] = MAX( maxAirtime[0], w.MaxHourlyAirtime );
+            maxAirtime[1] = MAX( maxAirtime[1], b.MaxHourlyAirtime );
+        }
+    }
+    PrintTraffic( "greedy", &window[1], &baseline[1] );
+    PrintTraffic( "bursty", &window[0], &baseline[0] );
+    printf( "EU868 random traffic: at most %u ms on air in one hour out of %u ms with the window, "
+            "%u ms with the time-off after every frame\n",
+            ( unsigned )maxAirtime[0], ( unsigned )HOURLY_AIRTIME, ( unsigned )maxAirtime[1] );
+
+    return TestSummary( );
+}
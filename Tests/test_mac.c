@@ -0,0 +1,911 @@
+ /******************************************************************************
+  * @file    test_mac.c
+  * @brief   host test of the LoRaMac layer with the regions and the SX1276
+  *          driver on the emulated radio, against a network server stand-in
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+#include "LoRaMac.h"
+#include "LoRaMacTest.h"
+#include "region/Region.h"
+#include "radio.h"
+#include "sx1276.h"
+#include "sx1276_emu.h"
+#include "ns_stub.h"
+#include "timer_stub.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/*!
+ * Step of the timer stub while waiting for the MAC [ms]
+ */
+#define RUN_STEP                                    10
+
+/*!
+ * Longest wait for a confirm, duty cycle back-offs included [ms]
+ */
+#define RUN_LIMIT                                   ( 3600 * 1000 )
+
+/*!
+ * Flags of the LoRaMac internal state, eLoRaMacState of LoRaMac.c
+ */
+#define MAC_STATE_TX_DELAYED                        0x10
+#define MAC_STATE_TX_CAD                            0x80
+
+/*!
+ * Operating mode bits of RegOpMode, LoRa mode included
+ */
+#define OPMODE_MASK                                 ( RFLR_OPMODE_LONGRANGEMODE_ON | ~RFLR_OPMODE_MASK )
+
+/*!
+ * Period the MAC state check was polled at before the radio and timer
+ * events triggered it [ms]
+ */
+#define STATE_CHECK_POLL_PERIOD                     1000
+
+/* Private variables ---------------------------------------------------------*/
+
+/*!
+ * LoRaMac internal state
+ */
+extern uint32_t LoRaMacState;
+
+static uint8_t DevEui[8] = { 0x00, 0x80, 0xE1, 0x15, 0x00, 0x00, 0x12, 0x34 };
+static uint8_t AppEui[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01 };
+static uint8_t AppKey[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                              0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+
+static LoRaMacPrimitives_t Primitives;
+static LoRaMacCallback_t Callbacks;
+
+static uint32_t McpsConfirmCount;
+static uint32_t McpsIndicationCount;
+static uint32_t MlmeConfirmCount;
+static McpsConfirm_t LastMcpsConfirm;
+static McpsIndication_t LastMcpsIndication;
+static MlmeConfirm_t LastMlmeConfirm;
+static uint8_t RxPayload[256];
+static uint32_t TxFrequency;
+static TimerTime_t TxStartTime;
+static TimerTime_t McpsConfirmTime;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void OnMcpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+    McpsConfirmCount++;
+    LastMcpsConfirm = *mcpsConfirm;
+    McpsConfirmTime = TimerGetCurrentTime( );
+}
+
+static void OnMcpsIndication( McpsIndication_t *mcpsIndication )
+{
+    McpsIndicationCount++;
+    LastMcpsIndication = *mcpsIndication;
+    if( mcpsIndication->RxData == true )
+    {
+        memcpy( RxPayload, mcpsIndication->Buffer, mcpsIndication->BufferSize );
+    }
+}
+
+static void OnMlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+    MlmeConfirmCount++;
+    LastMlmeConfirm = *mlmeConfirm;
+}
+
+static uint8_t GetBatteryLevel( void )
+{
+    return 254;
+}
+
+/*!
+ * \brief Records the carrier frequency of the frames the device sends before
+ *        the network server serves them
+ */
+static void OnAir( const SX1276EmuFrame_t *frame )
+{
+    TxFrequency = frame->Frequency;
+    NsStubOnUplink( frame );
+}
+
+/*!
+ * \brief Records the start of the frames the device sends
+ */
+static void OnTxStart( const SX1276EmuFrame_t *frame )
+{
+    TxStartTime = frame->Start;
+}
+
+/*!
+ * \brief Returns the carrier frequency the radio is tuned to [Hz]
+ */
+static uint32_t RadioFrequency( void )
+{
+    uint32_t frf = ( ( uint32_t )SX1276EmuGetRegister( false, REG_FRFMSB ) << 16 ) |
+                   ( ( uint32_t )SX1276EmuGetRegister( false, REG_FRFMID ) << 8 ) |
+                   SX1276EmuGetRegister( false, REG_FRFLSB );
+
+    return ( uint32_t )( ( double )frf * XTAL_FREQ / 524288.0 + 0.5 );
+}
+
+/*!
+ * \brief Puts another node's LoRa SF7 125 kHz frame on the air
+ */
+static void Jam( uint32_t frequency, uint32_t duration )
+{
+    SX1276EmuFrame_t frame;
+
+    memset( &frame, 0, sizeof( frame ) );
+    frame.Start = TimerGetCurrentTime( );
+    frame.Duration = duration;
+    frame.Frequency = frequency;
+    frame.Lora = true;
+    frame.Sf = 7;
+    frame.Bw = 7;
+    frame.Rssi = -70;
+    frame.Snr = 5;
+    frame.Size = 10;
+    SX1276EmuPutOnAir( &frame );
+}
+
+/*!
+ * \brief Runs the timers until the counter moves, for RUN_LIMIT at most
+ *
+ * \retval true when the counter moved
+ */
+static bool RunUntil( const uint32_t *counter )
+{
+    uint32_t start = *counter;
+
+    for( uint32_t time = 0; ( time < RUN_LIMIT ) && ( *counter == start ); time += RUN_STEP )
+    {
+        TimerStubAdvance( RUN_STEP );
+    }
+    return *counter != start;
+}
+
+/*!
+ * \brief Starts the MAC of the region on a fresh radio and network server
+ */
+static void StartMac( LoRaMacRegion_t region, NsStubPlan_t plan )
+{
+    MibRequestConfirm_t mibReq;
+
+    TimerStubReset( 0 );
+    SX1276EmuReset( );
+    NsStubInit( plan, AppKey );
+    SX1276EmuSetTxHandler( OnAir );
+    SX1276EmuSetTxStartHandler( OnTxStart );
+    Radio.IoInit( );
+
+    McpsConfirmCount = 0;
+    McpsIndicationCount = 0;
+    MlmeConfirmCount = 0;
+
+    Primitives.MacMcpsConfirm = OnMcpsConfirm;
+    Primitives.MacMcpsIndication = OnMcpsIndication;
+    Primitives.MacMlmeConfirm = OnMlmeConfirm;
+    Callbacks.GetBatteryLevel = GetBatteryLevel;
+    TEST_CHECK_EQUAL( LoRaMacInitialization( &Primitives, &Callbacks, region ), LORAMAC_STATUS_OK );
+
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = false;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+/*!
+ * \brief Joins over the air, runs the MAC until the join confirm
+ */
+static bool Join( void )
+{
+    MlmeReq_t mlmeReq;
+    MibRequestConfirm_t mibReq;
+
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.DevEui = DevEui;
+    mlmeReq.Req.Join.AppEui = AppEui;
+    mlmeReq.Req.Join.AppKey = AppKey;
+    mlmeReq.Req.Join.NbTrials = 1;
+    TEST_CHECK_EQUAL( LoRaMacMlmeRequest( &mlmeReq ), LORAMAC_STATUS_OK );
+    TEST_CHECK( RunUntil( &MlmeConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMlmeConfirm.MlmeRequest, MLME_JOIN );
+
+    mibReq.Type = MIB_NETWORK_JOINED;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    return ( LastMlmeConfirm.Status == LORAMAC_EVENT_INFO_STATUS_OK ) && ( mibReq.Param.IsNetworkJoined == true );
+}
+
+/*!
+ * \brief Requests an uplink
+ */
+static void RequestUplink( bool confirmed, uint8_t port, const char *text, int8_t datarate )
+{
+    McpsReq_t mcpsReq;
+
+    if( confirmed == true )
+    {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = port;
+        mcpsReq.Req.Confirmed.fBuffer = ( void* )text;
+        mcpsReq.Req.Confirmed.fBufferSize = strlen( text );
+        mcpsReq.Req.Confirmed.NbTrials = 8;
+        mcpsReq.Req.Confirmed.Datarate = datarate;
+    }
+    else
+    {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = port;
+        mcpsReq.Req.Unconfirmed.fBuffer = ( void* )text;
+        mcpsReq.Req.Unconfirmed.fBufferSize = strlen( text );
+        mcpsReq.Req.Unconfirmed.Datarate = datarate;
+    }
+    TEST_CHECK_EQUAL( LoRaMacMcpsRequest( &mcpsReq ), LORAMAC_STATUS_OK );
+}
+
+/*!
+ * \brief Sends an uplink, runs the MAC until its confirm
+ */
+static void Uplink( bool confirmed, uint8_t port, const char *text, int8_t datarate )
+{
+    RequestUplink( confirmed, port, text, datarate );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    // Leave the MAC back to idle
+    TimerStubAdvance( 100 );
+}
+
+/*!
+ * \brief Checks the payload the network server got last
+ */
+static void CheckNsUplink( uint8_t port, const char *text )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+
+    TEST_CHECK_EQUAL( ns->Port, port );
+    TEST_CHECK_EQUAL( ns->Size, strlen( text ) );
+    TEST_CHECK( memcmp( ns->Payload, text, strlen( text ) ) == 0 );
+}
+
+static void TestJoinAndExchange( LoRaMacRegion_t region, NsStubPlan_t plan, int8_t datarate, const char *name )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    MibRequestConfirm_t mibReq;
+    uint32_t indications;
+
+    TestCase( "%s join", name );
+    StartMac( region, plan );
+    TEST_CHECK( Join( ) );
+    TEST_CHECK_EQUAL( ns->JoinRequests, 1 );
+    TEST_CHECK_EQUAL( ns->MicErrors, 0 );
+    mibReq.Type = MIB_DEV_ADDR;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    TEST_CHECK_EQUAL( mibReq.Param.DevAddr, ns->DevAddr );
+
+    TestCase( "%s unconfirmed uplink", name );
+    indications = McpsIndicationCount;
+    Uplink( false, 2, "hello", datarate );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, 1 );
+    TEST_CHECK_EQUAL( ns->MicErrors, 0 );
+    TEST_CHECK_EQUAL( ns->FCntUp, 0 );
+    TEST_CHECK_EQUAL( ns->Confirmed, false );
+    CheckNsUplink( 2, "hello" );
+    TEST_CHECK_EQUAL( McpsIndicationCount, indications );
+
+    TestCase( "%s downlink in RX1", name );
+    NsStubQueueDownlink( 3, ( const uint8_t* )"down", 4, false );
+    Uplink( false, 2, "again", datarate );
+    TEST_CHECK_EQUAL( ns->Uplinks, 2 );
+    TEST_CHECK_EQUAL( ns->FCntUp, 1 );
+    CheckNsUplink( 2, "again" );
+    TEST_CHECK_EQUAL( ns->Downlinks, 2 );
+    TEST_CHECK_EQUAL( McpsIndicationCount, indications + 1 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxData, true );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxSlot, 0 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.Port, 3 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.BufferSize, 4 );
+    TEST_CHECK( memcmp( RxPayload, "down", 4 ) == 0 );
+    // The emulator gives the signal strength within 1 dB
+    TEST_CHECK( abs( LastMcpsIndication.Rssi - NS_STUB_RSSI ) <= 1 );
+
+    TestCase( "%s downlink in RX2", name );
+    NsStubSetRxWindow( 2 );
+    NsStubQueueDownlink( 4, ( const uint8_t* )"late", 4, false );
+    Uplink( false, 5, "rx2", datarate );
+    TEST_CHECK_EQUAL( McpsIndicationCount, indications + 2 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxData, true );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxSlot, 1 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.Port, 4 );
+    TEST_CHECK( memcmp( RxPayload, "late", 4 ) == 0 );
+    NsStubSetRxWindow( 1 );
+
+    TestCase( "%s confirmed uplink", name );
+    Uplink( true, 6, "confirm", datarate );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.AckReceived, true );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.NbRetries, 1 );
+    TEST_CHECK_EQUAL( ns->Confirmed, true );
+    CheckNsUplink( 6, "confirm" );
+
+    TestCase( "%s confirmed downlink", name );
+    NsStubQueueDownlink( 7, ( const uint8_t* )"ack me", 6, true );
+    Uplink( false, 2, "x", datarate );
+    TEST_CHECK_EQUAL( LastMcpsIndication.McpsIndication, MCPS_CONFIRMED );
+    TEST_CHECK( memcmp( RxPayload, "ack me", 6 ) == 0 );
+    Uplink( false, 2, "y", datarate );
+    TEST_CHECK_EQUAL( ns->Ack, true );
+
+    TestCase( "%s confirmed uplink without answer", name );
+    NsStubSetRxWindow( 0 );
+    indications = ns->Uplinks;
+    Uplink( true, 6, "lost", datarate );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.AckReceived, false );
+    TEST_CHECK_EQUAL( ns->Uplinks, indications + 8 );
+    TEST_CHECK_EQUAL( ns->MicErrors, 0 );
+}
+
+static void TestFsk( void )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    ChannelParams_t channel = { 868800000, 0, { ( DR_7 << 4 ) | DR_7 }, 0 };
+
+    TestCase( "EU868 FSK exchange" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    TEST_CHECK_EQUAL( LoRaMacChannelAdd( 3, channel ), LORAMAC_STATUS_OK );
+
+    NsStubQueueDownlink( 9, ( const uint8_t* )"fsk down", 8, false );
+    Uplink( false, 8, "fsk up", DR_7 );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Datarate, DR_7 );
+    TEST_CHECK_EQUAL( ns->Lora, false );
+    CheckNsUplink( 8, "fsk up" );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxData, true );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxSlot, 0 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxDatarate, DR_7 );
+    TEST_CHECK_EQUAL( LastMcpsIndication.Port, 9 );
+    TEST_CHECK( memcmp( RxPayload, "fsk down", 8 ) == 0 );
+
+    // Longer than the 64 bytes FIFO, sent in chunks
+    TestCase( "EU868 FSK long uplink" );
+    Uplink( false, 8, "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789", DR_7 );
+    CheckNsUplink( 8, "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789" );
+}
+
+/*!
+ * \brief Channel activity detection of the LoRa datarates, the test builds
+ *        the MAC with LORAMAC_CAD_ATTEMPTS at 3
+ */
+static void TestCad( void )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    MlmeReq_t mlmeReq;
+    uint32_t uplinks;
+    uint32_t frequency;
+    uint32_t randomCalls;
+    TimerTime_t start;
+
+    TestCase( "EU868 CAD on a free channel" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    LoRaMacTestSetDutyCycleOn( false );
+    uplinks = ns->Uplinks;
+    RequestUplink( false, 2, "free", DR_5 );
+    frequency = RadioFrequency( );
+    TEST_CHECK( ( LoRaMacState & MAC_STATE_TX_CAD ) != 0 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_OPMODE ) & OPMODE_MASK, RFLR_OPMODE_LONGRANGEMODE_ON | RFLR_OPMODE_CAD );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 1 );
+    TEST_CHECK( abs( ( int32_t )( TxFrequency - frequency ) ) < 1000 );
+    TimerStubAdvance( 100 );
+
+    TestCase( "EU868 CAD on a busy channel" );
+    RequestUplink( false, 2, "busy", DR_5 );
+    frequency = RadioFrequency( );
+    Jam( frequency, 10000 );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 2 );
+    CheckNsUplink( 2, "busy" );
+    // Sent on another channel
+    TEST_CHECK( abs( ( int32_t )( TxFrequency - frequency ) ) > 100000 );
+    TimerStubAdvance( 10000 );
+
+    TestCase( "EU868 CAD timeout" );
+    SX1276EmuSetDioLost( true );
+    RequestUplink( false, 2, "timeout", DR_5 );
+    frequency = RadioFrequency( );
+    TimerStubAdvance( 110 );
+    // The CAD which did not end counts as a busy channel, another one is
+    // sensed
+    TEST_CHECK( ( LoRaMacState & MAC_STATE_TX_CAD ) != 0 );
+    TEST_CHECK( abs( ( int32_t )( RadioFrequency( ) - frequency ) ) > 100000 );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 2 );
+    SX1276EmuSetDioLost( false );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 3 );
+    CheckNsUplink( 2, "timeout" );
+    TimerStubAdvance( 100 );
+
+    TestCase( "EU868 CAD with all the channels busy" );
+    SX1276EmuSetChannelBusy( true );
+    RequestUplink( false, 2, "later", DR_5 );
+    TimerStubAdvance( 50 );
+    // The 3 channels were sensed, the uplink waits for a random delay
+    TEST_CHECK_EQUAL( LoRaMacState & ( MAC_STATE_TX_DELAYED | MAC_STATE_TX_CAD ), MAC_STATE_TX_DELAYED );
+    TEST_CHECK_EQUAL( McpsConfirmCount, 3 );
+    SX1276EmuSetChannelBusy( false );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 4 );
+    CheckNsUplink( 2, "later" );
+    TimerStubAdvance( 100 );
+
+    TestCase( "EU868 CAD with the channels jammed" );
+    SX1276EmuSetChannelBusy( true );
+    start = TimerGetCurrentTime( );
+    RequestUplink( true, 2, "jammed", DR_5 );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_CHANNEL_BUSY );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.AckReceived, false );
+    // Given up after 8 delays of 1 s at most
+    TEST_CHECK( TimerGetElapsedTime( start ) <= 9 * 1000 );
+    TimerStubAdvance( 100 );
+    TEST_CHECK_EQUAL( LoRaMacState, 0 );
+    SX1276EmuSetChannelBusy( false );
+    Uplink( false, 2, "after", DR_5 );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    CheckNsUplink( 2, "after" );
+
+    TestCase( "EU868 join with the channels busy" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    SX1276EmuSetChannelBusy( true );
+    randomCalls = SX1276EmuGetRandomCalls( );
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.DevEui = DevEui;
+    mlmeReq.Req.Join.AppEui = AppEui;
+    mlmeReq.Req.Join.AppKey = AppKey;
+    mlmeReq.Req.Join.NbTrials = 1;
+    TEST_CHECK_EQUAL( LoRaMacMlmeRequest( &mlmeReq ), LORAMAC_STATUS_OK );
+    TimerStubAdvance( 3000 );
+    TEST_CHECK_EQUAL( MlmeConfirmCount, 0 );
+    SX1276EmuSetChannelBusy( false );
+    TEST_CHECK( RunUntil( &MlmeConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMlmeConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->JoinRequests, 1 );
+    // The delayed join request kept the DevNonce drawn for it
+    TEST_CHECK_EQUAL( SX1276EmuGetRandomCalls( ) - randomCalls, 1 );
+}
+
+/*!
+ * \brief Carrier sense of the FSK datarate, which has no CAD, and of the
+ *        listen before talk of AS923, both on timer events
+ */
+static void TestCarrierSense( void )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    ChannelParams_t channel = { 868800000, 0, { ( DR_7 << 4 ) | DR_7 }, 0 };
+    uint32_t uplinks;
+    TimerTime_t start;
+
+    TestCase( "EU868 FSK carrier sense" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    LoRaMacTestSetDutyCycleOn( false );
+    TEST_CHECK_EQUAL( LoRaMacChannelAdd( 3, channel ), LORAMAC_STATUS_OK );
+    uplinks = ns->Uplinks;
+    SX1276EmuSetChannelBusy( true );
+    RequestUplink( false, 8, "fsk", DR_7 );
+    TEST_CHECK( ( LoRaMacState & MAC_STATE_TX_CAD ) != 0 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & OPMODE_MASK, RF_OPMODE_RECEIVER );
+    TimerStubAdvance( 20 );
+    TEST_CHECK_EQUAL( LoRaMacState & ( MAC_STATE_TX_DELAYED | MAC_STATE_TX_CAD ), MAC_STATE_TX_DELAYED );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks );
+    SX1276EmuSetChannelBusy( false );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 1 );
+    TEST_CHECK_EQUAL( ns->Lora, false );
+    CheckNsUplink( 8, "fsk" );
+    TimerStubAdvance( 100 );
+
+    TestCase( "AS923 listen before talk" );
+    StartMac( LORAMAC_REGION_AS923, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    uplinks = ns->Uplinks;
+    start = TimerGetCurrentTime( );
+    RequestUplink( false, 2, "lbt", DR_2 );
+    // The request returns at once, the RSSI is read on timer events
+    TEST_CHECK_EQUAL( TimerGetCurrentTime( ), start );
+    TEST_CHECK( ( LoRaMacState & MAC_STATE_TX_CAD ) != 0 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_OPMODE ) & OPMODE_MASK, RFLR_OPMODE_LONGRANGEMODE_ON | RFLR_OPMODE_RECEIVER );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 1 );
+    CheckNsUplink( 2, "lbt" );
+    TimerStubAdvance( 100 );
+
+    TestCase( "AS923 listen before talk on busy channels" );
+    SX1276EmuSetChannelBusy( true );
+    RequestUplink( false, 2, "wait", DR_2 );
+    TimerStubAdvance( 50 );
+    TEST_CHECK_EQUAL( LoRaMacState & ( MAC_STATE_TX_DELAYED | MAC_STATE_TX_CAD ), MAC_STATE_TX_DELAYED );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 1 );
+    SX1276EmuSetChannelBusy( false );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    TEST_CHECK_EQUAL( ns->Uplinks, uplinks + 2 );
+    CheckNsUplink( 2, "wait" );
+}
+
+/*!
+ * \brief Runs the timers 1 ms at a time until the confirm, records when the
+ *        radio last went back to sleep or standby and the last timer expiry
+ *        before the one delivering the confirm
+ *
+ * \param [OUT] radioIdle Time the radio went idle [ms]
+ * \param [OUT] lastExpiry Time of the last timer expiry [ms]
+ */
+static void RunConfirm( TimerTime_t *radioIdle, TimerTime_t *lastExpiry )
+{
+    uint32_t start = McpsConfirmCount;
+    bool busy = false;
+
+    for( uint32_t time = 0; ( time < RUN_LIMIT ) && ( McpsConfirmCount == start ); time++ )
+    {
+        TimerTime_t expiry = 0;
+        bool pending = TimerStubGetNextExpiry( &expiry );
+        uint8_t mode;
+
+        TimerStubAdvance( 1 );
+        if( ( McpsConfirmCount == start ) && ( pending == true ) && ( ( int32_t )( expiry - TimerGetCurrentTime( ) ) <= 0 ) )
+        {
+            *lastExpiry = expiry;
+        }
+        mode = SX1276EmuGetRegister( true, REG_LR_OPMODE ) & ~RFLR_OPMODE_MASK;
+        if( ( mode != RFLR_OPMODE_SLEEP ) && ( mode != RFLR_OPMODE_STANDBY ) )
+        {
+            busy = true;
+        }
+        else if( busy == true )
+        {
+            busy = false;
+            *radioIdle = TimerGetCurrentTime( );
+        }
+    }
+    TEST_CHECK( McpsConfirmCount != start );
+}
+
+/*!
+ * \brief Prints the delay of the confirm after the event completing the
+ *        uplink, and the one the MAC state check polled every second gave
+ */
+static uint32_t ConfirmLatency( const char *name, TimerTime_t event )
+{
+    uint32_t elapsed = event - TxStartTime;
+    uint32_t polled = ( ( elapsed + STATE_CHECK_POLL_PERIOD - 1 ) / STATE_CHECK_POLL_PERIOD ) * STATE_CHECK_POLL_PERIOD - elapsed;
+
+    printf( "confirm latency, %-32s %4u ms, polled %4u ms\n", name, ( unsigned )( McpsConfirmTime - event ), ( unsigned )polled );
+    return McpsConfirmTime - event;
+}
+
+/*!
+ * \brief The confirms follow the radio and timer events completing the
+ *        uplinks, not the state check watchdog
+ */
+static void TestConfirmLatency( void )
+{
+    McpsReq_t mcpsReq;
+    TimerTime_t radioIdle = 0;
+    TimerTime_t lastExpiry = 0;
+
+    TestCase( "EU868 confirm latency" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    LoRaMacTestSetDutyCycleOn( false );
+    TimerStubAdvance( 100 );
+
+    // Completed by the RX2 timeout
+    NsStubSetRxWindow( 0 );
+    RequestUplink( false, 2, "timeout", DR_5 );
+    RunConfirm( &radioIdle, &lastExpiry );
+    TEST_CHECK( ConfirmLatency( "RX2 timeout", radioIdle ) <= 1 );
+    TimerStubAdvance( 100 );
+
+    // Completed by the downlink received in RX1
+    NsStubSetRxWindow( 1 );
+    NsStubQueueDownlink( 3, ( const uint8_t* )"down", 4, false );
+    RequestUplink( false, 2, "answered", DR_5 );
+    RunConfirm( &radioIdle, &lastExpiry );
+    TEST_CHECK_EQUAL( LastMcpsIndication.RxSlot, 0 );
+    TEST_CHECK( ConfirmLatency( "RX1 downlink", radioIdle ) <= 1 );
+    TimerStubAdvance( 100 );
+
+    // Completed by the acknowledgement timeout, after RX2 and ahead of the
+    // watchdog
+    NsStubSetRxWindow( 0 );
+    mcpsReq.Type = MCPS_CONFIRMED;
+    mcpsReq.Req.Confirmed.fPort = 2;
+    mcpsReq.Req.Confirmed.fBuffer = "unacked";
+    mcpsReq.Req.Confirmed.fBufferSize = 7;
+    mcpsReq.Req.Confirmed.NbTrials = 1;
+    mcpsReq.Req.Confirmed.Datarate = DR_5;
+    TEST_CHECK_EQUAL( LoRaMacMcpsRequest( &mcpsReq ), LORAMAC_STATUS_OK );
+    RunConfirm( &radioIdle, &lastExpiry );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.AckReceived, false );
+    TEST_CHECK( ( int32_t )( lastExpiry - radioIdle ) > 1 );
+    TEST_CHECK( ( int32_t )( lastExpiry - ( TxStartTime + MAC_STATE_CHECK_TIMEOUT ) ) < 0 );
+    TEST_CHECK( ConfirmLatency( "acknowledgement timeout", lastExpiry ) <= 1 );
+    NsStubSetRxWindow( 1 );
+}
+
+/*!
+ * \brief ADR of the network server stand-in, the emulated uplinks reach it
+ *        at a 0 dB SNR
+ */
+static void TestAdr( void )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    MibRequestConfirm_t mibReq;
+
+    TestCase( "EU868 ADR" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    LoRaMacTestSetDutyCycleOn( false );
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = DR_0;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = true;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    // 0 dB is 20 dB above the floor of DR0, 10 dB above the margin, three
+    // steps up once the history is full
+    for( uint8_t i = 0; i < 10; i++ )
+    {
+        Uplink( false, 2, "adr", DR_0 );
+        TEST_CHECK_EQUAL( LastMcpsConfirm.Datarate, DR_0 );
+    }
+    TEST_CHECK_EQUAL( ns->LinkAdrReqs, 1 );
+    TEST_CHECK_EQUAL( ns->Downlinks, 2 );
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    TEST_CHECK_EQUAL( mibReq.Param.ChannelsDatarate, DR_3 );
+
+    // DR3 leaves no margin, the history restarts and keeps it
+    for( uint8_t i = 0; i < 12; i++ )
+    {
+        Uplink( false, 2, "adr", DR_0 );
+        TEST_CHECK_EQUAL( LastMcpsConfirm.Datarate, DR_3 );
+    }
+    TEST_CHECK_EQUAL( ns->LinkAdrReqs, 1 );
+    TEST_CHECK_EQUAL( ns->TxPower, 0 );
+    TEST_CHECK_EQUAL( ns->MicErrors, 0 );
+}
+
+/*!
+ * \brief Gives the current region an ABP session told apart by its address
+ *        and uplink counter
+ */
+static void SetSession( uint32_t devAddr, uint32_t upLinkCounter )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_DEV_ADDR;
+    mibReq.Param.DevAddr = devAddr;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_UPLINK_COUNTER;
+    mibReq.Param.UpLinkCounter = upLinkCounter;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_NETWORK_JOINED;
+    mibReq.Param.IsNetworkJoined = true;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+/*!
+ * \brief Tells whether the current region holds the session
+ */
+static bool HasSession( uint32_t devAddr, uint32_t upLinkCounter )
+{
+    MibRequestConfirm_t joined;
+    MibRequestConfirm_t address;
+    MibRequestConfirm_t counter;
+
+    joined.Type = MIB_NETWORK_JOINED;
+    LoRaMacMibGetRequestConfirm( &joined );
+    address.Type = MIB_DEV_ADDR;
+    LoRaMacMibGetRequestConfirm( &address );
+    counter.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm( &counter );
+    return ( joined.Param.IsNetworkJoined == true ) && ( address.Param.DevAddr == devAddr ) &&
+           ( counter.Param.UpLinkCounter == upLinkCounter );
+}
+
+/*!
+ * \brief Tells whether the current region is joined
+ */
+static bool IsJoined( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_NETWORK_JOINED;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    return mibReq.Param.IsNetworkJoined;
+}
+
+/*!
+ * \brief Returns the frequency of a channel of the current region [Hz]
+ */
+static uint32_t ChannelFrequency( uint8_t id )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_CHANNELS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    return mibReq.Param.ChannelList[id].Frequency;
+}
+
+/*!
+ * \brief Switches among four regions, as many as the three contexts and the
+ *        region in use hold, the joined EU868 session keeps talking to the
+ *        network server
+ */
+static void TestSwitchRegion( void )
+{
+    const NsStubStatus_t *ns = NsStubGetStatus( );
+    const LoRaMacRegion_t regions[4] = { LORAMAC_REGION_EU868, LORAMAC_REGION_US915, LORAMAC_REGION_AS923, LORAMAC_REGION_AU915 };
+    ChannelParams_t channel = { 867100000, 0, { ( DR_5 << 4 ) | DR_0 }, 0 };
+    MibRequestConfirm_t mibReq;
+    uint32_t devAddr;
+    uint32_t upLinkCounter;
+    uint32_t current = 0;
+    uint32_t failures = 0;
+
+    TestCase( "region switch sessions" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    LoRaMacTestSetDutyCycleOn( false );
+    TEST_CHECK_EQUAL( LoRaMacChannelAdd( 3, channel ), LORAMAC_STATUS_OK );
+    Uplink( false, 2, "before", DR_5 );
+    devAddr = ns->DevAddr;
+    mibReq.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    upLinkCounter = mibReq.Param.UpLinkCounter;
+    for( uint8_t i = 1; i < 4; i++ )
+    {
+        TEST_CHECK_EQUAL( LoRaMacSwitchRegion( regions[i] ), LORAMAC_STATUS_OK );
+        TEST_CHECK( IsJoined( ) == false );
+        SetSession( 0x26000000 + i, 100 * i );
+    }
+
+    srand( 1 );
+    for( uint32_t i = 0; i < 3000; i++ )
+    {
+        uint32_t next = rand( ) % 4;
+
+        if( LoRaMacSwitchRegion( regions[next] ) != LORAMAC_STATUS_OK )
+        {
+            failures++;
+        }
+        current = next;
+        if( ( current == 0 ) ? ( ( HasSession( devAddr, upLinkCounter ) == false ) || ( ChannelFrequency( 3 ) != channel.Frequency ) )
+                             : ( HasSession( 0x26000000 + current, 100 * current ) == false ) )
+        {
+            failures++;
+        }
+    }
+    TEST_CHECK_EQUAL( failures, 0 );
+
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_EU868 ), LORAMAC_STATUS_OK );
+    Uplink( false, 2, "after", DR_5 );
+    TEST_CHECK_EQUAL( LastMcpsConfirm.Status, LORAMAC_EVENT_INFO_STATUS_OK );
+    CheckNsUplink( 2, "after" );
+    TEST_CHECK_EQUAL( ns->FCntUp, upLinkCounter );
+    TEST_CHECK_EQUAL( ns->MicErrors, 0 );
+
+    TestCase( "region switch while sending" );
+    RequestUplink( false, 2, "busy", DR_5 );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_US915 ), LORAMAC_STATUS_BUSY );
+    TEST_CHECK( RunUntil( &McpsConfirmCount ) );
+    TimerStubAdvance( 100 );
+    CheckNsUplink( 2, "busy" );
+    TEST_CHECK( ( TxFrequency >= 863000000 ) && ( TxFrequency <= 870000000 ) );
+
+    TEST_BENCH( "LoRaMacSwitchRegion", 10000,
+                LoRaMacSwitchRegion( ( ( benchRun & 1 ) == 0 ) ? LORAMAC_REGION_US915 : LORAMAC_REGION_EU868 ) );
+    printf( "region context: %u bytes of RAM\n", LoRaMacTestGetRegionContextSize( ) );
+}
+
+/*!
+ * \brief Leaves more regions than the contexts hold, the oldest session is
+ *        dropped and its region starts again from its defaults
+ */
+static void TestSwitchRegionEviction( void )
+{
+    ChannelParams_t channel = { 867100000, 0, { ( DR_5 << 4 ) | DR_0 }, 0 };
+    MibRequestConfirm_t mibReq;
+
+    TestCase( "region switch eviction" );
+    StartMac( LORAMAC_REGION_EU868, NS_STUB_EU868 );
+    TEST_CHECK( Join( ) );
+    TEST_CHECK_EQUAL( LoRaMacChannelAdd( 3, channel ), LORAMAC_STATUS_OK );
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = DR_3;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    // Saved in order: EU868, US915, AS923
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_US915 ), LORAMAC_STATUS_OK );
+    SetSession( 0x26000001, 1 );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_AS923 ), LORAMAC_STATUS_OK );
+    SetSession( 0x26000002, 2 );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_AU915 ), LORAMAC_STATUS_OK );
+    SetSession( 0x26000003, 3 );
+
+    // The oldest session is the one switched to, its context takes the
+    // session left and nothing is dropped
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_EU868 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( IsJoined( ) );
+    TEST_CHECK_EQUAL( ChannelFrequency( 3 ), channel.Frequency );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_US915 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( HasSession( 0x26000001, 1 ) );
+
+    // Saved in order: AS923, AU915, EU868. Each switch to a region without a
+    // session drops the oldest: leaving US915 drops AS923, leaving KR920
+    // drops AU915, leaving AS923 drops EU868
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_KR920 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( IsJoined( ) == false );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_AS923 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( IsJoined( ) == false );
+    SetSession( 0x26000012, 12 );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_AU915 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( IsJoined( ) == false );
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_EU868 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( IsJoined( ) == false );
+    // The channels of the region are back to their defaults
+    TEST_CHECK_EQUAL( ChannelFrequency( 3 ), 0 );
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    TEST_CHECK_EQUAL( mibReq.Param.ChannelsDatarate, DR_0 );
+    TEST_CHECK( Join( ) );
+
+    // Leaving EU868 drops KR920, the session of AS923 is kept
+    TEST_CHECK_EQUAL( LoRaMacSwitchRegion( LORAMAC_REGION_AS923 ), LORAMAC_STATUS_OK );
+    TEST_CHECK( HasSession( 0x26000012, 12 ) );
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main( void )
+{
+    TestJoinAndExchange( LORAMAC_REGION_EU868, NS_STUB_EU868, DR_5, "EU868" );
+    TestJoinAndExchange( LORAMAC_REGION_US915, NS_STUB_US915, DR_3, "US915" );
+    TestFsk( );
+    TestCad( );
+    TestCarrierSense( );
+    TestConfirmLatency( );
+    TestAdr( );
+    TestSwitchRegion( );
+    TestSwitchRegionEviction( );
+
+    return TestSummary( );
+}
@@ -0,0 +1,1414 @@
+ /******************************************************************************
+  * @file    test_region.c
+  * @brief   host tests of the region layer against the LoRaWAN Regional
+  *          Parameters, with per call timings
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "region/Region.h"
+#include "region/RegionCommon.h"
+#include "region/RegionAS923.h"
+#include "region/RegionAU915.h"
+#include "region/RegionCN470.h"
+#include "region/RegionCN779.h"
+#include "region/RegionEU433.h"
+#include "region/RegionEU868.h"
+#include "region/RegionIN865.h"
+#include "region/RegionKR920.h"
+#include "region/RegionUS915.h"
+#include "region/RegionUS915-Hybrid.h"
+#include "radio_stub.h"
+#include "timer_stub.h"
+#include "test.h"
+
+/* Private typedef -----------------------------------------------------------*/
+
+/*!
+ * \brief How the channels of a region are defined
+ */
+typedef enum ePlanType
+{
+    /*!
+     * Default channels plus channels added by the network, one mask word
+     */
+    PLAN_DYNAMIC,
+    /*!
+     * 64 125 kHz and 8 500 kHz channels, ChMaskCntl 6 and 7 address the
+     * 125 kHz channels as a whole
+     */
+    PLAN_FIXED_72,
+    /*!
+     * 96 125 kHz channels, ChMaskCntl 6 enables them all
+     */
+    PLAN_FIXED_96,
+}PlanType_t;
+
+/*!
+ * \brief One datarate of a region. A null spreading factor is the 50 kbps
+ *        FSK datarate
+ */
+typedef struct sDrSpec
+{
+    uint8_t Sf;
+    /*!
+     * 0: 125 kHz, 1: 250 kHz, 2: 500 kHz
+     */
+    uint8_t Bw;
+}DrSpec_t;
+
+/*!
+ * \brief Expectations of one region, from the LoRaWAN Regional Parameters
+ */
+typedef struct sRegionCase
+{
+    const char* Name;
+    LoRaMacRegion_t Region;
+    PlanType_t Plan;
+    uint8_t MaxNbChannels;
+    /*!
+     * Channels enabled after the initialization
+     */
+    uint8_t NbEnabledChannels;
+    /*!
+     * Default channels of a dynamic plan
+     */
+    uint8_t NbDefaultChannels;
+    uint32_t DefaultFrequencies[3];
+    /*!
+     * First 125 kHz and 500 kHz channels of a fixed plan
+     */
+    uint32_t First125kHz;
+    uint32_t First500kHz;
+    /*!
+     * Smallest number of 125 kHz channels ChanMaskSet accepts, 0 if any.
+     * US915-Hybrid needs 6 of them in the same 8 channel sub-band
+     */
+    uint8_t MinMaskChannels;
+    /*!
+     * US915-Hybrid keeps the 125 kHz channels of a single 8 channel sub-band
+     * and the 500 kHz channel of that sub-band
+     */
+    bool SingleSubBand;
+    int8_t TxMaxDr;
+    int8_t RxMinDr;
+    int8_t RxMaxDr;
+    /*!
+     * Highest TX power index, the lowest power
+     */
+    int8_t MinTxPower;
+    /*!
+     * Highest TX power index granted with the default channels: FCC limits
+     * hopping over less than 50 channels to 21 dBm
+     */
+    int8_t DefaultMaxTxPower;
+    int8_t MaxRx1DrOffset;
+    uint32_t Rx2Frequency;
+    int8_t Rx2Datarate;
+    int8_t DefaultDatarate;
+    bool DutyCycle;
+    /*!
+     * Duty cycle of the band of the default channels
+     */
+    uint16_t DefaultBandDCycle;
+    /*!
+     * The region performs a carrier sense before each uplink
+     */
+    bool Lbt;
+    /*!
+     * RSSI under which the carrier sense finds the channel free, in dBm
+     */
+    int16_t LbtRssiFreeTh;
+    /*!
+     * First of 5 channels 200 kHz apart the region accepts in a NewChannelReq
+     * or a CFList
+     */
+    uint32_t NewChannelFrequency;
+    const DrSpec_t* Datarates;
+}RegionCase_t;
+
+/* Private define ------------------------------------------------------------*/
+
+/*!
+ * Number of runs of each timed call
+ */
+#define BENCH_RUNS                                  20000
+
+/*!
+ * Channels of a CFList
+ */
+#define CFLIST_NB_CHANNELS                          5
+
+/*!
+ * LinkAdrReq payload: DR and TX power, channel mask, ChMaskCntl and NbRep
+ */
+#define LINK_ADR_REQ( dr, power, mask, cntl, nbRep )    \
+    { SRV_MAC_LINK_ADR_REQ, ( uint8_t )( ( ( dr ) << 4 ) | ( power ) ), \
+      ( uint8_t )( mask ), ( uint8_t )( ( mask ) >> 8 ), ( uint8_t )( ( ( cntl ) << 4 ) | ( nbRep ) ) }
+
+/* Private variables ---------------------------------------------------------*/
+
+static const DrSpec_t DatarateEU[16] =
+{
+    { 12, 0 }, { 11, 0 }, { 10, 0 }, { 9, 0 }, { 8, 0 }, { 7, 0 }, { 7, 1 }, { 0, 0 }
+};
+
+static const DrSpec_t Datarate125kHz[16] =
+{
+    { 12, 0 }, { 11, 0 }, { 10, 0 }, { 9, 0 }, { 8, 0 }, { 7, 0 }
+};
+
+static const DrSpec_t DatarateUS[16] =
+{
+    { 10, 0 }, { 9, 0 }, { 8, 0 }, { 7, 0 }, { 8, 2 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+    { 12, 2 }, { 11, 2 }, { 10, 2 }, { 9, 2 }, { 8, 2 }, { 7, 2 }
+};
+
+static const DrSpec_t DatarateAU[16] =
+{
+    { 12, 0 }, { 11, 0 }, { 10, 0 }, { 9, 0 }, { 8, 0 }, { 7, 0 }, { 8, 2 }, { 0, 0 },
+    { 12, 2 }, { 11, 2 }, { 10, 2 }, { 9, 2 }, { 8, 2 }, { 7, 2 }
+};
+
+static const RegionCase_t RegionCases[] =
+{
+    {
+        .Name = "EU868", .Region = LORAMAC_REGION_EU868, .Plan = PLAN_DYNAMIC,
+        .MaxNbChannels = 16, .NbEnabledChannels = 3,
+        .NbDefaultChannels = 3, .DefaultFrequencies = { 868100000, 868300000, 868500000 },
+        .TxMaxDr = DR_7, .RxMinDr = DR_0, .RxMaxDr = DR_7, .MinTxPower = TX_POWER_7, .MaxRx1DrOffset = 5,
+        .Rx2Frequency = 869525000, .Rx2Datarate = DR_0, .DefaultDatarate = DR_0,
+        .DutyCycle = true, .DefaultBandDCycle = 100, .Lbt = false,
+        .NewChannelFrequency = 867100000, .Datarates = DatarateEU,
+    },
+    {
+        .Name = "EU433", .Region = LORAMAC_REGION_EU433, .Plan = PLAN_DYNAMIC,
+        .MaxNbChannels = 16, .NbEnabledChannels = 3,
+        .NbDefaultChannels = 3, .DefaultFrequencies = { 433175000, 433375000, 433575000 },
+        .TxMaxDr = DR_7, .RxMinDr = DR_0, .RxMaxDr = DR_7, .MinTxPower = TX_POWER_5, .MaxRx1DrOffset = 5,
+        .Rx2Frequency = 434665000, .Rx2Datarate = DR_0, .DefaultDatarate = DR_0,
+        .DutyCycle = true, .DefaultBandDCycle = 100, .Lbt = false,
+        .NewChannelFrequency = 433775000, .Datarates = DatarateEU,
+    },
+    {
+        .Name = "CN779", .Region = LORAMAC_REGION_CN779, .Plan = PLAN_DYNAMIC,
+        .MaxNbChannels = 16, .NbEnabledChannels = 3,
+        .NbDefaultChannels = 3, .DefaultFrequencies = { 779500000, 779700000, 779900000 },
+        .TxMaxDr = DR_7, .RxMinDr = DR_0, .RxMaxDr = DR_7, .MinTxPower = TX_POWER_5, .MaxRx1DrOffset = 5,
+        .Rx2Frequency = 786000000, .Rx2Datarate = DR_0, .DefaultDatarate = DR_0,
+        .DutyCycle = true, .DefaultBandDCycle = 100, .Lbt = false,
+        .NewChannelFrequency = 780100000, .Datarates = DatarateEU,
+    },
+    {
+        .Name = "IN865", .Region = LORAMAC_REGION_IN865, .Plan = PLAN_DYNAMIC,
+        .MaxNbChannels = 16, .NbEnabledChannels = 3,
+        .NbDefaultChannels = 3, .DefaultFrequencies = { 865062500, 865402500, 865985000 },
+        .TxMaxDr = DR_7, .RxMinDr = DR_0, .RxMaxDr = DR_7, .MinTxPower = TX_POWER_10, .MaxRx1DrOffset = 7,
+        .Rx2Frequency = 866550000, .Rx2Datarate = DR_2, .DefaultDatarate = DR_0,
+        .DutyCycle = true, .DefaultBandDCycle = 1, .Lbt = false,
+        .NewChannelFrequency = 865500000, .Datarates = DatarateEU,
+    },
+    {
+        .Name = "KR920", .Region = LORAMAC_REGION_KR920, .Plan = PLAN_DYNAMIC,
+        .MaxNbChannels = 16, .NbEnabledChannels = 3,
+        .NbDefaultChannels = 3, .DefaultFrequencies = { 922100000, 922300000, 922500000 },
+        .TxMaxDr = DR_5, .RxMinDr = DR_0, .RxMaxDr = DR_5, .MinTxPower = TX_POWER_7, .MaxRx1DrOffset = 5,
+        .Rx2Frequency = 921900000, .Rx2Datarate = DR_0, .DefaultDatarate = DR_0,
+        .DutyCycle = false, .DefaultBandDCycle = 1, .Lbt = true, .LbtRssiFreeTh = -65,
+        .NewChannelFrequency = 921100000, .Datarates = Datarate125kHz,
+    },
+    {
+        .Name = "AS923", .Region = LORAMAC_REGION_AS923, .Plan = PLAN_DYNAMIC,
+        .MaxNbChannels = 16, .NbEnabledChannels = 2,
+        .NbDefaultChannels = 2, .DefaultFrequencies = { 923200000, 923400000 },
+        .TxMaxDr = DR_7, .RxMinDr = DR_0, .RxMaxDr = DR_7, .MinTxPower = TX_POWER_7, .MaxRx1DrOffset = 7,
+        .Rx2Frequency = 923200000, .Rx2Datarate = DR_2, .DefaultDatarate = DR_2,
+        .DutyCycle = false, .DefaultBandDCycle = 100, .Lbt = true, .LbtRssiFreeTh = -85,
+        .NewChannelFrequency = 923600000, .Datarates = DatarateEU,
+    },
+    {
+        .Name = "US915", .Region = LORAMAC_REGION_US915, .Plan = PLAN_FIXED_72,
+        .MaxNbChannels = 72, .NbEnabledChannels = 72,
+        .First125kHz = 902300000, .First500kHz = 903000000, .MinMaskChannels = 2,
+        .TxMaxDr = DR_4, .RxMinDr = DR_8, .RxMaxDr = DR_13, .MinTxPower = TX_POWER_10, .MaxRx1DrOffset = 3,
+        .Rx2Frequency = 923300000, .Rx2Datarate = DR_8, .DefaultDatarate = DR_0,
+        .DutyCycle = false, .DefaultBandDCycle = 1, .Lbt = false,
+        .Datarates = DatarateUS,
+    },
+    {
+        .Name = "US915-Hybrid", .Region = LORAMAC_REGION_US915_HYBRID, .Plan = PLAN_FIXED_72,
+        .MaxNbChannels = 72, .NbEnabledChannels = 9,
+        .First125kHz = 902300000, .First500kHz = 903000000, .MinMaskChannels = 6, .SingleSubBand = true,
+        .TxMaxDr = DR_4, .RxMinDr = DR_8, .RxMaxDr = DR_13, .MinTxPower = TX_POWER_10, .DefaultMaxTxPower = TX_POWER_5, .MaxRx1DrOffset = 3,
+        .Rx2Frequency = 923300000, .Rx2Datarate = DR_8, .DefaultDatarate = DR_0,
+        .DutyCycle = false, .DefaultBandDCycle = 1, .Lbt = false,
+        .Datarates = DatarateUS,
+    },
+    {
+        .Name = "AU915", .Region = LORAMAC_REGION_AU915, .Plan = PLAN_FIXED_72,
+        .MaxNbChannels = 72, .NbEnabledChannels = 72,
+        .First125kHz = 915200000, .First500kHz = 915900000, .MinMaskChannels = 20,
+        .TxMaxDr = DR_6, .RxMinDr = DR_8, .RxMaxDr = DR_13, .MinTxPower = TX_POWER_10, .MaxRx1DrOffset = 6,
+        .Rx2Frequency = 923300000, .Rx2Datarate = DR_8, .DefaultDatarate = DR_0,
+        .DutyCycle = false, .DefaultBandDCycle = 1, .Lbt = false,
+        .Datarates = DatarateAU,
+    },
+    {
+        .Name = "CN470", .Region = LORAMAC_REGION_CN470, .Plan = PLAN_FIXED_96,
+        .MaxNbChannels = 96, .NbEnabledChannels = 96,
+        .First125kHz = 470300000, .MinMaskChannels = 0,
+        .TxMaxDr = DR_5, .RxMinDr = DR_0, .RxMaxDr = DR_5, .MinTxPower = TX_POWER_7, .MaxRx1DrOffset = 3,
+        .Rx2Frequency = 505300000, .Rx2Datarate = DR_0, .DefaultDatarate = DR_0,
+        .DutyCycle = false, .DefaultBandDCycle = 1, .Lbt = false,
+        .Datarates = Datarate125kHz,
+    },
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t GetPhy( const RegionCase_t* rc, PhyAttribute_t attribute )
+{
+    GetPhyParams_t getPhy = { .Attribute = attribute };
+
+    return RegionGetPhyParam( rc->Region, &getPhy ).Value;
+}
+
+static uint16_t* GetChannelsMask( const RegionCase_t* rc )
+{
+    GetPhyParams_t getPhy = { .Attribute = PHY_CHANNELS_MASK };
+
+    return RegionGetPhyParam( rc->Region, &getPhy ).ChannelsMask;
+}
+
+static ChannelParams_t* GetChannels( const RegionCase_t* rc )
+{
+    GetPhyParams_t getPhy = { .Attribute = PHY_CHANNELS };
+
+    return RegionGetPhyParam( rc->Region, &getPhy ).Channels;
+}
+
+static uint8_t NbMaskWords( const RegionCase_t* rc )
+{
+    return ( rc->MaxNbChannels + 15 ) / 16;
+}
+
+static uint8_t CountEnabledChannels( const RegionCase_t* rc )
+{
+    return RegionCommonCountChannels( GetChannelsMask( rc ), 0, NbMaskWords( rc ) );
+}
+
+/*!
+ * \brief Counts the enabled 125 kHz channels of a fixed plan, all enabled
+ *        channels of the others
+ */
+static uint8_t Count125kHzChannels( const RegionCase_t* rc )
+{
+    return RegionCommonCountChannels( GetChannelsMask( rc ), 0, ( rc->Plan == PLAN_FIXED_72 ) ? 4 : NbMaskWords( rc ) );
+}
+
+static bool ChannelEnabled( const RegionCase_t* rc, uint8_t channel )
+{
+    return ( GetChannelsMask( rc )[channel / 16] & ( 1 << ( channel % 16 ) ) ) != 0;
+}
+
+/*!
+ * \brief Fresh region state at time 1 h, radio answers to their defaults
+ */
+static void ResetRegion( const RegionCase_t* rc )
+{
+    RadioStubReset( );
+    TimerStubReset( 3600000 );
+    RegionInitDefaults( rc->Region, INIT_TYPE_INIT );
+}
+
+/*!
+ * \brief Mask of the first channels a LinkAdrReq with ChMaskCntl 0 enables
+ */
+static uint16_t AcceptedMask( const RegionCase_t* rc )
+{
+    return ( rc->Plan == PLAN_DYNAMIC ) ? 0x0003 : 0x003F;
+}
+
+static uint8_t LinkAdrReq( const RegionCase_t* rc, uint8_t* payload, bool adrEnabled,
+                           int8_t* dr, int8_t* txPower, uint8_t* nbRep )
+{
+    LinkAdrReqParams_t linkAdrReq;
+    uint8_t nbBytesParsed = 0;
+    uint8_t status;
+
+    linkAdrReq.Payload = payload;
+    linkAdrReq.PayloadSize = 5;
+    linkAdrReq.UplinkDwellTime = 0;
+    linkAdrReq.AdrEnabled = adrEnabled;
+    linkAdrReq.CurrentDatarate = *dr;
+    linkAdrReq.CurrentTxPower = *txPower;
+    linkAdrReq.CurrentNbRep = *nbRep;
+
+    status = RegionLinkAdrReq( rc->Region, &linkAdrReq, dr, txPower, nbRep, &nbBytesParsed );
+    TEST_CHECK_EQUAL( nbBytesParsed, 5 );
+    return status;
+}
+
+static bool NextChannelBusy( const RegionCase_t* rc, bool joined, bool dutyCycle, int8_t dr, bool query,
+                             uint16_t* busyMask, uint8_t* channel, TimerTime_t* time )
+{
+    NextChanParams_t nextChan;
+    TimerTime_t aggregatedTimeOff = 0;
+
+    nextChan.AggrTimeOff = 0;
+    nextChan.LastAggrTx = 0;
+    nextChan.Datarate = dr;
+    nextChan.Joined = joined;
+    nextChan.DutyCycleEnabled = dutyCycle;
+    nextChan.Query = query;
+    nextChan.BusyChannelsMask = busyMask;
+    *time = 0;
+    return RegionNextChannel( rc->Region, &nextChan, channel, time, &aggregatedTimeOff );
+}
+
+static bool NextChannelQuery( const RegionCase_t* rc, bool joined, bool dutyCycle, int8_t dr, bool query,
+                              uint8_t* channel, TimerTime_t* time )
+{
+    return NextChannelBusy( rc, joined, dutyCycle, dr, query, NULL, channel, time );
+}
+
+static bool NextChannel( const RegionCase_t* rc, bool joined, bool dutyCycle, int8_t dr,
+                         uint8_t* channel, TimerTime_t* time )
+{
+    return NextChannelQuery( rc, joined, dutyCycle, dr, false, channel, time );
+}
+
+/*!
+ * \brief Records an uplink on a channel and computes the band time-off
+ */
+static void SendOnChannel( const RegionCase_t* rc, bool joined, bool joinRequest, bool dutyCycle,
+                           uint8_t channel, TimerTime_t timeOnAir )
+{
+    SetBandTxDoneParams_t txDone;
+    CalcBackOffParams_t calcBackOff;
+
+    txDone.Channel = channel;
+    txDone.Joined = joined;
+    txDone.LastTxDoneTime = TimerGetCurrentTime( );
+    RegionSetBandTxDone( rc->Region, &txDone );
+
+    calcBackOff.Joined = joined;
+    calcBackOff.LastTxIsJoinRequest = joinRequest;
+    calcBackOff.DutyCycleEnabled = dutyCycle;
+    calcBackOff.Channel = channel;
+    calcBackOff.ElapsedTime = 0;
+    calcBackOff.TxTimeOnAir = timeOnAir;
+    RegionCalcBackOff( rc->Region, &calcBackOff );
+}
+
+static uint32_t ChannelFrequency( const RegionCase_t* rc, uint8_t channel )
+{
+    if( rc->Plan == PLAN_FIXED_72 )
+    {
+        return ( channel < 64 ) ? rc->First125kHz + channel * 200000 : rc->First500kHz + ( channel - 64 ) * 1600000;
+    }
+    if( rc->Plan == PLAN_FIXED_96 )
+    {
+        return rc->First125kHz + channel * 200000;
+    }
+    return ( channel < rc->NbDefaultChannels ) ? rc->DefaultFrequencies[channel] : 0;
+}
+
+/*!
+ * \brief Reference RX window computation, the double formula of LoRaMac-node
+ *        with the symbol time in us
+ */
+static void RxWindowReference( const DrSpec_t* spec, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime,
+                               uint32_t* windowTimeout, int32_t* windowOffset )
+{
+    static const double bandwidths[] = { 125.0, 250.0, 500.0 };
+    double tSymbol;
+    double symbols;
+
+    // In us, the symbol times of the regions are whole numbers of us: the
+    // products and sums below are exact and each ceil sees the exact quotient.
+    // The 0.16 ms FSK symbol in ms is not exact in double and rounded the
+    // timeout of the original formula up by one symbol for some inputs
+    if( spec->Sf == 0 )
+    {
+        tSymbol = 8000.0 / 50.0;
+    }
+    else
+    {
+        tSymbol = ( double )( 1 << spec->Sf ) * 1000.0 / bandwidths[spec->Bw];
+    }
+    symbols = ceil( ( ( 2 * minRxSymbols - 8 ) * tSymbol + 2000.0 * rxError ) / tSymbol );
+    *windowTimeout = ( symbols > minRxSymbols ) ? ( uint32_t )symbols : minRxSymbols;
+    *windowOffset = ( int32_t )ceil( ( ( 8.0 * tSymbol ) - ( *windowTimeout * tSymbol ) - 2000.0 * wakeUpTime ) / 2000.0 );
+}
+
+/* Test cases ----------------------------------------------------------------*/
+
+static void TestInitDefaults( const RegionCase_t* rc )
+{
+    ChannelParams_t* channels;
+
+    TestCase( "%s defaults", rc->Name );
+    ResetRegion( rc );
+    channels = GetChannels( rc );
+
+    TEST_CHECK( RegionIsActive( rc->Region ) );
+    TEST_CHECK( RegionGetOps( rc->Region ) != NULL );
+    TEST_CHECK( RegionGetOps( ( LoRaMacRegion_t )( LORAMAC_REGION_US915_HYBRID + 1 ) ) == NULL );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_MAX_NB_CHANNELS ), rc->MaxNbChannels );
+    TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbEnabledChannels );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_DEF_RX2_FREQUENCY ), rc->Rx2Frequency );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_DEF_RX2_DR ), rc->Rx2Datarate );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_DEF_TX_DR ), rc->DefaultDatarate );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_DUTY_CYCLE ), rc->DutyCycle );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_RECEIVE_DELAY1 ), 1000 );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_RECEIVE_DELAY2 ), 2000 );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_JOIN_ACCEPT_DELAY1 ), 5000 );
+    TEST_CHECK_EQUAL( GetPhy( rc, PHY_JOIN_ACCEPT_DELAY2 ), 6000 );
+
+    for( uint8_t i = 0; i < rc->MaxNbChannels; i++ )
+    {
+        if( ChannelEnabled( rc, i ) == true )
+        {
+            TEST_CHECK_EQUAL( channels[i].Frequency, ChannelFrequency( rc, i ) );
+        }
+    }
+}
+
+static void TestLinkAdrReq( const RegionCase_t* rc )
+{
+    int8_t dr;
+    int8_t txPower;
+    uint8_t nbRep;
+    uint16_t* mask;
+    uint16_t initialMask[6];
+
+    TestCase( "%s LinkAdrReq accepted", rc->Name );
+    ResetRegion( rc );
+    {
+        uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, AcceptedMask( rc ), 0, 2 );
+        dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x07 );
+        TEST_CHECK_EQUAL( dr, DR_1 );
+        TEST_CHECK_EQUAL( txPower, TX_POWER_1 );
+        TEST_CHECK_EQUAL( nbRep, 2 );
+        TEST_CHECK_EQUAL( GetChannelsMask( rc )[0], AcceptedMask( rc ) );
+    }
+
+    TestCase( "%s LinkAdrReq NbRep 0 keeps the current one", rc->Name );
+    ResetRegion( rc );
+    {
+        uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, AcceptedMask( rc ), 0, 0 );
+        dr = DR_0; txPower = TX_POWER_0; nbRep = 3;
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x07 );
+        TEST_CHECK_EQUAL( nbRep, 3 );
+    }
+
+    TestCase( "%s LinkAdrReq datarate out of range", rc->Name );
+    ResetRegion( rc );
+    {
+        uint8_t payload[] = LINK_ADR_REQ( rc->TxMaxDr + 1, TX_POWER_1, AcceptedMask( rc ), 0, 1 );
+        dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+        memcpy( initialMask, GetChannelsMask( rc ), 2 * NbMaskWords( rc ) );
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x05 );
+        // Nothing applied
+        TEST_CHECK( memcmp( initialMask, GetChannelsMask( rc ), 2 * NbMaskWords( rc ) ) == 0 );
+    }
+
+    TestCase( "%s LinkAdrReq TX power out of range", rc->Name );
+    ResetRegion( rc );
+    {
+        uint8_t payload[] = LINK_ADR_REQ( DR_1, rc->MinTxPower + 1, AcceptedMask( rc ), 0, 1 );
+        dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x03 );
+    }
+
+    TestCase( "%s LinkAdrReq ADR off", rc->Name );
+    ResetRegion( rc );
+    {
+        uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, AcceptedMask( rc ), 0, 1 );
+        dr = DR_0; txPower = TX_POWER_2; nbRep = 1;
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, false, &dr, &txPower, &nbRep ), 0x00 );
+        TEST_CHECK_EQUAL( dr, DR_0 );
+        TEST_CHECK_EQUAL( txPower, TX_POWER_2 );
+    }
+
+    TestCase( "%s LinkAdrReq ADR off, mask only", rc->Name );
+    ResetRegion( rc );
+    {
+        uint8_t payload[] = LINK_ADR_REQ( 0x0F, 0x0F, AcceptedMask( rc ), 0, 1 );
+        dr = DR_0; txPower = TX_POWER_2; nbRep = 1;
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, false, &dr, &txPower, &nbRep ), 0x07 );
+        TEST_CHECK_EQUAL( dr, DR_0 );
+        TEST_CHECK_EQUAL( txPower, TX_POWER_2 );
+        TEST_CHECK_EQUAL( GetChannelsMask( rc )[0], AcceptedMask( rc ) );
+    }
+
+    TestCase( "%s LinkAdrReq channel mask rejected", rc->Name );
+    ResetRegion( rc );
+    {
+        // No channel left for a dynamic plan, no 125 kHz channel for a 72
+        // channel plan, the datarate is then not supported either. ChMaskCntl 7
+        // is RFU for CN470
+        uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, 0x0000, ( rc->Plan == PLAN_DYNAMIC ) ? 0 : 7, 1 );
+        dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), ( rc->Plan == PLAN_FIXED_96 ) ? 0x06 : 0x04 );
+        TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbEnabledChannels );
+    }
+
+    if( rc->Plan == PLAN_DYNAMIC )
+    {
+        TestCase( "%s LinkAdrReq undefined channel", rc->Name );
+        ResetRegion( rc );
+        {
+            uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, 0x8001, 0, 1 );
+            dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+            TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x06 );
+        }
+        TestCase( "%s LinkAdrReq ChMaskCntl RFU", rc->Name );
+        ResetRegion( rc );
+        {
+            uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, 0x0001, 1, 1 );
+            dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+            TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x06 );
+        }
+    }
+
+    TestCase( "%s LinkAdrReq ChMaskCntl 6", rc->Name );
+    ResetRegion( rc );
+    {
+        // The mask applies to the 500 kHz channels of a 72 channel plan. The
+        // dynamic plans OR it with the defined channels
+        uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, 0x0000, 0, 1 );
+        uint8_t payloadAll[] = LINK_ADR_REQ( DR_1, TX_POWER_1, ( rc->Plan == PLAN_DYNAMIC ) ? 0x0000 : 0x00F0, 6, 1 );
+
+        dr = DR_0; txPower = TX_POWER_0; nbRep = 1;
+        if( ( rc->Plan != PLAN_DYNAMIC ) && ( rc->SingleSubBand == false ) )
+        {
+            // Start from channels 16 and up only
+            TEST_CHECK_EQUAL( LinkAdrReq( rc, payload, true, &dr, &txPower, &nbRep ), 0x07 );
+        }
+        TEST_CHECK_EQUAL( LinkAdrReq( rc, payloadAll, true, &dr, &txPower, &nbRep ), 0x07 );
+        mask = GetChannelsMask( rc );
+        switch( rc->Plan )
+        {
+            case PLAN_DYNAMIC:
+                // All defined channels
+                TEST_CHECK_EQUAL( mask[0], ( 1 << rc->NbDefaultChannels ) - 1 );
+                break;
+            case PLAN_FIXED_72:
+                if( rc->SingleSubBand == true )
+                {
+                    // Narrowed to the first sub-band
+                    TEST_CHECK_EQUAL( mask[0], 0x00FF );
+                    TEST_CHECK_EQUAL( RegionCommonCountChannels( mask, 0, 4 ), 8 );
+                    TEST_CHECK_EQUAL( mask[4], 0x0001 );
+                    break;
+                }
+                // All 125 kHz channels, the mask applies to the 500 kHz ones
+                TEST_CHECK_EQUAL( RegionCommonCountChannels( mask, 0, 4 ), 64 );
+                TEST_CHECK_EQUAL( mask[4], 0x00F0 );
+                break;
+            case PLAN_FIXED_96:
+                TEST_CHECK_EQUAL( CountEnabledChannels( rc ), 96 );
+                break;
+        }
+    }
+}
+
+static void TestNewChannelReq( const RegionCase_t* rc )
+{
+    ChannelParams_t newChannel;
+    NewChannelReqParams_t newChannelReq;
+    uint8_t id = rc->NbDefaultChannels;
+
+    memset( &newChannel, 0, sizeof( newChannel ) );
+    newChannelReq.NewChannel = &newChannel;
+
+    TestCase( "%s NewChannelReq", rc->Name );
+    ResetRegion( rc );
+    newChannel.Frequency = rc->NewChannelFrequency;
+    newChannel.DrRange.Value = ( DR_5 << 4 ) | DR_0;
+    newChannelReq.ChannelId = id;
+
+    if( rc->Plan != PLAN_DYNAMIC )
+    {
+        // Channel plan defined by the region, the request is not supported
+        newChannel.Frequency = rc->First125kHz;
+        newChannelReq.ChannelId = 1;
+        TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x00 );
+        TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbEnabledChannels );
+        return;
+    }
+
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x03 );
+    TEST_CHECK( ChannelEnabled( rc, id ) );
+    TEST_CHECK_EQUAL( GetChannels( rc )[id].Frequency, rc->NewChannelFrequency );
+    TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbEnabledChannels + 1 );
+
+    TestCase( "%s NewChannelReq removes a channel", rc->Name );
+    newChannel.Frequency = 0;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x03 );
+    TEST_CHECK( ChannelEnabled( rc, id ) == false );
+    TEST_CHECK_EQUAL( GetChannels( rc )[id].Frequency, 0 );
+
+    TestCase( "%s NewChannelReq frequency out of the region", rc->Name );
+    newChannel.Frequency = 100000000;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x02 );
+    newChannel.Frequency = rc->Rx2Frequency + 10000000;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x02 );
+    TEST_CHECK( ChannelEnabled( rc, id ) == false );
+
+    TestCase( "%s NewChannelReq datarate range", rc->Name );
+    newChannel.Frequency = rc->NewChannelFrequency;
+    newChannel.DrRange.Value = ( DR_0 << 4 ) | DR_5;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x01 );
+    newChannel.DrRange.Value = ( DR_5 << 4 ) | DR_0;
+    newChannel.Frequency = 100000000;
+    newChannel.DrRange.Value = ( DR_0 << 4 ) | DR_5;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x00 );
+
+    TestCase( "%s NewChannelReq default channels", rc->Name );
+    newChannelReq.ChannelId = 0;
+    newChannel.Frequency = rc->NewChannelFrequency;
+    newChannel.DrRange.Value = ( DR_5 << 4 ) | DR_0;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x02 );
+    newChannel.Frequency = 0;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x00 );
+    TEST_CHECK_EQUAL( GetChannels( rc )[0].Frequency, rc->DefaultFrequencies[0] );
+
+    TestCase( "%s NewChannelReq beyond the last channel", rc->Name );
+    newChannelReq.ChannelId = rc->MaxNbChannels;
+    newChannel.Frequency = rc->NewChannelFrequency;
+    TEST_CHECK_EQUAL( RegionNewChannelReq( rc->Region, &newChannelReq ), 0x00 );
+}
+
+static void TestRxParamSetupReq( const RegionCase_t* rc )
+{
+    RxParamSetupReqParams_t rxParamSetupReq;
+
+    TestCase( "%s RxParamSetupReq", rc->Name );
+    ResetRegion( rc );
+    rxParamSetupReq.Frequency = rc->Rx2Frequency;
+    rxParamSetupReq.Datarate = rc->Rx2Datarate;
+    rxParamSetupReq.DrOffset = rc->MaxRx1DrOffset;
+    TEST_CHECK_EQUAL( RegionRxParamSetupReq( rc->Region, &rxParamSetupReq ), 0x07 );
+
+    rxParamSetupReq.Frequency = 100000000;
+    TEST_CHECK_EQUAL( RegionRxParamSetupReq( rc->Region, &rxParamSetupReq ), 0x06 );
+    rxParamSetupReq.Frequency = rc->Rx2Frequency;
+
+    rxParamSetupReq.Datarate = rc->RxMaxDr + 1;
+    TEST_CHECK_EQUAL( RegionRxParamSetupReq( rc->Region, &rxParamSetupReq ), 0x05 );
+    rxParamSetupReq.Datarate = rc->Rx2Datarate;
+
+    rxParamSetupReq.DrOffset = rc->MaxRx1DrOffset + 1;
+    TEST_CHECK_EQUAL( RegionRxParamSetupReq( rc->Region, &rxParamSetupReq ), 0x03 );
+}
+
+static void TestChanMaskSet( const RegionCase_t* rc )
+{
+    uint16_t mask[6] = { 0 };
+    ChanMaskSetParams_t chanMaskSet;
+    uint8_t nbChannels = MAX( rc->MinMaskChannels, 2 );
+    uint8_t channel;
+    TimerTime_t time;
+
+    TestCase( "%s ChanMaskSet", rc->Name );
+    ResetRegion( rc );
+    for( uint8_t i = 0; i < nbChannels; i++ )
+    {
+        mask[i / 16] |= 1 << ( i % 16 );
+    }
+    chanMaskSet.ChannelsMaskIn = mask;
+    chanMaskSet.ChannelsMaskType = CHANNELS_MASK;
+    TEST_CHECK( RegionChanMaskSet( rc->Region, &chanMaskSet ) );
+    TEST_CHECK_EQUAL( Count125kHzChannels( rc ), nbChannels );
+
+    // Only the enabled channels carry uplinks
+    for( uint8_t i = 0; i < 4 * nbChannels; i++ )
+    {
+        TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+        TEST_CHECK( channel < nbChannels );
+    }
+
+    if( rc->MinMaskChannels > 1 )
+    {
+        TestCase( "%s ChanMaskSet below the minimum of channels", rc->Name );
+        mask[( nbChannels - 1 ) / 16] &= ~( 1 << ( ( nbChannels - 1 ) % 16 ) );
+        TEST_CHECK( RegionChanMaskSet( rc->Region, &chanMaskSet ) == false );
+        TEST_CHECK_EQUAL( Count125kHzChannels( rc ), nbChannels );
+    }
+
+    TestCase( "%s ChanMaskSet default mask", rc->Name );
+    chanMaskSet.ChannelsMaskType = CHANNELS_DEFAULT_MASK;
+    mask[( nbChannels - 1 ) / 16] |= 1 << ( ( nbChannels - 1 ) % 16 );
+    TEST_CHECK( RegionChanMaskSet( rc->Region, &chanMaskSet ) );
+    {
+        GetPhyParams_t getPhy = { .Attribute = PHY_CHANNELS_DEFAULT_MASK };
+        uint16_t* defaultMask = RegionGetPhyParam( rc->Region, &getPhy ).ChannelsMask;
+        TEST_CHECK_EQUAL( RegionCommonCountChannels( defaultMask, 0, ( rc->Plan == PLAN_FIXED_72 ) ? 4 : NbMaskWords( rc ) ), nbChannels );
+    }
+}
+
+static void TestNextChannel( const RegionCase_t* rc )
+{
+    uint8_t channel;
+    TimerTime_t time;
+    uint8_t used[96] = { 0 };
+    uint8_t nb125kHz;
+
+    TestCase( "%s NextChannel", rc->Name );
+    ResetRegion( rc );
+    for( uint32_t i = 0; i < 8 * 96; i++ )
+    {
+        TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 0 );
+        TEST_CHECK( ChannelEnabled( rc, channel ) );
+        TEST_CHECK( GetChannels( rc )[channel].DrRange.Fields.Min == DR_0 );
+        used[channel]++;
+    }
+    // Every enabled channel of the datarate gets uplinks
+    for( uint8_t i = 0; i < rc->MaxNbChannels; i++ )
+    {
+        if( ( ChannelEnabled( rc, i ) == true ) && ( GetChannels( rc )[i].DrRange.Fields.Min == DR_0 ) )
+        {
+            TEST_CHECK( used[i] > 0 );
+        }
+    }
+
+    if( rc->Plan == PLAN_FIXED_72 )
+    {
+        TestCase( "%s NextChannel hops over every 125 kHz channel", rc->Name );
+        ResetRegion( rc );
+        memset( used, 0, sizeof( used ) );
+        nb125kHz = RegionCommonCountChannels( GetChannelsMask( rc ), 0, 4 );
+        for( uint8_t i = 0; i < nb125kHz; i++ )
+        {
+            TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+            TEST_CHECK( channel < 64 );
+            used[channel]++;
+        }
+        for( uint8_t i = 0; i < 64; i++ )
+        {
+            TEST_CHECK_EQUAL( used[i], ChannelEnabled( rc, i ) ? 1 : 0 );
+        }
+
+        TestCase( "%s NextChannel 500 kHz datarate", rc->Name );
+        ResetRegion( rc );
+        TEST_CHECK( NextChannel( rc, true, false, rc->Datarates[DR_4].Bw == 2 ? DR_4 : DR_6, &channel, &time ) );
+        TEST_CHECK( channel >= 64 );
+    }
+
+    if( rc->Lbt == true )
+    {
+        // The MAC senses the channel the region selects, without blocking
+        TestCase( "%s NextChannel listen before talk", rc->Name );
+        ResetRegion( rc );
+        RadioStub.ChannelFree = false;
+        TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 0 );
+        TEST_CHECK_EQUAL( RadioStub.ChannelFreeCalls, 0 );
+        TEST_CHECK_EQUAL( GetPhy( rc, PHY_CARRIER_SENSE_TIME ), 6 );
+        TEST_CHECK_EQUAL( ( int16_t )GetPhy( rc, PHY_RSSI_FREE_TH ), rc->LbtRssiFreeTh );
+    }
+    else
+    {
+        TestCase( "%s NextChannel without listen before talk", rc->Name );
+        TEST_CHECK_EQUAL( GetPhy( rc, PHY_CARRIER_SENSE_TIME ), 0 );
+    }
+
+    TestCase( "%s NextChannel datarate not supported", rc->Name );
+    ResetRegion( rc );
+    TEST_CHECK( NextChannel( rc, true, false, rc->TxMaxDr + 1, &channel, &time ) == false );
+}
+
+/*!
+ * \brief The channels found busy by a CAD are only selected again when all
+ *        the channels are busy
+ */
+static void TestNextChannelBusy( const RegionCase_t* rc )
+{
+    uint16_t busyMask[REGION_COMMON_BUSY_MASK_SIZE];
+    uint8_t freeChannel = 0;
+    uint8_t channel;
+    TimerTime_t time;
+
+    TestCase( "%s NextChannel leaves the busy channels out", rc->Name );
+    ResetRegion( rc );
+    memset( busyMask, 0xFF, sizeof( busyMask ) );
+    for( uint8_t i = 0; i < rc->MaxNbChannels; i++ )
+    {
+        if( ( ChannelEnabled( rc, i ) == true ) && ( GetChannels( rc )[i].DrRange.Fields.Min == DR_0 ) )
+        {
+            freeChannel = i;
+        }
+    }
+    busyMask[freeChannel / 16] &= ~( 1 << ( freeChannel % 16 ) );
+    for( uint8_t i = 0; i < 64; i++ )
+    {
+        // A fixed plan hands each channel out once per round
+        ResetRegion( rc );
+        TEST_CHECK( NextChannelBusy( rc, true, false, DR_0, false, busyMask, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 0 );
+        TEST_CHECK_EQUAL( channel, freeChannel );
+    }
+
+    TestCase( "%s NextChannel with all the channels busy", rc->Name );
+    memset( busyMask, 0xFF, sizeof( busyMask ) );
+    for( uint8_t i = 0; i < 64; i++ )
+    {
+        TEST_CHECK( NextChannelBusy( rc, true, false, DR_0, false, busyMask, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 0 );
+        TEST_CHECK( ChannelEnabled( rc, channel ) );
+    }
+}
+
+/*!
+ * \brief A query of the next channel must leave the region as it is
+ */
+static void TestNextChannelQuery( const RegionCase_t* rc )
+{
+    uint8_t channel;
+    TimerTime_t time;
+    TimerTime_t queryTime;
+    uint16_t mask[6];
+    uint8_t used[96] = { 0 };
+    uint8_t nb125kHz;
+    ChannelParams_t newChannel = { rc->NewChannelFrequency, 0, { .Fields = { .Min = DR_5, .Max = DR_5 } }, 0 };
+    ChannelAddParams_t channelAdd = { &newChannel, 3 };
+
+    TestCase( "%s NextChannel query keeps the channels mask", rc->Name );
+    ResetRegion( rc );
+    memcpy( mask, GetChannelsMask( rc ), NbMaskWords( rc ) * sizeof( uint16_t ) );
+    for( uint8_t i = 0; i < 100; i++ )
+    {
+        TEST_CHECK( NextChannelQuery( rc, true, false, DR_0, true, &channel, &time ) );
+        TEST_CHECK( ChannelEnabled( rc, channel ) );
+    }
+    TEST_CHECK( memcmp( mask, GetChannelsMask( rc ), NbMaskWords( rc ) * sizeof( uint16_t ) ) == 0 );
+
+    if( rc->Plan == PLAN_FIXED_72 )
+    {
+        TestCase( "%s NextChannel query keeps the hopping sequence", rc->Name );
+        nb125kHz = RegionCommonCountChannels( GetChannelsMask( rc ), 0, 4 );
+        for( uint8_t i = 0; i < nb125kHz; i++ )
+        {
+            TEST_CHECK( NextChannelQuery( rc, true, false, DR_0, true, &channel, &time ) );
+            TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+            used[channel]++;
+        }
+        for( uint8_t i = 0; i < 64; i++ )
+        {
+            TEST_CHECK_EQUAL( used[i], ChannelEnabled( rc, i ) ? 1 : 0 );
+        }
+    }
+
+    if( rc->DutyCycle == true )
+    {
+        TestCase( "%s NextChannel query delay", rc->Name );
+        ResetRegion( rc );
+        TEST_CHECK( NextChannel( rc, true, true, DR_0, &channel, &time ) );
+        SendOnChannel( rc, true, false, true, channel, 100 );
+        TimerStubAdvance( 10 );
+        TEST_CHECK( NextChannelQuery( rc, true, true, DR_0, true, &channel, &queryTime ) );
+        TEST_CHECK( NextChannel( rc, true, true, DR_0, &channel, &time ) );
+        TEST_CHECK_EQUAL( queryTime, time );
+    }
+
+    if( rc->Lbt == true )
+    {
+        TestCase( "%s NextChannel query without carrier sense", rc->Name );
+        ResetRegion( rc );
+        RadioStub.ChannelFree = false;
+        TEST_CHECK( NextChannelQuery( rc, true, false, DR_0, true, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 0 );
+        TEST_CHECK_EQUAL( RadioStub.ChannelFreeCalls, 0 );
+    }
+
+    if( rc->Plan == PLAN_DYNAMIC )
+    {
+        TestCase( "%s NextChannel query on a datarate no channel fits", rc->Name );
+        ResetRegion( rc );
+        TEST_CHECK_EQUAL( RegionChannelAdd( rc->Region, &channelAdd ), LORAMAC_STATUS_OK );
+        GetChannelsMask( rc )[0] = 1 << 3;
+        // The query counts the default channels the actual call restores
+        TEST_CHECK( NextChannelQuery( rc, true, false, DR_0, true, &channel, &time ) );
+        TEST_CHECK( channel < rc->NbDefaultChannels );
+        TEST_CHECK_EQUAL( GetChannelsMask( rc )[0], 1 << 3 );
+        TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) == false );
+        TEST_CHECK_EQUAL( GetChannelsMask( rc )[0], ( 1 << 3 ) | ( ( 1 << rc->NbDefaultChannels ) - 1 ) );
+    }
+}
+
+static void TestCalcBackOff( const RegionCase_t* rc )
+{
+    uint8_t channel;
+    TimerTime_t time;
+    TimerTime_t timeOff;
+
+    TestCase( "%s CalcBackOff duty cycle", rc->Name );
+    ResetRegion( rc );
+    TEST_CHECK( NextChannel( rc, true, true, DR_0, &channel, &time ) );
+    SendOnChannel( rc, true, false, true, channel, 100 );
+    timeOff = 100 * rc->DefaultBandDCycle - 100;
+    TEST_CHECK( NextChannel( rc, true, true, DR_0, &channel, &time ) );
+    if( ( timeOff != 0 ) && ( rc->Plan == PLAN_DYNAMIC ) )
+    {
+        // The default channels share the band
+        TEST_CHECK_EQUAL( time, timeOff );
+        TimerStubAdvance( timeOff - 1 );
+        TEST_CHECK( NextChannel( rc, true, true, DR_0, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 1 );
+        TimerStubAdvance( 1 );
+        TEST_CHECK( NextChannel( rc, true, true, DR_0, &channel, &time ) );
+    }
+    TEST_CHECK_EQUAL( time, 0 );
+
+    TestCase( "%s CalcBackOff duty cycle off", rc->Name );
+    ResetRegion( rc );
+    TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+    SendOnChannel( rc, true, false, false, channel, 100 );
+    TEST_CHECK( NextChannel( rc, true, false, DR_0, &channel, &time ) );
+    TEST_CHECK_EQUAL( time, 0 );
+
+    TestCase( "%s CalcBackOff join duty cycle", rc->Name );
+    ResetRegion( rc );
+    TEST_CHECK( NextChannel( rc, false, false, DR_0, &channel, &time ) );
+    SendOnChannel( rc, false, true, false, channel, 100 );
+    TEST_CHECK( NextChannel( rc, false, false, DR_0, &channel, &time ) );
+    if( rc->Plan == PLAN_DYNAMIC )
+    {
+        // 1 % during the first hour
+        TEST_CHECK_EQUAL( time, 100 * 100 - 100 );
+        TimerStubAdvance( 100 * 100 - 100 );
+        TEST_CHECK( NextChannel( rc, false, false, DR_0, &channel, &time ) );
+        TEST_CHECK_EQUAL( time, 0 );
+    }
+}
+
+static void TestAdrNext( const RegionCase_t* rc )
+{
+    AdrNextParams_t adrNext;
+    int8_t dr;
+    int8_t txPower;
+    uint32_t adrAckCounter;
+
+    TestCase( "%s AdrNext below the ADR ack limit", rc->Name );
+    ResetRegion( rc );
+    adrNext.UpdateChanMask = true;
+    adrNext.AdrEnabled = true;
+    adrNext.AdrAckCounter = 63;
+    adrNext.Datarate = DR_3;
+    adrNext.TxPower = TX_POWER_3;
+    adrNext.UplinkDwellTime = 0;
+    TEST_CHECK( RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter ) == false );
+    TEST_CHECK_EQUAL( dr, DR_3 );
+    TEST_CHECK_EQUAL( txPower, TX_POWER_3 );
+    TEST_CHECK_EQUAL( adrAckCounter, 63 );
+
+    TestCase( "%s AdrNext ADR ack request", rc->Name );
+    adrNext.AdrAckCounter = 64;
+    TEST_CHECK( RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter ) );
+    TEST_CHECK_EQUAL( dr, DR_3 );
+    TEST_CHECK_EQUAL( txPower, TX_POWER_0 );
+
+    TestCase( "%s AdrNext datarate decrease", rc->Name );
+    adrNext.AdrAckCounter = 64 + 32 + 1;
+    TEST_CHECK( RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter ) );
+    TEST_CHECK_EQUAL( dr, DR_2 );
+    adrNext.AdrAckCounter = 64 + 32 + 2;
+    RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter );
+    TEST_CHECK_EQUAL( dr, DR_3 );
+
+    TestCase( "%s AdrNext lowest datarate", rc->Name );
+    adrNext.Datarate = DR_1;
+    adrNext.AdrAckCounter = 64 + 32 + 1;
+    TEST_CHECK( RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter ) == false );
+    TEST_CHECK_EQUAL( dr, DR_0 );
+    adrNext.Datarate = DR_0;
+    TEST_CHECK( RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter ) == false );
+    TEST_CHECK_EQUAL( adrAckCounter, 0 );
+
+    TestCase( "%s AdrNext ADR off", rc->Name );
+    adrNext.AdrEnabled = false;
+    adrNext.Datarate = DR_3;
+    adrNext.AdrAckCounter = 64 + 32 + 1;
+    TEST_CHECK( RegionAdrNext( rc->Region, &adrNext, &dr, &txPower, &adrAckCounter ) == false );
+    TEST_CHECK_EQUAL( dr, DR_3 );
+}
+
+static void TestApplyCFList( const RegionCase_t* rc )
+{
+    uint8_t cfList[16] = { 0 };
+    ApplyCFListParams_t applyCFList;
+
+    TestCase( "%s CFList", rc->Name );
+    ResetRegion( rc );
+    for( uint8_t i = 0; i < CFLIST_NB_CHANNELS; i++ )
+    {
+        uint32_t freq = ( rc->NewChannelFrequency + i * 200000 ) / 100;
+
+        cfList[3 * i] = freq & 0xFF;
+        cfList[3 * i + 1] = ( freq >> 8 ) & 0xFF;
+        cfList[3 * i + 2] = ( freq >> 16 ) & 0xFF;
+    }
+    applyCFList.Payload = cfList;
+    applyCFList.Size = sizeof( cfList );
+    RegionApplyCFList( rc->Region, &applyCFList );
+
+    if( rc->Plan != PLAN_DYNAMIC )
+    {
+        TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbEnabledChannels );
+        return;
+    }
+    TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbDefaultChannels + CFLIST_NB_CHANNELS );
+    for( uint8_t i = 0; i < CFLIST_NB_CHANNELS; i++ )
+    {
+        uint8_t id = rc->NbDefaultChannels + i;
+
+        TEST_CHECK( ChannelEnabled( rc, id ) );
+        TEST_CHECK_EQUAL( GetChannels( rc )[id].Frequency, rc->NewChannelFrequency + i * 200000 );
+        TEST_CHECK_EQUAL( GetChannels( rc )[id].DrRange.Value, ( DR_5 << 4 ) | DR_0 );
+    }
+
+    TestCase( "%s CFList of a wrong size", rc->Name );
+    ResetRegion( rc );
+    applyCFList.Size = 15;
+    RegionApplyCFList( rc->Region, &applyCFList );
+    TEST_CHECK_EQUAL( CountEnabledChannels( rc ), rc->NbDefaultChannels );
+}
+
+static void TestTxConfig( const RegionCase_t* rc )
+{
+    TxConfigParams_t txConfig;
+    int8_t txPower;
+    int8_t phyTxPower[3];
+    TimerTime_t timeOnAir;
+
+    ResetRegion( rc );
+    txConfig.Channel = 0;
+    {
+        GetPhyParams_t getPhy = { .Attribute = PHY_DEF_MAX_EIRP };
+        txConfig.MaxEirp = ( int8_t )RegionGetPhyParam( rc->Region, &getPhy ).Value;
+    }
+    txConfig.AntennaGain = 0;
+    txConfig.PktLen = 20;
+
+    for( int8_t dr = DR_0; dr <= rc->TxMaxDr; dr++ )
+    {
+        const DrSpec_t* spec = &rc->Datarates[dr];
+
+        TestCase( "%s TxConfig DR%d", rc->Name, dr );
+        if( ( rc->Plan == PLAN_FIXED_72 ) && ( spec->Bw == 2 ) )
+        {
+            txConfig.Channel = 64;
+        }
+        else
+        {
+            txConfig.Channel = 0;
+        }
+        txConfig.Datarate = dr;
+        txConfig.TxPower = TX_POWER_0;
+        RadioStub.TimeOnAir = 123;
+        TEST_CHECK( RegionTxConfig( rc->Region, &txConfig, &txPower, &timeOnAir ) );
+        TEST_CHECK_EQUAL( timeOnAir, 123 );
+        TEST_CHECK_EQUAL( RadioStub.Frequency, GetChannels( rc )[txConfig.Channel].Frequency );
+        if( spec->Sf == 0 )
+        {
+            TEST_CHECK_EQUAL( RadioStub.TxModem, MODEM_FSK );
+            TEST_CHECK_EQUAL( RadioStub.TxDatarate, 50000 );
+        }
+        else
+        {
+            TEST_CHECK_EQUAL( RadioStub.TxModem, MODEM_LORA );
+            TEST_CHECK_EQUAL( RadioStub.TxDatarate, spec->Sf );
+            TEST_CHECK_EQUAL( RadioStub.TxBandwidth, spec->Bw );
+        }
+    }
+
+    TestCase( "%s TX power limit", rc->Name );
+    txConfig.Channel = 0;
+    txConfig.Datarate = DR_0;
+    txConfig.TxPower = TX_POWER_0;
+    TEST_CHECK( RegionTxConfig( rc->Region, &txConfig, &txPower, &timeOnAir ) );
+    TEST_CHECK_EQUAL( txPower, rc->DefaultMaxTxPower );
+
+    // Each TX power step lowers the EIRP by 2 dB
+    TestCase( "%s TX power steps", rc->Name );
+    for( int8_t i = 0; i < 3; i++ )
+    {
+        txConfig.TxPower = rc->DefaultMaxTxPower + i;
+        TEST_CHECK( RegionTxConfig( rc->Region, &txConfig, &txPower, &timeOnAir ) );
+        TEST_CHECK_EQUAL( txPower, txConfig.TxPower );
+        phyTxPower[i] = RadioStub.TxPower;
+    }
+    TEST_CHECK_EQUAL( phyTxPower[0] - phyTxPower[1], 2 );
+    TEST_CHECK_EQUAL( phyTxPower[1] - phyTxPower[2], 2 );
+}
+
+/*!
+ * \brief TX power from the EIRP and the antenna gain in half dB, rounded down
+ *        to the dB without ever going over the EIRP, and for the regional
+ *        defaults the power the values in dB give exactly
+ */
+static void TestComputeTxPower( void )
+{
+    static const struct
+    {
+        const char* Name;
+        int8_t MaxEirp;
+        int8_t AntennaGain;
+        int32_t MaxEirpCentiDb;
+        int32_t AntennaGainCentiDb;
+    }defaults[] =
+    {
+        { "AS923", AS923_DEFAULT_MAX_EIRP, AS923_DEFAULT_ANTENNA_GAIN, 1600, 215 },
+        { "AU915", AU915_DEFAULT_MAX_EIRP, AU915_DEFAULT_ANTENNA_GAIN, 3000, 215 },
+        { "CN470", CN470_DEFAULT_MAX_EIRP, CN470_DEFAULT_ANTENNA_GAIN, 1915, 215 },
+        { "CN779", CN779_DEFAULT_MAX_EIRP, CN779_DEFAULT_ANTENNA_GAIN, 1215, 215 },
+        { "EU433", EU433_DEFAULT_MAX_EIRP, EU433_DEFAULT_ANTENNA_GAIN, 1215, 215 },
+        { "EU868", EU868_DEFAULT_MAX_EIRP, EU868_DEFAULT_ANTENNA_GAIN, 1600, 215 },
+        { "IN865", IN865_DEFAULT_MAX_EIRP, IN865_DEFAULT_ANTENNA_GAIN, 3000, 215 },
+        { "KR920 low", KR920_DEFAULT_MAX_EIRP_LOW, KR920_DEFAULT_ANTENNA_GAIN, 1000, 215 },
+        { "KR920 high", KR920_DEFAULT_MAX_EIRP_HIGH, KR920_DEFAULT_ANTENNA_GAIN, 1400, 215 },
+        { "US915", US915_DEFAULT_MAX_ERP, 0, 3000, 0 },
+        { "US915 hybrid", US915_HYBRID_DEFAULT_MAX_ERP, 0, 3000, 0 },
+    };
+
+    TestCase( "TX power in half dB" );
+    for( int8_t maxEirp = -20; maxEirp <= 80; maxEirp++ )
+    {
+        for( int8_t antennaGain = 0; antennaGain <= 20; antennaGain++ )
+        {
+            for( int8_t txPower = 0; txPower < 16; txPower++ )
+            {
+                int8_t phyTxPower = RegionCommonComputeTxPower( txPower, maxEirp, antennaGain );
+
+                TEST_CHECK( 2 * phyTxPower + antennaGain <= maxEirp - 4 * txPower );
+                TEST_CHECK( 2 * phyTxPower + antennaGain > maxEirp - 4 * txPower - 2 );
+            }
+        }
+    }
+
+    for( uint8_t i = 0; i < sizeof( defaults ) / sizeof( defaults[0] ); i++ )
+    {
+        TestCase( "%s default TX power", defaults[i].Name );
+        for( int8_t txPower = 0; txPower < 16; txPower++ )
+        {
+            int32_t centiDb = defaults[i].MaxEirpCentiDb - 200 * txPower - defaults[i].AntennaGainCentiDb;
+            int32_t expected = ( centiDb >= 0 ) ? ( centiDb / 100 ) : -( ( 99 - centiDb ) / 100 );
+
+            TEST_CHECK_EQUAL( RegionCommonComputeTxPower( txPower, defaults[i].MaxEirp, defaults[i].AntennaGain ), expected );
+        }
+    }
+}
+
+static void TestRxWindow( const RegionCase_t* rc )
+{
+    RxConfigParams_t rxConfig;
+    uint32_t windowTimeout;
+    int32_t windowOffset;
+
+    ResetRegion( rc );
+    for( int8_t dr = rc->RxMinDr; dr <= rc->RxMaxDr; dr++ )
+    {
+        TestCase( "%s RX window DR%d", rc->Name, dr );
+        for( uint32_t wakeUpTime = 0; wakeUpTime < 12; wakeUpTime += 3 )
+        {
+            RadioStub.WakeUpTime = wakeUpTime;
+            for( uint8_t minRxSymbols = 1; minRxSymbols < 20; minRxSymbols++ )
+            {
+                for( uint32_t rxError = 0; rxError < 60; rxError += 7 )
+                {
+                    RegionComputeRxWindowParameters( rc->Region, dr, minRxSymbols, rxError, &rxConfig );
+                    RxWindowReference( &rc->Datarates[dr], minRxSymbols, rxError, wakeUpTime, &windowTimeout, &windowOffset );
+                    TEST_CHECK_EQUAL( rxConfig.Datarate, dr );
+                    TEST_CHECK_EQUAL( rxConfig.Bandwidth, rc->Datarates[dr].Bw );
+                    TEST_CHECK_EQUAL( rxConfig.WindowTimeout, windowTimeout );
+                    TEST_CHECK_EQUAL( rxConfig.WindowOffset, windowOffset );
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * \brief The PHY cache of the MAC holds what RegionGetPhyParam returns,
+ *        for every dwell time and repeater setting
+ */
+static void TestPhyCache( const RegionCase_t* rc )
+{
+    GetPhyCacheParams_t getPhyCache;
+    GetPhyParams_t getPhy = { 0 };
+    PhyCache_t phyCache;
+    PhyAttribute_t maxPayload;
+    int8_t minRxDr;
+
+    ResetRegion( rc );
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        getPhyCache.UplinkDwellTime = i & 0x01;
+        getPhyCache.DownlinkDwellTime = ( i >> 1 ) & 0x01;
+        getPhyCache.RepeaterSupport = ( i & 0x04 ) != 0;
+        maxPayload = getPhyCache.RepeaterSupport ? PHY_MAX_PAYLOAD_REPEATER : PHY_MAX_PAYLOAD;
+
+        TestCase( "%s PHY cache, dwell times %u/%u, repeater %u", rc->Name, getPhyCache.UplinkDwellTime,
+                  getPhyCache.DownlinkDwellTime, getPhyCache.RepeaterSupport );
+        memset( &phyCache, 0xA5, sizeof( phyCache ) );
+        RegionGetPhyCache( rc->Region, &getPhyCache, &phyCache );
+
+        getPhy.UplinkDwellTime = getPhyCache.UplinkDwellTime;
+        getPhy.DownlinkDwellTime = getPhyCache.DownlinkDwellTime;
+        getPhy.Attribute = PHY_MIN_TX_DR;
+        TEST_CHECK_EQUAL( phyCache.MinTxDr, ( int8_t )RegionGetPhyParam( rc->Region, &getPhy ).Value );
+        getPhy.Attribute = PHY_MIN_RX_DR;
+        minRxDr = RegionGetPhyParam( rc->Region, &getPhy ).Value;
+        getPhy.Attribute = PHY_MAX_FCNT_GAP;
+        TEST_CHECK_EQUAL( phyCache.MaxFCntGap, RegionGetPhyParam( rc->Region, &getPhy ).Value );
+        getPhy.Attribute = PHY_CARRIER_SENSE_TIME;
+        TEST_CHECK_EQUAL( phyCache.CarrierSenseTime, RegionGetPhyParam( rc->Region, &getPhy ).Value );
+        getPhy.Attribute = PHY_RSSI_FREE_TH;
+        TEST_CHECK_EQUAL( phyCache.RssiFreeTh, ( int16_t )RegionGetPhyParam( rc->Region, &getPhy ).Value );
+
+        for( int8_t dr = 0; dr < 16; dr++ )
+        {
+            getPhy.Datarate = dr;
+            getPhy.UplinkDwellTime = getPhyCache.UplinkDwellTime;
+            getPhy.Attribute = PHY_NEXT_LOWER_TX_DR;
+            TEST_CHECK_EQUAL( phyCache.NextLowerTxDr[dr], ( int8_t )RegionGetPhyParam( rc->Region, &getPhy ).Value );
+            getPhy.Attribute = PHY_BANDWIDTH;
+            TEST_CHECK_EQUAL( phyCache.Bandwidth[dr], RegionGetPhyParam( rc->Region, &getPhy ).Value );
+            getPhy.Attribute = PHY_SYMBOL_TIME;
+            TEST_CHECK_EQUAL( phyCache.SymbolTime[dr], RegionGetPhyParam( rc->Region, &getPhy ).Value );
+
+            getPhy.Attribute = maxPayload;
+            if( ( dr >= phyCache.MinTxDr ) && ( dr <= rc->TxMaxDr ) )
+            {
+                TEST_CHECK_EQUAL( phyCache.MaxTxPayload[dr], RegionGetPhyParam( rc->Region, &getPhy ).Value );
+            }
+            else
+            {
+                TEST_CHECK_EQUAL( phyCache.MaxTxPayload[dr], 0 );
+            }
+            getPhy.UplinkDwellTime = getPhyCache.DownlinkDwellTime;
+            if( ( dr >= minRxDr ) && ( dr <= rc->RxMaxDr ) )
+            {
+                TEST_CHECK_EQUAL( phyCache.MaxRxPayload[dr], RegionGetPhyParam( rc->Region, &getPhy ).Value );
+            }
+            else
+            {
+                TEST_CHECK_EQUAL( phyCache.MaxRxPayload[dr], 0 );
+            }
+        }
+
+        // The bandwidths and symbol times of the Regional Parameters
+        for( int8_t dr = rc->RxMinDr; dr <= rc->RxMaxDr; dr++ )
+        {
+            const DrSpec_t* spec = &rc->Datarates[dr];
+
+            if( spec->Sf == 0 )
+            {
+                TEST_CHECK_EQUAL( phyCache.Bandwidth[dr], 0 );
+                TEST_CHECK_EQUAL( phyCache.SymbolTime[dr], 160 );
+            }
+            else
+            {
+                TEST_CHECK_EQUAL( phyCache.Bandwidth[dr], 125000 << spec->Bw );
+                TEST_CHECK_EQUAL( phyCache.SymbolTime[dr], ( ( 1u << spec->Sf ) * 1000000u ) / ( 125000u << spec->Bw ) );
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Mean duration of the calls made on each uplink and MAC command
+ */
+static void BenchRegion( const RegionCase_t* rc )
+{
+    uint8_t payload[] = LINK_ADR_REQ( DR_1, TX_POWER_1, AcceptedMask( rc ), 0, 1 );
+    int8_t dr = DR_0;
+    int8_t txPower = TX_POWER_0;
+    uint8_t nbRep = 1;
+    uint8_t nbBytesParsed;
+    uint8_t channel;
+    TimerTime_t time;
+    LinkAdrReqParams_t linkAdrReq = { payload, sizeof( payload ), 0, true, DR_0, TX_POWER_0, 1 };
+    NextChanParams_t nextChan = { 0, 0, DR_0, true, true };
+    CalcBackOffParams_t calcBackOff = { true, false, true, 0, 0, 100 };
+    RxConfigParams_t rxConfig;
+    GetPhyParams_t getPhy = { .Attribute = PHY_MAX_PAYLOAD, .Datarate = DR_0 };
+    const RegionOps_t* ops;
+
+    printf( "%s\n", rc->Name );
+    ResetRegion( rc );
+
+    TEST_BENCH( "LinkAdrReq", BENCH_RUNS, RegionLinkAdrReq( rc->Region, &linkAdrReq, &dr, &txPower, &nbRep, &nbBytesParsed ) );
+
+    ResetRegion( rc );
+    TEST_BENCH( "NextChannel", BENCH_RUNS, RegionNextChannel( rc->Region, &nextChan, &channel, &time, &time ) );
+
+    TEST_BENCH( "CalcBackOff", BENCH_RUNS, RegionCalcBackOff( rc->Region, &calcBackOff ) );
+
+    TEST_BENCH( "ComputeRxWindowParameters", BENCH_RUNS, RegionComputeRxWindowParameters( rc->Region, rc->RxMinDr, 6, 10, &rxConfig ) );
+
+    TEST_BENCH( "GetPhyParam( PHY_MAX_PAYLOAD )", BENCH_RUNS, RegionGetPhyParam( rc->Region, &getPhy ) );
+
+    // The MAC keeps the operations of its region and calls them directly
+    ops = RegionGetOps( rc->Region );
+    TEST_BENCH( "CalcBackOff, cached ops", BENCH_RUNS, ops->CalcBackOff( &calcBackOff ) );
+
+    TEST_BENCH( "GetPhyParam( PHY_MAX_PAYLOAD ), cached ops", BENCH_RUNS, ops->GetPhyParam( &getPhy ) );
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main( void )
+{
+    srand1( 1 );
+
+    for( uint8_t i = 0; i < sizeof( RegionCases ) / sizeof( RegionCases[0] ); i++ )
+    {
+        const RegionCase_t* rc = &RegionCases[i];
+
+        TestInitDefaults( rc );
+        TestLinkAdrReq( rc );
+        TestNewChannelReq( rc );
+        TestRxParamSetupReq( rc );
+        TestChanMaskSet( rc );
+        TestNextChannel( rc );
+        TestNextChannelQuery( rc );
+        TestNextChannelBusy( rc );
+        TestCalcBackOff( rc );
+        TestAdrNext( rc );
+        TestApplyCFList( rc );
+        TestTxConfig( rc );
+        TestRxWindow( rc );
+        TestPhyCache( rc );
+    }
+
+    TestComputeTxPower( );
+
+    printf( "Region layer timings\n" );
+    for( uint8_t i = 0; i < sizeof( RegionCases ) / sizeof( RegionCases[0] ); i++ )
+    {
+        BenchRegion( &RegionCases[i] );
+    }
+
+    return TestSummary( );
+}
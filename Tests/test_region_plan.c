@@ -0,0 +1,742 @@
+ /******************************************************************************
+  * @file    test_region_plan.c
+  * @brief   host test of the channel plan handling shared by the regions with
+  *          a dynamic channel plan, against the per region code it replaced
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "region/Region.h"
+#include "region/RegionCommon.h"
+#include "region/RegionAS923.h"
+#include "region/RegionCN779.h"
+#include "region/RegionEU433.h"
+#include "region/RegionEU868.h"
+#include "region/RegionIN865.h"
+#include "region/RegionKR920.h"
+#include "radio_stub.h"
+#include "timer_stub.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/*!
+ * Random MAC commands run against each region
+ */
+#define NB_COMMANDS                                 20000
+
+#define REF_MAX_NB_CHANNELS                         16
+
+/* Private typedef -----------------------------------------------------------*/
+
+/*!
+ * \brief Constants of a region, read from its header as the per region
+ *        code did
+ */
+typedef struct sRefRegion
+{
+    const char* Name;
+    LoRaMacRegion_t Region;
+    uint8_t MaxNbChannels;
+    uint8_t NbDefaultChannels;
+    int8_t TxMinDatarate;
+    int8_t TxMaxDatarate;
+    int8_t RxMinDatarate;
+    int8_t RxMaxDatarate;
+    uint8_t MinRx1DrOffset;
+    uint8_t MaxRx1DrOffset;
+    int8_t MinTxPower;
+    int8_t MaxTxPower;
+    /*!
+     * KR920 does not restrict the datarates of its default channels
+     */
+    bool DefaultChannelsAnyDr;
+    /*!
+     * KR920 has no FSK datarate and no repeater payload sizes
+     */
+    bool HasFsk;
+    const uint8_t* Datarates;
+    const uint8_t* MaxPayloadOfDatarate;
+    const uint8_t* MaxPayloadOfDatarateRepeater;
+    bool ( *VerifyTxFreq )( uint32_t freq, uint8_t* band );
+    /*!
+     * Lowest and highest uplink frequencies, to draw the requests from
+     */
+    uint32_t MinFrequency;
+    uint32_t MaxFrequency;
+}RefRegion_t;
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * VerifyTxFreq of each region, as they were
+ */
+
+static bool RefVerifyTxFreqEU868( uint32_t freq, uint8_t* band )
+{
+    if( Radio.CheckRfFrequency( freq ) == false )
+    {
+        return false;
+    }
+    if( ( freq >= 863000000 ) && ( freq < 865000000 ) )
+    {
+        *band = 2;
+    }
+    else if( ( freq >= 865000000 ) && ( freq <= 868000000 ) )
+    {
+        *band = 0;
+    }
+    else if( ( freq > 868000000 ) && ( freq <= 868600000 ) )
+    {
+        *band = 1;
+    }
+    else if( ( freq >= 868700000 ) && ( freq <= 869200000 ) )
+    {
+        *band = 2;
+    }
+    else if( ( freq >= 869400000 ) && ( freq <= 869650000 ) )
+    {
+        *band = 3;
+    }
+    else if( ( freq >= 869700000 ) && ( freq <= 870000000 ) )
+    {
+        *band = 4;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+static bool RefVerifyTxFreqRange( uint32_t freq, uint32_t min, uint32_t max )
+{
+    if( Radio.CheckRfFrequency( freq ) == false )
+    {
+        return false;
+    }
+    return ( freq >= min ) && ( freq <= max );
+}
+
+static bool RefVerifyTxFreqEU433( uint32_t freq, uint8_t* band )
+{
+    return RefVerifyTxFreqRange( freq, 433175000, 434665000 );
+}
+
+static bool RefVerifyTxFreqCN779( uint32_t freq, uint8_t* band )
+{
+    return RefVerifyTxFreqRange( freq, 779500000, 786500000 );
+}
+
+static bool RefVerifyTxFreqIN865( uint32_t freq, uint8_t* band )
+{
+    return RefVerifyTxFreqRange( freq, 865000000, 867000000 );
+}
+
+static bool RefVerifyTxFreqAS923( uint32_t freq, uint8_t* band )
+{
+    return RefVerifyTxFreqRange( freq, 915000000, 928000000 );
+}
+
+static bool RefVerifyTxFreqKR920( uint32_t freq, uint8_t* band )
+{
+    if( Radio.CheckRfFrequency( freq ) == false )
+    {
+        return false;
+    }
+    return ( freq >= 920900000 ) && ( freq <= 923300000 ) && ( ( ( freq - 920900000 ) % 200000 ) == 0 );
+}
+
+/* Private variables ---------------------------------------------------------*/
+
+static const RefRegion_t RefRegions[] =
+{
+    {
+        "EU868", LORAMAC_REGION_EU868, EU868_MAX_NB_CHANNELS, EU868_NUMB_DEFAULT_CHANNELS,
+        EU868_TX_MIN_DATARATE, EU868_TX_MAX_DATARATE, EU868_RX_MIN_DATARATE, EU868_RX_MAX_DATARATE,
+        EU868_MIN_RX1_DR_OFFSET, EU868_MAX_RX1_DR_OFFSET, EU868_MIN_TX_POWER, EU868_MAX_TX_POWER,
+        false, true, DataratesEU868, MaxPayloadOfDatarateEU868, MaxPayloadOfDatarateRepeaterEU868,
+        RefVerifyTxFreqEU868, 863000000, 870000000
+    },
+    {
+        "EU433", LORAMAC_REGION_EU433, EU433_MAX_NB_CHANNELS, EU433_NUMB_DEFAULT_CHANNELS,
+        EU433_TX_MIN_DATARATE, EU433_TX_MAX_DATARATE, EU433_RX_MIN_DATARATE, EU433_RX_MAX_DATARATE,
+        EU433_MIN_RX1_DR_OFFSET, EU433_MAX_RX1_DR_OFFSET, EU433_MIN_TX_POWER, EU433_MAX_TX_POWER,
+        false, true, DataratesEU433, MaxPayloadOfDatarateEU433, MaxPayloadOfDatarateRepeaterEU433,
+        RefVerifyTxFreqEU433, 433175000, 434665000
+    },
+    {
+        "CN779", LORAMAC_REGION_CN779, CN779_MAX_NB_CHANNELS, CN779_NUMB_DEFAULT_CHANNELS,
+        CN779_TX_MIN_DATARATE, CN779_TX_MAX_DATARATE, CN779_RX_MIN_DATARATE, CN779_RX_MAX_DATARATE,
+        CN779_MIN_RX1_DR_OFFSET, CN779_MAX_RX1_DR_OFFSET, CN779_MIN_TX_POWER, CN779_MAX_TX_POWER,
+        false, true, DataratesCN779, MaxPayloadOfDatarateCN779, MaxPayloadOfDatarateRepeaterCN779,
+        RefVerifyTxFreqCN779, 779500000, 786500000
+    },
+    {
+        "IN865", LORAMAC_REGION_IN865, IN865_MAX_NB_CHANNELS, IN865_NUMB_DEFAULT_CHANNELS,
+        IN865_TX_MIN_DATARATE, IN865_TX_MAX_DATARATE, IN865_RX_MIN_DATARATE, IN865_RX_MAX_DATARATE,
+        IN865_MIN_RX1_DR_OFFSET, IN865_MAX_RX1_DR_OFFSET, IN865_MIN_TX_POWER, IN865_MAX_TX_POWER,
+        false, true, DataratesIN865, MaxPayloadOfDatarateIN865, MaxPayloadOfDatarateRepeaterIN865,
+        RefVerifyTxFreqIN865, 865000000, 867000000
+    },
+    {
+        "KR920", LORAMAC_REGION_KR920, KR920_MAX_NB_CHANNELS, KR920_NUMB_DEFAULT_CHANNELS,
+        KR920_TX_MIN_DATARATE, KR920_TX_MAX_DATARATE, KR920_RX_MIN_DATARATE, KR920_RX_MAX_DATARATE,
+        KR920_MIN_RX1_DR_OFFSET, KR920_MAX_RX1_DR_OFFSET, KR920_MIN_TX_POWER, KR920_MAX_TX_POWER,
+        true, false, DataratesKR920, MaxPayloadOfDatarateKR920, MaxPayloadOfDatarateKR920,
+        RefVerifyTxFreqKR920, 920900000, 923300000
+    },
+    {
+        "AS923", LORAMAC_REGION_AS923, AS923_MAX_NB_CHANNELS, AS923_NUMB_DEFAULT_CHANNELS,
+        AS923_TX_MIN_DATARATE, AS923_TX_MAX_DATARATE, AS923_RX_MIN_DATARATE, AS923_RX_MAX_DATARATE,
+        AS923_MIN_RX1_DR_OFFSET, AS923_MAX_RX1_DR_OFFSET, AS923_MIN_TX_POWER, AS923_MAX_TX_POWER,
+        false, true, DataratesAS923, MaxPayloadOfDatarateDwell0AS923, MaxPayloadOfDatarateRepeaterDwell0AS923,
+        RefVerifyTxFreqAS923, 915000000, 928000000
+    },
+};
+
+/*!
+ * State of the reference, kept in step with the region
+ */
+static ChannelParams_t RefChannels[REF_MAX_NB_CHANNELS];
+static uint16_t RefChannelsMask[1];
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint16_t* GetChannelsMask( const RefRegion_t* ref )
+{
+    GetPhyParams_t getPhy = { .Attribute = PHY_CHANNELS_MASK };
+
+    return RegionGetPhyParam( ref->Region, &getPhy ).ChannelsMask;
+}
+
+static ChannelParams_t* GetChannels( const RefRegion_t* ref )
+{
+    GetPhyParams_t getPhy = { .Attribute = PHY_CHANNELS };
+
+    return RegionGetPhyParam( ref->Region, &getPhy ).Channels;
+}
+
+/*
+ * Per region code of ChannelAdd, ChannelsRemove, NewChannelReq,
+ * DlChannelReq, LinkAdrReq, RxParamSetupReq and RxConfig, written once with
+ * the constants of the region
+ */
+
+static LoRaMacStatus_t RefChannelAdd( const RefRegion_t* ref, ChannelAddParams_t* channelAdd )
+{
+    uint8_t band = 0;
+    bool drInvalid = false;
+    bool freqInvalid = false;
+    uint8_t id = channelAdd->ChannelId;
+
+    if( id >= ref->MaxNbChannels )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Min, ref->TxMinDatarate, ref->TxMaxDatarate ) == false )
+    {
+        drInvalid = true;
+    }
+    if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Max, ref->TxMinDatarate, ref->TxMaxDatarate ) == false )
+    {
+        drInvalid = true;
+    }
+    if( channelAdd->NewChannel->DrRange.Fields.Min > channelAdd->NewChannel->DrRange.Fields.Max )
+    {
+        drInvalid = true;
+    }
+    if( id < ref->NbDefaultChannels )
+    {
+        if( ref->DefaultChannelsAnyDr == false )
+        {
+            if( channelAdd->NewChannel->DrRange.Fields.Min > DR_0 )
+            {
+                drInvalid = true;
+            }
+            if( RegionCommonValueInRange( channelAdd->NewChannel->DrRange.Fields.Max, DR_5, ref->TxMaxDatarate ) == false )
+            {
+                drInvalid = true;
+            }
+        }
+        if( channelAdd->NewChannel->Frequency != RefChannels[id].Frequency )
+        {
+            freqInvalid = true;
+        }
+    }
+    if( freqInvalid == false )
+    {
+        if( ref->VerifyTxFreq( channelAdd->NewChannel->Frequency, &band ) == false )
+        {
+            freqInvalid = true;
+        }
+    }
+    if( ( drInvalid == true ) && ( freqInvalid == true ) )
+    {
+        return LORAMAC_STATUS_FREQ_AND_DR_INVALID;
+    }
+    if( drInvalid == true )
+    {
+        return LORAMAC_STATUS_DATARATE_INVALID;
+    }
+    if( freqInvalid == true )
+    {
+        return LORAMAC_STATUS_FREQUENCY_INVALID;
+    }
+
+    memcpy( &( RefChannels[id] ), channelAdd->NewChannel, sizeof( RefChannels[id] ) );
+    RefChannels[id].Band = band;
+    RefChannelsMask[0] |= ( 1 << id );
+    return LORAMAC_STATUS_OK;
+}
+
+static bool RefChannelsRemove( const RefRegion_t* ref, ChannelRemoveParams_t* channelRemove )
+{
+    uint8_t id = channelRemove->ChannelId;
+
+    if( id < ref->NbDefaultChannels )
+    {
+        return false;
+    }
+    RefChannels[id] = ( ChannelParams_t ){ 0, 0, { 0 }, 0 };
+    return RegionCommonChanDisable( RefChannelsMask, id, ref->MaxNbChannels );
+}
+
+static uint8_t RefNewChannelReq( const RefRegion_t* ref, NewChannelReqParams_t* newChannelReq )
+{
+    uint8_t status = 0x03;
+    ChannelAddParams_t channelAdd;
+    ChannelRemoveParams_t channelRemove;
+
+    if( newChannelReq->NewChannel->Frequency == 0 )
+    {
+        channelRemove.ChannelId = newChannelReq->ChannelId;
+        if( RefChannelsRemove( ref, &channelRemove ) == false )
+        {
+            status &= 0xFC;
+        }
+    }
+    else
+    {
+        channelAdd.NewChannel = newChannelReq->NewChannel;
+        channelAdd.ChannelId = newChannelReq->ChannelId;
+        switch( RefChannelAdd( ref, &channelAdd ) )
+        {
+            case LORAMAC_STATUS_OK:
+                break;
+            case LORAMAC_STATUS_FREQUENCY_INVALID:
+                status &= 0xFE;
+                break;
+            case LORAMAC_STATUS_DATARATE_INVALID:
+                status &= 0xFD;
+                break;
+            default:
+                status &= 0xFC;
+                break;
+        }
+    }
+    return status;
+}
+
+static uint8_t RefDlChannelReq( const RefRegion_t* ref, DlChannelReqParams_t* dlChannelReq )
+{
+    uint8_t status = 0x03;
+    uint8_t band = 0;
+
+    if( ref->VerifyTxFreq( dlChannelReq->Rx1Frequency, &band ) == false )
+    {
+        status &= 0xFE;
+    }
+    if( RefChannels[dlChannelReq->ChannelId].Frequency == 0 )
+    {
+        status &= 0xFD;
+    }
+    if( status == 0x03 )
+    {
+        RefChannels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
+    }
+    return status;
+}
+
+static uint8_t RefLinkAdrReq( const RefRegion_t* ref, LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, int8_t* txPowOut, uint8_t* nbRepOut, uint8_t* nbBytesParsed )
+{
+    uint8_t status = 0x07;
+    RegionCommonLinkAdrParams_t linkAdrParams;
+    uint8_t nextIndex = 0;
+    uint8_t bytesProcessed = 0;
+    uint16_t chMask = 0;
+    GetPhyParams_t getPhy;
+    RegionCommonLinkAdrReqVerifyParams_t linkAdrVerifyParams;
+
+    while( bytesProcessed < linkAdrReq->PayloadSize )
+    {
+        nextIndex = RegionCommonParseLinkAdrReq( &( linkAdrReq->Payload[bytesProcessed] ), &linkAdrParams );
+        if( nextIndex == 0 )
+        {
+            break;
+        }
+        bytesProcessed += nextIndex;
+        status = 0x07;
+        chMask = linkAdrParams.ChMask;
+
+        if( ( linkAdrParams.ChMaskCtrl == 0 ) && ( chMask == 0 ) )
+        {
+            status &= 0xFE;
+        }
+        else if( ( ( linkAdrParams.ChMaskCtrl >= 1 ) && ( linkAdrParams.ChMaskCtrl <= 5 ) ) ||
+                 ( linkAdrParams.ChMaskCtrl >= 7 ) )
+        {
+            status &= 0xFE;
+        }
+        else
+        {
+            for( uint8_t i = 0; i < ref->MaxNbChannels; i++ )
+            {
+                if( linkAdrParams.ChMaskCtrl == 6 )
+                {
+                    if( RefChannels[i].Frequency != 0 )
+                    {
+                        chMask |= 1 << i;
+                    }
+                }
+                else if( ( ( chMask & ( 1 << i ) ) != 0 ) && ( RefChannels[i].Frequency == 0 ) )
+                {
+                    status &= 0xFE;
+                }
+            }
+        }
+    }
+
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    getPhy.UplinkDwellTime = linkAdrReq->UplinkDwellTime;
+
+    linkAdrVerifyParams.Status = status;
+    linkAdrVerifyParams.AdrEnabled = linkAdrReq->AdrEnabled;
+    linkAdrVerifyParams.Datarate = linkAdrParams.Datarate;
+    linkAdrVerifyParams.TxPower = linkAdrParams.TxPower;
+    linkAdrVerifyParams.NbRep = linkAdrParams.NbRep;
+    linkAdrVerifyParams.CurrentDatarate = linkAdrReq->CurrentDatarate;
+    linkAdrVerifyParams.CurrentTxPower = linkAdrReq->CurrentTxPower;
+    linkAdrVerifyParams.CurrentNbRep = linkAdrReq->CurrentNbRep;
+    linkAdrVerifyParams.NbChannels = ref->MaxNbChannels;
+    linkAdrVerifyParams.ChannelsMask = &chMask;
+    linkAdrVerifyParams.MinDatarate = ( int8_t )RegionGetPhyParam( ref->Region, &getPhy ).Value;
+    linkAdrVerifyParams.MaxDatarate = ref->TxMaxDatarate;
+    linkAdrVerifyParams.Channels = RefChannels;
+    linkAdrVerifyParams.MinTxPower = ref->MinTxPower;
+    linkAdrVerifyParams.MaxTxPower = ref->MaxTxPower;
+
+    status = RegionCommonLinkAdrReqVerifyParams( &linkAdrVerifyParams, &linkAdrParams.Datarate, &linkAdrParams.TxPower, &linkAdrParams.NbRep );
+    if( status == 0x07 )
+    {
+        memset( RefChannelsMask, 0, sizeof( RefChannelsMask ) );
+        RefChannelsMask[0] = chMask;
+    }
+
+    *drOut = linkAdrParams.Datarate;
+    *txPowOut = linkAdrParams.TxPower;
+    *nbRepOut = linkAdrParams.NbRep;
+    *nbBytesParsed = bytesProcessed;
+    return status;
+}
+
+static uint8_t RefRxParamSetupReq( const RefRegion_t* ref, RxParamSetupReqParams_t* rxParamSetupReq )
+{
+    uint8_t status = 0x07;
+
+    if( Radio.CheckRfFrequency( rxParamSetupReq->Frequency ) == false )
+    {
+        status &= 0xFE;
+    }
+    if( RegionCommonValueInRange( rxParamSetupReq->Datarate, ref->RxMinDatarate, ref->RxMaxDatarate ) == false )
+    {
+        status &= 0xFD;
+    }
+    if( RegionCommonValueInRange( rxParamSetupReq->DrOffset, ref->MinRx1DrOffset, ref->MaxRx1DrOffset ) == false )
+    {
+        status &= 0xFB;
+    }
+    return status;
+}
+
+/*!
+ * \brief Radio settings RxConfig is expected to apply
+ */
+static void RefRxConfig( const RefRegion_t* ref, RxConfigParams_t* rxConfig, RadioStub_t* radio )
+{
+    int8_t dr = rxConfig->Datarate;
+    uint8_t maxPayload;
+
+    radio->Frequency = rxConfig->Frequency;
+    if( rxConfig->Window == 0 )
+    {
+        radio->Frequency = RefChannels[rxConfig->Channel].Frequency;
+        if( RefChannels[rxConfig->Channel].Rx1Frequency != 0 )
+        {
+            radio->Frequency = RefChannels[rxConfig->Channel].Rx1Frequency;
+        }
+    }
+    if( ( ref->HasFsk == true ) && ( dr == DR_7 ) )
+    {
+        radio->RxModem = MODEM_FSK;
+        radio->RxBandwidth = 50000;
+        radio->RxDatarate = ref->Datarates[dr] * 1000;
+    }
+    else
+    {
+        radio->RxModem = MODEM_LORA;
+        radio->RxBandwidth = rxConfig->Bandwidth;
+        radio->RxDatarate = ref->Datarates[dr];
+    }
+    radio->RxSymbTimeout = rxConfig->WindowTimeout;
+    radio->RxContinuous = rxConfig->RxContinuous;
+
+    maxPayload = ( rxConfig->RepeaterSupport == true ) ? ref->MaxPayloadOfDatarateRepeater[dr] : ref->MaxPayloadOfDatarate[dr];
+    radio->MaxPayloadModem = radio->RxModem;
+    radio->MaxPayloadLength = maxPayload + LORA_MAC_FRMPAYLOAD_OVERHEAD;
+}
+
+/*!
+ * \brief Frequency drawn around the band of the region, on its edges, on the
+ *        default channels or out of the radio range
+ */
+static uint32_t RandomFrequency( const RefRegion_t* ref )
+{
+    switch( randr( 0, 7 ) )
+    {
+        case 0:
+            return 0;
+        case 1:
+            return ref->MinFrequency + randr( -1, 1 );
+        case 2:
+            return ref->MaxFrequency + randr( -1, 1 );
+        case 3:
+            return RefChannels[randr( 0, ref->NbDefaultChannels - 1 )].Frequency;
+        case 4:
+            return randr( 100000000, 1100000000 );
+        case 5:
+            return ref->MinFrequency + randr( 0, ( ref->MaxFrequency - ref->MinFrequency ) / 100000 ) * 100000;
+        default:
+            return ref->MinFrequency + randr( 0, ref->MaxFrequency - ref->MinFrequency );
+    }
+}
+
+static void CheckState( const RefRegion_t* ref )
+{
+    ChannelParams_t* channels = GetChannels( ref );
+
+    TEST_CHECK_EQUAL( GetChannelsMask( ref )[0], RefChannelsMask[0] );
+    for( uint8_t i = 0; i < ref->MaxNbChannels; i++ )
+    {
+        TEST_CHECK_EQUAL( channels[i].Frequency, RefChannels[i].Frequency );
+        TEST_CHECK_EQUAL( channels[i].Rx1Frequency, RefChannels[i].Rx1Frequency );
+        TEST_CHECK_EQUAL( channels[i].DrRange.Value, RefChannels[i].DrRange.Value );
+        TEST_CHECK_EQUAL( channels[i].Band, RefChannels[i].Band );
+    }
+}
+
+static void TestNewChannelReq( const RefRegion_t* ref )
+{
+    ChannelParams_t newChannel;
+    NewChannelReqParams_t newChannelReq;
+
+    newChannel.Frequency = RandomFrequency( ref );
+    newChannel.Rx1Frequency = 0;
+    newChannel.DrRange.Fields.Min = randr( 0, 15 );
+    newChannel.DrRange.Fields.Max = randr( 0, 15 );
+    newChannel.Band = 0;
+    newChannelReq.NewChannel = &newChannel;
+    newChannelReq.ChannelId = randr( 0, ref->MaxNbChannels - 1 );
+
+    TEST_CHECK_EQUAL( RegionNewChannelReq( ref->Region, &newChannelReq ), RefNewChannelReq( ref, &newChannelReq ) );
+}
+
+static void TestChannelAdd( const RefRegion_t* ref )
+{
+    ChannelParams_t newChannel;
+    ChannelAddParams_t channelAdd;
+    ChannelRemoveParams_t channelRemove;
+
+    if( randr( 0, 1 ) == 0 )
+    {
+        channelRemove.ChannelId = randr( 0, ref->MaxNbChannels - 1 );
+        TEST_CHECK_EQUAL( RegionChannelsRemove( ref->Region, &channelRemove ), RefChannelsRemove( ref, &channelRemove ) );
+        return;
+    }
+
+    newChannel.Frequency = RandomFrequency( ref );
+    newChannel.Rx1Frequency = ( randr( 0, 1 ) == 0 ) ? 0 : RandomFrequency( ref );
+    newChannel.DrRange.Fields.Min = randr( 0, 15 );
+    newChannel.DrRange.Fields.Max = randr( 0, 15 );
+    newChannel.Band = 0;
+    channelAdd.NewChannel = &newChannel;
+    // Out of range identifiers are rejected
+    channelAdd.ChannelId = randr( 0, ref->MaxNbChannels );
+
+    TEST_CHECK_EQUAL( RegionChannelAdd( ref->Region, &channelAdd ), RefChannelAdd( ref, &channelAdd ) );
+}
+
+static void TestDlChannelReq( const RefRegion_t* ref )
+{
+    DlChannelReqParams_t dlChannelReq;
+
+    dlChannelReq.ChannelId = randr( 0, ref->MaxNbChannels - 1 );
+    dlChannelReq.Rx1Frequency = RandomFrequency( ref );
+
+    TEST_CHECK_EQUAL( RegionDlChannelReq( ref->Region, &dlChannelReq ), RefDlChannelReq( ref, &dlChannelReq ) );
+}
+
+static void TestLinkAdrReq( const RefRegion_t* ref )
+{
+    uint8_t payload[15];
+    LinkAdrReqParams_t linkAdrReq;
+    int8_t dr[2];
+    int8_t txPower[2];
+    uint8_t nbRep[2];
+    uint8_t nbBytesParsed[2];
+    uint8_t nbBlocks = randr( 1, 3 );
+    uint16_t chMask;
+
+    for( uint8_t i = 0; i < nbBlocks; i++ )
+    {
+        // Masks of defined channels are the interesting ones
+        chMask = ( randr( 0, 1 ) == 0 ) ? RefChannelsMask[0] | ( 1 << randr( 0, 15 ) ) : randr( 0, 0xFFFF );
+        payload[i * 5] = SRV_MAC_LINK_ADR_REQ;
+        payload[i * 5 + 1] = ( randr( 0, 15 ) << 4 ) | randr( 0, 15 );
+        payload[i * 5 + 2] = chMask & 0xFF;
+        payload[i * 5 + 3] = chMask >> 8;
+        payload[i * 5 + 4] = ( ( ( randr( 0, 3 ) == 0 ) ? randr( 0, 7 ) : ( randr( 0, 1 ) * 6 ) ) << 4 ) | randr( 0, 15 );
+    }
+
+    linkAdrReq.Payload = payload;
+    linkAdrReq.PayloadSize = nbBlocks * 5;
+    linkAdrReq.UplinkDwellTime = randr( 0, 1 );
+    linkAdrReq.AdrEnabled = randr( 0, 1 );
+    linkAdrReq.CurrentDatarate = randr( ref->TxMinDatarate, ref->TxMaxDatarate );
+    linkAdrReq.CurrentTxPower = randr( ref->MaxTxPower, ref->MinTxPower );
+    linkAdrReq.CurrentNbRep = randr( 1, 15 );
+
+    TEST_CHECK_EQUAL( RegionLinkAdrReq( ref->Region, &linkAdrReq, &dr[0], &txPower[0], &nbRep[0], &nbBytesParsed[0] ),
+                      RefLinkAdrReq( ref, &linkAdrReq, &dr[1], &txPower[1], &nbRep[1], &nbBytesParsed[1] ) );
+    TEST_CHECK_EQUAL( dr[0], dr[1] );
+    TEST_CHECK_EQUAL( txPower[0], txPower[1] );
+    TEST_CHECK_EQUAL( nbRep[0], nbRep[1] );
+    TEST_CHECK_EQUAL( nbBytesParsed[0], nbBytesParsed[1] );
+}
+
+static void TestRxParamSetupReq( const RefRegion_t* ref )
+{
+    RxParamSetupReqParams_t rxParamSetupReq;
+
+    rxParamSetupReq.Frequency = RandomFrequency( ref );
+    rxParamSetupReq.Datarate = randr( 0, 15 );
+    rxParamSetupReq.DrOffset = randr( 0, 7 );
+
+    TEST_CHECK_EQUAL( RegionRxParamSetupReq( ref->Region, &rxParamSetupReq ), RefRxParamSetupReq( ref, &rxParamSetupReq ) );
+}
+
+static void TestRxConfig( const RefRegion_t* ref )
+{
+    RxConfigParams_t rxConfig;
+    RadioStub_t expected;
+    int8_t datarate = -1;
+
+    memset( &rxConfig, 0, sizeof( rxConfig ) );
+    rxConfig.Channel = randr( 0, ref->MaxNbChannels - 1 );
+    rxConfig.Window = randr( 0, 1 );
+    rxConfig.Frequency = RandomFrequency( ref );
+    rxConfig.Datarate = randr( ref->RxMinDatarate, ref->RxMaxDatarate );
+    rxConfig.Bandwidth = randr( 0, 2 );
+    rxConfig.WindowTimeout = randr( 5, 1023 );
+    rxConfig.RepeaterSupport = randr( 0, 1 );
+    rxConfig.RxContinuous = randr( 0, 1 );
+
+    RadioStubReset( );
+    if( randr( 0, 7 ) == 0 )
+    {
+        RadioStub.Status = RF_RX_RUNNING;
+        TEST_CHECK( RegionRxConfig( ref->Region, &rxConfig, &datarate ) == false );
+        TEST_CHECK_EQUAL( RadioStub.Frequency, 0 );
+        return;
+    }
+
+    expected = RadioStub;
+    RefRxConfig( ref, &rxConfig, &expected );
+    TEST_CHECK( RegionRxConfig( ref->Region, &rxConfig, &datarate ) );
+    TEST_CHECK_EQUAL( datarate, rxConfig.Datarate );
+    TEST_CHECK_EQUAL( RadioStub.Frequency, expected.Frequency );
+    TEST_CHECK_EQUAL( RadioStub.RxModem, expected.RxModem );
+    TEST_CHECK_EQUAL( RadioStub.RxBandwidth, expected.RxBandwidth );
+    TEST_CHECK_EQUAL( RadioStub.RxDatarate, expected.RxDatarate );
+    TEST_CHECK_EQUAL( RadioStub.RxSymbTimeout, expected.RxSymbTimeout );
+    TEST_CHECK_EQUAL( RadioStub.RxContinuous, expected.RxContinuous );
+    TEST_CHECK_EQUAL( RadioStub.MaxPayloadModem, expected.MaxPayloadModem );
+    TEST_CHECK_EQUAL( RadioStub.MaxPayloadLength, expected.MaxPayloadLength );
+}
+
+/*!
+ * \brief Runs random MAC commands against the region and the reference,
+ *        the answers and the channels must stay the same
+ */
+static void TestRegion( const RefRegion_t* ref )
+{
+    TestCase( "%s shared channel plan", ref->Name );
+
+    RadioStubReset( );
+    TimerStubReset( 0 );
+    RegionInitDefaults( ref->Region, INIT_TYPE_INIT );
+    memcpy( RefChannels, GetChannels( ref ), sizeof( RefChannels ) );
+    RefChannelsMask[0] = GetChannelsMask( ref )[0];
+
+    for( uint32_t i = 0; i < NB_COMMANDS; i++ )
+    {
+        switch( randr( 0, 5 ) )
+        {
+            case 0:
+                TestNewChannelReq( ref );
+                break;
+            case 1:
+                TestChannelAdd( ref );
+                break;
+            case 2:
+                TestDlChannelReq( ref );
+                break;
+            case 3:
+                TestLinkAdrReq( ref );
+                break;
+            case 4:
+                TestRxParamSetupReq( ref );
+                break;
+            default:
+                TestRxConfig( ref );
+                break;
+        }
+        CheckState( ref );
+    }
+}
+
+int main( void )
+{
+    srand1( 1 );
+
+    for( uint8_t i = 0; i < sizeof( RefRegions ) / sizeof( RefRegions[0] ); i++ )
+    {
+        TestRegion( &RefRegions[i] );
+    }
+
+    return TestSummary( );
+}
@@ -0,0 +1,175 @@
+ /******************************************************************************
+  * @file    test_sx1272.c
+  * @brief   host test of the time on air of the SX1272 driver
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "radio.h"
+#include "sx1272.h"
+#include "test.h"
+
+/* Private variables ---------------------------------------------------------*/
+
+static const uint16_t PreambleLens[] = { 6, 8, 12, 65535 };
+
+/* Private functions ---------------------------------------------------------*/
+
+/*!
+ * \brief LoRa time on air in ms as the driver computed it in floating point
+ *        before it went to integers
+ *
+ * \param [IN] previous Payload bits in uint32_t as the driver had them, from
+ *                      its uint32_t spreading factor [false: signed]
+ * \param [OUT] wrapped The payload bits went negative and wrapped around
+ * \retval Time on air, before the conversion to uint32_t it may overflow
+ */
+static double ReferenceTimeOnAir( bool previous, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                  uint16_t preambleLen, bool fixLen, bool crcOn, bool lowDatarateOptimize,
+                                  uint8_t pktLen, bool *wrapped )
+{
+    static const double bws[3] = { 125000, 250000, 500000 };
+    double bw = bws[bandwidth];
+    int32_t nBits = 8 * pktLen - 4 * ( int32_t )datarate + 28 + 16 * crcOn - ( fixLen ? 20 : 0 );
+    double bits = ( previous == true ) ? ( double )( uint32_t )nBits : ( double )nBits;
+
+    // Symbol rate : time for one symbol (secs)
+    double rs = bw / ( 1 << datarate );
+    double ts = 1 / rs;
+    // time of preamble
+    double tPreamble = ( preambleLen + 4.25 ) * ts;
+    // Symbol length of payload and time
+    double tmp = ceil( bits / ( double )( 4 * ( datarate - ( ( lowDatarateOptimize == true ) ? 2 : 0 ) ) ) ) *
+                 ( coderate + 4 );
+    double nPayload = 8 + ( ( tmp > 0 ) ? tmp : 0 );
+    double tPayload = nPayload * ts;
+    // Time on air
+    double tOnAir = tPreamble + tPayload;
+
+    *wrapped = nBits < 0;
+    // return ms secs
+    return floor( tOnAir * 1000 + 0.999 );
+}
+
+/*!
+ * \brief LoRa time on air against the floating point formula it replaced,
+ *        for every configuration and payload length. The formula took the
+ *        payload bits from the uint32_t spreading factor, they wrapped
+ *        around for the short implicit header payloads and gave an absurd
+ *        time on air there, the integer code keeps them signed and gives
+ *        the 8 symbols of the header.
+ */
+static void TestTimeOnAir( void )
+{
+    uint32_t nbConfigs = 0;
+    uint32_t nbWrapped = 0;
+
+    for( uint32_t datarate = 6; datarate <= 12; datarate++ )
+    {
+        for( uint32_t bandwidth = 0; bandwidth <= 2; bandwidth++ )
+        {
+            for( uint8_t coderate = 1; coderate <= 4; coderate++ )
+            {
+                for( uint8_t i = 0; i < 8 * sizeof( PreambleLens ) / sizeof( PreambleLens[0] ); i++ )
+                {
+                    uint16_t preambleLen = PreambleLens[i / 8];
+                    bool fixLen = ( i & 0x01 ) != 0;
+                    bool crcOn = ( i & 0x02 ) != 0;
+                    bool lowDatarateOptimize = ( i & 0x04 ) != 0;
+
+                    TestCase( "SX1272 LoRa time on air, SF%u, bandwidth %u, coding rate 4/%u, preamble %u, %s header, CRC %s, LDRO %s",
+                              ( unsigned )datarate, ( unsigned )bandwidth, coderate + 4, preambleLen,
+                              fixLen ? "implicit" : "explicit", crcOn ? "on" : "off", lowDatarateOptimize ? "on" : "off" );
+                    SX1272.Settings.LoRa.Datarate = datarate;
+                    SX1272.Settings.LoRa.Bandwidth = bandwidth;
+                    SX1272.Settings.LoRa.Coderate = coderate;
+                    SX1272.Settings.LoRa.PreambleLen = preambleLen;
+                    SX1272.Settings.LoRa.FixLen = fixLen;
+                    SX1272.Settings.LoRa.CrcOn = crcOn;
+                    SX1272.Settings.LoRa.LowDatarateOptimize = lowDatarateOptimize;
+                    for( uint16_t pktLen = 0; pktLen <= 255; pktLen++ )
+                    {
+                        uint32_t timeOnAir = SX1272GetTimeOnAir( MODEM_LORA, pktLen );
+                        bool wrapped;
+                        double previous = ReferenceTimeOnAir( true, bandwidth, datarate, coderate, preambleLen,
+                                                              fixLen, crcOn, lowDatarateOptimize, pktLen, &wrapped );
+
+                        TEST_CHECK_EQUAL( timeOnAir, ReferenceTimeOnAir( false, bandwidth, datarate, coderate, preambleLen,
+                                                                         fixLen, crcOn, lowDatarateOptimize, pktLen, &wrapped ) );
+                        if( wrapped == false )
+                        {
+                            TEST_CHECK_EQUAL( timeOnAir, previous );
+                        }
+                        else
+                        {
+                            // Hours on air, not a time the MAC could use
+                            TEST_CHECK( previous > 3600000.0 );
+                            nbWrapped++;
+                        }
+                    }
+                    nbConfigs++;
+                }
+            }
+        }
+    }
+    printf( "SX1272 LoRa time on air: %u configurations of 256 payload lengths, %u times different from the previous formula, all with the payload bits wrapped around\n",
+            ( unsigned )nbConfigs, ( unsigned )nbWrapped );
+}
+
+/*!
+ * \brief FSK time on air, rounded to the nearest ms as the floating point
+ *        formula did
+ */
+static void TestFskTimeOnAir( void )
+{
+    static const uint32_t datarates[] = { 1200, 4800, 50000, 300000 };
+
+    for( uint8_t d = 0; d < sizeof( datarates ) / sizeof( datarates[0] ); d++ )
+    {
+        for( uint8_t i = 0; i < 16; i++ )
+        {
+            bool fixLen = ( i & 0x01 ) != 0;
+            bool crcOn = ( i & 0x02 ) != 0;
+            uint8_t syncSize = ( i & 0x04 ) ? 7 : 2;
+            uint8_t addressFiltering = ( i & 0x08 ) ? 0x02 : 0x00;
+
+            TestCase( "SX1272 FSK time on air, %u bps, %s length, CRC %s, sync word %u, address filtering %s",
+                      ( unsigned )datarates[d], fixLen ? "fixed" : "variable", crcOn ? "on" : "off",
+                      syncSize + 1, addressFiltering ? "on" : "off" );
+            SX1272.Settings.Fsk.Datarate = datarates[d];
+            SX1272.Settings.Fsk.PreambleLen = 5;
+            SX1272.Settings.Fsk.FixLen = fixLen;
+            SX1272.Settings.Fsk.CrcOn = crcOn;
+            SX1272Write( REG_SYNCCONFIG, 0x10 | syncSize );
+            SX1272Write( REG_PACKETCONFIG1, 0x10 | addressFiltering );
+            for( uint16_t pktLen = 0; pktLen <= 255; pktLen++ )
+            {
+                double bytes = 5 + syncSize + 1 + ( fixLen ? 0.0 : 1.0 ) + ( ( addressFiltering != 0 ) ? 1.0 : 0 ) +
+                               pktLen + ( crcOn ? 2.0 : 0 );
+
+                TEST_CHECK_EQUAL( SX1272GetTimeOnAir( MODEM_FSK, pktLen ),
+                                  ( uint32_t )round( ( 8 * bytes / datarates[d] ) * 1000 ) );
+            }
+        }
+    }
+}
+
+int main( void )
+{
+    TestTimeOnAir( );
+    TestFskTimeOnAir( );
+
+    return TestSummary( );
+}
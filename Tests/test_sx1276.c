@@ -0,0 +1,1048 @@
+ /******************************************************************************
+  * @file    test_sx1276.c
+  * @brief   host test of the SX1276 driver against the register level
+  *          emulator of the radio
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "utilities.h"
+#include "radio.h"
+#include "sx1276.h"
+#include "sx1276_emu.h"
+#include "timer_stub.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define RF_FREQUENCY                                868100000
+
+/*!
+ * Transmission timeout, longer than any LoRa frame [ms]
+ */
+#define TX_TIMEOUT                                  20000
+
+/*!
+ * Registers paged by RegOpMode LongRangeMode
+ */
+#define REG_PAGE_START                              0x0D
+#define REG_PAGE_END                                0x3F
+
+/*!
+ * Random values drawn, one per join attempt
+ */
+#define NB_RANDOM                                   10000
+
+/* Private function prototypes -----------------------------------------------*/
+
+/*!
+ * Reset of the radio through its reset line, not exported by sx1276.h
+ */
+void SX1276Reset( void );
+
+/* Private variables ---------------------------------------------------------*/
+
+static RadioEvents_t RadioEvents;
+
+static uint32_t TxDoneCount;
+static uint32_t RxDoneCount;
+static uint32_t RxTimeoutCount;
+static uint32_t CadDoneCount;
+static TimerTime_t EventTime;
+static bool CadDetected;
+static uint8_t RxPayload[256];
+static uint16_t RxSize;
+static int16_t RxRssi;
+static int8_t RxSnr;
+
+/*!
+ * SPI transactions of Uplink( 7 ) with this driver built to read every
+ * register it modifies from the radio and to write every register it sets,
+ * as it did before the register shadow
+ */
+#define UPLINK_SPI_TRANSACTIONS_UNCACHED            125
+
+static const uint16_t PreambleLens[] = { 6, 8, 12, 65535 };
+
+static uint32_t RandomValues[NB_RANDOM];
+static uint32_t RawValues[NB_RANDOM];
+
+/* Private functions ---------------------------------------------------------*/
+
+static void OnTxDone( void )
+{
+    TxDoneCount++;
+    EventTime = TimerGetCurrentTime( );
+}
+
+static void OnRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
+{
+    RxDoneCount++;
+    EventTime = TimerGetCurrentTime( );
+    memcpy( RxPayload, payload, size );
+    RxSize = size;
+    RxRssi = rssi;
+    RxSnr = snr;
+}
+
+static void OnRxTimeout( void )
+{
+    RxTimeoutCount++;
+    EventTime = TimerGetCurrentTime( );
+}
+
+static void OnCadDone( bool channelActivityDetected )
+{
+    CadDoneCount++;
+    EventTime = TimerGetCurrentTime( );
+    CadDetected = channelActivityDetected;
+}
+
+static void ResetRadio( void )
+{
+    TimerStubReset( 0 );
+    SX1276EmuReset( );
+
+    RadioEvents.TxDone = OnTxDone;
+    RadioEvents.RxDone = OnRxDone;
+    RadioEvents.RxTimeout = OnRxTimeout;
+    RadioEvents.CadDone = OnCadDone;
+    Radio.IoInit( );
+    Radio.Init( &RadioEvents );
+    Radio.SetChannel( RF_FREQUENCY );
+    Radio.SetPublicNetwork( true );
+
+    TxDoneCount = 0;
+    RxDoneCount = 0;
+    RxTimeoutCount = 0;
+    CadDoneCount = 0;
+}
+
+/*!
+ * \brief LoRa time on air in ms as the driver computed it in floating point
+ *        before it went to integers, the low data rate optimization being on
+ *        for symbols of 16 ms or more
+ *
+ * \remark The driver took the spreading factor from a uint32_t, the payload
+ *         bits then wrapped around instead of going negative for the short
+ *         fixed length payloads. It is signed here, as in the integer code.
+ */
+static uint32_t ReferenceTimeOnAir( uint32_t bandwidth, uint8_t datarate, uint8_t coderate,
+                                    uint16_t preambleLen, bool fixLen, bool crcOn, uint8_t pktLen )
+{
+    static const double bws[3] = { 125000, 250000, 500000 };
+    double bw = bws[bandwidth];
+    uint8_t lowDatarateOptimize = ( ( ( 1 << datarate ) * 1000 / bw ) >= 16 ) ? 1 : 0;
+
+    // Symbol rate : time for one symbol (secs)
+    double rs = bw / ( 1 << datarate );
+    double ts = 1 / rs;
+    // time of preamble
+    double tPreamble = ( preambleLen + 4.25 ) * ts;
+    // Symbol length of payload and time
+    double tmp = ceil( ( 8 * pktLen - 4 * datarate +
+                         28 + 16 * crcOn -
+                         ( fixLen ? 20 : 0 ) ) /
+                         ( double )( 4 * ( datarate -
+                         ( ( lowDatarateOptimize > 0 ) ? 2 : 0 ) ) ) ) *
+                         ( coderate + 4 );
+    double nPayload = 8 + ( ( tmp > 0 ) ? tmp : 0 );
+    double tPayload = nPayload * ts;
+    // Time on air
+    double tOnAir = tPreamble + tPayload;
+    // return ms secs
+    return ( uint32_t )floor( tOnAir * 1000 + 0.999 );
+}
+
+static void TestInit( void )
+{
+    TestCase( "SX1276 initialization" );
+    ResetRadio( );
+    TEST_CHECK_EQUAL( Radio.Read( REG_VERSION ), 0x12 );
+    TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+    // The registers of RADIO_INIT_REGISTERS_VALUE, on both pages
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_SYNCCONFIG ), 0x12 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_PACKETCONFIG1 ), 0xD8 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_PAYLOADMAXLENGTH ), 0x40 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_SYNCWORD ), LORA_MAC_PUBLIC_SYNCWORD );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RFLR_OPMODE_SLEEP );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_FRFMSB ), 0xD9 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_FRFMID ), 0x06 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_FRFLSB ), 0x66 );
+}
+
+/*!
+ * \brief The integer time on air of the driver against the floating point
+ *        formula it replaced and against the registers it wrote, for every
+ *        LoRa configuration and payload length
+ */
+static void TestTimeOnAir( void )
+{
+    uint32_t nbConfigs = 0;
+
+    TestCase( "SX1276 LoRa time on air" );
+    ResetRadio( );
+    for( uint32_t datarate = 6; datarate <= 12; datarate++ )
+    {
+        for( uint32_t bandwidth = 0; bandwidth <= 2; bandwidth++ )
+        {
+            for( uint8_t coderate = 1; coderate <= 4; coderate++ )
+            {
+                for( uint8_t i = 0; i < 4 * sizeof( PreambleLens ) / sizeof( PreambleLens[0] ); i++ )
+                {
+                    uint16_t preambleLen = PreambleLens[i / 4];
+                    bool fixLen = ( i & 0x01 ) != 0;
+                    bool crcOn = ( i & 0x02 ) != 0;
+
+                    Radio.SetTxConfig( MODEM_LORA, 14, 0, bandwidth, datarate, coderate, preambleLen,
+                                       fixLen, crcOn, false, 0, false, TX_TIMEOUT );
+                    for( uint16_t pktLen = 0; pktLen <= 255; pktLen++ )
+                    {
+                        uint32_t timeOnAir = Radio.TimeOnAir( MODEM_LORA, pktLen );
+
+                        TEST_CHECK_EQUAL( timeOnAir, ReferenceTimeOnAir( bandwidth, datarate, coderate,
+                                                                         preambleLen, fixLen, crcOn, pktLen ) );
+                        TEST_CHECK_EQUAL( timeOnAir, ( uint32_t )ceil( SX1276EmuTimeOnAir( pktLen ) / 1000 ) );
+                    }
+                    nbConfigs++;
+                }
+            }
+        }
+    }
+    printf( "SX1276 LoRa time on air: %u configurations of 256 payload lengths\n", ( unsigned )nbConfigs );
+}
+
+/*!
+ * \brief FSK time on air, rounded to the nearest ms
+ */
+static void TestFskTimeOnAir( void )
+{
+    static const uint32_t datarates[] = { 4800, 50000, 300000 };
+
+    TestCase( "SX1276 FSK time on air" );
+    ResetRadio( );
+    for( uint8_t d = 0; d < sizeof( datarates ) / sizeof( datarates[0] ); d++ )
+    {
+        for( uint8_t i = 0; i < 4; i++ )
+        {
+            bool fixLen = ( i & 0x01 ) != 0;
+            bool crcOn = ( i & 0x02 ) != 0;
+
+            Radio.SetTxConfig( MODEM_FSK, 14, 25000, 0, datarates[d], 0, 5, fixLen, crcOn, false, 0, false, TX_TIMEOUT );
+            for( uint16_t pktLen = 0; pktLen <= 255; pktLen++ )
+            {
+                double bytes = 5 + ( SX1276EmuGetRegister( false, REG_SYNCCONFIG ) & 0x07 ) + 1 +
+                               ( fixLen ? 0.0 : 1.0 ) +
+                               ( ( ( SX1276EmuGetRegister( false, REG_PACKETCONFIG1 ) & 0x06 ) != 0 ) ? 1.0 : 0 ) +
+                               pktLen + ( crcOn ? 2.0 : 0 );
+
+                TEST_CHECK_EQUAL( Radio.TimeOnAir( MODEM_FSK, pktLen ),
+                                  ( uint32_t )round( ( 8 * bytes / datarates[d] ) * 1000 ) );
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Transmissions end with TxDone after the time on air, the payload in
+ *        the data buffer
+ */
+static void TestTx( void )
+{
+    uint8_t payload[255];
+    uint32_t nbFrames = 0;
+
+    for( uint16_t i = 0; i < sizeof( payload ); i++ )
+    {
+        payload[i] = randr( 0, 255 );
+    }
+
+    TestCase( "SX1276 LoRa transmissions" );
+    ResetRadio( );
+    for( uint32_t datarate = 7; datarate <= 12; datarate++ )
+    {
+        for( uint32_t bandwidth = 0; bandwidth <= 2; bandwidth++ )
+        {
+            Radio.SetTxConfig( MODEM_LORA, 14, 0, bandwidth, datarate, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+            for( uint16_t size = 1; size <= 255; size += 13 )
+            {
+                uint32_t timeOnAir = Radio.TimeOnAir( MODEM_LORA, size );
+                uint32_t txDoneCount = TxDoneCount;
+                TimerTime_t start;
+
+                Radio.Send( payload, size );
+                start = TimerGetCurrentTime( );
+                TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_TX_RUNNING );
+                TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RFLR_OPMODE_TRANSMITTER );
+                TEST_CHECK( memcmp( SX1276EmuGetFifo( ), payload, size ) == 0 );
+
+                TimerStubAdvance( timeOnAir + 2 );
+                TEST_CHECK_EQUAL( TxDoneCount, txDoneCount + 1 );
+                // Within the bus time of the transactions around the start and the end
+                TEST_CHECK( ( EventTime + 1 >= start + timeOnAir ) && ( EventTime <= start + timeOnAir + 1 ) );
+                TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+                TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RFLR_OPMODE_STANDBY );
+                TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_IRQFLAGS ), 0 );
+                nbFrames++;
+            }
+        }
+    }
+    printf( "SX1276 LoRa transmissions: %u frames\n", ( unsigned )nbFrames );
+}
+
+/*!
+ * \brief Single receptions end with RxDone on a frame, on the symbol timeout
+ *        otherwise
+ */
+static void TestRx( void )
+{
+    static const uint8_t frame[] = { 0x60, 0x04, 0x03, 0x02, 0x01, 0x00, 0x01, 0x00, 0x11, 0x22, 0x33, 0x44 };
+    TimerTime_t start;
+
+    TestCase( "SX1276 LoRa single reception" );
+    ResetRadio( );
+    Radio.SetRxConfig( MODEM_LORA, 0, 7, 1, 0, 8, 5, false, 0, false, false, 0, true, false );
+    SX1276EmuSetRxFrame( frame, sizeof( frame ), -80, 7 );
+    Radio.Rx( 3000 );
+    start = TimerGetCurrentTime( );
+    TimerStubAdvance( 100 );
+    TEST_CHECK_EQUAL( RxDoneCount, 1 );
+    TEST_CHECK_EQUAL( RxTimeoutCount, 0 );
+    TEST_CHECK_EQUAL( RxSize, sizeof( frame ) );
+    TEST_CHECK( memcmp( RxPayload, frame, sizeof( frame ) ) == 0 );
+    TEST_CHECK( ( RxRssi >= -81 ) && ( RxRssi <= -79 ) );
+    TEST_CHECK_EQUAL( RxSnr, 7 * 4 );
+    TEST_CHECK( EventTime <= start + Radio.TimeOnAir( MODEM_LORA, sizeof( frame ) ) + 1 );
+    TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RFLR_OPMODE_STANDBY );
+
+    TestCase( "SX1276 LoRa reception timeout" );
+    Radio.Rx( 3000 );
+    start = TimerGetCurrentTime( );
+    TimerStubAdvance( 100 );
+    TEST_CHECK_EQUAL( RxDoneCount, 1 );
+    TEST_CHECK_EQUAL( RxTimeoutCount, 1 );
+    // 5 symbols of 1.024 ms
+    TEST_CHECK( ( EventTime + 1 >= start + 6 ) && ( EventTime <= start + 7 ) );
+    TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RFLR_OPMODE_STANDBY );
+}
+
+/*!
+ * \brief The FSK packet engine stays in its mode after PacketSent, after
+ *        PayloadReady and on a timeout, the driver puts it in standby
+ */
+static void TestFskStandby( void )
+{
+    static const uint8_t frame[] = { 0x60, 0x04, 0x03, 0x02, 0x01, 0x00, 0x01, 0x00, 0x11, 0x22, 0x33, 0x44 };
+    SX1276EmuFrame_t airFrame = { 0 };
+    uint32_t txDoneCount;
+    uint32_t rxDoneCount;
+    uint32_t rxTimeoutCount;
+
+    TestCase( "SX1276 FSK transmission back to standby" );
+    ResetRadio( );
+    Radio.SetTxConfig( MODEM_FSK, 14, 25000, 0, 50000, 0, 5, false, true, false, 0, false, TX_TIMEOUT );
+    // The emulator raises SyncAddress with PayloadReady, the sync word
+    // timeout of 64 bytes outlasts the frame
+    Radio.SetRxConfig( MODEM_FSK, 50000, 50000, 0, 83333, 5, 64, false, 0, true, false, 0, false, false );
+    Radio.SetMaxPayloadLength( MODEM_FSK, 255 );
+    txDoneCount = TxDoneCount;
+    Radio.Send( ( uint8_t* )frame, sizeof( frame ) );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RF_OPMODE_TRANSMITTER );
+    TimerStubAdvance( Radio.TimeOnAir( MODEM_FSK, sizeof( frame ) ) + 2 );
+    TEST_CHECK_EQUAL( TxDoneCount, txDoneCount + 1 );
+    TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RF_OPMODE_STANDBY );
+
+    TestCase( "SX1276 FSK single reception back to standby" );
+    rxDoneCount = RxDoneCount;
+    Radio.Rx( 3000 );
+    airFrame.Start = TimerGetCurrentTime( );
+    airFrame.Frequency = RF_FREQUENCY;
+    airFrame.Bitrate = 50000;
+    airFrame.Rssi = -80;
+    airFrame.Snr = 7;
+    airFrame.Size = sizeof( frame );
+    memcpy( airFrame.Payload, frame, sizeof( frame ) );
+    SX1276EmuPutOnAir( &airFrame );
+    TimerStubAdvance( 100 );
+    TEST_CHECK_EQUAL( RxDoneCount, rxDoneCount + 1 );
+    TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RF_OPMODE_STANDBY );
+
+    TestCase( "SX1276 FSK reception timeout back to standby" );
+    rxTimeoutCount = RxTimeoutCount;
+    Radio.Rx( 50 );
+    TimerStubAdvance( 100 );
+    TEST_CHECK_EQUAL( RxTimeoutCount, rxTimeoutCount + 1 );
+    TEST_CHECK_EQUAL( Radio.GetStatus( ), RF_IDLE );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RF_OPMODE_STANDBY );
+}
+
+static void TestChannelActivity( void )
+{
+    TestCase( "SX1276 channel activity detection" );
+    ResetRadio( );
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+    for( uint8_t i = 0; i < 2; i++ )
+    {
+        SX1276EmuSetChannelBusy( i != 0 );
+        Radio.StartCad( );
+        TimerStubAdvance( 10 );
+        TEST_CHECK_EQUAL( CadDoneCount, i + 1 );
+        TEST_CHECK_EQUAL( CadDetected, i != 0 );
+        TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_IRQFLAGS ), 0 );
+    }
+
+    TestCase( "SX1276 carrier sense" );
+    SX1276EmuSetChannelBusy( false );
+    TEST_CHECK( Radio.IsChannelFree( MODEM_LORA, RF_FREQUENCY, -90, 5 ) );
+    SX1276EmuSetChannelBusy( true );
+    TEST_CHECK( Radio.IsChannelFree( MODEM_LORA, RF_FREQUENCY, -90, 5 ) == false );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & ~RFLR_OPMODE_MASK, RFLR_OPMODE_SLEEP );
+}
+
+/*!
+ * \brief Status registers the radio changes, and the FIFO
+ */
+static bool VolatileRegister( bool lora, uint8_t addr )
+{
+    static const uint8_t fskRegisters[] = { REG_FIFO, REG_RSSIVALUE, REG_AFCMSB, REG_AFCLSB, REG_FEIMSB, REG_FEILSB,
+                                            REG_IMAGECAL, REG_TEMP, REG_IRQFLAGS1, REG_IRQFLAGS2, REG_FORMERTEMP };
+    static const uint8_t loraRegisters[] = { REG_LR_FIFO, REG_LR_FIFOADDRPTR, REG_LR_FIFORXCURRENTADDR, REG_LR_IRQFLAGS,
+                                             REG_LR_RXNBBYTES, REG_LR_RXHEADERCNTVALUEMSB, REG_LR_RXHEADERCNTVALUELSB,
+                                             REG_LR_RXPACKETCNTVALUEMSB, REG_LR_RXPACKETCNTVALUELSB, REG_LR_MODEMSTAT,
+                                             REG_LR_PKTSNRVALUE, REG_LR_PKTRSSIVALUE, REG_LR_RSSIVALUE, REG_LR_HOPCHANNEL,
+                                             REG_LR_FIFORXBYTEADDR, REG_LR_FEIMSB, REG_LR_FEIMID, REG_LR_FEILSB,
+                                             REG_LR_RSSIWIDEBAND, REG_LR_FORMERTEMP };
+    const uint8_t *registers = ( lora == true ) ? loraRegisters : fskRegisters;
+    uint8_t nbRegisters = ( lora == true ) ? sizeof( loraRegisters ) : sizeof( fskRegisters );
+
+    for( uint8_t i = 0; i < nbRegisters; i++ )
+    {
+        if( registers[i] == addr )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Checks the registers the driver holds in its shadow copy against
+ *        the registers of the radio, the mode bits of RegOpMode and the
+ *        status registers left out
+ *
+ * \retval Returns the number of registers the shadow copy holds
+ */
+static uint16_t CheckShadow( void )
+{
+    uint16_t nbRegisters = 0;
+    uint8_t data;
+
+    for( uint8_t page = 0; page < 2; page++ )
+    {
+        bool lora = ( page == 1 );
+
+        for( uint8_t addr = 1; addr < 0x80; addr++ )
+        {
+            if( ( lora == true ) && ( ( addr < REG_PAGE_START ) || ( addr > REG_PAGE_END ) ) )
+            {
+                // Only the paged registers differ on the LoRa page
+                continue;
+            }
+            if( ( VolatileRegister( lora, addr ) == true ) ||
+                ( SX1276GetShadowRegister( lora ? MODEM_LORA : MODEM_FSK, addr, &data ) == false ) )
+            {
+                continue;
+            }
+            if( addr == REG_OPMODE )
+            {
+                TEST_CHECK_EQUAL( data & RFLR_OPMODE_MASK, SX1276EmuGetRegister( lora, addr ) & RFLR_OPMODE_MASK );
+            }
+            else
+            {
+                TEST_CHECK_EQUAL( data, SX1276EmuGetRegister( lora, addr ) );
+            }
+            nbRegisters++;
+        }
+    }
+    return nbRegisters;
+}
+
+/*!
+ * \brief Class A uplink as the MAC and the region drive it, the frame and
+ *        both receive windows without a downlink
+ */
+static void Uplink( uint8_t datarate )
+{
+    static uint8_t frame[20];
+
+    Radio.SetChannel( RF_FREQUENCY );
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 0, datarate, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+    Radio.Send( frame, sizeof( frame ) );
+    TimerStubAdvance( 1000 );
+    Radio.Sleep( );
+    for( uint8_t window = 0; window < 2; window++ )
+    {
+        Radio.SetChannel( ( window == 0 ) ? RF_FREQUENCY : 869525000 );
+        Radio.SetRxConfig( MODEM_LORA, 0, ( window == 0 ) ? datarate : 12, 1, 0, 8, 8, false, 0, true, false, 0, true, false );
+        Radio.SetMaxPayloadLength( MODEM_LORA, 255 );
+        Radio.Rx( 3000 );
+        TimerStubAdvance( 1000 );
+        Radio.Sleep( );
+    }
+}
+
+/*!
+ * \brief The shadow copy of the registers follows the radio through the
+ *        operating modes, the modem changes and the resets
+ */
+static void TestRegisterShadow( void )
+{
+    static const uint8_t frame[] = { 0x60, 0x04, 0x03, 0x02, 0x01, 0x00, 0x01, 0x00, 0x11, 0x22, 0x33, 0x44 };
+
+    TestCase( "SX1276 register shadow after the initialization" );
+    ResetRadio( );
+    TEST_CHECK( CheckShadow( ) > 0 );
+
+    TestCase( "SX1276 register shadow after an uplink" );
+    Uplink( 7 );
+    CheckShadow( );
+
+    TestCase( "SX1276 register shadow after a reception" );
+    Radio.SetRxConfig( MODEM_LORA, 0, 7, 1, 0, 8, 5, false, 0, false, false, 0, true, false );
+    SX1276EmuSetRxFrame( frame, sizeof( frame ), -80, 7 );
+    Radio.Rx( 3000 );
+    TimerStubAdvance( 100 );
+    TEST_CHECK_EQUAL( RxDoneCount, 1 );
+    CheckShadow( );
+
+    TestCase( "SX1276 register shadow after a CAD and a carrier sense" );
+    Radio.StartCad( );
+    TimerStubAdvance( 10 );
+    Radio.IsChannelFree( MODEM_LORA, RF_FREQUENCY, -90, 5 );
+    Radio.Random( );
+    CheckShadow( );
+
+    TestCase( "SX1276 register shadow across the modems" );
+    Radio.SetTxConfig( MODEM_FSK, 14, 25000, 0, 50000, 0, 5, false, true, false, 0, false, TX_TIMEOUT );
+    Radio.SetRxConfig( MODEM_FSK, 50000, 50000, 0, 83333, 5, 0, false, 0, true, false, 0, false, true );
+    Radio.SetMaxPayloadLength( MODEM_FSK, 255 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_ON, 0 );
+    CheckShadow( );
+    Radio.SetPublicNetwork( false );
+    Uplink( 12 );
+    TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, REG_OPMODE ) & RFLR_OPMODE_LONGRANGEMODE_ON, RFLR_OPMODE_LONGRANGEMODE_ON );
+    CheckShadow( );
+
+    TestCase( "SX1276 register shadow after a reset" );
+    SX1276Reset( );
+    for( uint16_t addr = 0; addr < 0x80; addr++ )
+    {
+        uint8_t data;
+
+        TEST_CHECK( SX1276GetShadowRegister( MODEM_FSK, addr, &data ) == false );
+        TEST_CHECK( SX1276GetShadowRegister( MODEM_LORA, addr, &data ) == false );
+    }
+    Radio.Init( &RadioEvents );
+    Radio.SetChannel( RF_FREQUENCY );
+    Radio.SetPublicNetwork( true );
+    Uplink( 9 );
+    CheckShadow( );
+}
+
+/*!
+ * \brief LoRa registers after SX1276SetTxConfig or SX1276SetRxConfig as the
+ *        driver wrote them, one register at a time, before the precomputed
+ *        profiles and the skipped writes, frequency hopping off
+ *
+ * \param [IN/OUT] regs Registers as seen in LoRa mode
+ */
+static void ReferenceLoRaConfig( uint8_t *regs, bool rx, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, uint16_t symbTimeout, bool fixLen, uint8_t payloadLen,
+                                 bool crcOn, uint32_t channel )
+{
+    uint8_t lowDatarateOptimize;
+
+    bandwidth += 7;
+    if( datarate > 12 )
+    {
+        datarate = 12;
+    }
+    else if( datarate < 6 )
+    {
+        datarate = 6;
+    }
+    if( ( ( bandwidth == 7 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
+        ( ( bandwidth == 8 ) && ( datarate == 12 ) ) )
+    {
+        lowDatarateOptimize = 0x01;
+    }
+    else
+    {
+        lowDatarateOptimize = 0x00;
+    }
+
+    regs[REG_LR_MODEMCONFIG1] = ( regs[REG_LR_MODEMCONFIG1] & RFLR_MODEMCONFIG1_BW_MASK &
+                                  RFLR_MODEMCONFIG1_CODINGRATE_MASK & RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
+                                ( bandwidth << 4 ) | ( coderate << 1 ) | fixLen;
+    if( rx == true )
+    {
+        regs[REG_LR_MODEMCONFIG2] = ( regs[REG_LR_MODEMCONFIG2] & RFLR_MODEMCONFIG2_SF_MASK &
+                                      RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK & RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) |
+                                    ( datarate << 4 ) | ( crcOn << 2 ) |
+                                    ( ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK );
+        regs[REG_LR_SYMBTIMEOUTLSB] = ( uint8_t )( symbTimeout & 0xFF );
+    }
+    else
+    {
+        regs[REG_LR_MODEMCONFIG2] = ( regs[REG_LR_MODEMCONFIG2] & RFLR_MODEMCONFIG2_SF_MASK &
+                                      RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK ) |
+                                    ( datarate << 4 ) | ( crcOn << 2 );
+    }
+    regs[REG_LR_MODEMCONFIG3] = ( regs[REG_LR_MODEMCONFIG3] & RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
+                                ( lowDatarateOptimize << 3 );
+    regs[REG_LR_PREAMBLEMSB] = ( uint8_t )( ( preambleLen >> 8 ) & 0xFF );
+    regs[REG_LR_PREAMBLELSB] = ( uint8_t )( preambleLen & 0xFF );
+
+    if( rx == true )
+    {
+        if( fixLen == true )
+        {
+            regs[REG_LR_PAYLOADLENGTH] = payloadLen;
+        }
+        if( ( bandwidth == 9 ) && ( channel > RF_MID_BAND_THRESH ) )
+        {
+            regs[REG_LR_TEST36] = 0x02;
+            regs[REG_LR_TEST3A] = 0x64;
+        }
+        else if( bandwidth == 9 )
+        {
+            regs[REG_LR_TEST36] = 0x02;
+            regs[REG_LR_TEST3A] = 0x7F;
+        }
+        else
+        {
+            regs[REG_LR_TEST36] = 0x03;
+        }
+    }
+
+    regs[REG_LR_DETECTOPTIMIZE] = ( regs[REG_LR_DETECTOPTIMIZE] & RFLR_DETECTIONOPTIMIZE_MASK ) |
+                                  ( ( datarate == 6 ) ? RFLR_DETECTIONOPTIMIZE_SF6 : RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
+    regs[REG_LR_DETECTIONTHRESHOLD] = ( datarate == 6 ) ? RFLR_DETECTIONTHRESH_SF6 : RFLR_DETECTIONTHRESH_SF7_TO_SF12;
+}
+
+/*!
+ * \brief Compares the registers of the radio, both pages, with the expected
+ *        LoRa view and the FSK page left as it was
+ */
+static void CheckConfigRegisters( const uint8_t *lora, const uint8_t *fsk )
+{
+    for( uint16_t addr = 1; addr < 0x80; addr++ )
+    {
+        if( VolatileRegister( true, addr ) == false )
+        {
+            TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, addr ), lora[addr] );
+        }
+        if( VolatileRegister( false, addr ) == false )
+        {
+            TEST_CHECK_EQUAL( SX1276EmuGetRegister( false, addr ), fsk[addr] );
+        }
+    }
+}
+
+/*!
+ * \brief SX1276SetTxConfig and SX1276SetRxConfig leave the registers as the
+ *        writes made one at a time did, for every spreading factor,
+ *        bandwidth, IQ inversion, CRC and header mode, on both sides of
+ *        RF_MID_BAND_THRESH, each configuration following the previous one
+ *        so that the writes skipped on the shadow copy are covered. The IQ
+ *        inversion itself is written by SX1276Send and SX1276SetRx.
+ */
+static void TestConfigRegisters( void )
+{
+    static const uint32_t channels[2] = { RF_FREQUENCY, 433175000 };
+    static uint8_t frame[12];
+    uint8_t lora[0x80];
+    uint8_t fsk[0x80];
+    uint32_t nbConfigs = 0;
+
+    TestCase( "SX1276 LoRa configuration registers" );
+    ResetRadio( );
+    // The output power is left out, the board writes it as before
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+
+    for( uint8_t c = 0; c < 2; c++ )
+    {
+        Radio.SetChannel( channels[c] );
+        for( uint32_t bandwidth = 0; bandwidth < 3; bandwidth++ )
+        {
+            for( uint32_t datarate = 5; datarate <= 13; datarate++ )
+            {
+                for( uint8_t options = 0; options < 8; options++ )
+                {
+                    bool iqInverted = ( options & 0x01 ) != 0;
+                    bool crcOn = ( options & 0x02 ) != 0;
+                    bool fixLen = ( options & 0x04 ) != 0;
+                    uint8_t coderate = 1 + ( ( datarate + options ) % 4 );
+                    uint16_t preambleLen = 6 + ( datarate + options ) % 4;
+                    uint16_t symbTimeout = ( ( datarate * 37 ) + options ) & 0x3FF;
+                    uint8_t payloadLen = 10 + options;
+
+                    TestCase( "SX1276 LoRa configuration registers, %u Hz, bandwidth %u, SF%u, IQ %s, CRC %s, %s header",
+                              ( unsigned )channels[c], ( unsigned )bandwidth, ( unsigned )datarate,
+                              iqInverted ? "inverted" : "normal", crcOn ? "on" : "off", fixLen ? "implicit" : "explicit" );
+                    for( uint16_t addr = 0; addr < 0x80; addr++ )
+                    {
+                        lora[addr] = SX1276EmuGetRegister( true, addr );
+                        fsk[addr] = SX1276EmuGetRegister( false, addr );
+                    }
+                    ReferenceLoRaConfig( lora, false, bandwidth, datarate, coderate, preambleLen, 0, fixLen, 0, crcOn, channels[c] );
+                    Radio.SetTxConfig( MODEM_LORA, 14, 0, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                                       false, 0, iqInverted, TX_TIMEOUT );
+                    CheckConfigRegisters( lora, fsk );
+
+                    Radio.Send( frame, fixLen ? payloadLen : sizeof( frame ) );
+                    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_INVERTIQ ) & ~RFLR_INVERTIQ_TX_MASK,
+                                      iqInverted ? RFLR_INVERTIQ_TX_ON : RFLR_INVERTIQ_TX_OFF );
+                    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_INVERTIQ2 ),
+                                      iqInverted ? RFLR_INVERTIQ2_ON : RFLR_INVERTIQ2_OFF );
+                    Radio.Sleep( );
+
+                    for( uint16_t addr = 0; addr < 0x80; addr++ )
+                    {
+                        lora[addr] = SX1276EmuGetRegister( true, addr );
+                        fsk[addr] = SX1276EmuGetRegister( false, addr );
+                    }
+                    ReferenceLoRaConfig( lora, true, bandwidth, datarate, coderate, preambleLen, symbTimeout, fixLen,
+                                         payloadLen, crcOn, channels[c] );
+                    Radio.SetRxConfig( MODEM_LORA, bandwidth, datarate, coderate, 0, preambleLen, symbTimeout, fixLen,
+                                       payloadLen, crcOn, false, 0, iqInverted, false );
+                    CheckConfigRegisters( lora, fsk );
+
+                    Radio.Rx( 3000 );
+                    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_INVERTIQ ) & ~RFLR_INVERTIQ_RX_MASK,
+                                      iqInverted ? RFLR_INVERTIQ_RX_ON : RFLR_INVERTIQ_RX_OFF );
+                    TEST_CHECK_EQUAL( SX1276EmuGetRegister( true, REG_LR_INVERTIQ2 ),
+                                      iqInverted ? RFLR_INVERTIQ2_ON : RFLR_INVERTIQ2_OFF );
+                    Radio.Sleep( );
+                    nbConfigs++;
+                }
+            }
+        }
+    }
+    printf( "SX1276 LoRa configuration registers: %u transmit and receive configurations\n", ( unsigned )nbConfigs );
+}
+
+/*!
+ * \brief The driver counts the transactions the radio sees, and a steady
+ *        state uplink takes fewer of them than before the shadow copy
+ */
+static void TestSpiTransactions( void )
+{
+    uint32_t transactions;
+    uint32_t emuTransactions;
+
+    TestCase( "SX1276 SPI transactions" );
+    ResetRadio( );
+    transactions = SX1276GetSpiTransactions( );
+    emuTransactions = SX1276EmuGetSpiTransactions( );
+    Uplink( 7 );
+    TEST_CHECK_EQUAL( SX1276GetSpiTransactions( ) - transactions, SX1276EmuGetSpiTransactions( ) - emuTransactions );
+
+    transactions = SX1276EmuGetSpiTransactions( );
+    Uplink( 7 );
+    transactions = SX1276EmuGetSpiTransactions( ) - transactions;
+    TEST_CHECK( transactions < UPLINK_SPI_TRANSACTIONS_UNCACHED );
+    printf( "SX1276 SPI transactions per uplink and receive windows: %u, %u without the register shadow\n",
+            ( unsigned )transactions, UPLINK_SPI_TRANSACTIONS_UNCACHED );
+}
+
+/*!
+ * \brief Counts the recorded SPI writes touching the given registers
+ *
+ * \param [IN] lora Page of the registers 0x0D to 0x3F [false: FSK, true: LoRa]
+ * \param [OUT] record Last of these writes
+ */
+static uint16_t CountWrites( bool lora, uint8_t first, uint8_t last, SX1276EmuSpiRecord_t *record )
+{
+    const SX1276EmuSpiRecord_t *log;
+    uint16_t count;
+    uint16_t writes = 0;
+
+    log = SX1276EmuGetSpiLog( &count );
+    for( uint16_t i = 0; i < count; i++ )
+    {
+        bool paged = ( first >= REG_PAGE_START ) && ( first <= REG_PAGE_END );
+
+        if( ( log[i].Write == true ) && ( ( paged == false ) || ( log[i].Lora == lora ) ) &&
+            ( log[i].Addr <= last ) && ( ( log[i].Addr + log[i].Size ) > first ) )
+        {
+            *record = log[i];
+            writes++;
+        }
+    }
+    return writes;
+}
+
+/*!
+ * \brief The frequency and the LoRa modem configuration go out as single
+ *        bursts, and a transfer that stops half way drops the shadow copy
+ */
+static void TestSpiBursts( void )
+{
+    static uint8_t frame[20];
+    SX1276EmuSpiRecord_t record;
+    uint8_t buffer[4];
+    uint8_t data;
+
+    TestCase( "SX1276 SPI burst of the frequency" );
+    ResetRadio( );
+    Uplink( 7 );
+    SX1276EmuClearSpiLog( );
+    Radio.SetChannel( 868300000 );
+    TEST_CHECK_EQUAL( CountWrites( false, REG_FRFMSB, REG_FRFLSB, &record ), 1 );
+    TEST_CHECK_EQUAL( record.Addr, REG_FRFMSB );
+    TEST_CHECK_EQUAL( record.Size, 3 );
+
+    TestCase( "SX1276 SPI burst of the LoRa modem configuration" );
+    SX1276EmuClearSpiLog( );
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 1, 9, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+    TEST_CHECK_EQUAL( CountWrites( true, REG_LR_MODEMCONFIG1, REG_LR_PREAMBLELSB, &record ), 1 );
+    TEST_CHECK_EQUAL( record.Addr, REG_LR_MODEMCONFIG1 );
+    TEST_CHECK_EQUAL( record.Size, 5 );
+    SX1276EmuClearSpiLog( );
+    Radio.SetRxConfig( MODEM_LORA, 0, 10, 1, 0, 8, 5, false, 0, true, false, 0, true, false );
+    TEST_CHECK_EQUAL( CountWrites( true, REG_LR_MODEMCONFIG1, REG_LR_PREAMBLELSB, &record ), 1 );
+    TEST_CHECK_EQUAL( record.Addr, REG_LR_MODEMCONFIG1 );
+    TEST_CHECK_EQUAL( record.Size, 5 );
+    SX1276EmuClearSpiLog( );
+    Radio.SetRxConfig( MODEM_LORA, 0, 10, 1, 0, 8, 5, false, 0, true, false, 0, true, false );
+    TEST_CHECK_EQUAL( CountWrites( true, REG_LR_MODEMCONFIG1, REG_LR_PREAMBLELSB, &record ), 0 );
+
+    TestCase( "SX1276 SPI burst of the FIFO" );
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+    SX1276EmuClearSpiLog( );
+    Radio.Send( frame, sizeof( frame ) );
+    TEST_CHECK_EQUAL( CountWrites( true, REG_LR_FIFO, REG_LR_FIFO, &record ), 1 );
+    TEST_CHECK_EQUAL( record.Size, sizeof( frame ) );
+    TimerStubAdvance( 1000 );
+    Radio.Sleep( );
+
+    TestCase( "SX1276 SPI transfer stopping half way" );
+    memset1( buffer, 0xFF, sizeof( buffer ) );
+    SX1276EmuFailSpi( );
+    SX1276ReadBuffer( REG_LR_MODEMCONFIG1, buffer, sizeof( buffer ) );
+    TEST_CHECK_EQUAL( buffer[0], SX1276EmuGetRegister( true, REG_LR_MODEMCONFIG1 ) );
+    TEST_CHECK_EQUAL( buffer[2], 0 );
+    TEST_CHECK_EQUAL( buffer[3], 0 );
+    TEST_CHECK( SX1276GetShadowRegister( MODEM_LORA, REG_LR_MODEMCONFIG1, &data ) == false );
+    TEST_CHECK( SX1276GetShadowRegister( MODEM_FSK, REG_OPMODE, &data ) == false );
+    SX1276EmuClearSpiLog( );
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+    TEST_CHECK_EQUAL( CountWrites( true, REG_LR_MODEMCONFIG1, REG_LR_PREAMBLELSB, &record ), 1 );
+    Uplink( 7 );
+    CheckShadow( );
+}
+
+/*!
+ * \brief EU868 join attempt at SF7, the request and both receive windows
+ *        without a join accept, then the random value of the next DevNonce
+ *
+ * The windows time out after the symbols the MAC computes with its default
+ * 10 ms error: 24 symbols at SF7 in RX1 and 6 symbols at SF12 in RX2.
+ *
+ * \retval Returns true when the random value was drawn without sampling
+ */
+static bool JoinAttempt( uint32_t *value )
+{
+    static uint8_t joinRequest[23];
+    static const uint8_t rxSf[2] = { 7, 12 };
+    static const uint16_t rxSymbols[2] = { 24, 6 };
+    TimerTime_t start;
+
+    Radio.SetTxConfig( MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, false, 0, false, TX_TIMEOUT );
+    Radio.Send( joinRequest, sizeof( joinRequest ) );
+    TimerStubAdvance( 100 );
+    for( uint8_t window = 0; window < 2; window++ )
+    {
+        Radio.SetRxConfig( MODEM_LORA, 0, rxSf[window], 1, 0, 8, rxSymbols[window], false, 0, false, false, 0, true, false );
+        Radio.Rx( 3000 );
+        TimerStubAdvance( 1000 );
+    }
+
+    start = TimerGetCurrentTime( );
+    *value = Radio.Random( );
+    return TimerGetCurrentTime( ) == start;
+}
+
+/*!
+ * \brief Returns the raw pool bits a random value was whitened from
+ *
+ * \param [IN] value Random value
+ * \param [IN] previous Random value drawn before, chained into this one
+ */
+static uint32_t Unwhiten( uint32_t value, uint32_t previous )
+{
+    // Inverse of the mixer of SX1276Random, step by step from the last one
+    value ^= value >> 16;
+    value *= 0x7ED1B41D;
+    value ^= ( value >> 13 ) ^ ( value >> 26 );
+    value *= 0xA5CB9243;
+    value ^= value >> 16;
+    return value ^ previous;
+}
+
+/*!
+ * \brief Checks that the values look uniform: their bits, each bit position,
+ *        their bytes, the bits changing from one bit to the next and from
+ *        one value to the next, the bounds being 5 standard deviations away
+ */
+static void CheckRandomStatistics( const char *name, const uint32_t *values, uint32_t nbValues )
+{
+    uint32_t positions[32] = { 0 };
+    uint32_t bytes[256] = { 0 };
+    uint64_t ones = 0;
+    uint64_t serialChanges = 0;
+    uint64_t changes = 0;
+    double bound;
+    double chiSquare = 0;
+
+    for( uint32_t i = 0; i < nbValues; i++ )
+    {
+        for( uint8_t bit = 0; bit < 32; bit++ )
+        {
+            positions[bit] += ( values[i] >> bit ) & 0x01;
+        }
+        for( uint8_t byte = 0; byte < 4; byte++ )
+        {
+            bytes[( values[i] >> ( 8 * byte ) ) & 0xFF]++;
+        }
+        ones += __builtin_popcount( values[i] );
+        serialChanges += __builtin_popcount( ( values[i] ^ ( values[i] >> 1 ) ) & 0x7FFFFFFF );
+        if( i > 0 )
+        {
+            changes += __builtin_popcount( values[i] ^ values[i - 1] );
+        }
+    }
+
+    bound = 5 * sqrt( 32.0 * nbValues ) / 2;
+    TEST_CHECK( fabs( ones - 16.0 * nbValues ) < bound );
+    TEST_CHECK( fabs( changes - 16.0 * ( nbValues - 1 ) ) < bound );
+    TEST_CHECK( fabs( serialChanges - 15.5 * nbValues ) < bound );
+    bound = 5 * sqrt( nbValues ) / 2;
+    for( uint8_t bit = 0; bit < 32; bit++ )
+    {
+        TEST_CHECK( fabs( positions[bit] - nbValues / 2.0 ) < bound );
+    }
+    // 255 degrees of freedom, standard deviation sqrt( 2 * 255 )
+    for( uint16_t i = 0; i < 256; i++ )
+    {
+        double expected = 4.0 * nbValues / 256;
+
+        chiSquare += ( bytes[i] - expected ) * ( bytes[i] - expected ) / expected;
+    }
+    TEST_CHECK( chiSquare < ( 255 + 5 * sqrt( 2 * 255 ) ) );
+    printf( "SX1276 %s: %u values, %.4f of the bits at 1, %.4f changing from one bit to the next, "
+            "byte chi-square %.1f for 255 degrees of freedom\n",
+            name, ( unsigned )nbValues, ( double )ones / ( 32.0 * nbValues ),
+            ( double )serialChanges / ( 31.0 * nbValues ), chiSquare );
+}
+
+/*!
+ * \brief Draws NB_RANDOM random values after join attempts and recovers the
+ *        raw pool bits of each one into RawValues
+ *
+ * \retval Returns the number of values drawn with the sampling loop
+ */
+static uint32_t DrawJoinValues( void )
+{
+    uint32_t previous = Radio.Random( );
+    uint32_t nbBlocking = 0;
+
+    for( uint32_t i = 0; i < NB_RANDOM; i++ )
+    {
+        nbBlocking += ( JoinAttempt( &RandomValues[i] ) == false ) ? 1 : 0;
+        RawValues[i] = Unwhiten( RandomValues[i], previous );
+        previous = RandomValues[i];
+    }
+    return nbBlocking;
+}
+
+/*!
+ * \brief Random values drawn from the wideband RSSI sampled in the receive
+ *        windows of the join attempts, without the sampling loop of
+ *        SX1276Random
+ */
+static void TestRandom( void )
+{
+    TimerTime_t start;
+    uint64_t ones = 0;
+    double bound;
+
+    TestCase( "SX1276 random value without reception" );
+    ResetRadio( );
+    Radio.Random( );
+    // No reception since the last value, the 32 bits are sampled 1 ms apart
+    start = TimerGetCurrentTime( );
+    Radio.Random( );
+    TEST_CHECK( ( TimerGetCurrentTime( ) - start ) >= 32 );
+    TEST_CHECK( ( TimerGetCurrentTime( ) - start ) <= 33 );
+
+    TestCase( "SX1276 random values of the join attempts" );
+    TEST_CHECK_EQUAL( DrawJoinValues( ), 0 );
+    // Every sample was taken while the radio received
+    TEST_CHECK_EQUAL( SX1276EmuGetWidebandReads( false ), 0 );
+    TEST_CHECK( SX1276EmuGetWidebandReads( true ) >= ( 32 * NB_RANDOM ) );
+    // The samples themselves, before the whitening, and the values
+    CheckRandomStatistics( "raw pool bits", RawValues, NB_RANDOM );
+    CheckRandomStatistics( "random values", RandomValues, NB_RANDOM );
+
+    // The whitening hides a biased noise, the raw pool bits show it
+    TestCase( "SX1276 random values of a biased noise" );
+    ResetRadio( );
+    SX1276EmuSetWidebandNoise( 0x2545F491, 80 );
+    TEST_CHECK_EQUAL( DrawJoinValues( ), 0 );
+    for( uint32_t i = 0; i < NB_RANDOM; i++ )
+    {
+        ones += __builtin_popcount( RawValues[i] );
+    }
+    bound = 5 * sqrt( 32.0 * NB_RANDOM * 0.8 * 0.2 );
+    TEST_CHECK( fabs( ones - 32.0 * NB_RANDOM * 0.8 ) < bound );
+    printf( "SX1276 raw pool bits of a biased noise: %.4f of the bits at 1\n", ( double )ones / ( 32.0 * NB_RANDOM ) );
+}
+
+int main( void )
+{
+    srand1( 1 );
+
+    TestInit( );
+    TestTimeOnAir( );
+    TestFskTimeOnAir( );
+    TestTx( );
+    TestRx( );
+    TestFskStandby( );
+    TestChannelActivity( );
+    TestRegisterShadow( );
+    TestConfigRegisters( );
+    TestSpiTransactions( );
+    TestSpiBursts( );
+    TestRandom( );
+
+    return TestSummary( );
+}
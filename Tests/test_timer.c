@@ -0,0 +1,367 @@
+ /******************************************************************************
+  * @file    test_timer.c
+  * @brief   host test of the timer server on the RTC stub, the wake-ups it
+  *          coalesces within the slack of the timers
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "hw.h"
+#include "utilities.h"
+#include "timeServer.h"
+#include "rtc_stub.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define HOUR                                        3600000
+
+#define NB_TIMERS                                   3
+
+#define NB_PERIODIC_TIMERS                          5
+
+/* Private typedef -----------------------------------------------------------*/
+
+typedef struct sExpiry
+{
+    TimerEvent_t Timer;
+    uint32_t Count;
+    uint32_t Time;
+    uint32_t Spend;
+}Expiry_t;
+
+/*!
+ * Timer restarted from its callback, as the application timers are
+ */
+typedef struct sPeriodicTimer
+{
+    const char* Name;
+    uint32_t Period;
+    uint32_t Slack;
+    TimerEvent_t Timer;
+    uint32_t Due;
+    uint32_t Count;
+    uint32_t MaxLateness;
+}PeriodicTimer_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static Expiry_t Expiries[NB_TIMERS];
+
+/*!
+ * Timers of an End_Node like application [ms]
+ */
+static PeriodicTimer_t PeriodicTimers[NB_PERIODIC_TIMERS] =
+{
+    { "application uplink", 10000, 1000 },
+    { "sensor measure", 2000, 200 },
+    // MAC_STATE_CHECK_TIMEOUT and MAC_STATE_CHECK_SLACK
+    { "MAC state check", 5000, 50 },
+    { "LED blink", 1000, 50 },
+    { "battery level", 60000, 5000 },
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void OnExpiry( uint8_t i )
+{
+    Expiries[i].Count++;
+    Expiries[i].Time = RtcStubNow( );
+    RtcStubSpend( Expiries[i].Spend );
+}
+
+static void OnExpiry0( void )
+{
+    OnExpiry( 0 );
+}
+
+static void OnExpiry1( void )
+{
+    OnExpiry( 1 );
+}
+
+static void OnExpiry2( void )
+{
+    OnExpiry( 2 );
+}
+
+static void (* const ExpiryCallbacks[NB_TIMERS] )( void ) = { OnExpiry0, OnExpiry1, OnExpiry2 };
+
+static void ResetTimers( void )
+{
+    RtcStubReset( 0 );
+    for( uint8_t i = 0; i < NB_TIMERS; i++ )
+    {
+        TimerStop( &Expiries[i].Timer );
+        TimerInit( &Expiries[i].Timer, ExpiryCallbacks[i] );
+        Expiries[i].Count = 0;
+        Expiries[i].Time = 0;
+        Expiries[i].Spend = 0;
+    }
+}
+
+static void StartTimer( uint8_t i, uint32_t value, uint32_t slack )
+{
+    TimerSetValue( &Expiries[i].Timer, value );
+    TimerSetSlack( &Expiries[i].Timer, slack );
+    TimerStart( &Expiries[i].Timer );
+}
+
+static void StartPeriodicTimer( PeriodicTimer_t* periodic )
+{
+    periodic->Due = RtcStubNow( ) + HW_RTC_ms2Tick( periodic->Period );
+    TimerStart( &periodic->Timer );
+}
+
+static void OnPeriodicTimer( uint8_t i )
+{
+    PeriodicTimer_t* periodic = &PeriodicTimers[i];
+
+    TEST_CHECK( ( int32_t )( RtcStubNow( ) - periodic->Due ) >= 0 );
+    periodic->MaxLateness = MAX( periodic->MaxLateness, RtcStubNow( ) - periodic->Due );
+    periodic->Count++;
+    StartPeriodicTimer( periodic );
+}
+
+static void OnPeriodicTimer0( void )
+{
+    OnPeriodicTimer( 0 );
+}
+
+static void OnPeriodicTimer1( void )
+{
+    OnPeriodicTimer( 1 );
+}
+
+static void OnPeriodicTimer2( void )
+{
+    OnPeriodicTimer( 2 );
+}
+
+static void OnPeriodicTimer3( void )
+{
+    OnPeriodicTimer( 3 );
+}
+
+static void OnPeriodicTimer4( void )
+{
+    OnPeriodicTimer( 4 );
+}
+
+static void (* const PeriodicCallbacks[NB_PERIODIC_TIMERS] )( void ) =
+{
+    OnPeriodicTimer0, OnPeriodicTimer1, OnPeriodicTimer2, OnPeriodicTimer3, OnPeriodicTimer4
+};
+
+/*!
+ * \brief A timer with slack waits for the exact timer due within its slack,
+ *        one beyond it gets its own wake-up
+ */
+static void TestSlackBatching( void )
+{
+    TestCase( "Timer expiring within the slack of the head" );
+    ResetTimers( );
+    StartTimer( 0, 100, 20 );
+    StartTimer( 1, 110, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 1 );
+    TEST_CHECK_EQUAL( Expiries[0].Count, 1 );
+    TEST_CHECK_EQUAL( Expiries[1].Count, 1 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 110 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 110 ) );
+
+    TestCase( "Timers with slack expiring within each other's slack" );
+    ResetTimers( );
+    StartTimer( 0, 100, 50 );
+    StartTimer( 1, 120, 10 );
+    StartTimer( 2, 125, 100 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 1 );
+    for( uint8_t i = 0; i < NB_TIMERS; i++ )
+    {
+        TEST_CHECK_EQUAL( Expiries[i].Count, 1 );
+        // The earliest latest expiry of the three
+        TEST_CHECK_EQUAL( Expiries[i].Time, HW_RTC_ms2Tick( 120 ) + HW_RTC_ms2Tick( 10 ) );
+    }
+
+    TestCase( "Timer expiring beyond the slack of the head" );
+    ResetTimers( );
+    StartTimer( 0, 100, 20 );
+    StartTimer( 1, 150, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 2 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 100 ) + HW_RTC_ms2Tick( 20 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 150 ) );
+
+    TestCase( "Timers without slack" );
+    ResetTimers( );
+    StartTimer( 0, 100, 0 );
+    StartTimer( 1, 110, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 2 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 100 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 110 ) );
+}
+
+/*!
+ * \brief TimerStart brings the deferred alarm of the head forward for a
+ *        timer due before it
+ */
+static void TestStartRearm( void )
+{
+    TestCase( "Timer started before the deferred alarm" );
+    ResetTimers( );
+    StartTimer( 0, 100, 50 );
+    StartTimer( 1, 120, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 1 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 120 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 120 ) );
+
+    TestCase( "Timer started later, before the deferred alarm" );
+    ResetTimers( );
+    StartTimer( 0, 100, 50 );
+    RtcStubRun( HW_RTC_ms2Tick( 40 ) );
+    StartTimer( 1, 70, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 1 );
+    TEST_CHECK_EQUAL( Expiries[0].Count, 1 );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 40 ) + HW_RTC_ms2Tick( 70 ) );
+
+    TestCase( "Timer started after the deferred alarm" );
+    ResetTimers( );
+    StartTimer( 0, 100, 50 );
+    StartTimer( 1, 200, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 2 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 100 ) + HW_RTC_ms2Tick( 50 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 200 ) );
+}
+
+/*!
+ * \brief The timers due at the very tick of the wake-up are served by it,
+ *        without a wake-up of the minimum timeout after
+ */
+static void TestSameTickExpiry( void )
+{
+    TestCase( "Timers expiring on the same tick" );
+    ResetTimers( );
+    StartTimer( 0, 100, 0 );
+    StartTimer( 1, 100, 0 );
+    StartTimer( 2, 100, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 1 );
+    for( uint8_t i = 0; i < NB_TIMERS; i++ )
+    {
+        TEST_CHECK_EQUAL( Expiries[i].Count, 1 );
+        TEST_CHECK_EQUAL( Expiries[i].Time, HW_RTC_ms2Tick( 100 ) );
+    }
+}
+
+/*!
+ * \brief Timers due within the minimum timeout of a wake-up are served
+ *        after it, the alarm is never set closer
+ */
+static void TestMinimumTimeout( void )
+{
+    TestCase( "Timers due within the minimum timeout" );
+    ResetTimers( );
+    StartTimer( 0, 10, 0 );
+    StartTimer( 1, 11, 0 );
+    StartTimer( 2, 12, 0 );
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubMissedAlarms( ), 0 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 2 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 10 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 10 ) + RTC_STUB_MIN_ALARM_DELAY );
+    TEST_CHECK_EQUAL( Expiries[2].Time, HW_RTC_ms2Tick( 10 ) + RTC_STUB_MIN_ALARM_DELAY );
+
+    TestCase( "Timers due within the minimum timeout of a long callback" );
+    ResetTimers( );
+    StartTimer( 0, 100, 0 );
+    StartTimer( 1, 105, 20 );
+    StartTimer( 2, 106, 0 );
+    // The callback of the first timer runs until 1 tick before the second
+    Expiries[0].Spend = HW_RTC_ms2Tick( 105 ) - HW_RTC_ms2Tick( 100 ) - 1;
+    RtcStubRun( 1024 );
+    TEST_CHECK_EQUAL( RtcStubMissedAlarms( ), 0 );
+    TEST_CHECK_EQUAL( RtcStubWakeUps( ), 2 );
+    TEST_CHECK_EQUAL( Expiries[0].Time, HW_RTC_ms2Tick( 100 ) );
+    TEST_CHECK_EQUAL( Expiries[1].Time, HW_RTC_ms2Tick( 105 ) - 1 + RTC_STUB_MIN_ALARM_DELAY );
+    TEST_CHECK_EQUAL( Expiries[2].Time, HW_RTC_ms2Tick( 105 ) - 1 + RTC_STUB_MIN_ALARM_DELAY );
+}
+
+/*!
+ * \brief Runs the periodic timers for an hour
+ *
+ * \retval Returns the number of wake-ups
+ */
+static uint32_t RunPeriodicTimers( bool slack )
+{
+    TestCase( "Periodic timers %s slack", slack ? "with" : "without" );
+    RtcStubReset( 0 );
+    for( uint8_t i = 0; i < NB_PERIODIC_TIMERS; i++ )
+    {
+        PeriodicTimer_t* periodic = &PeriodicTimers[i];
+
+        TimerInit( &periodic->Timer, PeriodicCallbacks[i] );
+        TimerSetValue( &periodic->Timer, periodic->Period );
+        TimerSetSlack( &periodic->Timer, slack ? periodic->Slack : 0 );
+        periodic->Count = 0;
+        periodic->MaxLateness = 0;
+        // Started at unrelated times
+        RtcStubRun( HW_RTC_ms2Tick( 137 ) );
+        StartPeriodicTimer( periodic );
+    }
+    RtcStubRun( HW_RTC_ms2Tick( HOUR ) );
+
+    TEST_CHECK_EQUAL( RtcStubMissedAlarms( ), 0 );
+    for( uint8_t i = 0; i < NB_PERIODIC_TIMERS; i++ )
+    {
+        PeriodicTimer_t* periodic = &PeriodicTimers[i];
+
+        TEST_CHECK( periodic->Count > 0 );
+        TEST_CHECK( periodic->MaxLateness <= ( HW_RTC_ms2Tick( slack ? periodic->Slack : 0 ) + RTC_STUB_MIN_ALARM_DELAY ) );
+        TimerStop( &periodic->Timer );
+    }
+    return RtcStubWakeUps( );
+}
+
+static void TestWakeUpsPerHour( void )
+{
+    uint32_t exact = RunPeriodicTimers( false );
+    uint32_t coalesced = RunPeriodicTimers( true );
+
+    TestCase( "Wake-ups per hour" );
+    TEST_CHECK( coalesced < exact );
+    printf( "Timers of %u periodic tasks: %u wake-ups per hour without slack, %u with\n",
+            NB_PERIODIC_TIMERS, ( unsigned )exact, ( unsigned )coalesced );
+    for( uint8_t i = 0; i < NB_PERIODIC_TIMERS; i++ )
+    {
+        printf( "  %-20s every %5u ms, slack %4u ms, at most %3u ms late\n", PeriodicTimers[i].Name,
+                ( unsigned )PeriodicTimers[i].Period, ( unsigned )PeriodicTimers[i].Slack,
+                ( unsigned )HW_RTC_Tick2ms( PeriodicTimers[i].MaxLateness ) );
+    }
+}
+
+int main( void )
+{
+    TestSlackBatching( );
+    TestStartRearm( );
+    TestSameTickExpiry( );
+    TestMinimumTimeout( );
+    TestWakeUpsPerHour( );
+
+    return TestSummary( );
+}
@@ -0,0 +1,166 @@
+ /******************************************************************************
+  * @file    trace_decode.c
+  * @brief   host decoder of the AT+TRACE dump
+  ******************************************************************************
+  * @attention
+  *
+  * Not part of the STMicroelectronics I-CUBE-LRWAN package, written for this
+  * firmware on top of it.
+  *
+  * License: Revised BSD License, see LICENSE.TXT file include in the project
+  *
+  ******************************************************************************
+  */
+
+/*
+ * Reads the answer of AT+TRACE? on the standard input, e.g.
+ *
+ *   +OK=0001a2b30300012c,0001a2c0000a0001
+ *
+ * and prints one line per entry with the time since the first entry, the
+ * time since the previous entry, the event and its arguments.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+/* Private define ------------------------------------------------------------*/
+/* RTC ticks per second, 1 << N_PREDIV_S of hw_rtc.c */
+#define TRACE_TICKS_PER_SECOND           1024
+
+/* The time stamps wrap around every hour */
+#define TRACE_TIME_PERIOD                ( 3600UL * TRACE_TICKS_PER_SECOND )
+
+/* Characters of an entry in the dump */
+#define TRACE_ENTRY_LENGTH               16
+
+/* Private variables ---------------------------------------------------------*/
+static const char *Trace_EventNames[TRACE_EVENT_MAX] =
+{
+  [TRACE_RADIO_OPMODE]   = "RADIO_OPMODE",
+  [TRACE_RADIO_DIO]      = "RADIO_DIO",
+  [TRACE_RADIO_TIMEOUT]  = "RADIO_TIMEOUT",
+  [TRACE_RADIO_SET_RX]   = "RADIO_SET_RX",
+  [TRACE_RADIO_SET_TX]   = "RADIO_SET_TX",
+  [TRACE_MAC_RX_WINDOW]  = "MAC_RX_WINDOW",
+  [TRACE_MAC_TX_TIMEOUT] = "MAC_TX_TIMEOUT",
+  [TRACE_MAC_RX_TIMEOUT] = "MAC_RX_TIMEOUT",
+  [TRACE_MAC_RX_ERROR]   = "MAC_RX_ERROR",
+  [TRACE_RADIO_SPI_ERROR] = "RADIO_SPI_ERROR",
+};
+
+static const char *Trace_ArgNames[TRACE_EVENT_MAX][2] =
+{
+  [TRACE_RADIO_OPMODE]   = { "opmode", "modem" },
+  [TRACE_RADIO_DIO]      = { "dio", "state" },
+  [TRACE_RADIO_TIMEOUT]  = { "state", NULL },
+  [TRACE_RADIO_SET_RX]   = { "continuous", "timeout_ms" },
+  [TRACE_RADIO_SET_TX]   = { NULL, "timeout_ms" },
+  [TRACE_MAC_RX_WINDOW]  = { "slot", "delay_ms" },
+  [TRACE_MAC_TX_TIMEOUT] = { NULL, NULL },
+  [TRACE_MAC_RX_TIMEOUT] = { "slot", NULL },
+  [TRACE_MAC_RX_ERROR]   = { "slot", NULL },
+  [TRACE_RADIO_SPI_ERROR] = { "addr", "size" },
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static int Trace_Parse( const char *text, Trace_Entry_t *entry )
+{
+  char field[9];
+  unsigned long value;
+
+  if( strspn( text, "0123456789abcdefABCDEF" ) < TRACE_ENTRY_LENGTH )
+  {
+    return -1;
+  }
+  memcpy( field, text, 8 );
+  field[8] = '\0';
+  entry->Time = ( uint32_t )strtoul( field, NULL, 16 );
+
+  memcpy( field, text + 8, 8 );
+  value = strtoul( field, NULL, 16 );
+  entry->Event = ( uint8_t )( value >> 24 );
+  entry->Arg1 = ( uint8_t )( value >> 16 );
+  entry->Arg2 = ( uint16_t )value;
+  return 0;
+}
+
+static void Trace_Print( const Trace_Entry_t *entry, unsigned long elapsed, unsigned long delta )
+{
+  const char *name = "UNKNOWN";
+  const char *arg1 = "arg1";
+  const char *arg2 = "arg2";
+
+  if( entry->Event < TRACE_EVENT_MAX )
+  {
+    name = Trace_EventNames[entry->Event];
+    arg1 = Trace_ArgNames[entry->Event][0];
+    arg2 = Trace_ArgNames[entry->Event][1];
+  }
+
+  printf( "%10.3f ms (+%9.3f) %-15s", elapsed * 1000.0 / TRACE_TICKS_PER_SECOND,
+          delta * 1000.0 / TRACE_TICKS_PER_SECOND, name );
+  if( arg1 != NULL )
+  {
+    printf( " %s=%u", arg1, entry->Arg1 );
+  }
+  if( arg2 != NULL )
+  {
+    printf( " %s=%u", arg2, entry->Arg2 );
+  }
+  printf( "\n" );
+}
+
+int main( void )
+{
+  static char line[8192];
+  Trace_Entry_t entry;
+  uint32_t previous = 0;
+  unsigned long elapsed = 0;
+  unsigned long delta;
+  unsigned count = 0;
+  char *text;
+
+  while( fgets( line, sizeof( line ), stdin ) != NULL )
+  {
+    text = strstr( line, "+OK=" );
+    if( text == NULL )
+    {
+      continue;
+    }
+    text += 4;
+
+    while( Trace_Parse( text, &entry ) == 0 )
+    {
+      if( count == 0 )
+      {
+        previous = entry.Time;
+      }
+      /* unwrap the hourly time stamps, entries are at most a few ticks
+       * out of order */
+      delta = ( entry.Time + TRACE_TIME_PERIOD - previous ) % TRACE_TIME_PERIOD;
+      if( delta > ( TRACE_TIME_PERIOD / 2 ) )
+      {
+        delta = 0;
+      }
+      elapsed += delta;
+      previous = entry.Time;
+
+      Trace_Print( &entry, elapsed, delta );
+      count++;
+
+      text += TRACE_ENTRY_LENGTH;
+      if( *text != ',' )
+      {
+        break;
+      }
+      text++;
+    }
+  }
+
+  return ( count == 0 ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}